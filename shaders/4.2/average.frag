@@ -4,13 +4,25 @@ layout (location = 0) in vec2 uv;
 
 layout (location = 0) out vec4 out_pixel;
 
-layout (location = 0) uniform sampler2D color[2];
-layout (location = 2) uniform uint frame;
+// rgb: sum of the frame estimates, a: frames
+layout (location = 0) uniform sampler2D accumulation;
+// z: relative standard error of the mean
+layout (location = 1) uniform sampler2D moments;
+layout (location = 2) uniform float threshold;
+layout (location = 3) uniform bool show_convergence;
+// shows the output of the denoiser instead of the accumulation
+layout (location = 4) uniform bool is_denoised;
+layout (location = 5) uniform sampler2D denoised;
 
 void main() {
-    const vec3 old = texture(color[0], uv).rgb;
-    const vec3 new = texture(color[1], uv).rgb;
-
-    const float weight = 1.0 / float(frame + 1);
-    out_pixel = vec4(mix(old, new, weight), 1.0);
+    const vec4 sum = texture(accumulation, uv);
+    vec3 color = is_denoised ? texture(denoised, uv).rgb : sum.rgb / max(sum.a, 1.0);
+    if (show_convergence) {
+        // converged pixels are dimmed, the others go from yellow to red with their error
+        const float error = texture(moments, uv).z;
+        color = error < threshold
+            ? color * 0.25
+            : mix(vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), clamp(error / threshold - 1.0, 0.0, 1.0));
+    }
+    out_pixel = vec4(color, 1.0);
 }
@@ -0,0 +1,23 @@
+// shared by the trace passes and the denoiser
+
+struct camera_data_t {
+    mat4 inv_pv;
+    // of the last frame, the denoiser reprojects its history with them
+    mat4 prev_pv;
+    mat4 prev_inv_pv;
+};
+
+layout (std140, binding = 0) uniform camera_buffer_t {
+    camera_data_t camera;
+};
+
+// the ray through a position in pixels, pixel centers are at .5 like gl_FragCoord
+void camera_ray(in mat4 inv_pv, in vec2 position, in vec2 resolution, out vec3 origin, out vec3 direction) {
+    const vec2 ndc_uv = 2.0 * (position / (resolution - 1)) - 1.0;
+    vec4 world_near = inv_pv * vec4(ndc_uv, -1.0, 1.0);
+    vec4 world_far = inv_pv * vec4(ndc_uv, 1.0, 1.0);
+    world_near /= world_near.w;
+    world_far /= world_far.w;
+    origin = vec3(world_near);
+    direction = normalize(vec3(world_far - world_near));
+}
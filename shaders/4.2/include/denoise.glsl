@@ -0,0 +1,33 @@
+// shared by the denoiser passes. they filter the illumination, the color divided by the albedo of the primary hit,
+// guided by the normals and distances of the primary hits, see primary_surface
+
+#include "camera.glsl"
+
+// keeps black surfaces from dividing by zero, the albedo is multiplied back in with the same bound
+const float MIN_ALBEDO = 0.01;
+// largest distance of a point from the plane of another one that still counts as the same surface, relative to
+// the distance from the camera
+const float PLANE_DISTANCE = 0.01;
+const float NORMAL_SIMILARITY = 0.9;
+
+float luminance(in vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// the primary hit of a pixel from its distance along the ray through the pixel center, see primary_surface. the sky
+// has no point, it is a direction with w = 0 instead
+vec4 pixel_point(in mat4 inv_pv, in ivec2 pixel, in vec2 resolution, in float depth) {
+    vec3 origin;
+    vec3 direction;
+    camera_ray(inv_pv, vec2(pixel) + 0.5, resolution, origin, direction);
+    return depth == 0.0 ? vec4(direction, 0.0) : vec4(origin + depth * direction, 1.0);
+}
+
+// xyz: normal, w: distance or 0 for the sky. the sky only matches the sky
+bool is_same_surface(in vec4 surface, in vec4 point, in vec4 other, in vec4 other_point) {
+    if (surface.w == 0.0 || other.w == 0.0) {
+        return surface.w == other.w;
+    }
+    return dot(surface.xyz, other.xyz) > NORMAL_SIMILARITY &&
+        abs(dot(other_point.xyz - point.xyz, surface.xyz)) < PLANE_DISTANCE * surface.w;
+}
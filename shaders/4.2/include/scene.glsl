@@ -0,0 +1,847 @@
+// scene, materials and intersection code shared by the megakernel in trace.frag and the wavefront passes
+
+/*struct camera_data_t {
+    float aspect;
+    float focal_length;
+    float viewport_height;
+    float viewport_width;
+    vec4 origin;
+    vec4 horizontal;
+    vec4 vertical;
+    vec4 lower_left_corner;
+};*/
+
+#include "camera.glsl"
+
+struct ray_t {
+    vec3 origin;
+    vec3 direction;
+};
+
+vec3 ray_hit(in ray_t ray, in float t) {
+    return ray.origin + t * ray.direction;
+}
+
+const uint E_HITTABLE_NONE = 0;
+const uint E_HITTABLE_SPHERE = 1;
+const uint E_HITTABLE_TRIANGLE = 2;
+
+struct hittable_t {
+    uint type;
+};
+
+struct sphere_t {
+    hittable_t hittable;
+    vec3 center;
+    float radius;
+    uint material_id;
+    // index into lights for spheres that emit, -1 otherwise
+    uint light_id;
+};
+
+struct _proxy_hittable_t {
+    // should be the max size of all hittable types or more
+    uint[8] _data;
+};
+
+struct hit_record_t {
+    float t;
+    vec3 point;
+    vec3 normal;
+    bool front_face;
+    uint material_id;
+    // modulates the albedo of the material, -1 without one
+    uint texture;
+    vec2 uv;
+    // light_id of the sphere that was hit, -1 for everything that does not emit
+    uint light;
+};
+
+layout (std430, binding = 1) readonly restrict buffer hittable_buffer_t {
+    _proxy_hittable_t[] hittables;
+};
+
+struct bvh_node_t {
+    vec3 min;
+    // leaves: first hittable, inner nodes: index of the second child, the first one follows the node
+    uint offset;
+    vec3 max;
+    // hittables of a leaf, 0 for inner nodes
+    uint count;
+};
+
+layout (std430, binding = 3) readonly restrict buffer bvh_buffer_t {
+    bvh_node_t[] nodes;
+};
+
+// bvh_max_depth - 1 in bvh.hpp, the host never builds a deeper tree
+const uint BVH_STACK_SIZE = 32;
+const float INFINITY = uintBitsToFloat(0x7f800000u);
+
+// object space, e1 and e2 are the edges from v0
+struct triangle_t {
+    vec4 v0;
+    vec4 e1;
+    vec4 e2;
+};
+
+// uv[0] holds the first two vertices, uv[1].xy the third
+struct triangle_attributes_t {
+    vec4[3] normals;
+    vec4[2] uv;
+};
+
+struct instance_t {
+    mat4 world_to_object;
+    uint node_offset;
+    uint triangle_offset;
+    uint diffuse_texture;
+    // only set for textures that are not opaque
+    uint alpha_texture;
+};
+
+layout (std430, binding = 4) readonly restrict buffer tlas_buffer_t {
+    bvh_node_t[] tlas_nodes;
+};
+
+layout (std430, binding = 5) readonly restrict buffer instance_buffer_t {
+    instance_t[] instances;
+};
+
+// BLAS node and triangle offsets are relative to the ones of their instance
+layout (std430, binding = 6) readonly restrict buffer blas_buffer_t {
+    bvh_node_t[] blas_nodes;
+};
+
+layout (std430, binding = 7) readonly restrict buffer triangle_buffer_t {
+    triangle_t[] triangles;
+};
+
+layout (std430, binding = 8) readonly restrict buffer triangle_attribute_buffer_t {
+    triangle_attributes_t[] triangle_attributes;
+};
+
+layout (std430, binding = 9) readonly restrict buffer texture_buffer_t {
+    sampler2D[] textures;
+};
+
+const uint E_MATERIAL_NONE = 0;
+const uint E_MATERIAL_LAMBERTIAN = 1;
+const uint E_MATERIAL_METAL = 2;
+const uint E_MATERIAL_DIELECTRIC = 3;
+
+struct material_t {
+    uint type;
+};
+
+struct lambertian_t {
+    material_t material;
+    vec3 albedo;
+    vec3 emissive;
+    float e_strength;
+};
+
+struct metal_t {
+    material_t material;
+    vec3 albedo;
+    float fuzz;
+};
+
+struct dielectric_t {
+    material_t material;
+    float refr_index;
+};
+
+struct _proxy_material_t {
+    // should be the max size of all material types or more
+    uint[8] _data;
+};
+
+layout (std430, binding = 2) readonly restrict buffer material_buffer_t {
+    _proxy_material_t[] materials;
+};
+
+layout (location = 3) uniform uint triangle_material;
+
+const float PI = 3.14159265358979;
+
+const uint E_INTEGRATOR_LIGHT_SAMPLING = 1;
+const uint E_INTEGRATOR_RUSSIAN_ROULETTE = 2;
+
+// E_INTEGRATOR_* bits
+layout (location = 6) uniform uint integrator;
+
+// an emissive sphere, the list is built on the CPU from the lambertians that emit
+struct light_t {
+    vec3 center;
+    float radius;
+    // emissive * e_strength
+    vec3 radiance;
+    uint _pad0;
+};
+
+layout (std430, binding = 15) readonly restrict buffer light_buffer_t {
+    uint light_count;
+    light_t[] lights;
+};
+
+bool near_zero(in vec3 v) {
+    return all(lessThan(abs(v), vec3(1e-8)));
+}
+
+uint wang_hash(in uint seed) {
+    seed = (seed ^ 61u) ^ (seed >> 16u);
+    seed *= 9u;
+    seed = seed ^ (seed >> 4u);
+    seed *= 0x27d4eb2du;
+    seed = seed ^ (seed >> 15u);
+    return 1u + seed;
+}
+
+uint xorshift32(uint state) {
+    uint x = state;
+    x ^= x << 13u;
+    x ^= x >> 17u;
+    x ^= x << 5u;
+    return x;
+}
+
+uint pcg(inout uint state) {
+    state = state * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random(inout uint state) {
+    state = pcg(state);
+    return float(state) / float(uint(-1));
+}
+
+float random(inout uint state, in float min, in float max) {
+    return min + (max - min) * random(state);
+}
+
+vec2 random_vec2(inout uint state) {
+    return vec2(random(state), random(state));
+}
+
+vec2 random_vec2(inout uint state, in float min, in float max) {
+    return min + (max - min) * random_vec2(state);
+}
+
+vec3 random_vec3(inout uint state) {
+    return vec3(random(state), random(state), random(state));
+}
+
+vec3 random_vec3(inout uint state, in float min, in float max) {
+    return min + (max - min) * random_vec3(state);
+}
+
+vec4 random_vec4(inout uint state) {
+    return vec4(random(state), random(state), random(state), random(state));
+}
+
+vec4 random_vec4(inout uint state, in float min, in float max) {
+    return min + (max - min) * random_vec4(state);
+}
+
+vec3 random_in_unit_sphere(inout uint state) {
+    for (uint i = 0; i < 16; ++i) {
+        const vec3 p = random_vec3(state, -1.0, 1.0);
+        if (dot(p, p) >= 1.0) {
+            continue;
+        }
+        return p;
+    }
+    return random_vec3(state, -1.0, 1.0) / 4.0;
+}
+
+vec3 random_in_hemisphere(inout uint state, in vec3 normal) {
+    const vec3 in_unit_sphere = random_in_unit_sphere(state);
+    if (dot(in_unit_sphere, normal) > 0.0) {
+        return in_unit_sphere;
+    }
+    return -in_unit_sphere;
+}
+
+uint as_type_from_hittable_proxy(in _proxy_hittable_t proxy) {
+    return proxy._data[0];
+}
+
+sphere_t as_sphere_from_hittable_proxy(in _proxy_hittable_t proxy) {
+    sphere_t sphere;
+    sphere.hittable.type = proxy._data[0];
+    sphere.center = vec3(
+        uintBitsToFloat(proxy._data[1]),
+        uintBitsToFloat(proxy._data[2]),
+        uintBitsToFloat(proxy._data[3]));
+    sphere.radius = uintBitsToFloat(proxy._data[4]);
+    sphere.material_id = proxy._data[5];
+    sphere.light_id = proxy._data[6];
+    return sphere;
+}
+
+uint as_type_from_material_proxy(in _proxy_material_t proxy) {
+    return proxy._data[0];
+}
+
+lambertian_t as_lambertian_from_material_proxy(in _proxy_material_t proxy) {
+    lambertian_t lambertian;
+    lambertian.material.type = proxy._data[0];
+    lambertian.albedo = vec3(
+        uintBitsToFloat(proxy._data[1]),
+        uintBitsToFloat(proxy._data[2]),
+        uintBitsToFloat(proxy._data[3]));
+    lambertian.emissive = vec3(
+        uintBitsToFloat(proxy._data[4]),
+        uintBitsToFloat(proxy._data[5]),
+        uintBitsToFloat(proxy._data[6]));
+    lambertian.e_strength = uintBitsToFloat(proxy._data[7]);
+    return lambertian;
+}
+
+metal_t as_metal_from_material_proxy(in _proxy_material_t proxy) {
+    metal_t metal;
+    metal.material.type = proxy._data[0];
+    metal.albedo = vec3(
+        uintBitsToFloat(proxy._data[1]),
+        uintBitsToFloat(proxy._data[2]),
+        uintBitsToFloat(proxy._data[3]));
+    metal.fuzz = uintBitsToFloat(proxy._data[4]);
+    return metal;
+}
+
+dielectric_t as_dielectric_from_material_proxy(in _proxy_material_t proxy) {
+    dielectric_t dielectric;
+    dielectric.material.type = proxy._data[0];
+    dielectric.refr_index = uintBitsToFloat(proxy._data[1]);
+    return dielectric;
+}
+
+float reflectance(in float cosine, in float refr_index) {
+    const float r0 = (1.0 - refr_index) / (1.0 + refr_index);
+    const float r0_2 = r0 * r0;
+    return r0_2 + (1.0 - r0_2) * pow(1.0 - cosine, 5.0);
+}
+
+bool scatter_lambertian(in lambertian_t material,
+                        in ray_t ray,
+                        in hit_record_t record,
+                        out vec3 attenuation,
+                        out vec3 emitted,
+                        out ray_t scattered,
+                        inout uint state) {
+    vec3 scatter_dir = record.normal + normalize(random_in_unit_sphere(state));
+    if (near_zero(scatter_dir)) {
+        scatter_dir = record.normal;
+    }
+    scattered = ray_t(record.point, scatter_dir);
+    attenuation = material.albedo;
+    emitted = material.emissive * material.e_strength;
+    return true;
+}
+
+bool scatter_metal(in metal_t material,
+                   in ray_t ray,
+                   in hit_record_t record,
+                   out vec3 attenuation,
+                   out ray_t scattered,
+                   inout uint state) {
+    const vec3 reflected = reflect(normalize(ray.direction), record.normal);
+    scattered = ray_t(record.point, reflected);
+    attenuation = material.albedo;
+    return dot(scattered.direction, record.normal) > 0.0;
+}
+
+bool scatter_dielectric(in dielectric_t material,
+                        in ray_t ray,
+                        in hit_record_t record,
+                        out vec3 attenuation,
+                        out ray_t scattered,
+                        inout uint state) {
+    attenuation = vec3(1.0);
+    const float refr_ratio = record.front_face ? (1.0 / material.refr_index) : material.refr_index;
+    const vec3 r_dir = normalize(ray.direction);
+    const float cos_t = min(dot(-r_dir, record.normal), 1.0);
+    const float sin_t = sqrt(1.0 - cos_t * cos_t);
+    const bool cannot_refract = refr_ratio * sin_t > 1.0;
+    vec3 direction;
+    if (cannot_refract || reflectance(cos_t, refr_ratio) > random(state)) {
+        direction = reflect(r_dir, record.normal);
+    } else {
+        direction = refract(r_dir, record.normal, refr_ratio);
+    }
+    scattered = ray_t(record.point, direction);
+    return true;
+}
+
+bool global_scatter(in _proxy_material_t proxy,
+                    in ray_t ray,
+                    in hit_record_t record,
+                    out vec3 attenuation,
+                    out vec3 emitted,
+                    out ray_t scattered,
+                    inout uint state) {
+    // only lambertians emit
+    emitted = vec3(0);
+    switch (as_type_from_material_proxy(proxy)) {
+        case E_MATERIAL_NONE:
+            return false;
+
+        case E_MATERIAL_LAMBERTIAN:
+            return scatter_lambertian(as_lambertian_from_material_proxy(proxy), ray, record, attenuation, emitted, scattered, state);
+
+        case E_MATERIAL_METAL:
+            return scatter_metal(as_metal_from_material_proxy(proxy), ray, record, attenuation, scattered, state);
+
+        case E_MATERIAL_DIELECTRIC:
+            return scatter_dielectric(as_dielectric_from_material_proxy(proxy), ray, record, attenuation, scattered, state);
+    }
+    emitted = vec3(0);
+    return false;
+}
+
+// what a material reflects at a hit, the denoiser divides it out of the lighting and multiplies it back in after
+// filtering. dielectrics and materials that do not scatter keep everything
+vec3 material_albedo(in _proxy_material_t proxy, in hit_record_t record) {
+    vec3 albedo = vec3(1.0);
+    switch (as_type_from_material_proxy(proxy)) {
+        case E_MATERIAL_LAMBERTIAN:
+            albedo = as_lambertian_from_material_proxy(proxy).albedo;
+            break;
+
+        case E_MATERIAL_METAL:
+            albedo = as_metal_from_material_proxy(proxy).albedo;
+            break;
+    }
+    if (record.texture != -1) {
+        albedo *= textureLod(textures[record.texture], record.uv, 0.0).rgb;
+    }
+    return albedo;
+}
+
+bool hit_sphere(in sphere_t sphere, in ray_t ray, in float t_min, in float t_max, out hit_record_t record) {
+    const vec3 oc = ray.origin - sphere.center;
+    const float a = dot(ray.direction, ray.direction);
+    const float b = dot(oc, ray.direction);
+    const float c = dot(oc, oc) - sphere.radius * sphere.radius;
+    const float discriminant = b * b - a * c;
+    if (discriminant < 0.0) {
+        return false;
+    }
+    float sq_d = sqrt(discriminant);
+    float root = (-b - sq_d) / a;
+    if (root < t_min || t_max < root) {
+        root = (-b + sq_d) / a;
+        if (root < t_min || t_max < root) {
+            return false;
+        }
+    }
+    record.t = root;
+    record.point = ray_hit(ray, record.t);
+    const vec3 normal = (record.point - sphere.center) / sphere.radius;
+    const bool front_face = dot(ray.direction, normal) < 0.0;
+    record.normal = front_face ? normal : -normal;
+    record.front_face = front_face;
+    record.material_id = sphere.material_id;
+    record.texture = -1;
+    record.uv = vec2(0.0);
+    record.light = sphere.light_id;
+    return true;
+}
+
+bool global_hit(in _proxy_hittable_t proxy, in ray_t ray, in float t_min, in float t_max, out hit_record_t record) {
+    const uint hittable_type = proxy._data[0];
+    switch (hittable_type) {
+        case E_HITTABLE_NONE:
+            return false;
+
+        case E_HITTABLE_SPHERE:
+            return hit_sphere(as_sphere_from_hittable_proxy(proxy), ray, t_min, t_max, record);
+
+        case E_HITTABLE_TRIANGLE:
+            return false;
+    }
+    return false;
+}
+
+// the root of a tree without primitives, its bounds are inverted
+bool is_empty(in bvh_node_t root) {
+    return any(greaterThan(root.min, root.max));
+}
+
+// entry distance of the ray into the box, INFINITY on a miss
+float hit_bounds(in vec3 b_min, in vec3 b_max, in ray_t ray, in vec3 inv_direction, in float t_min, in float t_max) {
+    const vec3 t0 = (b_min - ray.origin) * inv_direction;
+    const vec3 t1 = (b_max - ray.origin) * inv_direction;
+    const vec3 t_near = min(t0, t1);
+    const vec3 t_far = max(t0, t1);
+    const float t_enter = max(max(t_near.x, t_near.y), max(t_near.z, t_min));
+    const float t_exit = min(min(t_far.x, t_far.y), min(t_far.z, t_max));
+    return t_enter <= t_exit ? t_enter : INFINITY;
+}
+
+bool hittables_hit(in ray_t ray, in float t_min, inout float closest, inout hit_record_t record) {
+    const vec3 inv_direction = 1.0 / ray.direction;
+    bool hit_anything = false;
+    if (is_empty(nodes[0]) || hit_bounds(nodes[0].min, nodes[0].max, ray, inv_direction, t_min, closest) == INFINITY) {
+        return false;
+    }
+    // nearer child first, the other one waits on the stack with its entry distance
+    uint stack[BVH_STACK_SIZE];
+    float stack_t[BVH_STACK_SIZE];
+    uint top = 0;
+    uint node = 0;
+    while (true) {
+        const bvh_node_t current = nodes[node];
+        if (current.count != 0) {
+            for (uint i = current.offset; i < current.offset + current.count; ++i) {
+                hit_record_t current_hit;
+                if (global_hit(hittables[i], ray, t_min, closest, current_hit)) {
+                    hit_anything = true;
+                    closest = current_hit.t;
+                    record = current_hit;
+                }
+            }
+        } else {
+            uint near_child = node + 1;
+            uint far_child = current.offset;
+            float t_near = hit_bounds(nodes[near_child].min, nodes[near_child].max, ray, inv_direction, t_min, closest);
+            float t_far = hit_bounds(nodes[far_child].min, nodes[far_child].max, ray, inv_direction, t_min, closest);
+            if (t_far < t_near) {
+                const uint child = near_child;
+                near_child = far_child;
+                far_child = child;
+                const float t = t_near;
+                t_near = t_far;
+                t_far = t;
+            }
+            if (t_near != INFINITY) {
+                if (t_far != INFINITY) {
+                    stack[top] = far_child;
+                    stack_t[top] = t_far;
+                    ++top;
+                }
+                node = near_child;
+                continue;
+            }
+        }
+        // skip whatever starts behind the closest hit found since it was pushed
+        bool found = false;
+        while (top != 0) {
+            --top;
+            if (stack_t[top] <= closest) {
+                node = stack[top];
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+    return hit_anything;
+}
+
+// distance along the ray and the barycentrics of v1 and v2, the distance is INFINITY on a miss
+vec3 hit_triangle(in triangle_t triangle, in ray_t ray, in float t_min, in float t_max) {
+    const vec3 p = cross(ray.direction, triangle.e2.xyz);
+    const float determinant = dot(triangle.e1.xyz, p);
+    if (determinant == 0.0) {
+        return vec3(INFINITY);
+    }
+    const float inv_determinant = 1.0 / determinant;
+    const vec3 s = ray.origin - triangle.v0.xyz;
+    const float u = dot(s, p) * inv_determinant;
+    if (u < 0.0 || u > 1.0) {
+        return vec3(INFINITY);
+    }
+    const vec3 q = cross(s, triangle.e1.xyz);
+    const float v = dot(ray.direction, q) * inv_determinant;
+    if (v < 0.0 || u + v > 1.0) {
+        return vec3(INFINITY);
+    }
+    const float t = dot(triangle.e2.xyz, q) * inv_determinant;
+    if (t < t_min || t > t_max) {
+        return vec3(INFINITY);
+    }
+    return vec3(t, u, v);
+}
+
+vec2 triangle_uv(in triangle_attributes_t attributes, in vec2 barycentrics) {
+    return attributes.uv[0].xy * (1.0 - barycentrics.x - barycentrics.y) +
+           attributes.uv[0].zw * barycentrics.x +
+           attributes.uv[1].xy * barycentrics.y;
+}
+
+// the ray is moved into object space without normalizing its direction, distances stay the same as in world space
+bool instance_hit(in instance_t instance, in ray_t ray, in float t_min, inout float closest, inout hit_record_t record) {
+    ray_t object_ray;
+    object_ray.origin = vec3(instance.world_to_object * vec4(ray.origin, 1.0));
+    object_ray.direction = mat3(instance.world_to_object) * ray.direction;
+    const vec3 inv_direction = 1.0 / object_ray.direction;
+    uint closest_triangle = -1;
+    vec2 closest_barycentrics = vec2(0.0);
+
+    uint stack[BVH_STACK_SIZE];
+    float stack_t[BVH_STACK_SIZE];
+    uint top = 0;
+    uint node = 0;
+    while (true) {
+        const bvh_node_t current = blas_nodes[instance.node_offset + node];
+        if (current.count != 0) {
+            for (uint i = current.offset; i < current.offset + current.count; ++i) {
+                const uint index = instance.triangle_offset + i;
+                const vec3 hit = hit_triangle(triangles[index], object_ray, t_min, closest);
+                if (hit.x == INFINITY) {
+                    continue;
+                }
+                if (instance.alpha_texture != -1) {
+                    const vec2 uv = triangle_uv(triangle_attributes[index], hit.yz);
+                    if (textureLod(textures[instance.alpha_texture], uv, 0.0).a < 0.5) {
+                        continue;
+                    }
+                }
+                closest = hit.x;
+                closest_triangle = index;
+                closest_barycentrics = hit.yz;
+            }
+        } else {
+            uint near_child = node + 1;
+            uint far_child = current.offset;
+            const bvh_node_t near_node = blas_nodes[instance.node_offset + near_child];
+            const bvh_node_t far_node = blas_nodes[instance.node_offset + far_child];
+            float t_near = hit_bounds(near_node.min, near_node.max, object_ray, inv_direction, t_min, closest);
+            float t_far = hit_bounds(far_node.min, far_node.max, object_ray, inv_direction, t_min, closest);
+            if (t_far < t_near) {
+                const uint child = near_child;
+                near_child = far_child;
+                far_child = child;
+                const float t = t_near;
+                t_near = t_far;
+                t_far = t;
+            }
+            if (t_near != INFINITY) {
+                if (t_far != INFINITY) {
+                    stack[top] = far_child;
+                    stack_t[top] = t_far;
+                    ++top;
+                }
+                node = near_child;
+                continue;
+            }
+        }
+        bool found = false;
+        while (top != 0) {
+            --top;
+            if (stack_t[top] <= closest) {
+                node = stack[top];
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+    if (closest_triangle == -1) {
+        return false;
+    }
+
+    const triangle_t triangle = triangles[closest_triangle];
+    const triangle_attributes_t attributes = triangle_attributes[closest_triangle];
+    const vec3 barycentrics = vec3(1.0 - closest_barycentrics.x - closest_barycentrics.y, closest_barycentrics);
+    const mat3 normal_matrix = transpose(mat3(instance.world_to_object));
+    const vec3 geometric_normal = normalize(normal_matrix * cross(triangle.e1.xyz, triangle.e2.xyz));
+    vec3 normal = normal_matrix * (
+        attributes.normals[0].xyz * barycentrics.x +
+        attributes.normals[1].xyz * barycentrics.y +
+        attributes.normals[2].xyz * barycentrics.z);
+    normal = near_zero(normal) ? geometric_normal : normalize(normal);
+    // interpolated normals may lean past the surface, keep them on the side of the geometry
+    if (dot(normal, geometric_normal) < 0.0) {
+        normal = -normal;
+    }
+    const bool front_face = dot(ray.direction, geometric_normal) < 0.0;
+    record.t = closest;
+    record.point = ray_hit(ray, closest);
+    record.normal = front_face ? normal : -normal;
+    record.front_face = front_face;
+    record.material_id = triangle_material;
+    record.texture = instance.diffuse_texture;
+    record.uv = triangle_uv(attributes, closest_barycentrics);
+    record.light = -1;
+    return true;
+}
+
+bool instances_hit(in ray_t ray, in float t_min, inout float closest, inout hit_record_t record) {
+    const vec3 inv_direction = 1.0 / ray.direction;
+    bool hit_anything = false;
+    if (is_empty(tlas_nodes[0]) || hit_bounds(tlas_nodes[0].min, tlas_nodes[0].max, ray, inv_direction, t_min, closest) == INFINITY) {
+        return false;
+    }
+    uint stack[BVH_STACK_SIZE];
+    float stack_t[BVH_STACK_SIZE];
+    uint top = 0;
+    uint node = 0;
+    while (true) {
+        const bvh_node_t current = tlas_nodes[node];
+        if (current.count != 0) {
+            for (uint i = current.offset; i < current.offset + current.count; ++i) {
+                if (instance_hit(instances[i], ray, t_min, closest, record)) {
+                    hit_anything = true;
+                }
+            }
+        } else {
+            uint near_child = node + 1;
+            uint far_child = current.offset;
+            float t_near = hit_bounds(tlas_nodes[near_child].min, tlas_nodes[near_child].max, ray, inv_direction, t_min, closest);
+            float t_far = hit_bounds(tlas_nodes[far_child].min, tlas_nodes[far_child].max, ray, inv_direction, t_min, closest);
+            if (t_far < t_near) {
+                const uint child = near_child;
+                near_child = far_child;
+                far_child = child;
+                const float t = t_near;
+                t_near = t_far;
+                t_far = t;
+            }
+            if (t_near != INFINITY) {
+                if (t_far != INFINITY) {
+                    stack[top] = far_child;
+                    stack_t[top] = t_far;
+                    ++top;
+                }
+                node = near_child;
+                continue;
+            }
+        }
+        bool found = false;
+        while (top != 0) {
+            --top;
+            if (stack_t[top] <= closest) {
+                node = stack[top];
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+    return hit_anything;
+}
+
+bool world_hit(in ray_t ray, in float t_min, in float t_max, out hit_record_t record) {
+    float closest = t_max;
+    const bool hit_hittable = hittables_hit(ray, t_min, closest, record);
+    const bool hit_instance = instances_hit(ray, t_min, closest, record);
+    return hit_hittable || hit_instance;
+}
+
+// the hit of the ray through the pixel center guides the denoiser, unlike the jittered samples it stays the same
+// between frames. xyz: normal, w: distance or 0 for the sky
+void primary_surface(in vec2 position, in vec2 resolution, out vec4 normal_depth, out vec3 albedo) {
+    ray_t ray;
+    camera_ray(camera.inv_pv, position, resolution, ray.origin, ray.direction);
+    hit_record_t record;
+    normal_depth = vec4(0.0);
+    albedo = vec3(1.0);
+    if (world_hit(ray, 0.01, 100000.0, record)) {
+        normal_depth = vec4(record.normal, record.t);
+        albedo = material_albedo(materials[record.material_id], record);
+    }
+}
+
+// 1 - cos of the half angle of the cone the light covers seen from origin, 0 from inside it or on its surface.
+// written without the cancellation of 1 - cos for small and distant lights
+float light_cone(in vec3 origin, in uint light) {
+    const vec3 to_center = lights[light].center - origin;
+    const float distance2 = dot(to_center, to_center);
+    const float radius2 = lights[light].radius * lights[light].radius;
+    if (distance2 <= radius2 * 1.001) {
+        return 0.0;
+    }
+    const float sin2_max = radius2 / distance2;
+    return sin2_max / (1.0 + sqrt(1.0 - sin2_max));
+}
+
+// solid angle pdf of sample_light, the light is picked uniformly and its cone sampled uniformly
+float light_pdf(in float cone) {
+    return 1.0 / (float(light_count) * 2.0 * PI * cone);
+}
+
+// cosine weighted like scatter_lambertian
+float lambertian_pdf(in vec3 normal, in vec3 direction) {
+    return max(dot(normal, normalize(direction)), 0.0) / PI;
+}
+
+float power_heuristic(in float pdf, in float other_pdf) {
+    return pdf * pdf / (pdf * pdf + other_pdf * other_pdf);
+}
+
+// next event estimation from a lambertian: picks a light and a direction inside the cone it covers. light is what
+// arrives through the unoccluded shadow ray, divided by the pdf and weighted against the bounce that could have
+// found the same light. the albedo is left to the caller, the shadow ray ends just before the light
+bool sample_light(in hit_record_t record, out ray_t shadow, out float t_max, out vec3 light, inout uint state) {
+    if ((integrator & E_INTEGRATOR_LIGHT_SAMPLING) == 0 || light_count == 0) {
+        return false;
+    }
+    const uint index = min(uint(random(state) * float(light_count)), light_count - 1);
+    const float cone = light_cone(record.point, index);
+    if (cone == 0.0) {
+        return false;
+    }
+    const vec2 u = random_vec2(state);
+    const float cos_t = 1.0 - u.x * cone;
+    const float sin_t = sqrt(max(1.0 - cos_t * cos_t, 0.0));
+    const float phi = 2.0 * PI * u.y;
+
+    // orthonormal basis around the axis of the cone, Duff et al. 2017
+    const vec3 to_center = lights[index].center - record.point;
+    const float distance = length(to_center);
+    const vec3 axis = to_center / distance;
+    const float sign_z = axis.z >= 0.0 ? 1.0 : -1.0;
+    const float a = -1.0 / (sign_z + axis.z);
+    const float b = axis.x * axis.y * a;
+    const vec3 tangent = vec3(1.0 + sign_z * axis.x * axis.x * a, sign_z * b, -sign_z * axis.x);
+    const vec3 bitangent = vec3(b, sign_z + axis.y * axis.y * a, -axis.y);
+    const vec3 direction = normalize((tangent * cos(phi) + bitangent * sin(phi)) * sin_t + axis * cos_t);
+    const float cosine = dot(record.normal, direction);
+    if (cosine <= 0.0) {
+        return false;
+    }
+
+    const float radius = lights[index].radius;
+    const float half_chord = sqrt(max(radius * radius - distance * distance * sin_t * sin_t, 0.0));
+    t_max = (distance * cos_t - half_chord) * 0.999;
+    shadow = ray_t(record.point, direction);
+    const float pdf = light_pdf(cone);
+    light = lights[index].radiance * (cosine / PI) * power_heuristic(pdf, cosine / PI) / pdf;
+    return true;
+}
+
+// MIS weight of light a bounce ran into. bsdf_pdf is the pdf of the lambertian bounce that picked the direction,
+// 0 for camera rays and after specular bounces where no light was sampled
+float emission_weight(in vec3 origin, in hit_record_t record, in float bsdf_pdf) {
+    if ((integrator & E_INTEGRATOR_LIGHT_SAMPLING) == 0 || bsdf_pdf == 0.0 || record.light == -1) {
+        return 1.0;
+    }
+    const float cone = light_cone(origin, record.light);
+    if (cone == 0.0) {
+        return 1.0;
+    }
+    return power_heuristic(bsdf_pdf, light_pdf(cone));
+}
+
+// from the fourth bounce on a path survives with the probability of its throughput, survivors are scaled up
+bool russian_roulette(inout vec3 color, in uint hits, inout uint state) {
+    if ((integrator & E_INTEGRATOR_RUSSIAN_ROULETTE) == 0 || hits <= 3) {
+        return true;
+    }
+    const float survival = min(max(color.r, max(color.g, color.b)), 0.95);
+    if (random(state) >= survival) {
+        return false;
+    }
+    color /= survival;
+    return true;
+}
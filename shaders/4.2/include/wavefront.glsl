@@ -0,0 +1,94 @@
+// queues and path state of the wavefront passes, a path is indexed by its pixel
+
+#define WAVEFRONT_GROUP_SIZE 256
+
+const uint MAX_BOUNCES = 32;
+// the two ray queues are used in turns, one is consumed while the other one is filled
+const uint E_QUEUE_RAYS = 0;
+// one queue per material type, in the order of E_MATERIAL_*
+const uint E_QUEUE_MATERIALS = 2;
+// shadow rays of the lambertian pass
+const uint E_QUEUE_SHADOW = 5;
+const uint QUEUE_COUNT = 6;
+
+struct path_t {
+    vec3 origin;
+    // rng state, carried over to the next sample of the pixel
+    uint state;
+    vec3 direction;
+    uint hits;
+    // throughput so far
+    vec3 color;
+    // of the last lambertian bounce, 0 for the camera ray and after specular bounces
+    float bsdf_pdf;
+    vec3 incoming_light;
+    uint _pad1;
+};
+
+// the hit record of a path that waits for its material pass
+struct path_hit_t {
+    vec3 point;
+    uint material_id;
+    vec3 normal;
+    uint front_face;
+    vec2 uv;
+    uint texture;
+    uint light;
+};
+
+// light a lambertian sampled, added once the shadow ray from the origin of the path is found unoccluded
+struct shadow_ray_t {
+    vec3 direction;
+    float t_max;
+    vec3 light;
+    uint _pad0;
+};
+
+struct dispatch_command_t {
+    uint x;
+    uint y;
+    uint z;
+};
+
+layout (std430, binding = 10) restrict buffer path_buffer_t {
+    path_t[] paths;
+};
+
+layout (std430, binding = 11) restrict buffer path_hit_buffer_t {
+    path_hit_t[] path_hits;
+};
+
+layout (std430, binding = 12) restrict buffer queue_buffer_t {
+    uint[QUEUE_COUNT] queue_counts;
+    // entries of a single queue, the path count. set once when the buffer is created
+    uint queue_capacity;
+    // QUEUE_COUNT queues of path indices
+    uint[] queues;
+};
+
+// intersection first, then one per material type and the shadow rays
+layout (std430, binding = 13) restrict buffer dispatch_buffer_t {
+    dispatch_command_t[5] dispatches;
+};
+
+// sum of all samples of the frame so far
+layout (std430, binding = 14) restrict buffer radiance_buffer_t {
+    vec4[] radiance;
+};
+
+layout (std430, binding = 16) restrict buffer shadow_ray_buffer_t {
+    shadow_ray_t[] shadow_rays;
+};
+
+dispatch_command_t make_dispatch(in uint count) {
+    return dispatch_command_t((count + WAVEFRONT_GROUP_SIZE - 1) / WAVEFRONT_GROUP_SIZE, 1, 1);
+}
+
+void push_path(in uint queue, in uint path) {
+    const uint slot = atomicAdd(queue_counts[queue], 1);
+    queues[queue * queue_capacity + slot] = path;
+}
+
+uint queued_path(in uint queue, in uint slot) {
+    return queues[queue * queue_capacity + slot];
+}
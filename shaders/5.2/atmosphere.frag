@@ -4,11 +4,7 @@
 #define M_GOLDEN 1.6180339887498948482045868343656
 #define M_GOLDEN_CONJ 0.6180339887498948482045868343656
 
-struct directional_light_t {
-    vec3 direction;
-    vec3 diffuse;
-    vec3 specular;
-};
+#include "include/lights.glsl"
 
 layout (location = 0) in vec2 i_uv;
 
@@ -17,15 +13,7 @@ layout (location = 0) out vec4 o_pixel;
 layout (location = 0) uniform vec2 u_resolution;
 layout (location = 1) uniform float u_sun_angular_measure;
 
-layout (std140, binding = 0) uniform u_camera {
-    mat4 inf_projection;
-    mat4 projection;
-    mat4 view;
-    mat4 pv;
-    vec3 position;
-    float near;
-    float far;
-} camera;
+#include "include/camera.glsl"
 
 layout (std140, binding = 1) uniform b_directional_lights {
     directional_light_t[4] directional_lights;
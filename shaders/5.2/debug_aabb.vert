@@ -1,50 +1,10 @@
 #version 460 core
 
-struct indirect_command_t {
-    uint count;
-    uint instance_count;
-    uint first_index;
-    int base_vertex;
-    uint base_instance;
-};
-
-struct aabb_t {
-    vec4 min;
-    vec4 max;
-    vec4 center;
-    vec4 size;
-};
-
-struct object_info_t {
-    uint local_transform;
-    uint global_transform;
-    uint diffuse_texture;
-    uint normal_texture;
-    uint specular_texture;
-    uint group_index;
-    uint group_offset;
-
-    vec4 scale;
-    vec4 sphere; // w is radius
-    aabb_t aabb;
-    indirect_command_t command;
-};
-
-struct object_index_shift_t {
-    uint object_id;
-};
+#include "include/scene.glsl"
 
 layout (location = 0) in vec3 i_position;
 
-layout (std140, binding = 0) uniform u_camera {
-    mat4 inf_projection;
-    mat4 projection;
-    mat4 view;
-    mat4 pv;
-    vec3 position;
-    float near;
-    float far;
-} camera;
+#include "include/camera.glsl"
 
 layout (std430, binding = 1) readonly restrict buffer b_local_transform {
     mat4[] local_transforms;
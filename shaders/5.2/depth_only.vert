@@ -2,57 +2,20 @@
 
 invariant gl_Position;
 
-struct indirect_command_t {
-    uint count;
-    uint instance_count;
-    uint first_index;
-    int base_vertex;
-    uint base_instance;
-};
-
-struct aabb_t {
-    vec4 min;
-    vec4 max;
-    vec4 center;
-    vec4 size;
-};
-
-struct object_info_t {
-    uint local_transform;
-    uint global_transform;
-    uint diffuse_texture;
-    uint normal_texture;
-    uint specular_texture;
-    uint group_index;
-    uint group_offset;
-
-    vec4 scale;
-    vec4 sphere; // w is radius
-    aabb_t aabb;
-    indirect_command_t command;
-};
-
-struct object_index_shift_t {
-    uint object_id;
-};
+#include "include/scene.glsl"
 
 layout (location = 0) in vec3 i_position;
 layout (location = 1) in vec3 i_normal;
 layout (location = 2) in vec2 i_uv;
 layout (location = 3) in vec4 i_tangent;
 
-layout (location = 0) uniform uint u_group_offset;
-layout (location = 1) uniform vec2 u_jitter;
+// per pass values, sub-allocated from the parameter ring, mirrors prepass_parameters_t
+layout (std140, binding = PASS_PARAMETERS_BINDING) uniform u_pass_parameters {
+    vec2 jitter;
+    bool vertex_pulling;
+} parameters;
 
-layout (std140, binding = 0) uniform u_camera {
-    mat4 inf_projection;
-    mat4 projection;
-    mat4 view;
-    mat4 pv;
-    vec3 position;
-    float near;
-    float far;
-} camera;
+#include "include/camera.glsl"
 
 layout (std430, binding = 1) readonly restrict buffer b_local_transform {
     mat4[] local_transforms;
@@ -66,15 +29,36 @@ layout (std430, binding = 3) readonly restrict buffer b_object_info {
     object_info_t[] objects;
 };
 
-layout (std430, binding = 4) restrict buffer b_object_index_shift {
-    object_index_shift_t[] object_shift;
-};
+// mesh pool vertex blocks, only read when pulling vertices
+layout (std430, binding = 16) readonly restrict buffer b_vertex_block {
+    float[] data;
+} vertex_blocks[MAX_VERTEX_BLOCKS];
+
+vertex_t fetch_vertex(in object_info_t object_info) {
+    if (!parameters.vertex_pulling) {
+        return vertex_t(i_position, i_normal, i_uv, i_tangent);
+    }
+    // gl_VertexID already includes the base vertex, the block is dynamically uniform since it comes from gl_BaseInstance
+    const uint block = object_info.vertex_block;
+    const uint base = gl_VertexID * object_info.vertex_stride;
+    vertex_t vertex;
+    vertex.position = vec3(vertex_blocks[block].data[base + 0], vertex_blocks[block].data[base + 1], vertex_blocks[block].data[base + 2]);
+    vertex.normal = vec3(vertex_blocks[block].data[base + 3], vertex_blocks[block].data[base + 4], vertex_blocks[block].data[base + 5]);
+    vertex.uv = vec2(vertex_blocks[block].data[base + 6], vertex_blocks[block].data[base + 7]);
+    vertex.tangent = vec4(
+        vertex_blocks[block].data[base + 8],
+        vertex_blocks[block].data[base + 9],
+        vertex_blocks[block].data[base + 10],
+        vertex_blocks[block].data[base + 11]);
+    return vertex;
+}
 
 void main() {
-    const object_info_t object_info = objects[object_shift[gl_DrawID + u_group_offset].object_id];
+    // the culling pass writes the object index as the base instance of every command
+    const object_info_t object_info = objects[gl_BaseInstance];
     const mat4 global_transform = global_transforms[object_info.global_transform];
     const mat4 local_transform = local_transforms[object_info.local_transform];
     const mat4 transform = global_transform * local_transform;
-    const vec4 clip_pos = camera.pv * transform * vec4(i_position, 1.0);
-    gl_Position = clip_pos + vec4(u_jitter * clip_pos.w, 0.0, 0.0);
+    const vec4 clip_pos = camera.pv * transform * vec4(fetch_vertex(object_info).position, 1.0);
+    gl_Position = clip_pos + vec4(parameters.jitter * clip_pos.w, 0.0, 0.0);
 }
\ No newline at end of file
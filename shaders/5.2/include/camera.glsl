@@ -0,0 +1,14 @@
+// define CAMERA_BINDING before including when the camera is not bound at 0
+#ifndef CAMERA_BINDING
+#define CAMERA_BINDING 0
+#endif
+
+layout (std140, binding = CAMERA_BINDING) uniform u_camera {
+    mat4 inf_projection;
+    mat4 projection;
+    mat4 view;
+    mat4 pv;
+    vec3 position;
+    float near;
+    float far;
+} camera;
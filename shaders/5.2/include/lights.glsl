@@ -0,0 +1,16 @@
+struct directional_light_t {
+    vec3 direction;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct point_light_t {
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+    float radius;
+};
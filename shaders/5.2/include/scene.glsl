@@ -0,0 +1,44 @@
+// mirrors the object records built in 5.2/main.cpp, every std430 member has to stay in sync with the host
+struct indirect_command_t {
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+struct aabb_t {
+    vec4 min;
+    vec4 max;
+    vec4 center;
+    vec4 extent;
+};
+
+struct object_info_t {
+    uint local_transform;
+    uint global_transform;
+    uint diffuse_texture;
+    uint normal_texture;
+    uint specular_texture;
+    uint group_index;
+    uint group_offset;
+    uint vertex_block;
+    uint vertex_stride; // in floats
+
+    vec4 scale;
+    vec4 sphere; // w is radius
+    aabb_t aabb;
+    indirect_command_t command;
+};
+
+struct object_index_shift_t {
+    uint object_id;
+};
+
+// matches iris::vertex_format_t
+struct vertex_t {
+    vec3 position;
+    vec3 normal;
+    vec2 uv;
+    vec4 tangent;
+};
@@ -0,0 +1,72 @@
+// light evaluation shared by main.frag and visbuffer_resolve.frag. include after lights.glsl, camera.glsl and
+// a parameters block with resolution, positions are in world space
+vec3 calculate_directional_light(in directional_light_t light, in vec3 diffuse_color, in vec3 specular_color, in vec3 normal, in vec3 frag_pos) {
+    const vec3 light_dir = normalize(light.direction);
+    const float diffuse_intensity = max(dot(light_dir, normal), 0.0);
+    const vec3 diffuse_result = light.diffuse * diffuse_intensity * diffuse_color;
+
+#if defined(DISABLE_SPECULAR)
+    const vec3 specular_result = vec3(0.0);
+#else
+    const vec3 view_dir = normalize(camera.position - frag_pos);
+    const vec3 halfway = normalize(light_dir + view_dir);
+    const float specular_intensity = pow(max(dot(normal, halfway), 0.0), 32);
+    const vec3 specular_result = light.specular * specular_intensity * specular_color;
+#endif
+
+    return diffuse_result + specular_result;
+}
+
+// same froxel layout as cluster_build.comp, slices are exponential in view depth
+uint calculate_cluster(in vec2 frag_coord, in float depth_vs) {
+    const uvec2 tile = uvec2(frag_coord / parameters.resolution * vec2(CLUSTER_SIZE_X, CLUSTER_SIZE_Y));
+    const float slice = log(depth_vs / camera.near) / log(camera.far / camera.near) * CLUSTER_SIZE_Z;
+    const uvec3 id = min(uvec3(tile, uint(max(slice, 0.0))), uvec3(CLUSTER_SIZE_X, CLUSTER_SIZE_Y, CLUSTER_SIZE_Z) - 1);
+    return id.x + id.y * CLUSTER_SIZE_X + id.z * CLUSTER_SIZE_X * CLUSTER_SIZE_Y;
+}
+
+vec3 calculate_point_light(in point_light_t light, in vec3 diffuse_color, in vec3 specular_color, in vec3 normal, in vec3 frag_pos) {
+    const vec3 ambient_result = light.ambient * diffuse_color;
+
+    const vec3 light_dir = normalize(light.position - frag_pos);
+    const float diffuse_intensity = max(dot(light_dir, normal), 0.0);
+    const vec3 diffuse_result = light.diffuse * diffuse_intensity * diffuse_color;
+
+#if defined(DISABLE_SPECULAR)
+    const vec3 specular_result = vec3(0.0);
+#else
+    const vec3 view_dir = normalize(camera.position - frag_pos);
+    const vec3 halfway = normalize(light_dir + view_dir);
+    const float specular_intensity = pow(max(dot(normal, halfway), 0.0), 32);
+    const vec3 specular_result = light.specular * specular_intensity * specular_color;
+#endif
+
+    const float f_dist = length(light.position - frag_pos);
+    const float f_dist2 = f_dist * f_dist;
+    // windowed so the light reaches exactly zero at the radius it was culled with
+    const float window = pow(clamp(1.0 - pow(f_dist / light.radius, 4.0), 0.0, 1.0), 2.0);
+    const float attenuation =
+        window / (
+            light.constant +
+            f_dist * light.linear +
+            f_dist2 * light.quadratic);
+
+    return attenuation * (ambient_result + diffuse_result + specular_result);
+}
+
+vec3 hsv_to_rgb(in vec3 hsv) {
+    const vec3 rgb = clamp(abs(mod(hsv.x * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);
+    return hsv.z * mix(vec3(1.0), rgb, hsv.y);
+}
+
+vec3 as_srgb(in vec3 color) {
+    vec3 o = vec3(0.0);
+    for (uint i = 0; i < 3; ++i) {
+        if (color[i] < 0.0031308) {
+            o[i] = 12.92 * color[i];
+        } else {
+            o[i] = 1.055 * pow(color[i], 1.0 / 2.4) - 0.055;
+        }
+    }
+    return o;
+}
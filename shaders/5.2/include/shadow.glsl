@@ -0,0 +1,16 @@
+// CASCADE_COUNT is injected by the host
+#define SHADOW_FILTER_FIXED 0
+#define SHADOW_FILTER_ADAPTIVE 1
+
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER SHADOW_FILTER_FIXED
+#endif
+
+struct cascade_data_t {
+    mat4 projection;
+    mat4 view;
+    mat4 pv;
+    mat4 global;
+    vec4 scale;
+    vec4 offset; // w is split
+};
@@ -0,0 +1,110 @@
+// filtered cascade lookups shared by main.frag and visbuffer_resolve.frag. include after shadow.glsl, the
+// cascades buffer, u_shadow_map, u_shadow_depth, u_blue_noise and a parameters block with shadow_max_taps
+#define SHADOW_BLOCKER_SEARCH_TAPS 8
+#define SHADOW_PENUMBRA_MIN_TAPS 8
+// blocker to receiver distance (in world units) at which the full tap budget is used
+#define SHADOW_PENUMBRA_FULL_DISTANCE 2.0
+
+// from https://www.shadertoy.com/view/7ssfWN
+vec2 sample_hammersley(in uint i, in uint n) {
+    const float s = 2.3283064365386963e-10;
+    return vec2(
+        float(i) / float(n),
+        float(bitfieldReverse(i)) * s);
+}
+
+// uniform disk sample, rotated per pixel by blue noise
+vec2 sample_disk(in uint i, in uint n, in vec2 noise) {
+    const vec2 xi = fract(sample_hammersley(i, n) + noise);
+    const float r = sqrt(xi.x);
+    const float theta = xi.y * 2.0 * M_PI;
+    return vec2(r * cos(theta), r * sin(theta));
+}
+
+vec2 calculate_depth_plane_bias(in vec3 ddx, in vec3 ddy) {
+    vec2 bias_uv = vec2(
+        ddy.y * ddx.z - ddx.y * ddy.z,
+        ddx.x * ddy.z - ddy.x * ddx.z);
+    bias_uv *= 1.0 / ((ddx.x * ddy.y) - (ddx.y * ddy.x));
+    return bias_uv;
+}
+
+uint calculate_cascade(in float depth_vs) {
+    for (uint i = 0; i < CASCADE_COUNT; ++i) {
+        if (depth_vs < cascades[i].offset.w) {
+            return i;
+        }
+    }
+    return CASCADE_COUNT - 1;
+}
+
+vec3 sample_shadow(in vec3 shadow_frag_pos,
+                   in vec3 ddx_shadow_frag_pos,
+                   in vec3 ddy_shadow_frag_pos,
+                   in vec3 light_dir,
+                   in vec3 normal,
+                   in float depth_vs,
+                   in uint cascade) {
+    shadow_frag_pos += cascades[cascade].offset.xyz;
+    shadow_frag_pos *= cascades[cascade].scale.xyz;
+    ddx_shadow_frag_pos *= cascades[cascade].scale.xyz;
+    ddy_shadow_frag_pos *= cascades[cascade].scale.xyz;
+
+    const vec2 shadow_size = vec2(textureSize(u_shadow_map, 0));
+    const vec2 texel_size = 1.0 / shadow_size;
+
+    //const vec2 bias_uv = calculate_depth_plane_bias(ddx_shadow_frag_pos, ddy_shadow_frag_pos);
+    //const float plane_bias = min(dot(vec2(1.0) * texel_size, abs(bias_uv)), 0.05);
+    const float width = float[](0.0035, 0.002025, 0.001425, 0.000325)[cascade] / 2.0;
+    const vec3 halfway = normalize(light_dir + normal);
+    //float bias = clamp((width / 2.0) * tan(acos(abs(clamp(max(dot(normal, halfway), dot(halfway, light_dir)), -1.0, 1.0)))), 0.0, width);
+    float bias = clamp(width * tan(acos(abs(clamp(dot(normal, light_dir), -1.0, 1.0)))), 0.0, width);
+    const float prev_split = cascade == 0 ? 0.0 : cascades[cascade - 1].offset.w;
+    const float next_split = cascades[cascade].offset.w;
+    const float light_depth = shadow_frag_pos.z - bias;
+    const float kernel_radius = float[](4.0, 4.5, 3.5, 2.5)[cascade];
+    const ivec2 noise_size = textureSize(u_blue_noise, 0);
+    const ivec2 noise_texel = ivec2(int(gl_FragCoord.x) % noise_size.x, int(gl_FragCoord.y) % noise_size.y);
+    const vec2 noise = texelFetch(u_blue_noise, noise_texel, 0).xy;
+    uint sample_count = parameters.shadow_max_taps;
+    vec3 shadow_factor = vec3(0.0);
+
+    // constant per permutation, the other filter is compiled out
+    if (SHADOW_FILTER == SHADOW_FILTER_ADAPTIVE) {
+        // blocker search: a few raw depth taps over the same kernel decide if we are in a penumbra at all
+        float blocker_depth = 0.0;
+        uint blocker_count = 0;
+        for (uint i = 0; i < SHADOW_BLOCKER_SEARCH_TAPS; ++i) {
+            const vec2 s_uv = shadow_frag_pos.xy + sample_disk(i, SHADOW_BLOCKER_SEARCH_TAPS, noise) * texel_size * kernel_radius;
+            const float depth = texture(u_shadow_depth, vec3(s_uv, cascade)).r;
+            if (depth < light_depth) {
+                blocker_depth += depth;
+                blocker_count++;
+            }
+        }
+        if (blocker_count == 0) {
+            return vec3(1.0);
+        }
+        if (blocker_count == SHADOW_BLOCKER_SEARCH_TAPS) {
+            return vec3(0.0);
+        }
+        // scale the tap count with the estimated penumbra width, cascade depth is converted back to world units
+        blocker_depth /= float(blocker_count);
+        const float blocker_distance = (light_depth - blocker_depth) / abs(cascades[cascade].projection[2][2]);
+        const float penumbra = clamp(blocker_distance / SHADOW_PENUMBRA_FULL_DISTANCE, 0.0, 1.0);
+        sample_count = clamp(uint(float(parameters.shadow_max_taps) * penumbra), min(SHADOW_PENUMBRA_MIN_TAPS, parameters.shadow_max_taps), parameters.shadow_max_taps);
+    }
+
+    for (uint i = 0; i < sample_count; ++i) {
+        const vec2 s_uv = shadow_frag_pos.xy + sample_disk(i, sample_count, noise) * texel_size * kernel_radius;
+        shadow_factor += texture(u_shadow_map, vec4(s_uv, cascade, light_depth)).r;
+    }
+    vec3 shadow = shadow_factor / float(sample_count);
+    /*switch (cascade) {
+        case 0: shadow *= vec3(1.0, 0.5, 0.5); break;
+        case 1: shadow *= vec3(0.5, 1.0, 0.5); break;
+        case 2: shadow *= vec3(0.5, 0.5, 1.0); break;
+        case 3: shadow *= vec3(1.0, 1.0, 0.5); break;
+    }*/
+    return shadow;
+}
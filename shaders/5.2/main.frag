@@ -1,25 +1,13 @@
 #version 460 core
 #extension GL_ARB_bindless_texture : enable
 
-#define CASCADE_COUNT 4
 #define M_PI 3.1415926535897932384626433832795
 #define M_GOLDEN 1.6180339887498948482045868343656
 #define M_GOLDEN_CONJ 0.6180339887498948482045868343656
 
-struct cascade_data_t {
-    mat4 projection;
-    mat4 view;
-    mat4 pv;
-    mat4 global;
-    vec4 scale;
-    vec4 offset; // w is split
-};
-
-struct directional_light_t {
-    vec3 direction;
-    vec3 diffuse;
-    vec3 specular;
-};
+// SHADOW_FILTER picks the filter at build time, one permutation per mode
+#include "include/shadow.glsl"
+#include "include/lights.glsl"
 
 layout (early_fragment_tests) in;
 
@@ -37,19 +25,19 @@ layout (location = 11) in vec4 i_prev_clip_pos;
 layout (location = 0) out vec4 o_pixel;
 layout (location = 1) out vec2 o_velocity;
 
-layout (location = 2) uniform sampler2DArrayShadow u_shadow_map;
-layout (location = 3) uniform sampler2D u_blue_noise;
-layout (location = 4) uniform vec2 u_resolution;
+layout (binding = 0) uniform sampler2DArrayShadow u_shadow_map;
+layout (binding = 1) uniform sampler2D u_blue_noise;
+layout (binding = 2) uniform sampler2DArray u_shadow_depth;
 
-layout (std140, binding = 0) uniform u_camera {
-    mat4 inf_projection;
-    mat4 projection;
-    mat4 view;
-    mat4 pv;
-    vec3 position;
-    float near;
-    float far;
-} camera;
+// per pass values, sub-allocated from the parameter ring, mirrors lighting_parameters_t
+layout (std140, binding = PASS_PARAMETERS_BINDING) uniform u_pass_parameters {
+    vec2 jitter;
+    vec2 resolution;
+    bool vertex_pulling;
+    uint shadow_max_taps;
+} parameters;
+
+#include "include/camera.glsl"
 
 layout (std140, binding = 5) uniform u_directional_lights {
     directional_light_t[4] directional_lights;
@@ -63,92 +51,20 @@ layout (std430, binding = 7) readonly restrict buffer b_cascade_output {
     cascade_data_t[CASCADE_COUNT] cascades;
 };
 
-// from https://www.shadertoy.com/view/7ssfWN
-vec2 sample_hammersley(in uint i, in uint n) {
-    const float s = 2.3283064365386963e-10;
-    return vec2(
-        float(i) / float(n),
-        float(bitfieldReverse(i)) * s);
-}
-
-vec2 calcualte_depth_plane_bias(in vec3 ddx, in vec3 ddy) {
-    vec2 bias_uv = vec2(
-        ddy.y * ddx.z - ddx.y * ddy.z,
-        ddx.x * ddy.z - ddy.x * ddx.z);
-    bias_uv *= 1.0 / ((ddx.x * ddy.y) - (ddx.y * ddy.x));
-    return bias_uv;
-}
-
-uint calculate_cascade(in float depth_vs) {
-    for (uint i = 0; i < CASCADE_COUNT; ++i) {
-        if (depth_vs < cascades[i].offset.w) {
-            return i;
-        }
-    }
-    return CASCADE_COUNT - 1;
-}
-
-vec3 calculate_directional_light(in directional_light_t light, in vec3 diffuse_color, in vec3 specular_color, in vec3 normal) {
-    const vec3 light_dir = normalize(light.direction);
-    const float diffuse_intensity = max(dot(light_dir, normal), 0.0);
-    const vec3 diffuse_result = light.diffuse * diffuse_intensity * diffuse_color;
+layout (std430, binding = 13) readonly restrict buffer b_point_lights {
+    point_light_t[] point_lights;
+};
 
-    const vec3 view_dir = normalize(camera.position - i_frag_pos);
-    const vec3 halfway = normalize(light_dir + view_dir);
-    // TODO
-    const float specular_intensity = pow(max(dot(normal, halfway), 0.0), 32);
-    const vec3 specular_result = light.specular * specular_intensity * specular_color;
+layout (std430, binding = 14) readonly restrict buffer b_cluster_light_count {
+    uint[] cluster_light_count;
+};
 
-    return diffuse_result + specular_result;
-}
+layout (std430, binding = 15) readonly restrict buffer b_cluster_light_index {
+    uint[] cluster_light_index;
+};
 
-vec3 sample_shadow(in vec3 shadow_frag_pos,
-                   in vec3 ddx_shadow_frag_pos,
-                   in vec3 ddy_shadow_frag_pos,
-                   in vec3 light_dir,
-                   in vec3 normal,
-                   in float depth_vs,
-                   in uint cascade) {
-    shadow_frag_pos += cascades[cascade].offset.xyz;
-    shadow_frag_pos *= cascades[cascade].scale.xyz;
-    ddx_shadow_frag_pos *= cascades[cascade].scale.xyz;
-    ddy_shadow_frag_pos *= cascades[cascade].scale.xyz;
-
-    const vec2 shadow_size = vec2(textureSize(u_shadow_map, 0));
-    const vec2 texel_size = 1.0 / shadow_size;
-
-    //const vec2 bias_uv = calcualte_depth_plane_bias(ddx_shadow_frag_pos, ddy_shadow_frag_pos);
-    //const float plane_bias = min(dot(vec2(1.0) * texel_size, abs(bias_uv)), 0.05);
-    const float width = float[](0.0035, 0.002025, 0.001425, 0.000325)[cascade] / 2.0;
-    const vec3 halfway = normalize(light_dir + normal);
-    //float bias = clamp((width / 2.0) * tan(acos(abs(clamp(max(dot(normal, halfway), dot(halfway, light_dir)), -1.0, 1.0)))), 0.0, width);
-    float bias = clamp(width * tan(acos(abs(clamp(dot(normal, light_dir), -1.0, 1.0)))), 0.0, width);
-    const float prev_split = cascade == 0 ? 0.0 : cascades[cascade - 1].offset.w;
-    const float next_split = cascades[cascade].offset.w;
-    const float light_depth = shadow_frag_pos.z - bias;
-    const float kernel_radius = float[](4.0, 4.5, 3.5, 2.5)[cascade];
-    const uint sample_count = 64;
-    vec3 shadow_factor = vec3(0.0);
-
-    for (uint i = 0; i < sample_count; ++i) {
-        const ivec2 noise_size = textureSize(u_blue_noise, 0);
-        const ivec2 noise_texel = ivec2(int(gl_FragCoord.x) % noise_size.x, int(gl_FragCoord.y) % noise_size.y);
-        const vec2 xi = fract(sample_hammersley(i, sample_count) + texelFetch(u_blue_noise, noise_texel, 0).xy);
-        const float r = sqrt(xi.x);
-        const float theta = xi.y * 2.0 * M_PI;
-        const vec2 offset = vec2(r * cos(theta), r * sin(theta));
-        const vec2 s_uv = shadow_frag_pos.xy + offset * texel_size * kernel_radius;
-        shadow_factor += texture(u_shadow_map, vec4(s_uv, cascade, light_depth)).r;
-    }
-    vec3 shadow = shadow_factor / float(sample_count);
-    /*switch (cascade) {
-        case 0: shadow *= vec3(1.0, 0.5, 0.5); break;
-        case 1: shadow *= vec3(0.5, 1.0, 0.5); break;
-        case 2: shadow *= vec3(0.5, 0.5, 1.0); break;
-        case 3: shadow *= vec3(1.0, 1.0, 0.5); break;
-    }*/
-    return shadow;
-}
+#include "include/shadow_sampling.glsl"
+#include "include/shading.glsl"
 
 vec3 calculate_shadow(in directional_light_t light, in vec3 normal, in float depth_vs, in uint cascade) {
     const vec3 shadow_frag_pos = vec3(cascades[cascade].global * vec4(i_frag_pos, 1.0));
@@ -183,23 +99,6 @@ vec3 calculate_shadow(in directional_light_t light, in vec3 normal, in float dep
     return shadow_factor;
 }
 
-vec3 hsv_to_rgb(in vec3 hsv) {
-    const vec3 rgb = clamp(abs(mod(hsv.x * 6.0 + vec3(0.0, 4.0, 2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0);
-    return hsv.z * mix(vec3(1.0), rgb, hsv.y);
-}
-
-vec3 as_srgb(in vec3 color) {
-    vec3 o = vec3(0.0);
-    for (uint i = 0; i < 3; ++i) {
-        if (color[i] < 0.0031308) {
-            o[i] = 12.92 * color[i];
-        } else {
-            o[i] = 1.055 * pow(color[i], 1.0 / 2.4) - 0.055;
-        }
-    }
-    return o;
-}
-
 vec2 calculate_velocity() {
     vec4 clip_pos = i_clip_pos;
     vec4 prev_clip_pos = i_prev_clip_pos;
@@ -221,9 +120,11 @@ void main() {
         normal = normalize(i_TBN * (texture(textures[i_normal_texture], i_uv).rgb * 2.0 - 1.0));
     }
     vec3 specular = vec3(0.0);
+#if !defined(DISABLE_SPECULAR)
     if (i_specular_texture != -1) {
         specular = texture(textures[i_specular_texture], i_uv).rgb;
     }
+#endif
     const vec3 ambient = diffuse * ambient_factor;
     const float depth_vs = (camera.pv * vec4(i_frag_pos, 1.0)).w;
     const uint cascade = calculate_cascade(depth_vs);
@@ -235,12 +136,15 @@ void main() {
     //diffuse = hsv_to_rgb(hsv);
 
     vec3 color = diffuse * ambient_factor;
-    /*for (uint i = 0; i < n_point_lights; i++) {
-        color += calculate_point_light(point_light.data[i], diffuse, specular, n_normal);
-    }*/
+    const uint cluster = calculate_cluster(gl_FragCoord.xy, depth_vs);
+    const uint cluster_lights = cluster_light_count[cluster];
+    for (uint i = 0; i < cluster_lights; ++i) {
+        const uint light_index = cluster_light_index[cluster * MAX_LIGHTS_PER_CLUSTER + i];
+        color += calculate_point_light(point_lights[light_index], diffuse, specular, normal, i_frag_pos);
+    }
 
     color +=
-        calculate_directional_light(directional_lights[0], diffuse, specular, normal) *
+        calculate_directional_light(directional_lights[0], diffuse, specular, normal, i_frag_pos) *
         calculate_shadow(directional_lights[0], normal, depth_vs, cascade);
 
     o_pixel = vec4(as_srgb(color), 1.0);
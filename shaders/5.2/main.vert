@@ -2,39 +2,7 @@
 
 invariant gl_Position;
 
-struct indirect_command_t {
-    uint count;
-    uint instance_count;
-    uint first_index;
-    int base_vertex;
-    uint base_instance;
-};
-
-struct aabb_t {
-    vec4 min;
-    vec4 max;
-    vec4 center;
-    vec4 size;
-};
-
-struct object_info_t {
-    uint local_transform;
-    uint global_transform;
-    uint diffuse_texture;
-    uint normal_texture;
-    uint specular_texture;
-    uint group_index;
-    uint group_offset;
-
-    vec4 scale;
-    vec4 sphere; // w is radius
-    aabb_t aabb;
-    indirect_command_t command;
-};
-
-struct object_index_shift_t {
-    uint object_id;
-};
+#include "include/scene.glsl"
 
 layout (location = 0) in vec3 i_position;
 layout (location = 1) in vec3 i_normal;
@@ -52,18 +20,15 @@ layout (location = 7) out mat3 o_TBN;
 layout (location = 10) out vec4 o_clip_pos;
 layout (location = 11) out vec4 o_prev_clip_pos;
 
-layout (location = 0) uniform uint u_group_offset;
-layout (location = 1) uniform vec2 u_jitter;
+// per pass values, sub-allocated from the parameter ring, mirrors lighting_parameters_t
+layout (std140, binding = PASS_PARAMETERS_BINDING) uniform u_pass_parameters {
+    vec2 jitter;
+    vec2 resolution;
+    bool vertex_pulling;
+    uint shadow_max_taps;
+} parameters;
 
-layout (std140, binding = 0) uniform u_camera {
-    mat4 inf_projection;
-    mat4 projection;
-    mat4 view;
-    mat4 pv;
-    vec3 position;
-    float near;
-    float far;
-} camera;
+#include "include/camera.glsl"
 
 layout (std430, binding = 1) readonly restrict buffer b_local_transform {
     mat4[] local_transforms;
@@ -77,10 +42,6 @@ layout (std430, binding = 3) readonly restrict buffer b_object_info {
     object_info_t[] objects;
 };
 
-layout (std430, binding = 4) restrict buffer b_object_index_shift {
-    object_index_shift_t[] object_shift;
-};
-
 layout (std140, binding = 8) uniform u_prev_camera {
     mat4 inf_projection;
     mat4 projection;
@@ -99,38 +60,64 @@ layout (std430, binding = 10) readonly restrict buffer b_prev_global_transform {
     mat4[] prev_global_transforms;
 };
 
-mat3 mat3_make_tbn(in mat3 transform) {
-    const vec3 bitangent = cross(i_normal, i_tangent.xyz) * i_tangent.w;
-    const vec3 T = normalize(transform * i_tangent.xyz);
+// mesh pool vertex blocks, only read when pulling vertices
+layout (std430, binding = 16) readonly restrict buffer b_vertex_block {
+    float[] data;
+} vertex_blocks[MAX_VERTEX_BLOCKS];
+
+vertex_t fetch_vertex(in object_info_t object_info) {
+    if (!parameters.vertex_pulling) {
+        return vertex_t(i_position, i_normal, i_uv, i_tangent);
+    }
+    // gl_VertexID already includes the base vertex, the block is dynamically uniform since it comes from gl_BaseInstance
+    const uint block = object_info.vertex_block;
+    const uint base = gl_VertexID * object_info.vertex_stride;
+    vertex_t vertex;
+    vertex.position = vec3(vertex_blocks[block].data[base + 0], vertex_blocks[block].data[base + 1], vertex_blocks[block].data[base + 2]);
+    vertex.normal = vec3(vertex_blocks[block].data[base + 3], vertex_blocks[block].data[base + 4], vertex_blocks[block].data[base + 5]);
+    vertex.uv = vec2(vertex_blocks[block].data[base + 6], vertex_blocks[block].data[base + 7]);
+    vertex.tangent = vec4(
+        vertex_blocks[block].data[base + 8],
+        vertex_blocks[block].data[base + 9],
+        vertex_blocks[block].data[base + 10],
+        vertex_blocks[block].data[base + 11]);
+    return vertex;
+}
+
+mat3 mat3_make_tbn(in mat3 transform, in vec3 normal, in vec4 tangent) {
+    const vec3 bitangent = cross(normal, tangent.xyz) * tangent.w;
+    const vec3 T = normalize(transform * tangent.xyz);
     const vec3 B = normalize(transform * bitangent);
-    const vec3 N = normalize(transform * i_normal);
+    const vec3 N = normalize(transform * normal);
     return mat3(T, B, N);
 }
 
 void main() {
-    const uint object_id = object_shift[gl_DrawID + u_group_offset].object_id;
+    // the culling pass writes the object index as the base instance of every command
+    const uint object_id = gl_BaseInstance;
     const object_info_t object_info = objects[object_id];
+    const vertex_t vertex = fetch_vertex(object_info);
     const mat4 global_transform = global_transforms[object_info.global_transform];
     const mat4 local_transform = local_transforms[object_info.local_transform];
     const mat4 transform = global_transform * local_transform;
     const mat4 inv_transform = transpose(inverse(transform));
-    const mat3 TBN = mat3_make_tbn(mat3(transform));
+    const mat3 TBN = mat3_make_tbn(mat3(transform), vertex.normal, vertex.tangent);
     const mat4 prev_transform =
         prev_global_transforms[object_info.global_transform] *
         prev_local_transforms[object_info.local_transform];
-    const vec3 frag_pos = vec3(transform * vec4(i_position, 1.0));
-    const vec4 prev_clip_pos = prev_camera.pv * prev_transform * vec4(i_position, 1.0);
+    const vec3 frag_pos = vec3(transform * vec4(vertex.position, 1.0));
+    const vec4 prev_clip_pos = prev_camera.pv * prev_transform * vec4(vertex.position, 1.0);
     const vec4 clip_pos = camera.pv * vec4(frag_pos, 1.0);
 
     o_diffuse_texture = object_info.diffuse_texture;
     o_normal_texture = object_info.normal_texture;
     o_specular_texture = object_info.specular_texture;
-    o_normal = normalize(mat3(inv_transform) * i_normal);
-    o_uv = i_uv;
+    o_normal = normalize(mat3(inv_transform) * vertex.normal);
+    o_uv = vertex.uv;
     o_object_id = object_id;
     o_frag_pos = frag_pos;
     o_TBN = TBN;
     o_clip_pos = clip_pos;
     o_prev_clip_pos = prev_clip_pos;
-    gl_Position = clip_pos + vec4(u_jitter * clip_pos.w, 0.0, 0.0);
+    gl_Position = clip_pos + vec4(parameters.jitter * clip_pos.w, 0.0, 0.0);
 }
@@ -1,48 +1,7 @@
 #version 460 core
-#define CASCADE_COUNT 4
 
-struct cascade_data_t {
-    mat4 projection;
-    mat4 view;
-    mat4 pv;
-    mat4 global;
-    vec4 scale;
-    vec4 offset; // w is split
-};
-
-struct indirect_command_t {
-    uint count;
-    uint instance_count;
-    uint first_index;
-    int base_vertex;
-    uint base_instance;
-};
-
-struct aabb_t {
-    vec4 min;
-    vec4 max;
-    vec4 center;
-    vec4 size;
-};
-
-struct object_info_t {
-    uint local_transform;
-    uint global_transform;
-    uint diffuse_texture;
-    uint normal_texture;
-    uint specular_texture;
-    uint group_index;
-    uint group_offset;
-
-    vec4 scale;
-    vec4 sphere; // w is radius
-    aabb_t aabb;
-    indirect_command_t command;
-};
-
-struct object_index_shift_t {
-    uint object_id;
-};
+#include "include/scene.glsl"
+#include "include/shadow.glsl"
 
 layout (location = 0) in vec3 i_position;
 layout (location = 1) in vec3 i_normal;
@@ -52,8 +11,11 @@ layout (location = 3) in vec4 i_tangent;
 layout (location = 0) out flat uint o_diffuse_texture;
 layout (location = 1) out vec2 o_uv;
 
-layout (location = 0) uniform uint layer;
-layout (location = 1) uniform uint group_offset;
+// per cascade values, sub-allocated from the parameter ring, mirrors shadow_parameters_t
+layout (std140, binding = PASS_PARAMETERS_BINDING) uniform u_pass_parameters {
+    uint layer;
+    bool vertex_pulling;
+} parameters;
 
 layout (std430, binding = 0) readonly restrict buffer b_cascade_output {
     cascade_data_t[CASCADE_COUNT] cascades;
@@ -71,16 +33,38 @@ layout (std430, binding = 3) readonly restrict buffer b_object_info {
     object_info_t[] objects;
 };
 
-layout (std430, binding = 4) restrict buffer b_object_index_shift {
-    object_index_shift_t[] object_shift;
-};
+// mesh pool vertex blocks, only read when pulling vertices
+layout (std430, binding = 16) readonly restrict buffer b_vertex_block {
+    float[] data;
+} vertex_blocks[MAX_VERTEX_BLOCKS];
+
+vertex_t fetch_vertex(in object_info_t object_info) {
+    if (!parameters.vertex_pulling) {
+        return vertex_t(i_position, i_normal, i_uv, i_tangent);
+    }
+    // gl_VertexID already includes the base vertex, the block is dynamically uniform since it comes from gl_BaseInstance
+    const uint block = object_info.vertex_block;
+    const uint base = gl_VertexID * object_info.vertex_stride;
+    vertex_t vertex;
+    vertex.position = vec3(vertex_blocks[block].data[base + 0], vertex_blocks[block].data[base + 1], vertex_blocks[block].data[base + 2]);
+    vertex.normal = vec3(vertex_blocks[block].data[base + 3], vertex_blocks[block].data[base + 4], vertex_blocks[block].data[base + 5]);
+    vertex.uv = vec2(vertex_blocks[block].data[base + 6], vertex_blocks[block].data[base + 7]);
+    vertex.tangent = vec4(
+        vertex_blocks[block].data[base + 8],
+        vertex_blocks[block].data[base + 9],
+        vertex_blocks[block].data[base + 10],
+        vertex_blocks[block].data[base + 11]);
+    return vertex;
+}
 
 void main() {
-    const object_info_t object_info = objects[object_shift[gl_DrawID + group_offset].object_id];
+    // the culling pass writes the object index as the base instance of every command
+    const object_info_t object_info = objects[gl_BaseInstance];
     const mat4 global_transform = global_transforms[object_info.global_transform];
     const mat4 local_transform = local_transforms[object_info.local_transform];
     const mat4 transform = global_transform * local_transform;
-    gl_Position = cascades[layer].pv * transform * vec4(i_position, 1.0);
+    const vertex_t vertex = fetch_vertex(object_info);
+    gl_Position = cascades[parameters.layer].pv * transform * vec4(vertex.position, 1.0);
     o_diffuse_texture = object_info.diffuse_texture;
-    o_uv = i_uv;
+    o_uv = vertex.uv;
 }
@@ -0,0 +1,12 @@
+#version 460 core
+
+layout (early_fragment_tests) in;
+
+layout (location = 0) in flat uint i_object_id;
+
+// x => object id + 1 (0 is empty), y => triangle id relative to the object's first index
+layout (location = 0) out uvec2 o_visibility;
+
+void main() {
+    o_visibility = uvec2(i_object_id + 1, gl_PrimitiveID);
+}
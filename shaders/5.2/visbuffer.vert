@@ -0,0 +1,68 @@
+#version 460 core
+
+invariant gl_Position;
+
+#include "include/scene.glsl"
+
+layout (location = 0) in vec3 i_position;
+layout (location = 1) in vec3 i_normal;
+layout (location = 2) in vec2 i_uv;
+layout (location = 3) in vec4 i_tangent;
+
+layout (location = 0) out flat uint o_object_id;
+
+// per pass values, sub-allocated from the parameter ring, mirrors prepass_parameters_t
+layout (std140, binding = PASS_PARAMETERS_BINDING) uniform u_pass_parameters {
+    vec2 jitter;
+    bool vertex_pulling;
+} parameters;
+
+#include "include/camera.glsl"
+
+layout (std430, binding = 1) readonly restrict buffer b_local_transform {
+    mat4[] local_transforms;
+};
+
+layout (std430, binding = 2) readonly restrict buffer b_global_transform {
+    mat4[] global_transforms;
+};
+
+layout (std430, binding = 3) readonly restrict buffer b_object_info {
+    object_info_t[] objects;
+};
+
+// mesh pool vertex blocks, only read when pulling vertices
+layout (std430, binding = 16) readonly restrict buffer b_vertex_block {
+    float[] data;
+} vertex_blocks[MAX_VERTEX_BLOCKS];
+
+vertex_t fetch_vertex(in object_info_t object_info) {
+    if (!parameters.vertex_pulling) {
+        return vertex_t(i_position, i_normal, i_uv, i_tangent);
+    }
+    // gl_VertexID already includes the base vertex, the block is dynamically uniform since it comes from gl_BaseInstance
+    const uint block = object_info.vertex_block;
+    const uint base = gl_VertexID * object_info.vertex_stride;
+    vertex_t vertex;
+    vertex.position = vec3(vertex_blocks[block].data[base + 0], vertex_blocks[block].data[base + 1], vertex_blocks[block].data[base + 2]);
+    vertex.normal = vec3(vertex_blocks[block].data[base + 3], vertex_blocks[block].data[base + 4], vertex_blocks[block].data[base + 5]);
+    vertex.uv = vec2(vertex_blocks[block].data[base + 6], vertex_blocks[block].data[base + 7]);
+    vertex.tangent = vec4(
+        vertex_blocks[block].data[base + 8],
+        vertex_blocks[block].data[base + 9],
+        vertex_blocks[block].data[base + 10],
+        vertex_blocks[block].data[base + 11]);
+    return vertex;
+}
+
+void main() {
+    // the culling pass writes the object index as the base instance of every command
+    const uint object_id = gl_BaseInstance;
+    const object_info_t object_info = objects[object_id];
+    const mat4 global_transform = global_transforms[object_info.global_transform];
+    const mat4 local_transform = local_transforms[object_info.local_transform];
+    const mat4 transform = global_transform * local_transform;
+    const vec4 clip_pos = camera.pv * transform * vec4(fetch_vertex(object_info).position, 1.0);
+    o_object_id = object_id;
+    gl_Position = clip_pos + vec4(parameters.jitter * clip_pos.w, 0.0, 0.0);
+}
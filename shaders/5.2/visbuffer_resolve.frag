@@ -0,0 +1,304 @@
+#version 460 core
+#extension GL_ARB_bindless_texture : enable
+
+#define M_PI 3.1415926535897932384626433832795
+#define M_GOLDEN 1.6180339887498948482045868343656
+#define M_GOLDEN_CONJ 0.6180339887498948482045868343656
+
+#include "include/scene.glsl"
+// SHADOW_FILTER picks the filter at build time, one permutation per mode
+#include "include/shadow.glsl"
+#include "include/lights.glsl"
+
+struct barycentric_deriv_t {
+    vec3 lambda;
+    vec3 ddx;
+    vec3 ddy;
+};
+
+layout (location = 0) out vec4 o_pixel;
+layout (location = 1) out vec2 o_velocity;
+
+layout (binding = 0) uniform usampler2D u_visibility;
+layout (binding = 1) uniform sampler2DArrayShadow u_shadow_map;
+layout (binding = 2) uniform sampler2D u_blue_noise;
+layout (binding = 3) uniform sampler2DArray u_shadow_depth;
+
+// per pass values, sub-allocated from the parameter ring, mirrors lighting_parameters_t
+layout (std140, binding = PASS_PARAMETERS_BINDING) uniform u_pass_parameters {
+    vec2 jitter;
+    vec2 resolution;
+    bool vertex_pulling;
+    uint shadow_max_taps;
+} parameters;
+
+#include "include/camera.glsl"
+
+layout (std430, binding = 1) readonly restrict buffer b_local_transform {
+    mat4[] local_transforms;
+};
+
+layout (std430, binding = 2) readonly restrict buffer b_global_transform {
+    mat4[] global_transforms;
+};
+
+layout (std430, binding = 3) readonly restrict buffer b_object_info {
+    object_info_t[] objects;
+};
+
+layout (std140, binding = 5) uniform u_directional_lights {
+    directional_light_t[4] directional_lights;
+};
+
+layout (std430, binding = 6) readonly restrict buffer b_texture {
+    sampler2D[] textures;
+};
+
+layout (std430, binding = 7) readonly restrict buffer b_cascade_output {
+    cascade_data_t[CASCADE_COUNT] cascades;
+};
+
+layout (std430, binding = 13) readonly restrict buffer b_point_lights {
+    point_light_t[] point_lights;
+};
+
+layout (std430, binding = 14) readonly restrict buffer b_cluster_light_count {
+    uint[] cluster_light_count;
+};
+
+layout (std430, binding = 15) readonly restrict buffer b_cluster_light_index {
+    uint[] cluster_light_index;
+};
+
+layout (std140, binding = 8) uniform u_prev_camera {
+    mat4 inf_projection;
+    mat4 projection;
+    mat4 view;
+    mat4 pv;
+    vec3 position;
+    float near;
+    float far;
+} prev_camera;
+
+layout (std430, binding = 9) readonly restrict buffer b_prev_local_transform {
+    mat4[] prev_local_transforms;
+};
+
+layout (std430, binding = 10) readonly restrict buffer b_prev_global_transform {
+    mat4[] prev_global_transforms;
+};
+
+// the whole mesh pool, the resolve is only available when it fits in a single index block
+layout (std430, binding = 12) readonly restrict buffer b_indices {
+    uint[] indices;
+};
+
+layout (std430, binding = 16) readonly restrict buffer b_vertex_block {
+    float[] data;
+} vertex_blocks[MAX_VERTEX_BLOCKS];
+
+#include "include/shadow_sampling.glsl"
+#include "include/shading.glsl"
+
+#if MAX_VERTEX_BLOCKS != 4
+#error "fetch_vertex_data names every vertex block"
+#endif
+
+// the block differs per pixel and storage block arrays need a dynamically uniform index,
+// so every block is read through a constant index instead
+float fetch_vertex_data(in uint block, in uint offset) {
+    switch (block) {
+        case 0: return vertex_blocks[0].data[offset];
+        case 1: return vertex_blocks[1].data[offset];
+        case 2: return vertex_blocks[2].data[offset];
+        default: return vertex_blocks[3].data[offset];
+    }
+}
+
+vertex_t fetch_vertex(in uint block, in uint index, in uint stride) {
+    const uint base = index * stride;
+    float v[12];
+    for (uint i = 0; i < 12; ++i) {
+        v[i] = fetch_vertex_data(block, base + i);
+    }
+    vertex_t vertex;
+    vertex.position = vec3(v[0], v[1], v[2]);
+    vertex.normal = vec3(v[3], v[4], v[5]);
+    vertex.uv = vec2(v[6], v[7]);
+    vertex.tangent = vec4(v[8], v[9], v[10], v[11]);
+    return vertex;
+}
+
+// perspective correct barycentrics and their screen space derivatives, the rasterizer did this for us in main.frag
+barycentric_deriv_t calculate_barycentrics(in vec4 p0, in vec4 p1, in vec4 p2, in vec2 ndc, in vec2 resolution) {
+    const vec3 inv_w = 1.0 / vec3(p0.w, p1.w, p2.w);
+    const vec2 ndc0 = p0.xy * inv_w.x;
+    const vec2 ndc1 = p1.xy * inv_w.y;
+    const vec2 ndc2 = p2.xy * inv_w.z;
+
+    const float inv_det = 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+    vec3 ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * inv_det * inv_w;
+    vec3 ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * inv_det * inv_w;
+    float ddx_sum = dot(ddx, vec3(1.0));
+    float ddy_sum = dot(ddy, vec3(1.0));
+
+    const vec2 delta = ndc - ndc0;
+    const float interp_inv_w = inv_w.x + delta.x * ddx_sum + delta.y * ddy_sum;
+    const vec3 lambda_w = vec3(inv_w.x, 0.0, 0.0) + delta.x * ddx + delta.y * ddy;
+
+    // one pixel in ndc
+    ddx *= 2.0 / resolution.x;
+    ddy *= 2.0 / resolution.y;
+    ddx_sum *= 2.0 / resolution.x;
+    ddy_sum *= 2.0 / resolution.y;
+
+    barycentric_deriv_t result;
+    result.lambda = lambda_w / interp_inv_w;
+    result.ddx = (lambda_w + ddx) / (interp_inv_w + ddx_sum) - result.lambda;
+    result.ddy = (lambda_w + ddy) / (interp_inv_w + ddy_sum) - result.lambda;
+    return result;
+}
+
+vec3 interpolate(in vec3 lambda, in vec3 a, in vec3 b, in vec3 c) {
+    return lambda.x * a + lambda.y * b + lambda.z * c;
+}
+
+vec2 interpolate(in vec3 lambda, in vec2 a, in vec2 b, in vec2 c) {
+    return lambda.x * a + lambda.y * b + lambda.z * c;
+}
+
+vec4 interpolate(in vec3 lambda, in vec4 a, in vec4 b, in vec4 c) {
+    return lambda.x * a + lambda.y * b + lambda.z * c;
+}
+
+mat3 mat3_make_tbn(in mat3 transform, in vec3 normal, in vec4 tangent) {
+    const vec3 bitangent = cross(normal, tangent.xyz) * tangent.w;
+    const vec3 T = normalize(transform * tangent.xyz);
+    const vec3 B = normalize(transform * bitangent);
+    const vec3 N = normalize(transform * normal);
+    return mat3(T, B, N);
+}
+
+vec3 calculate_shadow(in directional_light_t light,
+                      in vec3 normal,
+                      in vec3 frag_pos,
+                      in vec3 ddx_frag_pos,
+                      in vec3 ddy_frag_pos,
+                      in float depth_vs,
+                      in uint cascade) {
+    // derivatives come from the analytic barycentrics, neighbouring pixels may belong to another triangle
+    const vec3 shadow_frag_pos = vec3(cascades[cascade].global * vec4(frag_pos, 1.0));
+    const vec3 ddx_shadow_frag_pos = mat3(cascades[cascade].global) * ddx_frag_pos;
+    const vec3 ddy_shadow_frag_pos = mat3(cascades[cascade].global) * ddy_frag_pos;
+    vec3 shadow_factor = sample_shadow(
+        shadow_frag_pos,
+        ddx_shadow_frag_pos,
+        ddy_shadow_frag_pos,
+        light.direction,
+        normal,
+        depth_vs,
+        cascade);
+
+    const float blend_threshold = 0.175;
+    const float next_split = cascades[cascade].offset.w;
+    const float split_size = cascade == 0 ? next_split : next_split - cascades[cascade - 1].offset.w;
+    const float split_distance = (next_split - depth_vs) / split_size;
+    if (split_distance <= blend_threshold && cascade != CASCADE_COUNT - 1) {
+        const vec3 next_shadow_factor = sample_shadow(
+            shadow_frag_pos,
+            ddx_shadow_frag_pos,
+            ddy_shadow_frag_pos,
+            light.direction,
+            normal,
+            depth_vs,
+            cascade + 1);
+        const float t_lerp = smoothstep(0.0, blend_threshold, split_distance);
+        shadow_factor = mix(next_shadow_factor, shadow_factor, t_lerp);
+    }
+
+    return shadow_factor;
+}
+
+vec2 calculate_velocity(in vec4 clip_pos, in vec4 prev_clip_pos) {
+    clip_pos /= clip_pos.w;
+    prev_clip_pos /= prev_clip_pos.w;
+
+    return prev_clip_pos.xy - clip_pos.xy;
+}
+
+void main() {
+    const uvec2 visibility = texelFetch(u_visibility, ivec2(gl_FragCoord.xy), 0).xy;
+    if (visibility.x == 0) {
+        discard;
+    }
+    const uint object_id = visibility.x - 1;
+    const object_info_t object_info = objects[object_id];
+    const uint first_index = object_info.command.first_index + visibility.y * 3;
+    const uint base_vertex = uint(object_info.command.base_vertex);
+    const vertex_t v0 = fetch_vertex(object_info.vertex_block, base_vertex + indices[first_index + 0], object_info.vertex_stride);
+    const vertex_t v1 = fetch_vertex(object_info.vertex_block, base_vertex + indices[first_index + 1], object_info.vertex_stride);
+    const vertex_t v2 = fetch_vertex(object_info.vertex_block, base_vertex + indices[first_index + 2], object_info.vertex_stride);
+
+    const mat4 transform =
+        global_transforms[object_info.global_transform] *
+        local_transforms[object_info.local_transform];
+    const mat4 prev_transform =
+        prev_global_transforms[object_info.global_transform] *
+        prev_local_transforms[object_info.local_transform];
+    const mat4 inv_transform = transpose(inverse(transform));
+
+    // must match the projection used by visbuffer.vert
+    vec4 p0 = camera.pv * transform * vec4(v0.position, 1.0);
+    vec4 p1 = camera.pv * transform * vec4(v1.position, 1.0);
+    vec4 p2 = camera.pv * transform * vec4(v2.position, 1.0);
+    p0.xy += parameters.jitter * p0.w;
+    p1.xy += parameters.jitter * p1.w;
+    p2.xy += parameters.jitter * p2.w;
+    const vec2 ndc = (gl_FragCoord.xy / parameters.resolution) * 2.0 - 1.0;
+    const barycentric_deriv_t bary = calculate_barycentrics(p0, p1, p2, ndc, parameters.resolution);
+
+    const vec3 position = interpolate(bary.lambda, v0.position, v1.position, v2.position);
+    const vec3 frag_pos = vec3(transform * vec4(position, 1.0));
+    const vec3 ddx_frag_pos = mat3(transform) * interpolate(bary.ddx, v0.position, v1.position, v2.position);
+    const vec3 ddy_frag_pos = mat3(transform) * interpolate(bary.ddy, v0.position, v1.position, v2.position);
+    const vec2 uv = interpolate(bary.lambda, v0.uv, v1.uv, v2.uv);
+    const vec2 ddx_uv = interpolate(bary.ddx, v0.uv, v1.uv, v2.uv);
+    const vec2 ddy_uv = interpolate(bary.ddy, v0.uv, v1.uv, v2.uv);
+    const vec3 vertex_normal = interpolate(bary.lambda, v0.normal, v1.normal, v2.normal);
+    const vec4 vertex_tangent = interpolate(bary.lambda, v0.tangent, v1.tangent, v2.tangent);
+
+    const float ambient_factor = 0.025;
+    vec3 diffuse = vec3(1.0);
+    if (object_info.diffuse_texture != -1) {
+        diffuse = textureGrad(textures[object_info.diffuse_texture], uv, ddx_uv, ddy_uv).rgb;
+    }
+    vec3 normal = normalize(mat3(inv_transform) * vertex_normal);
+    if (object_info.normal_texture != -1) {
+        const mat3 TBN = mat3_make_tbn(mat3(transform), vertex_normal, vertex_tangent);
+        normal = normalize(TBN * (textureGrad(textures[object_info.normal_texture], uv, ddx_uv, ddy_uv).rgb * 2.0 - 1.0));
+    }
+    vec3 specular = vec3(0.0);
+#if !defined(DISABLE_SPECULAR)
+    if (object_info.specular_texture != -1) {
+        specular = textureGrad(textures[object_info.specular_texture], uv, ddx_uv, ddy_uv).rgb;
+    }
+#endif
+    const vec4 clip_pos = camera.pv * vec4(frag_pos, 1.0);
+    const vec4 prev_clip_pos = prev_camera.pv * prev_transform * vec4(position, 1.0);
+    const float depth_vs = clip_pos.w;
+    const uint cascade = calculate_cascade(depth_vs);
+
+    vec3 color = diffuse * ambient_factor;
+    const uint cluster = calculate_cluster(gl_FragCoord.xy, depth_vs);
+    const uint cluster_lights = cluster_light_count[cluster];
+    for (uint i = 0; i < cluster_lights; ++i) {
+        const uint light_index = cluster_light_index[cluster * MAX_LIGHTS_PER_CLUSTER + i];
+        color += calculate_point_light(point_lights[light_index], diffuse, specular, normal, frag_pos);
+    }
+    color +=
+        calculate_directional_light(directional_lights[0], diffuse, specular, normal, frag_pos) *
+        calculate_shadow(directional_lights[0], normal, frag_pos, ddx_frag_pos, ddy_frag_pos, depth_vs, cascade);
+
+    o_pixel = vec4(as_srgb(color), 1.0);
+    o_velocity = calculate_velocity(clip_pos, prev_clip_pos);
+}
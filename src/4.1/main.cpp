@@ -379,9 +379,9 @@ int main() {
 
     // texture loading
     auto textures = std::vector<iris::texture_t>();
-    textures.emplace_back(iris::texture_t::create("../textures/wall.jpg", iris::texture_type_t::non_linear_r8g8b8a8_unorm));
-    textures.emplace_back(iris::texture_t::create("../textures/container.png", iris::texture_type_t::non_linear_r8g8b8a8_unorm));
-    textures.emplace_back(iris::texture_t::create("../textures/container_specular.png", iris::texture_type_t::non_linear_r8g8b8a8_unorm));
+    textures.emplace_back(iris::texture_t::create("../textures/wall.jpg", iris::texture_type_t::non_linear_r8g8b8a8_unorm, true, true));
+    textures.emplace_back(iris::texture_t::create("../textures/container.png", iris::texture_type_t::non_linear_r8g8b8a8_unorm, true, true));
+    textures.emplace_back(iris::texture_t::create("../textures/container_specular.png", iris::texture_type_t::non_linear_r8g8b8a8_unorm, true, true));
 
     // blue noise
     auto blue_noise_shadow = iris::texture_t::create("../textures/1024_1024/LDR_RGBA_0.png", iris::texture_type_t::linear_r8g8_unorm);
@@ -3,11 +3,21 @@
 #include <shader.hpp>
 #include <camera.hpp>
 #include <buffer.hpp>
+#include <bvh.hpp>
+#include <texture.hpp>
+#include <model.hpp>
+#include <mesh_pool.hpp>
+#include <raytracing_scene.hpp>
+#include <gl_state.hpp>
 
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include <imgui.h>
+#include <imgui_impl_glfw.h>
+#include <imgui_impl_opengl3.h>
+
 #include <iostream>
 #include <optional>
 #include <random>
@@ -15,12 +25,16 @@
 #include <vector>
 #include <thread>
 #include <array>
+#include <string>
 #include <span>
 
 using namespace iris::literals;
 
 struct camera_data_t {
     glm::mat4 inv_pv;
+    // of the last frame, the denoiser reprojects its history with them
+    glm::mat4 prev_pv;
+    glm::mat4 prev_inv_pv;
 };
 
 enum hittable_type_t : iris::uint32 {
@@ -38,6 +52,8 @@ struct sphere_t {
     glm::vec3 center = {};
     iris::float32 radius = 0;
     iris::uint32 material_id = 0;
+    // set for spheres that emit, see light_t
+    iris::uint32 light_id = -1_u32;
 };
 
 struct _proxy_hittable_t {
@@ -79,7 +95,150 @@ struct _proxy_material_t {
     iris::uint32 _data[8];
 };
 
-int main() {
+// an emissive sphere that next event estimation samples
+struct light_t {
+    glm::vec3 center = {};
+    iris::float32 radius = 0;
+    glm::vec3 radiance = {};
+    iris::uint32 _pad0 = 0;
+};
+
+// E_INTEGRATOR_* in shaders/4.2/include/scene.glsl
+enum integrator_flag_t : iris::uint32 {
+    integrator_light_sampling = 1,
+    integrator_russian_roulette = 2,
+};
+
+// mirrors of the wavefront state in shaders/4.2/include/wavefront.glsl, only their sizes are used here
+struct wavefront_path_t {
+    glm::vec3 origin = {};
+    iris::uint32 state = 0;
+    glm::vec3 direction = {};
+    iris::uint32 hits = 0;
+    glm::vec3 color = {};
+    iris::float32 bsdf_pdf = 0.0f;
+    glm::vec3 incoming_light = {};
+    iris::uint32 _pad1 = 0;
+};
+static_assert(sizeof(wavefront_path_t) == 64);
+
+struct wavefront_path_hit_t {
+    glm::vec3 point = {};
+    iris::uint32 material_id = 0;
+    glm::vec3 normal = {};
+    iris::uint32 front_face = 0;
+    glm::vec2 uv = {};
+    iris::uint32 texture = 0;
+    iris::uint32 light = 0;
+};
+static_assert(sizeof(wavefront_path_hit_t) == 48);
+
+struct wavefront_shadow_ray_t {
+    glm::vec3 direction = {};
+    iris::float32 t_max = 0.0f;
+    glm::vec3 light = {};
+    iris::uint32 _pad0 = 0;
+};
+static_assert(sizeof(wavefront_shadow_ray_t) == 32);
+
+struct dispatch_indirect_t {
+    iris::uint32 x = 0;
+    iris::uint32 y = 0;
+    iris::uint32 z = 0;
+};
+
+// two ray queues, one queue per material type and the shadow rays
+constexpr auto wavefront_queue_count = 6_u32;
+constexpr auto wavefront_samples = 4_u32;
+constexpr auto wavefront_max_bounces = 32_u32;
+
+struct wavefront_buffers_t {
+    iris::buffer_t paths;
+    iris::buffer_t path_hits;
+    // the queue counts and capacity, then the queues
+    iris::buffer_t queues;
+    iris::buffer_t dispatches;
+    iris::buffer_t radiance;
+    iris::buffer_t shadow_rays;
+};
+
+static auto make_wavefront_buffers(iris::uint32 width, iris::uint32 height) noexcept -> wavefront_buffers_t {
+    const auto path_count = width * height;
+    auto buffers = wavefront_buffers_t {
+        iris::buffer_t::create(sizeof(wavefront_path_t) * path_count, GL_SHADER_STORAGE_BUFFER, GL_NONE),
+        iris::buffer_t::create(sizeof(wavefront_path_hit_t) * path_count, GL_SHADER_STORAGE_BUFFER, GL_NONE),
+        iris::buffer_t::create(sizeof(iris::uint32) * (wavefront_queue_count + 1 + wavefront_queue_count * path_count), GL_SHADER_STORAGE_BUFFER, GL_NONE),
+        iris::buffer_t::create(sizeof(dispatch_indirect_t[5]), GL_DISPATCH_INDIRECT_BUFFER, GL_NONE),
+        iris::buffer_t::create(sizeof(glm::vec4) * path_count, GL_SHADER_STORAGE_BUFFER, GL_NONE),
+        iris::buffer_t::create(sizeof(wavefront_shadow_ray_t) * path_count, GL_SHADER_STORAGE_BUFFER, GL_NONE),
+    };
+    // the capacity follows the queue counts
+    glClearNamedBufferSubData(
+        buffers.queues.id(),
+        GL_R32UI,
+        sizeof(iris::uint32) * wavefront_queue_count,
+        sizeof(iris::uint32),
+        GL_RED_INTEGER,
+        GL_UNSIGNED_INT,
+        &path_count);
+    return buffers;
+}
+
+// written by accumulate.comp
+struct convergence_stats_t {
+    iris::uint32 converged_pixels = 0;
+    // relative errors clamped to 1 in 1/256 steps
+    iris::uint32 error_sum = 0;
+};
+
+// stats are read back through a persistently mapped ring, a slot is read once its frame finished on the GPU
+constexpr auto convergence_stats_frames = 3_u32;
+// pixels that have to converge before the image counts as converged
+constexpr auto converged_fraction = 0.99f;
+// every frame traces 4 samples per pixel, a pixel is only checked for convergence after this many frames
+constexpr auto convergence_min_frames = 8_u32;
+
+struct convergence_stats_slot_t {
+    iris::buffer_t buffer;
+    GLsync fence = nullptr;
+    // accumulation the slot belongs to, stats of an older one are dropped
+    iris::uint32 epoch = 0;
+    // when the frame was submitted
+    iris::float32 time = 0.0f;
+};
+
+// a-trous iterations of the denoiser, the taps of the last one are 16 pixels apart
+constexpr auto denoise_iterations = 5_u32;
+
+// the denoiser filters the illumination, the color divided by the albedo of the primary hit
+struct denoise_targets_t {
+    // rgb: illumination averaged over the history, a: variance of its luminance
+    iris::framebuffer_attachment_t illumination;
+    // x: mean luminance of the frames in the history, y: mean of its square, z: frames in the history
+    iris::framebuffer_attachment_t moments;
+    // illumination and moments of the last frame
+    iris::framebuffer_attachment_t history;
+    iris::framebuffer_attachment_t history_moments;
+    iris::framebuffer_attachment_t prev_normal_depth;
+    // the iterations alternate between both, the color ends up in the one of the last iteration
+    iris::framebuffer_attachment_t filtered[2];
+};
+
+static auto make_denoise_targets(iris::uint32 width, iris::uint32 height) noexcept -> denoise_targets_t {
+    const auto make_target = [&]() {
+        return iris::framebuffer_attachment_t::create(width, height, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    };
+    return {
+        make_target(),
+        make_target(),
+        make_target(),
+        make_target(),
+        make_target(),
+        { make_target(), make_target() },
+    };
+}
+
+int main(int argc, char** argv) {
     if (!glfwInit()) {
         std::cout << "failed to initialize GLFW" << std::endl;
         return -1;
@@ -132,7 +291,26 @@ int main() {
 #endif
 
     auto average_shader = iris::shader_t::create("../shaders/4.2/average.vert", "../shaders/4.2/average.frag");
+    auto accumulate_shader = iris::shader_t::create_compute("../shaders/4.2/accumulate.comp");
     auto trace_shader = iris::shader_t::create("../shaders/4.2/trace.vert", "../shaders/4.2/trace.frag");
+    // wavefront mode: instead of one invocation running a whole path, every bounce is split into an intersection
+    // pass and a shading pass per material type. paths move between them through queues, each pass is dispatched
+    // indirectly over its queue so invocations of a group take the same branches
+    auto wavefront_generate_shader = iris::shader_t::create_compute("../shaders/4.2/wavefront_generate.comp");
+    auto wavefront_intersect_shader = iris::shader_t::create_compute("../shaders/4.2/wavefront_intersect.comp");
+    auto wavefront_prepare_shader = iris::shader_t::create_compute("../shaders/4.2/wavefront_prepare.comp");
+    auto wavefront_resolve_shader = iris::shader_t::create_compute("../shaders/4.2/wavefront_resolve.comp");
+    auto wavefront_shadow_shader = iris::shader_t::create_compute("../shaders/4.2/wavefront_shadow.comp");
+    // SVGF style: the samples of a frame are added to a history reprojected from the last frames, then a-trous
+    // iterations filter the result. both are guided by the normals, distances and albedos of the primary hits
+    auto denoise_temporal_shader = iris::shader_t::create_compute("../shaders/4.2/denoise_temporal.comp");
+    auto denoise_atrous_shader = iris::shader_t::create_compute("../shaders/4.2/denoise_atrous.comp");
+    auto wavefront_shade_shaders = std::vector<iris::shader_t>();
+    for (const auto type : { material_type_lambertian, material_type_metal, material_type_dielectric }) {
+        wavefront_shade_shaders.emplace_back(iris::shader_t::create_compute(
+            "../shaders/4.2/wavefront_shade.comp",
+            std::to_array<iris::shader_define_t>({ { "MATERIAL_TYPE", std::to_string(type) } })));
+    }
 
     // empty VAO
     auto vao = 0_u32;
@@ -164,65 +342,55 @@ int main() {
         window.cursor_position = {};
     });
 
-    auto color_attachment = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    ImGui::CreateContext();
+    ImGui::StyleColorsClassic();
+    ImGui_ImplGlfw_InitForOpenGL(window.handle, true);
+    ImGui_ImplOpenGL3_Init("#version 460 core");
+
+    // the samples of one frame, summed up in float precision by accumulate.comp
+    auto color_attachment = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    // the hits of the rays through the pixel centers, xyz: normal, w: distance or 0 for the sky
+    auto normal_depth_attachment = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    auto albedo_attachment = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
     auto color_framebuffer = iris::framebuffer_t::create({
-        std::cref(color_attachment)
+        std::cref(color_attachment),
+        std::cref(normal_depth_attachment),
+        std::cref(albedo_attachment)
     });
-
-    auto old_color = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
-    auto old_color_framebuffer = iris::framebuffer_t::create({
-        std::cref(old_color)
+    constexpr auto draw_attachments = std::to_array<GLenum>({
+        GL_COLOR_ATTACHMENT0,
+        GL_COLOR_ATTACHMENT1,
+        GL_COLOR_ATTACHMENT2,
     });
+    glNamedFramebufferDrawBuffers(color_framebuffer.id(), draw_attachments.size(), draw_attachments.data());
+    auto accumulation = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    auto moments = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    auto denoise_targets = make_denoise_targets(window.width, window.height);
+    auto is_denoised = true;
+    // unset until the denoiser ran once on targets of the current size
+    auto is_denoise_history_valid = false;
+
+    auto convergence_stats = std::vector<convergence_stats_slot_t>(convergence_stats_frames);
+    for (auto& slot : convergence_stats) {
+        constexpr auto flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        slot.buffer = iris::buffer_t::create(sizeof(convergence_stats_t), GL_SHADER_STORAGE_BUFFER, flags, true);
+    }
+    auto is_adaptive = true;
+    auto show_convergence = false;
+    auto error_threshold = 0.02f;
+    // reset with the accumulation
+    auto epoch = 0_u32;
+    auto epoch_start = 0.0f;
+    auto last_stats = convergence_stats_t();
+    // seconds until converged_fraction of the pixels converged, negative until then
+    auto time_to_threshold = -1.0f;
 
     // uniform buffer
     auto camera_data = camera_data_t();
     auto camera_buffer = iris::buffer_t::create(iris::size_bytes(camera_data), GL_UNIFORM_BUFFER);
 
     // object buffer
-    auto sphere = sphere_t();
-
-    auto hittables = std::vector<_proxy_hittable_t>();
-    hittables.resize(16384);
-
-    sphere.hittable.type = hittable_type_sphere;
-    sphere.center = glm::vec3(0.0f, 0.0f, -1.0f);
-    sphere.radius = 0.5f;
-    sphere.material_id = 0;
-    std::memcpy(&hittables[0]._data[0], &sphere, sizeof(sphere_t));
-
-    sphere.hittable.type = hittable_type_sphere;
-    sphere.center = glm::vec3(0.0f, -100.5f, -1.0f);
-    sphere.radius = 100.0f;
-    sphere.material_id = 1;
-    std::memcpy(&hittables[1]._data[0], &sphere, sizeof(sphere_t));
-
-    sphere.hittable.type = hittable_type_sphere;
-    sphere.center = glm::vec3(-1.025, 0.0, -1.0125);
-    sphere.radius = 0.5f;
-    sphere.material_id = 2;
-    std::memcpy(&hittables[2]._data[0], &sphere, sizeof(sphere_t));
-
-    sphere.hittable.type = hittable_type_sphere;
-    sphere.center = glm::vec3(1.0125, 0.0, -1.035);
-    sphere.radius = 0.5f;
-    sphere.material_id = 3;
-    std::memcpy(&hittables[3]._data[0], &sphere, sizeof(sphere_t));
-
-    sphere.hittable.type = hittable_type_sphere;
-    sphere.center = glm::vec3(2.0625, 0.0, -1.035);
-    sphere.radius = 0.5f;
-    sphere.material_id = 4;
-    std::memcpy(&hittables[4]._data[0], &sphere, sizeof(sphere_t));
-
-    sphere.hittable.type = hittable_type_sphere;
-    sphere.center = glm::vec3(520.0, 35.0, 230.0);
-    sphere.radius = 400.0f;
-    sphere.material_id = 5;
-    std::memcpy(&hittables[5]._data[0], &sphere, sizeof(sphere_t));
-
-    auto object_buffer = iris::buffer_t::create(iris::size_bytes(hittables), GL_SHADER_STORAGE_BUFFER);
-    object_buffer.write(hittables.data(), iris::size_bytes(hittables));
-
+    auto spheres = std::vector<sphere_t>();
     auto materials = std::vector<_proxy_material_t>();
     materials.resize(16384);
 
@@ -256,13 +424,161 @@ int main() {
     lambertian.e_strength = 4.0f;
     std::memcpy(&materials[5]._data[0], &lambertian, iris::size_bytes(lambertian));
 
+    // triangles are white lambertians, tinted by their diffuse texture
+    const auto triangle_material = static_cast<iris::uint32>(materials.size() - 1);
+    lambertian = {};
+    lambertian.material.type = material_type_lambertian;
+    lambertian.albedo = glm::vec3(0.8f);
+    std::memcpy(&materials[triangle_material]._data[0], &lambertian, iris::size_bytes(lambertian));
+
+    // a glTF model given on the command line is traced instead of the spheres
+    auto mesh_pool = iris::mesh_pool_t::create();
+    auto model = iris::model_t();
+    auto scene = iris::raytracing_scene_t();
+    if (argc > 1) {
+        model = iris::model_t::create(mesh_pool, argv[1]);
+        scene = iris::raytracing_scene_t::create(model);
+    } else {
+        spheres.push_back({ { hittable_type_sphere }, glm::vec3(0.0f, 0.0f, -1.0f), 0.5f, 0 });
+        spheres.push_back({ { hittable_type_sphere }, glm::vec3(0.0f, -100.5f, -1.0f), 100.0f, 1 });
+        spheres.push_back({ { hittable_type_sphere }, glm::vec3(-1.025, 0.0, -1.0125), 0.5f, 2 });
+        spheres.push_back({ { hittable_type_sphere }, glm::vec3(1.0125, 0.0, -1.035), 0.5f, 3 });
+        spheres.push_back({ { hittable_type_sphere }, glm::vec3(2.0625, 0.0, -1.035), 0.5f, 4 });
+        spheres.push_back({ { hittable_type_sphere }, glm::vec3(520.0, 35.0, 230.0), 400.0f, 5 });
+
+        // a field of small spheres around the big ones, each with its own material
+        iris::seed_random(42);
+        for (auto z = -22_i32; z < 22; ++z) {
+            for (auto x = -22_i32; x < 22; ++x) {
+                const auto center = glm::vec3(
+                    x * 0.5f + iris::random(0.0f, 0.35f),
+                    -0.4f,
+                    z * 0.5f + iris::random(0.0f, 0.35f) - 1.0f);
+                if (glm::length(center - glm::vec3(0.5f, -0.4f, -1.0f)) < 2.2f) {
+                    continue;
+                }
+                const auto material_id = static_cast<iris::uint32>(spheres.size());
+                const auto choice = iris::random(0.0f, 1.0f);
+                if (choice < 0.7f) {
+                    lambertian = {};
+                    lambertian.material.type = material_type_lambertian;
+                    lambertian.albedo = glm::vec3(
+                        iris::random(0.0f, 1.0f),
+                        iris::random(0.0f, 1.0f),
+                        iris::random(0.0f, 1.0f));
+                    std::memcpy(&materials[material_id]._data[0], &lambertian, iris::size_bytes(lambertian));
+                } else if (choice < 0.9f) {
+                    metal.material.type = material_type_metal;
+                    metal.albedo = glm::vec3(iris::random(0.5f, 1.0f));
+                    metal.fuzz = 0.0f;
+                    std::memcpy(&materials[material_id]._data[0], &metal, iris::size_bytes(metal));
+                } else {
+                    dielectric.material.type = material_type_dielectric;
+                    dielectric.refr_index = 1.5f;
+                    std::memcpy(&materials[material_id]._data[0], &dielectric, iris::size_bytes(dielectric));
+                }
+                spheres.push_back({ { hittable_type_sphere }, center, 0.1f, material_id });
+            }
+        }
+
+        // small lights between the spheres, bounces alone rarely find them
+        const auto add_light = [&](const glm::vec3& center, const glm::vec3& emissive) {
+            const auto material_id = static_cast<iris::uint32>(spheres.size());
+            lambertian = {};
+            lambertian.material.type = material_type_lambertian;
+            lambertian.albedo = glm::vec3(1.0f);
+            lambertian.emissive = emissive;
+            lambertian.e_strength = 30.0f;
+            std::memcpy(&materials[material_id]._data[0], &lambertian, iris::size_bytes(lambertian));
+            spheres.push_back({ { hittable_type_sphere }, center, 0.05f, material_id });
+        };
+        add_light(glm::vec3(-0.5f, 0.6f, -0.6f), glm::vec3(1.0f, 0.6f, 0.3f));
+        add_light(glm::vec3(1.5f, 0.6f, -0.6f), glm::vec3(0.3f, 0.6f, 1.0f));
+        add_light(glm::vec3(0.5f, -0.4f, -0.3f), glm::vec3(1.0f));
+    }
+
+    // every sphere of a lambertian that emits is a light
+    auto lights = std::vector<light_t>();
+    for (auto& each : spheres) {
+        // emissive and e_strength of lambertian_t
+        const auto& material = materials[each.material_id];
+        auto emissive = glm::vec3();
+        auto e_strength = 0.0f;
+        std::memcpy(&emissive, &material._data[4], sizeof(emissive));
+        std::memcpy(&e_strength, &material._data[7], sizeof(e_strength));
+        const auto radiance = emissive * e_strength;
+        if (material._data[0] != material_type_lambertian || !glm::any(glm::greaterThan(radiance, glm::vec3(0.0f)))) {
+            continue;
+        }
+        each.light_id = static_cast<iris::uint32>(lights.size());
+        lights.push_back({ each.center, each.radius, radiance });
+    }
+    iris::log("lights: ", lights.size());
+    // the count is padded to the alignment of the lights
+    const auto light_count = static_cast<iris::uint32>(lights.size());
+    auto light_buffer = iris::buffer_t::create(sizeof(glm::uvec4) + iris::size_bytes(lights), GL_SHADER_STORAGE_BUFFER);
+    light_buffer.write(&light_count, sizeof(light_count));
+    if (!lights.empty()) {
+        light_buffer.write(lights.data(), iris::size_bytes(lights), sizeof(glm::uvec4));
+    }
+
+    // hittables are stored in leaf order so a leaf addresses a contiguous range of them
+    auto hittable_bounds = std::vector<iris::bvh_bounds_t>();
+    hittable_bounds.reserve(spheres.size());
+    for (const auto& each : spheres) {
+        hittable_bounds.push_back({ each.center - each.radius, each.center + each.radius });
+    }
+    // built no deeper than bvh_max_depth, so the fixed traversal stack in scene.glsl never overflows
+    const auto bvh = iris::bvh_t::create(hittable_bounds);
+
+    auto hittables = std::vector<_proxy_hittable_t>(spheres.size());
+    for (auto i = 0_u32; const auto index : bvh.indices()) {
+        std::memcpy(&hittables[i++]._data[0], &spheres[index], sizeof(sphere_t));
+    }
+
+    // GL does not allow empty buffers, each scene binds placeholders for the buffers of the other one
+    const auto make_storage_buffer = [](const auto& data) {
+        auto buffer = iris::buffer_t::create(std::max(iris::size_bytes(data), 256_u64), GL_SHADER_STORAGE_BUFFER);
+        if (!data.empty()) {
+            buffer.write(data.data(), iris::size_bytes(data));
+        }
+        return buffer;
+    };
+
+    // a glTF scene has no spheres
+    auto object_buffer = make_storage_buffer(hittables);
+
+    auto bvh_buffer = iris::buffer_t::create(iris::size_bytes(bvh.nodes()), GL_SHADER_STORAGE_BUFFER);
+    bvh_buffer.write(bvh.nodes().data(), iris::size_bytes(bvh.nodes()));
+
     auto material_buffer = iris::buffer_t::create(iris::size_bytes(materials), GL_SHADER_STORAGE_BUFFER);
     material_buffer.write(materials.data(), iris::size_bytes(materials));
 
+    const auto empty_bvh = iris::bvh_t::create({});
+    const auto tlas_nodes = scene.tlas_nodes().empty() ? empty_bvh.nodes() : scene.tlas_nodes();
+    auto texture_handles = std::vector<iris::uint64>();
+    for (const auto& texture : model.textures()) {
+        texture_handles.emplace_back(texture.handle());
+    }
+    auto tlas_buffer = make_storage_buffer(tlas_nodes);
+    auto instance_buffer = make_storage_buffer(scene.instances());
+    auto blas_buffer = make_storage_buffer(scene.blas_nodes());
+    auto triangle_buffer = make_storage_buffer(scene.triangles());
+    auto triangle_attribute_buffer = make_storage_buffer(scene.triangle_attributes());
+    auto texture_buffer = make_storage_buffer(texture_handles);
+    auto wavefront_buffers = make_wavefront_buffers(window.width, window.height);
+    // M switches between the megakernel and the wavefront passes
+    auto is_wavefront = false;
+    auto last_key_m = false;
+    auto integrator = static_cast<iris::uint32>(integrator_light_sampling | integrator_russian_roulette);
+
     auto fps_camera = iris::camera_t(window);
     auto old_camera_position = fps_camera.position();
+    auto prev_pv = fps_camera.projection() * fps_camera.view();
 
     auto frame = 0_u32;
+    // unlike "frame" never reset
+    auto total_frames = 0_u64;
     auto last_time = 0.0f;
     auto delta_time = 0.0f;
 
@@ -277,57 +593,322 @@ int main() {
 
         if (window.is_resized) {
             window.is_resized = false;
-            color_attachment = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+            color_attachment = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+            normal_depth_attachment = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+            albedo_attachment = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
             color_framebuffer = iris::framebuffer_t::create({
-                std::cref(color_attachment)
+                std::cref(color_attachment),
+                std::cref(normal_depth_attachment),
+                std::cref(albedo_attachment)
             });
+            glNamedFramebufferDrawBuffers(color_framebuffer.id(), draw_attachments.size(), draw_attachments.data());
+            accumulation = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+            moments = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+            denoise_targets = make_denoise_targets(window.width, window.height);
+            is_denoise_history_valid = false;
+            wavefront_buffers = make_wavefront_buffers(window.width, window.height);
 
-            old_color = iris::framebuffer_attachment_t::create(window.width, window.height, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
-            old_color_framebuffer = iris::framebuffer_t::create({
-                std::cref(old_color)
-            });
+            frame = 0;
+        }
 
+        const auto key_m_pressed = glfwGetKey(window.handle, GLFW_KEY_M) == GLFW_PRESS;
+        if (key_m_pressed && !last_key_m) {
+            is_wavefront = !is_wavefront;
+            iris::log(is_wavefront ? "wavefront path tracing" : "megakernel path tracing");
             frame = 0;
         }
+        last_key_m = key_m_pressed;
 
         if (window.is_mouse_captured || glm::any(glm::greaterThan(glm::abs(fps_camera.position() - old_camera_position), glm::vec3(FLT_EPSILON)))) {
             frame = 0;
         }
-        camera_data.inv_pv = glm::inverse(fps_camera.projection() * fps_camera.view());
-        camera_buffer.write(&camera_data, iris::size_bytes(camera_data));
 
-        color_framebuffer.bind();
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(16.0f, 16.0f), ImGuiCond_Once);
+        ImGui::Begin("Convergence", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+        {
+            const auto pixels = static_cast<iris::float32>(window.width * window.height);
+            ImGui::Text("Mode: %s (M to switch)", is_wavefront ? "wavefront" : "megakernel");
+            ImGui::Text("Frame Time: %.3fms", delta_time * 1000.0f);
+            ImGui::Text("Samples per Pixel: up to %u", frame * wavefront_samples);
+            ImGui::Text("Converged: %.2f%%", 100.0f * last_stats.converged_pixels / pixels);
+            ImGui::Text("Mean Relative Error: %.4f", last_stats.error_sum / 256.0f / pixels);
+            if (time_to_threshold >= 0.0f) {
+                ImGui::Text("Time to %.0f%% Converged: %.3fs", converged_fraction * 100.0f, time_to_threshold);
+            } else {
+                ImGui::Text("Time to %.0f%% Converged: - (%.1fs)", converged_fraction * 100.0f, current_time - epoch_start);
+            }
+            ImGui::Separator();
+
+            // both change what counts as converged, the measurement starts over
+            if (ImGui::Checkbox("Adaptive Sampling", &is_adaptive)) {
+                frame = 0;
+            }
+            if (ImGui::SliderFloat("Error Threshold", &error_threshold, 0.005f, 0.1f, "%.3f")) {
+                frame = 0;
+            }
+            ImGui::Checkbox("Show Convergence", &show_convergence);
+            ImGui::Separator();
+
+            // a different integrator starts a new accumulation, its time to converge can be compared
+            if (ImGui::CheckboxFlags("Light Sampling", &integrator, integrator_light_sampling)) {
+                frame = 0;
+            }
+            if (ImGui::CheckboxFlags("Russian Roulette", &integrator, integrator_russian_roulette)) {
+                frame = 0;
+            }
+            ImGui::Separator();
+
+            // the history is not kept up to date while it is off
+            if (ImGui::Checkbox("Denoise", &is_denoised)) {
+                is_denoise_history_valid = false;
+            }
+        }
+        ImGui::End();
+
+        if (frame == 0) {
+            ++epoch;
+            epoch_start = current_time;
+            time_to_threshold = -1.0f;
+            last_stats = {};
+        }
+        // the slot was last written convergence_stats_frames frames ago and should be done by now
+        auto& stats_slot = convergence_stats[total_frames % convergence_stats_frames];
+        if (stats_slot.fence) {
+            glClientWaitSync(stats_slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+            glDeleteSync(stats_slot.fence);
+            stats_slot.fence = nullptr;
+            if (stats_slot.epoch == epoch) {
+                last_stats = *static_cast<const convergence_stats_t*>(stats_slot.buffer.mapped());
+                const auto pixels = static_cast<iris::float32>(window.width * window.height);
+                if (time_to_threshold < 0.0f && last_stats.converged_pixels >= converged_fraction * pixels) {
+                    time_to_threshold = stats_slot.time - epoch_start;
+                }
+            }
+        }
+
+        const auto pv = fps_camera.projection() * fps_camera.view();
+        camera_data.inv_pv = glm::inverse(pv);
+        camera_data.prev_pv = prev_pv;
+        camera_data.prev_inv_pv = glm::inverse(prev_pv);
+        prev_pv = pv;
+        camera_buffer.write(&camera_data, iris::size_bytes(camera_data));
 
-        trace_shader
-            .bind()
-            .set(0, glm::vec2(window.width, window.height))
-            .set(1, { frame })
-            .set(2, { current_time * 1000 + frame });
         camera_buffer.bind_base(0);
         object_buffer.bind_base(1);
         material_buffer.bind_base(2);
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        bvh_buffer.bind_base(3);
+        tlas_buffer.bind_base(4);
+        instance_buffer.bind_base(5);
+        blas_buffer.bind_base(6);
+        triangle_buffer.bind_base(7);
+        triangle_attribute_buffer.bind_base(8);
+        texture_buffer.bind_base(9);
+        light_buffer.bind_base(15);
+        // pixels that converged are skipped
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, moments.id());
+        if (is_wavefront) {
+            wavefront_buffers.paths.bind_base(10);
+            wavefront_buffers.path_hits.bind_base(11);
+            wavefront_buffers.queues.bind_base(12);
+            wavefront_buffers.dispatches.bind_base(GL_SHADER_STORAGE_BUFFER, 13);
+            wavefront_buffers.radiance.bind_base(14);
+            wavefront_buffers.shadow_rays.bind_base(16);
+            wavefront_buffers.dispatches.bind(GL_DISPATCH_INDIRECT_BUFFER);
+            normal_depth_attachment.bind_image_texture(2, 0, false, 0, GL_WRITE_ONLY);
+            albedo_attachment.bind_image_texture(3, 0, false, 0, GL_WRITE_ONLY);
+            constexpr auto queue_barrier = GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT;
+            for (auto sample = 0_u32; sample < wavefront_samples; ++sample) {
+                wavefront_prepare_shader
+                    .bind()
+                    .set(1, { 2_u32 });
+                glDispatchCompute(1, 1, 1);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+                // only unconverged pixels start a path, the first queue is compacted like every other one
+                wavefront_generate_shader
+                    .bind()
+                    .set(0, glm::vec2(window.width, window.height))
+                    .set(1, { sample })
+                    .set(2, { current_time * 1000 + frame })
+                    .set(4, { 0_i32 })
+                    .set(5, { frame });
+                glDispatchCompute((window.width + 7) / 8, (window.height + 7) / 8, 1);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                wavefront_prepare_shader
+                    .bind()
+                    .set(0, { 0_u32 })
+                    .set(1, { 1_u32 });
+                glDispatchCompute(1, 1, 1);
+                glMemoryBarrier(queue_barrier);
+
+                // empty queues end up as dispatches without groups, the bounce count stays on the CPU
+                for (auto bounce = 0_u32; bounce <= wavefront_max_bounces; ++bounce) {
+                    const auto queue = bounce % 2;
+                    wavefront_intersect_shader
+                        .bind()
+                        .set(0, { queue })
+                        .set(3, { triangle_material });
+                    glDispatchComputeIndirect(0);
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                    if (bounce == wavefront_max_bounces) {
+                        break;
+                    }
+
+                    wavefront_prepare_shader
+                        .bind()
+                        .set(0, { queue })
+                        .set(1, { 0_u32 });
+                    glDispatchCompute(1, 1, 1);
+                    glMemoryBarrier(queue_barrier);
+                    for (auto i = 0_u32; i < wavefront_shade_shaders.size(); ++i) {
+                        wavefront_shade_shaders[i]
+                            .bind()
+                            .set(0, { queue })
+                            .set(6, { integrator });
+                        glDispatchComputeIndirect(sizeof(dispatch_indirect_t) * (i + 1));
+                    }
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+                    wavefront_prepare_shader
+                        .bind()
+                        .set(0, { 1 - queue })
+                        .set(1, { 1_u32 });
+                    glDispatchCompute(1, 1, 1);
+                    glMemoryBarrier(queue_barrier);
+
+                    // the shadow rays of the light samples the lambertian pass took
+                    wavefront_shadow_shader.bind();
+                    glDispatchComputeIndirect(sizeof(dispatch_indirect_t) * 4);
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                }
+            }
+            glBindImageTexture(0, color_attachment.id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+            wavefront_resolve_shader
+                .bind()
+                .set(0, glm::vec2(window.width, window.height))
+                .set(1, { wavefront_samples });
+            glDispatchCompute((window.width + 7) / 8, (window.height + 7) / 8, 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+        } else {
+            // the primary hits of skipped pixels stay from the frame that traced them last
+            color_framebuffer.bind();
+            color_framebuffer.clear_color(0, { 0.0f, 0.0f, 0.0f, 1.0f });
+
+            trace_shader
+                .bind()
+                .set(0, glm::vec2(window.width, window.height))
+                .set(1, { frame })
+                .set(2, { current_time * 1000 + frame })
+                .set(3, { triangle_material })
+                .set(4, { 0_i32 })
+                .set(6, { integrator });
+            glBindVertexArray(vao);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        // sums the samples of this frame up and updates the error estimate of every pixel
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, color_attachment.id());
+        glBindImageTexture(0, accumulation.id(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, moments.id(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glClearNamedBufferData(stats_slot.buffer.id(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        stats_slot.buffer.bind_base(0);
+        accumulate_shader
+            .bind()
+            .set(0, { 0_i32 })
+            .set(1, { frame })
+            .set(2, { error_threshold })
+            .set(3, { convergence_min_frames })
+            .set(4, { static_cast<iris::int32>(is_adaptive) });
+        glDispatchCompute((window.width + 7) / 8, (window.height + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+        stats_slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        stats_slot.epoch = epoch;
+        stats_slot.time = current_time;
+
+        if (is_denoised) {
+            const auto groups_x = (window.width + 7) / 8;
+            const auto groups_y = (window.height + 7) / 8;
+            color_attachment.bind_texture(0);
+            accumulation.bind_texture(1);
+            moments.bind_texture(2);
+            normal_depth_attachment.bind_texture(3);
+            albedo_attachment.bind_texture(4);
+            denoise_targets.prev_normal_depth.bind_texture(5);
+            denoise_targets.history.bind_texture(6);
+            denoise_targets.history_moments.bind_texture(7);
+            denoise_targets.illumination.bind_image_texture(0, 0, false, 0, GL_WRITE_ONLY);
+            denoise_targets.moments.bind_image_texture(1, 0, false, 0, GL_WRITE_ONLY);
+            denoise_temporal_shader
+                .bind()
+                .set(0, { 0_i32 })
+                .set(1, { 1_i32 })
+                .set(2, { 2_i32 })
+                .set(3, { 3_i32 })
+                .set(4, { 4_i32 })
+                .set(5, { 5_i32 })
+                .set(6, { 6_i32 })
+                .set(7, { 7_i32 })
+                .set(8, { frame })
+                .set(9, { static_cast<iris::int32>(is_denoise_history_valid) });
+            glDispatchCompute(groups_x, groups_y, 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+            // the history keeps the unfiltered illumination, a still camera converges to the accumulation
+            normal_depth_attachment.bind_texture(1);
+            albedo_attachment.bind_texture(2);
+            for (auto i = 0_u32; i < denoise_iterations; ++i) {
+                const auto& input = i == 0 ? denoise_targets.illumination : denoise_targets.filtered[(i + 1) % 2];
+                input.bind_texture(0);
+                denoise_targets.filtered[i % 2].bind_image_texture(0, 0, false, 0, GL_WRITE_ONLY);
+                denoise_atrous_shader
+                    .bind()
+                    .set(0, { 0_i32 })
+                    .set(1, { 1_i32 })
+                    .set(2, { 2_i32 })
+                    .set(3, { static_cast<iris::int32>(1 << i) })
+                    .set(4, { static_cast<iris::int32>(i + 1 == denoise_iterations) });
+                glDispatchCompute(groups_x, groups_y, 1);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+            }
+
+            // this frame becomes the history of the next one
+            denoise_targets.illumination.swap(denoise_targets.history);
+            denoise_targets.moments.swap(denoise_targets.history_moments);
+            glCopyImageSubData(
+                normal_depth_attachment.id(), GL_TEXTURE_2D, 0, 0, 0, 0,
+                denoise_targets.prev_normal_depth.id(), GL_TEXTURE_2D, 0, 0, 0, 0,
+                window.width, window.height, 1);
+            is_denoise_history_valid = true;
+        }
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, old_color.id());
+        glBindTexture(GL_TEXTURE_2D, accumulation.id());
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, color_attachment.id());
+        glBindTexture(GL_TEXTURE_2D, moments.id());
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, denoise_targets.filtered[(denoise_iterations - 1) % 2].id());
         average_shader
             .bind()
             .set(0, { 0_i32 })
             .set(1, { 1_i32 })
-            .set(2, { frame });
+            .set(2, { error_threshold })
+            .set(3, { static_cast<iris::int32>(show_convergence) })
+            .set(4, { static_cast<iris::int32>(is_denoised) })
+            .set(5, { 2_i32 });
 
         glBindVertexArray(vao);
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, old_color_framebuffer.id());
-        glBlitFramebuffer(0, 0, window.width, window.height, 0, 0, window.width, window.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // the backend restores what it touches, but through raw GL calls the cache can not see
+        iris::gl_state::invalidate();
 
         glfwSwapBuffers(window.handle);
         glfwPollEvents();
@@ -335,6 +916,7 @@ int main() {
         window.update();
         fps_camera.update(delta_time);
         ++frame;
+        ++total_frames;
     }
     return 0;
 }
@@ -18,6 +18,7 @@
 #include <framebuffer.hpp>
 #include <buffer.hpp>
 #include <allocator.hpp>
+#include <frame_graph.hpp>
 
 #include <debug_break.hpp>
 
@@ -123,6 +124,9 @@ struct cull_input_package_t {
     std::reference_wrapper<iris::buffer_t> indirect;
     std::reference_wrapper<iris::buffer_t> count;
     std::reference_wrapper<iris::buffer_t> shift;
+    iris::frame_graph_resource_t indirect_resource;
+    iris::frame_graph_resource_t count_resource;
+    iris::frame_graph_resource_t shift_resource;
 };
 
 static auto hash_combine(iris::uint64 seed, iris::uint64 value) noexcept -> iris::uint64 {
@@ -209,50 +213,42 @@ static auto calculate_global_projection(const iris::camera_t& camera, const glm:
     return uv_scale_bias * pv;
 }
 
-static auto calculate_wg_from_resolution(iris::uint32 width, iris::uint32 height) noexcept -> std::vector<glm::uvec2> {
-    constexpr auto wg_size = 16_u32;
-    auto wg_count = std::vector<glm::uvec2>();
-    wg_count.reserve(16);
-    wg_count.emplace_back(
-        (width + wg_size - 1) / wg_size,
-        (height + wg_size - 1) / wg_size);
-    while (wg_count.back() != glm::uvec2(1)) {
-        const auto& previous = wg_count.back();
-        const auto current_size = glm::uvec2(
-            (previous.x + wg_size - 1) / wg_size,
-            (previous.y + wg_size - 1) / wg_size);
-        wg_count.emplace_back(glm::max(current_size, glm::uvec2(1)));
-    }
-    return wg_count;
-}
-
-static auto calculate_hiz_construct_wg(iris::uint32 width, iris::uint32 height) noexcept -> std::vector<glm::uvec2> {
-    const auto work_size = 16_u32;
-    auto wg_count = std::vector<glm::uvec2>();
-    wg_count.reserve(16);
-    wg_count.emplace_back(
-        (width + work_size - 1) / work_size,
-        (height + work_size - 1) / work_size);
-    while (glm::uvec2(width, height) != glm::uvec2(1)) {
-        width = std::max(width >> 1, 1u);
-        height = std::max(height >> 1, 1u);
-        wg_count.emplace_back(glm::max(
-            glm::uvec2(
-                (width + work_size - 1) / work_size,
-                (height + work_size - 1) / work_size),
-            glm::uvec2(1)));
-    }
-    return wg_count;
-}
-
 static auto previous_power_two(iris::uint32 v) noexcept -> iris::uint32 {
-    auto r = 1;
+    auto r = 1_u32;
     while ((r << 1) < v) {
         r <<= 1;
     }
     return r;
 }
 
+static auto make_depth_pyramid(iris::uint32 width, iris::uint32 height) noexcept -> iris::framebuffer_attachment_t {
+    const auto size = glm::uvec2(
+        previous_power_two(width),
+        previous_power_two(height));
+    const auto levels = 1 + std::floor(std::log2(std::max(size.x, size.y)));
+    auto pyramid = iris::framebuffer_attachment_t::create_mips(
+        size.x,
+        size.y,
+        1,
+        levels,
+        GL_RGBA32F,
+        GL_RGBA,
+        GL_FLOAT,
+        true,
+        false);
+    pyramid.make_image_handles_resident(GL_READ_WRITE);
+    return pyramid;
+}
+
+static auto calculate_depth_pyramid_wg(const iris::framebuffer_attachment_t& pyramid) noexcept -> glm::uvec2 {
+    // one workgroup per 32x32 tile of the first level
+    constexpr auto tile_size = 32_u32;
+    return {
+        (pyramid.width() + tile_size - 1) / tile_size,
+        (pyramid.height() + tile_size - 1) / tile_size
+    };
+}
+
 int main() {
     if (!glfwInit()) {
         return -1;
@@ -338,13 +334,11 @@ int main() {
 
     auto main_shader = iris::shader_t::create("../shaders/5.0/main.vert", "../shaders/5.0/main.frag");
     auto depth_only_shader = iris::shader_t::create("../shaders/5.0/depth_only.vert", "../shaders/5.0/empty.frag");
-    auto depth_reduce_init_shader = iris::shader_t::create_compute("../shaders/5.0/depth_reduce_init.comp");
-    auto depth_reduce_shader = iris::shader_t::create_compute("../shaders/5.0/depth_reduce.comp");
+    auto depth_pyramid_shader = iris::shader_t::create_compute("../shaders/5.0/depth_pyramid.comp");
     auto setup_cascades_shader = iris::shader_t::create_compute("../shaders/5.0/setup_shadows.comp");
     auto shadow_shader = iris::shader_t::create("../shaders/5.0/shadow.vert", "../shaders/5.0/shadow.frag");
     auto fullscreen_shader = iris::shader_t::create("../shaders/5.0/fullscreen.vert", "../shaders/5.0/fullscreen.frag");
     auto cull_shader = iris::shader_t::create_compute("../shaders/5.0/generic_cull.comp");
-    auto hiz_construct_shader = iris::shader_t::create_compute("../shaders/5.0/hiz_construct.comp");
 
     // DEBUG
     auto debug_aabb_shader = iris::shader_t::create("../shaders/5.0/debug_aabb.vert", "../shaders/5.0/debug_aabb.frag");
@@ -437,6 +431,15 @@ int main() {
     auto cascade_setup_buffer = iris::buffer_t::create(sizeof(cascade_setup_data_t), GL_UNIFORM_BUFFER);
     auto directional_lights_buffer = iris::buffer_t::create(sizeof(directional_light_t[16]), GL_UNIFORM_BUFFER);
     auto cascade_buffer = iris::buffer_t::create(sizeof(cascade_data_t[CASCADE_COUNT]), GL_SHADER_STORAGE_BUFFER, GL_NONE);
+    auto depth_pyramid_counter_buffer = iris::buffer_t::create(sizeof(iris::uint32), GL_SHADER_STORAGE_BUFFER, GL_NONE);
+    glClearNamedBufferSubData(
+        depth_pyramid_counter_buffer.id(),
+        GL_R32UI,
+        0,
+        depth_pyramid_counter_buffer.size(),
+        GL_RED_INTEGER,
+        GL_UNSIGNED_INT,
+        nullptr);
 
     // cull output
     auto main_indirect_buffer = iris::buffer_t::create(sizeof(draw_elements_indirect_t[16384]), GL_DRAW_INDIRECT_BUFFER);
@@ -450,26 +453,6 @@ int main() {
     // DEBUG
     auto debug_aabb_indirect_buffer = iris::buffer_t::create(sizeof(draw_arrays_indirect_t), GL_DRAW_INDIRECT_BUFFER, GL_DYNAMIC_STORAGE_BIT);
 
-    auto offscreen_attachment = std::vector<iris::framebuffer_attachment_t>(2);
-    offscreen_attachment[0] = iris::framebuffer_attachment_t::create(
-        window.width,
-        window.height,
-        1,
-        GL_SRGB8_ALPHA8,
-        GL_RGBA,
-        GL_UNSIGNED_BYTE,
-        false,
-        true);
-    offscreen_attachment[1] = iris::framebuffer_attachment_t::create(
-        window.width,
-        window.height,
-        1,
-        GL_DEPTH_COMPONENT32F,
-        GL_DEPTH_COMPONENT,
-        GL_FLOAT,
-        true,
-        false);
-
     auto shadow_attachment = iris::framebuffer_attachment_t::create(
         4096,
         4096,
@@ -481,48 +464,16 @@ int main() {
     glTextureParameteri(shadow_attachment.id(), GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
     glTextureParameteri(shadow_attachment.id(), GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 
-    auto hiz_size = glm::uvec2(
-        previous_power_two(window.width),
-        previous_power_two(window.height));
-    auto hiz_mips = 1 + std::floor(std::log2(std::max(hiz_size.x, hiz_size.y)));
-    auto hiz_map = iris::framebuffer_attachment_t::create_mips(
-        hiz_size.x,
-        hiz_size.y,
-        1,
-        hiz_mips,
-        GL_R32F,
-        GL_RED,
-        GL_FLOAT,
-        true,
-        false);
-    auto hiz_construct_wgc = calculate_hiz_construct_wg(hiz_map.width(), hiz_map.height());
-
-    auto depth_reduce_wgc = calculate_wg_from_resolution(window.width, window.height);
-    auto depth_reduce_attachments = std::vector<iris::framebuffer_attachment_t>();
-    depth_reduce_attachments.reserve(depth_reduce_wgc.size());
-    for (const auto& each : depth_reduce_wgc) {
-        depth_reduce_attachments.emplace_back(iris::framebuffer_attachment_t::create(
-            each.x,
-            each.y,
-            1,
-            GL_RG32F,
-            GL_RG,
-            GL_FLOAT));
-    }
-
-    auto offscreen_fbo = iris::framebuffer_t::create({
-        std::cref(offscreen_attachment[0]),
-        std::cref(offscreen_attachment[1])
-    });
-
-    auto depth_only_fbo = iris::framebuffer_t::create({
-        std::cref(offscreen_attachment[1])
-    });
+    // hi-z in .r, SDSM bounds in .gb
+    auto hiz_map = make_depth_pyramid(window.width, window.height);
+    auto hiz_map_wgc = calculate_depth_pyramid_wg(hiz_map);
 
     auto shadow_fbo = iris::framebuffer_t::create({
         std::cref(shadow_attachment)
     });
 
+    auto frame_graph = iris::frame_graph_t::create();
+
     auto delta_time = 0.0f;
     auto last_time = 0.0f;
     glfwSwapInterval(0);
@@ -530,61 +481,10 @@ int main() {
     auto freeze_frustum_culling = false;
     while (!glfwWindowShouldClose(window.handle)) {
         if (window.is_resized) {
-            offscreen_attachment[0] = iris::framebuffer_attachment_t::create(
-                window.width,
-                window.height,
-                1,
-                GL_SRGB8_ALPHA8,
-                GL_RGBA,
-                GL_UNSIGNED_BYTE,
-                false,
-                true);
-            offscreen_attachment[1] = iris::framebuffer_attachment_t::create(
-                window.width,
-                window.height,
-                1,
-                GL_DEPTH_COMPONENT32F,
-                GL_DEPTH_COMPONENT,
-                GL_FLOAT,
-                true,
-                false);
-
-            offscreen_fbo = iris::framebuffer_t::create({
-                std::cref(offscreen_attachment[0]),
-                std::cref(offscreen_attachment[1])
-            });
-
-            depth_only_fbo = iris::framebuffer_t::create({
-                std::cref(offscreen_attachment[1])
-            });
-
-            depth_reduce_wgc = calculate_wg_from_resolution(window.width, window.height);
-            depth_reduce_attachments.clear();
-            for (const auto& each : depth_reduce_wgc) {
-                depth_reduce_attachments.emplace_back(iris::framebuffer_attachment_t::create(
-                    each.x,
-                    each.y,
-                    1,
-                    GL_RG32F,
-                    GL_RG,
-                    GL_FLOAT));
-            }
-
-            hiz_size = glm::uvec2(
-                previous_power_two(window.width),
-                previous_power_two(window.height));
-            hiz_mips = 1 + std::floor(std::log2(std::max(hiz_size.x, hiz_size.y)));
-            hiz_map = iris::framebuffer_attachment_t::create_mips(
-                hiz_size.x,
-                hiz_size.y,
-                1,
-                hiz_mips,
-                GL_R32F,
-                GL_RED,
-                GL_FLOAT,
-                true,
-                false);
-            hiz_construct_wgc = calculate_hiz_construct_wg(hiz_map.width(), hiz_map.height());
+            // the hi-z map outlives the frame, the next cull tests against it
+            frame_graph.forget_attachment(hiz_map);
+            hiz_map = make_depth_pyramid(window.width, window.height);
+            hiz_map_wgc = calculate_depth_pyramid_wg(hiz_map);
             window.is_resized = false;
         }
 
@@ -677,85 +577,121 @@ int main() {
         texture_buffer.write(texture_handles.data(), iris::size_bytes(texture_handles));
         directional_lights_buffer.write(directional_lights.data(), iris::size_bytes(directional_lights));
 
-        auto frustum_cull_scene = [&](
-                iris::framebuffer_attachment_t& hiz,
-                cull_input_package_t package,
-                iris::uint32 disable_near,
-                iris::uint32 cascade_layer = -1) {
-            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "frustum_cull_pass");
-            cull_shader
-                .bind()
-                .set(0, { static_cast<iris::uint32>(indirect_groups.size()) })
-                .set(1, { static_cast<iris::uint32>(object_infos.size()) })
-                .set(2, { 0_u32 })
-                .set(3, { disable_near })
-                .set(4, { cascade_layer })
-                .set(5, { 0_i32 });
-            hiz.bind_texture(0);
-            local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-            global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-            object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-            package.indirect.get().bind_base(GL_SHADER_STORAGE_BUFFER, 4);
-            package.count.get().bind_base(GL_SHADER_STORAGE_BUFFER, 5);
-            package.shift.get().bind_base(6);
-            cascade_buffer.bind_base(7);
-            camera_buffer.bind_base(8);
-
-            glClearNamedBufferSubData(
-                package.count.get().id(),
-                GL_R32UI,
-                0,
-                package.count.get().size(),
-                GL_RED_INTEGER,
-                GL_UNSIGNED_INT,
-                nullptr);
-            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-            glDispatchCompute((object_infos.size() + 255) / 256, 1, 1);
-            glMemoryBarrier(GL_SHADER_STORAGE_BUFFER | GL_COMMAND_BARRIER_BIT);
-            glPopDebugGroup();
-        };
+        frustum_buffer.write(iris::as_const_ptr(camera_frustum), iris::size_bytes(camera_frustum));
+
+        // buffers only ever written by the CPU never need a barrier and are not declared
+        frame_graph.reset();
+        const auto main_indirect = frame_graph.import_buffer("main_indirect", main_indirect_buffer);
+        const auto main_count = frame_graph.import_buffer("main_count", main_count_buffer);
+        const auto main_shift = frame_graph.import_buffer("main_object_shift", main_object_shift_buffer);
+        const auto shadow_indirect = frame_graph.import_buffer("shadow_indirect", shadow_indirect_buffer);
+        const auto shadow_count = frame_graph.import_buffer("shadow_count", shadow_count_buffer);
+        const auto shadow_shift = frame_graph.import_buffer("shadow_object_shift", shadow_object_shift_buffer);
+        const auto frustums = frame_graph.import_buffer("frustums", frustum_buffer);
+        const auto cascades = frame_graph.import_buffer("cascades", cascade_buffer);
+        const auto depth_pyramid_counter = frame_graph.import_buffer("depth_pyramid_counter", depth_pyramid_counter_buffer);
+        const auto debug_aabb_indirect = frame_graph.import_buffer("debug_aabb_indirect", debug_aabb_indirect_buffer);
+        const auto hiz = frame_graph.import_attachment("hiz_map", hiz_map);
+        const auto shadow_map = frame_graph.import_attachment("shadow_map", shadow_attachment);
+
+        const auto frame_width = static_cast<iris::uint32>(window.width);
+        const auto frame_height = static_cast<iris::uint32>(window.height);
+        const auto color = frame_graph.create_attachment("color", {
+            .width = frame_width,
+            .height = frame_height,
+            .format = GL_SRGB8_ALPHA8,
+            .base_format = GL_RGBA,
+            .type = GL_UNSIGNED_BYTE,
+            .nearest = false,
+        });
+        const auto depth = frame_graph.create_attachment("depth", {
+            .width = frame_width,
+            .height = frame_height,
+            .format = GL_DEPTH_COMPONENT32F,
+            .base_format = GL_DEPTH_COMPONENT,
+            .type = GL_FLOAT,
+            .border = false,
+        });
+        const auto depth_reduce_output = frame_graph.create_attachment("depth_reduce_output", {
+            .width = 1,
+            .height = 1,
+            .format = GL_RG32F,
+            .base_format = GL_RG,
+            .type = GL_FLOAT,
+        });
 
         auto main_indirect_package = cull_input_package_t {
             .indirect = std::ref(main_indirect_buffer),
             .count = std::ref(main_count_buffer),
-            .shift = std::ref(main_object_shift_buffer)
+            .shift = std::ref(main_object_shift_buffer),
+            .indirect_resource = main_indirect,
+            .count_resource = main_count,
+            .shift_resource = main_shift
         };
         auto shadow_indirect_package = cull_input_package_t {
             .indirect = std::ref(shadow_indirect_buffer),
             .count = std::ref(shadow_count_buffer),
-            .shift = std::ref(shadow_object_shift_buffer)
+            .shift = std::ref(shadow_object_shift_buffer),
+            .indirect_resource = shadow_indirect,
+            .count_resource = shadow_count,
+            .shift_resource = shadow_shift
         };
 
-        glViewport(0, 0, window.width, window.height);
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "depth_prepass");
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_CULL_FACE);
-        glDepthMask(GL_TRUE);
-        glDepthFunc(GL_LEQUAL);
-
-        frustum_buffer.write(iris::as_const_ptr(camera_frustum), iris::size_bytes(camera_frustum));
-        frustum_buffer.bind_range(0, 0, iris::size_bytes(camera_frustum));
-        if (!freeze_frustum_culling) {
-            frustum_cull_scene(hiz_map, main_indirect_package, 0);
-        }
+        auto add_frustum_cull_pass = [&](
+                cull_input_package_t package,
+                iris::uint32 disable_near,
+                iris::uint32 cascade_layer = -1) {
+            frame_graph.add_pass("frustum_cull_pass")
+                .read(hiz, iris::frame_graph_access_t::texture)
+                .read(frustums, iris::frame_graph_access_t::storage)
+                .read(cascades, iris::frame_graph_access_t::storage)
+                .write(package.indirect_resource, iris::frame_graph_access_t::storage)
+                .write(package.count_resource, iris::frame_graph_access_t::transfer)
+                .write(package.count_resource, iris::frame_graph_access_t::storage)
+                .write(package.shift_resource, iris::frame_graph_access_t::storage)
+                .execute([&, package, disable_near, cascade_layer]() {
+                    if (cascade_layer == static_cast<iris::uint32>(-1)) {
+                        frustum_buffer.bind_range(0, 0, sizeof(iris::frustum_t));
+                    } else {
+                        frustum_buffer.bind_range(0, (cascade_layer + 1) * sizeof(iris::frustum_t), sizeof(iris::frustum_t));
+                    }
+                    cull_shader
+                        .bind()
+                        .set(0, { static_cast<iris::uint32>(indirect_groups.size()) })
+                        .set(1, { static_cast<iris::uint32>(object_infos.size()) })
+                        .set(2, { 0_u32 })
+                        .set(3, { disable_near })
+                        .set(4, { cascade_layer })
+                        .set(5, { 0_i32 });
+                    hiz_map.bind_texture(0);
+                    local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                    global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                    object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                    package.indirect.get().bind_base(GL_SHADER_STORAGE_BUFFER, 4);
+                    package.count.get().bind_base(GL_SHADER_STORAGE_BUFFER, 5);
+                    package.shift.get().bind_base(6);
+                    cascade_buffer.bind_base(7);
+                    camera_buffer.bind_base(8);
+
+                    glClearNamedBufferSubData(
+                        package.count.get().id(),
+                        GL_R32UI,
+                        0,
+                        package.count.get().size(),
+                        GL_RED_INTEGER,
+                        GL_UNSIGNED_INT,
+                        nullptr);
+                    glDispatchCompute((object_infos.size() + 255) / 256, 1, 1);
+                });
+        };
 
-        depth_only_fbo.clear_depth(1.0f);
-        depth_only_fbo.bind();
-        depth_only_shader.bind();
-        camera_buffer.bind_base(0);
-        local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-        global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-        object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-        main_object_shift_buffer.bind_base(4);
-        main_indirect_buffer.bind();
-        main_count_buffer.bind();
-        {
+        // the group offset uniform lives at a different location in every shader
+        auto draw_indirect_groups = [&](const iris::shader_t& shader, iris::uint32 group_offset_location) {
             auto indirect_offset = 0_u32;
             auto group_offset = 0_u32;
             auto group_count_offset = 0_u64;
             for (auto& [_, group] : indirect_groups) {
-                depth_only_shader.set(0, { group_offset });
+                shader.set(group_offset_location, { group_offset });
                 glBindVertexArray(group.vao);
                 glVertexArrayVertexBuffer(group.vao, 0, group.vbo, 0, group.vertex_size);
                 glVertexArrayElementBuffer(group.vao, group.ebo);
@@ -770,211 +706,206 @@ int main() {
                 group_offset += group.objects.size();
                 group_count_offset += sizeof(iris::uint32);
             }
+        };
+
+        frame_graph.begin_group("depth_prepass");
+        if (!freeze_frustum_culling) {
+            add_frustum_cull_pass(main_indirect_package, 0);
         }
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "depth_reduce");
-        depth_reduce_init_shader.bind();
-        offscreen_attachment[1].bind_texture(0);
-        depth_reduce_attachments[0].bind_image_texture(0, 0, false, 0, GL_WRITE_ONLY);
-        camera_buffer.bind_base(1);
-        glDispatchCompute(depth_reduce_wgc[0].x, depth_reduce_wgc[0].y, 1);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-        depth_reduce_shader.bind();
-        for (auto i = 1; i < depth_reduce_wgc.size(); i++) {
-            depth_reduce_attachments[i - 1].bind_image_texture(0, 0, false, 0, GL_READ_ONLY);
-            depth_reduce_attachments[i].bind_image_texture(1, 0, false, 0, GL_WRITE_ONLY);
-            glDispatchCompute(depth_reduce_wgc[i].x, depth_reduce_wgc[i].y, 1);
-            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-        }
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "shadow_setup");
-        setup_cascades_shader.bind();
-        depth_reduce_attachments.back().bind_image_texture(0, 0, false, 0, GL_READ_ONLY);
-        cascade_setup_buffer.bind_base(1);
-        camera_buffer.bind_base(2);
-        cascade_buffer.bind_base(3);
-        frustum_buffer.bind_range(4, sizeof(iris::frustum_t), sizeof(iris::frustum_t[CASCADE_COUNT]));
-        glDispatchCompute(1, 1, 1);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "shadow_render");
-        glCullFace(GL_FRONT);
-        glEnable(GL_DEPTH_CLAMP);
+        frame_graph.add_pass("prepass_draw")
+            .read(main_indirect, iris::frame_graph_access_t::indirect)
+            .read(main_count, iris::frame_graph_access_t::indirect)
+            .read(main_shift, iris::frame_graph_access_t::storage)
+            .write(depth, iris::frame_graph_access_t::attachment)
+            .execute([&]() {
+                glViewport(0, 0, window.width, window.height);
+                glEnable(GL_DEPTH_TEST);
+                glEnable(GL_CULL_FACE);
+                glDepthMask(GL_TRUE);
+                glDepthFunc(GL_LEQUAL);
+                const auto& depth_only_fbo = frame_graph.framebuffer({ depth });
+                depth_only_fbo.clear_depth(1.0f);
+                depth_only_fbo.bind();
+                depth_only_shader.bind();
+                camera_buffer.bind_base(0);
+                local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                main_object_shift_buffer.bind_base(4);
+                main_indirect_buffer.bind();
+                main_count_buffer.bind();
+                draw_indirect_groups(depth_only_shader, 0);
+            });
+        frame_graph.end_group();
+
+        frame_graph.add_pass("depth_reduce")
+            .read(depth, iris::frame_graph_access_t::texture)
+            .write(hiz, iris::frame_graph_access_t::image)
+            .write(depth_pyramid_counter, iris::frame_graph_access_t::storage)
+            .write(depth_reduce_output, iris::frame_graph_access_t::image)
+            .execute([&]() {
+                depth_pyramid_shader
+                    .bind()
+                    .set(0, { 0_i32 })
+                    .set(1, { hiz_map.levels() })
+                    .set(2, { hiz_map_wgc.x * hiz_map_wgc.y })
+                    .set(3, hiz_map.image_handles());
+                frame_graph.attachment(depth).bind_texture(0);
+                frame_graph.attachment(depth_reduce_output).bind_image_texture(0, 0, false, 0, GL_WRITE_ONLY);
+                depth_pyramid_counter_buffer.bind_base(0);
+                camera_buffer.bind_base(1);
+                glDispatchCompute(hiz_map_wgc.x, hiz_map_wgc.y, 1);
+            });
+
+        frame_graph.add_pass("shadow_setup")
+            .read(depth_reduce_output, iris::frame_graph_access_t::image)
+            .write(cascades, iris::frame_graph_access_t::storage)
+            .write(frustums, iris::frame_graph_access_t::storage)
+            .execute([&]() {
+                setup_cascades_shader.bind();
+                frame_graph.attachment(depth_reduce_output).bind_image_texture(0, 0, false, 0, GL_READ_ONLY);
+                cascade_setup_buffer.bind_base(1);
+                camera_buffer.bind_base(2);
+                cascade_buffer.bind_base(3);
+                frustum_buffer.bind_range(4, sizeof(iris::frustum_t), sizeof(iris::frustum_t[CASCADE_COUNT]));
+                glDispatchCompute(1, 1, 1);
+            });
+
+        frame_graph.begin_group("shadow_render");
         for (auto layer = 0_u32; layer < CASCADE_COUNT; layer++) {
-            // cull first
-            shadow_fbo.bind();
-            shadow_fbo.set_layer(0, layer);
-            frustum_buffer.bind_range(0, (layer + 1) * sizeof(iris::frustum_t), sizeof(iris::frustum_t));
             // occlusion culling is disabled for shadows (for now)
-            frustum_cull_scene(hiz_map, shadow_indirect_package, 1, layer);
-
-            glViewport(0, 0, shadow_attachment.width(), shadow_attachment.height());
-            shadow_shader
-                .bind()
-                .set(0, { layer });
-            cascade_buffer.bind_base(0);
-            local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-            global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-            object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-            shadow_object_shift_buffer.bind_base(4);
-            texture_buffer.bind_range(5, 0, iris::size_bytes(texture_handles));
-            shadow_count_buffer.bind();
-            shadow_indirect_buffer.bind();
-
-            shadow_fbo.clear_depth(1.0f);
-
-            auto indirect_offset = 0_u32;
-            auto group_offset = 0_u32;
-            auto group_count_offset = 0_u64;
-            for (auto& [_, group] : indirect_groups) {
-                shadow_shader.set(1, { group_offset });
-                glBindVertexArray(group.vao);
-                glVertexArrayVertexBuffer(group.vao, 0, group.vbo, 0, group.vertex_size);
-                glVertexArrayElementBuffer(group.vao, group.ebo);
-                glMultiDrawElementsIndirectCount(
-                    GL_TRIANGLES,
-                    GL_UNSIGNED_INT,
-                    reinterpret_cast<const void*>(indirect_offset),
-                    static_cast<std::intptr_t>(group_count_offset),
-                    static_cast<iris::int32>(group.objects.size()),
-                    0);
-                indirect_offset += group.objects.size() * sizeof(draw_elements_indirect_t);
-                group_offset += group.objects.size();
-                group_count_offset += sizeof(iris::uint32);
-            }
+            add_frustum_cull_pass(shadow_indirect_package, 1, layer);
+            frame_graph.add_pass("shadow_draw")
+                .read(shadow_indirect, iris::frame_graph_access_t::indirect)
+                .read(shadow_count, iris::frame_graph_access_t::indirect)
+                .read(shadow_shift, iris::frame_graph_access_t::storage)
+                .read(cascades, iris::frame_graph_access_t::storage)
+                .write(shadow_map, iris::frame_graph_access_t::attachment)
+                .execute([&, layer]() {
+                    glEnable(GL_DEPTH_TEST);
+                    glEnable(GL_CULL_FACE);
+                    glDepthMask(GL_TRUE);
+                    glDepthFunc(GL_LEQUAL);
+                    glCullFace(GL_FRONT);
+                    glEnable(GL_DEPTH_CLAMP);
+                    shadow_fbo.bind();
+                    shadow_fbo.set_layer(0, layer);
+                    glViewport(0, 0, shadow_attachment.width(), shadow_attachment.height());
+                    shadow_shader
+                        .bind()
+                        .set(0, { layer });
+                    cascade_buffer.bind_base(0);
+                    local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                    global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                    object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                    shadow_object_shift_buffer.bind_base(4);
+                    texture_buffer.bind_range(5, 0, iris::size_bytes(texture_handles));
+                    shadow_count_buffer.bind();
+                    shadow_indirect_buffer.bind();
+
+                    shadow_fbo.clear_depth(1.0f);
+                    draw_indirect_groups(shadow_shader, 1);
+                    glDisable(GL_DEPTH_CLAMP);
+                    glCullFace(GL_BACK);
+                });
         }
-        glDisable(GL_DEPTH_CLAMP);
-        glCullFace(GL_BACK);
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "final_color_pass");
-        glViewport(0, 0, window.width, window.height);
-        glDepthMask(GL_FALSE);
-        glDepthFunc(GL_EQUAL);
-
-        offscreen_fbo.bind();
-        offscreen_fbo.clear_color(0, { 0_u32, 0_u32, 0_u32, 255_u32 });
-        frustum_buffer.bind_range(0, 0, iris::size_bytes(camera_frustum));
-
-        main_shader.bind();
-        camera_buffer.bind_base(0);
-        local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-        global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-        object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-        main_object_shift_buffer.bind_base(4);
-        directional_lights_buffer.bind_range(5, 0, iris::size_bytes(directional_lights));
-        texture_buffer.bind_range(6, 0, iris::size_bytes(texture_handles));
-        cascade_buffer.bind_base(7);
-        shadow_attachment.bind_texture(0);
-        blue_noise_texture.bind(1);
-        main_indirect_buffer.bind();
-        main_count_buffer.bind();
-        {
-            auto indirect_offset = 0_u32;
-            auto group_offset = 0_u32;
-            auto group_count_offset = 0_u64;
-            main_shader
-                .set(1, { 0_i32 })
-                .set(2, { 1_i32 });
-            for (auto& [_, group] : indirect_groups) {
-                main_shader.set(0, { group_offset });
-                glBindVertexArray(group.vao);
-                glVertexArrayVertexBuffer(group.vao, 0, group.vbo, 0, group.vertex_size);
-                glVertexArrayElementBuffer(group.vao, group.ebo);
-                glMultiDrawElementsIndirectCount(
-                    GL_TRIANGLES,
-                    GL_UNSIGNED_INT,
-                    reinterpret_cast<const void*>(indirect_offset),
-                    static_cast<std::intptr_t>(group_count_offset),
-                    static_cast<iris::int32>(group.objects.size()),
-                    0);
-                indirect_offset += group.objects.size() * sizeof(draw_elements_indirect_t);
-                group_offset += group.objects.size();
-                group_count_offset += sizeof(iris::uint32);
-            }
-        }
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "hi_z_construct");
-        hiz_construct_shader
-            .bind()
-            .set(0, {  0_u32 })
-            .set(1, {  0_i32 })
-            .set(2, {  0_i32 })
-            .set(3, { -1_u32 });
-        offscreen_attachment[1].bind_texture(0);
-        hiz_map.bind_image_texture(1, 0, GL_FALSE, 0, GL_WRITE_ONLY);
-        glDispatchCompute(hiz_construct_wgc[0].x, hiz_construct_wgc[0].y, 1);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-        for (auto i = 1_u32; i < hiz_mips; ++i) {
-            hiz_construct_shader
-                .set(0, {  i - 1 })
-                .set(1, {  0_i32 })
-                .set(2, {  0_i32 })
-                .set(3, { -1_u32 });
-            hiz_map.bind_texture(0);
-            glTextureParameteri(hiz_map.id(), GL_TEXTURE_BASE_LEVEL, i - 1);
-            hiz_map.bind_image_texture(1, i, GL_FALSE, 0, GL_WRITE_ONLY);
-            glDispatchCompute(hiz_construct_wgc[i].x, hiz_construct_wgc[i].y, 1);
-            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
-        }
-        glTextureParameteri(hiz_map.id(), GL_TEXTURE_BASE_LEVEL, 0);
-        glPopDebugGroup();
+        frame_graph.end_group();
+
+        frame_graph.add_pass("final_color_pass")
+            .read(main_indirect, iris::frame_graph_access_t::indirect)
+            .read(main_count, iris::frame_graph_access_t::indirect)
+            .read(main_shift, iris::frame_graph_access_t::storage)
+            .read(cascades, iris::frame_graph_access_t::storage)
+            .read(shadow_map, iris::frame_graph_access_t::texture)
+            .read(depth, iris::frame_graph_access_t::attachment)
+            .write(color, iris::frame_graph_access_t::attachment)
+            .execute([&]() {
+                glViewport(0, 0, window.width, window.height);
+                glEnable(GL_DEPTH_TEST);
+                glEnable(GL_CULL_FACE);
+                glDepthMask(GL_FALSE);
+                glDepthFunc(GL_EQUAL);
+
+                const auto& offscreen_fbo = frame_graph.framebuffer({ color, depth });
+                offscreen_fbo.bind();
+                offscreen_fbo.clear_color(0, { 0_u32, 0_u32, 0_u32, 255_u32 });
+                frustum_buffer.bind_range(0, 0, iris::size_bytes(camera_frustum));
+
+                main_shader.bind();
+                camera_buffer.bind_base(0);
+                local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                main_object_shift_buffer.bind_base(4);
+                directional_lights_buffer.bind_range(5, 0, iris::size_bytes(directional_lights));
+                texture_buffer.bind_range(6, 0, iris::size_bytes(texture_handles));
+                cascade_buffer.bind_base(7);
+                shadow_attachment.bind_texture(0);
+                blue_noise_texture.bind(1);
+                main_indirect_buffer.bind();
+                main_count_buffer.bind();
+                main_shader
+                    .set(1, { 0_i32 })
+                    .set(2, { 1_i32 });
+                draw_indirect_groups(main_shader, 0);
+            });
 
-        glDisable(GL_DEPTH_TEST);
-        //glDepthFunc(GL_LESS);
-        //glDepthMask(GL_TRUE);
-        glDisable(GL_CULL_FACE);
         if (glfwGetKey(window.handle, GLFW_KEY_F) == GLFW_PRESS) {
-            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "debug_aabbs");
-            debug_aabb_shader.bind();
-            camera_buffer.bind_base(0);
-            local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-            global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-            object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-            main_object_shift_buffer.bind_base(4);
-            {
-                auto group_offset = 0_u32;
-                auto group_count_offset = 0_u64;
-                auto command = draw_arrays_indirect_t {
-                    .count = 24,
-                    .instance_count = 0,
-                    .first = 0,
-                    .base_instance = group_offset
-                };
-                debug_aabb_indirect_buffer.write(&command, sizeof(command));
-                debug_aabb_indirect_buffer.bind();
-                for (auto& [_, group] : indirect_groups) {
-                    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-                    glCopyNamedBufferSubData(
-                        main_count_buffer.id(),
-                        debug_aabb_indirect_buffer.id(),
-                        group_count_offset,
-                        sizeof(iris::uint32),
-                        sizeof(iris::uint32));
-                    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
-                    glBindVertexArray(aabb_vao);
-                    glMultiDrawArraysIndirect(GL_LINES, nullptr, 1, 0);
-                    group_offset += group.objects.size();
-                    group_count_offset += sizeof(iris::uint32);
-                }
-            }
-            glPopDebugGroup();
+            frame_graph.add_pass("debug_aabbs")
+                .read(main_count, iris::frame_graph_access_t::transfer)
+                .read(main_shift, iris::frame_graph_access_t::storage)
+                .write(debug_aabb_indirect, iris::frame_graph_access_t::transfer)
+                .read(debug_aabb_indirect, iris::frame_graph_access_t::indirect)
+                .write(color, iris::frame_graph_access_t::attachment)
+                .execute([&]() {
+                    glDisable(GL_DEPTH_TEST);
+                    glDisable(GL_CULL_FACE);
+                    frame_graph.framebuffer({ color, depth }).bind();
+                    debug_aabb_shader.bind();
+                    camera_buffer.bind_base(0);
+                    local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                    global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                    object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                    main_object_shift_buffer.bind_base(4);
+                    auto group_offset = 0_u32;
+                    auto group_count_offset = 0_u64;
+                    auto command = draw_arrays_indirect_t {
+                        .count = 24,
+                        .instance_count = 0,
+                        .first = 0,
+                        .base_instance = group_offset
+                    };
+                    debug_aabb_indirect_buffer.write(&command, sizeof(command));
+                    debug_aabb_indirect_buffer.bind();
+                    // copies are ordered with the draws, only the cull output needed a barrier
+                    for (auto& [_, group] : indirect_groups) {
+                        glCopyNamedBufferSubData(
+                            main_count_buffer.id(),
+                            debug_aabb_indirect_buffer.id(),
+                            group_count_offset,
+                            sizeof(iris::uint32),
+                            sizeof(iris::uint32));
+                        glBindVertexArray(aabb_vao);
+                        glMultiDrawArraysIndirect(GL_LINES, nullptr, 1, 0);
+                        group_offset += group.objects.size();
+                        group_count_offset += sizeof(iris::uint32);
+                    }
+                });
         }
 
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "copy_to_backbuffer");
-        glDisable(GL_DEPTH_TEST);
-        glDisable(GL_CULL_FACE);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        fullscreen_shader.bind();
-        offscreen_attachment[0].bind_texture(0);
-        glBindVertexArray(empty_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-        glPopDebugGroup();
+        frame_graph.add_pass("copy_to_backbuffer")
+            .read(color, iris::frame_graph_access_t::texture)
+            .execute([&]() {
+                glDisable(GL_DEPTH_TEST);
+                glDisable(GL_CULL_FACE);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                fullscreen_shader.bind();
+                frame_graph.attachment(color).bind_texture(0);
+                glBindVertexArray(empty_vao);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            });
+
+        frame_graph.execute();
 
         glfwSwapBuffers(window.handle);
         glfwPollEvents();
@@ -1,7 +1,9 @@
 #include <algorithm>
 #include <numeric>
 #include <cstdlib>
+#include <cstdio>
 #include <vector>
+#include <string>
 #include <cmath>
 #include <array>
 #include <tuple>
@@ -18,6 +20,16 @@
 #include <framebuffer.hpp>
 #include <buffer.hpp>
 #include <allocator.hpp>
+#include <gpu_profiler.hpp>
+#include <gl_state.hpp>
+#include <parameter_ring.hpp>
+#include <frame_graph.hpp>
+#include <texture_streamer.hpp>
+#include <upload_queue.hpp>
+#include <cpu_profiler.hpp>
+#include <benchmark.hpp>
+#include <headless.hpp>
+#include <capture.hpp>
 
 #include <debug_break.hpp>
 
@@ -35,8 +47,23 @@
 #include <imgui_impl_opengl3.h>
 
 #define CASCADE_COUNT 4
+#define MAX_VERTEX_BLOCKS 4
+#define CLUSTER_SIZE_X 16
+#define CLUSTER_SIZE_Y 9
+#define CLUSTER_SIZE_Z 24
+#define CLUSTER_COUNT (CLUSTER_SIZE_X * CLUSTER_SIZE_Y * CLUSTER_SIZE_Z)
+#define MAX_LIGHTS_PER_CLUSTER 256
+#define MAX_POINT_LIGHTS 16384
 #define CULL_MODE_PERSPECTIVE_CAMERA 0
 #define CULL_MODE_ORTHOGRAPHIC_CAMERA 1
+// injected into generic_cull.comp as INVOCATION_SIZE
+#define CULL_INVOCATION_SIZE 256
+// uniform buffer binding of the per pass parameter block, injected as PASS_PARAMETERS_BINDING
+#define PASS_PARAMETERS_BINDING 9
+#define SHADOW_FILTER_FIXED 0
+#define SHADOW_FILTER_ADAPTIVE 1
+#define RENDER_PATH_FORWARD 0
+#define RENDER_PATH_VISIBILITY_BUFFER 1
 
 using namespace iris::literals;
 
@@ -76,7 +103,9 @@ struct object_info_t {
     iris::uint32 specular_texture = 0;
     iris::uint32 group_index = 0;
     iris::uint32 group_offset = 0;
-    iris::float32 _pad = 0;
+    iris::uint32 vertex_block = 0;
+    iris::uint32 vertex_stride = 0;
+    iris::float32 _pad[3] = {};
     glm::vec4 scale = {};
     glm::vec4 sphere = {};
     iris::aabb_t aabb = {};
@@ -94,7 +123,8 @@ struct point_light_t {
     iris::float32 constant = 0;
     iris::float32 linear = 0;
     iris::float32 quadratic = 0;
-    iris::float32 _pad4[2] = {};
+    iris::float32 radius = 0;
+    iris::float32 _pad4 = 0;
 };
 
 struct directional_light_t {
@@ -123,57 +153,127 @@ struct cascade_data_t {
     glm::vec4 offset; // w is split
 };
 
+// std140 mirrors of the u_pass_parameters blocks, pushed to the parameter ring once per pass
+struct prepass_parameters_t {
+    glm::vec2 jitter = {};
+    iris::uint32 vertex_pulling = 0;
+    iris::uint32 _pad0 = 0;
+};
+
+struct shadow_parameters_t {
+    iris::uint32 layer = 0;
+    iris::uint32 vertex_pulling = 0;
+    iris::uint32 _pad0[2] = {};
+};
+
+struct lighting_parameters_t {
+    glm::vec2 jitter = {};
+    glm::vec2 resolution = {};
+    iris::uint32 vertex_pulling = 0;
+    iris::uint32 shadow_max_taps = 0;
+    iris::uint32 _pad0[2] = {};
+};
+
 struct cull_input_package_t {
     std::reference_wrapper<iris::buffer_t> indirect;
     std::reference_wrapper<iris::buffer_t> count;
     std::reference_wrapper<iris::buffer_t> shift;
+    // the same buffers as declared to the frame graph
+    iris::frame_graph_resource_t indirect_resource;
+    iris::frame_graph_resource_t count_resource;
+    iris::frame_graph_resource_t shift_resource;
 };
 
 struct indirect_group_t {
     std::vector<std::reference_wrapper<const iris::object_t>> objects;
+    // parallel to objects
+    std::vector<iris::uint32> model_indices;
     iris::uint32 vao = 0;
     iris::uint32 vbo = 0;
     iris::uint32 ebo = 0;
     iris::uint32 vertex_size = 0;
-    iris::uint32 model_index = 0;
+    iris::uint32 vertex_block = 0;
 };
 
 struct taa_pass_t {
     iris::framebuffer_attachment_t history;
-    iris::framebuffer_attachment_t velocity;
-    iris::framebuffer_attachment_t output;
-
-    iris::framebuffer_t output_fbo;
 
     iris::uint32 frames = 0;
 };
 
+// sweeps the point light count, timings come from the "cluster_build" and "lighting" gpu zones
+struct light_benchmark_t {
+    bool is_running = false;
+    iris::uint32 step = 0;
+    iris::uint32 step_frame = 0;
+    iris::uint32 restore_light_count = 0;
+    iris::float64 build_accumulator = 0.0;
+    iris::float64 shading_accumulator = 0.0;
+    std::vector<std::tuple<iris::uint32, iris::float32, iris::float32>> results;
+};
+
 struct ui_state_t {
     iris::uint32 cascade_index = 0;
     iris::float32 sun_size = 4.0f;
     iris::float32 sun_pitch = 1.404f;
     iris::float32 sun_heading = 4.474f;
+    iris::uint32 shadow_filter_mode = SHADOW_FILTER_ADAPTIVE;
+    iris::uint32 shadow_max_taps = 64;
+    iris::uint32 render_path = RENDER_PATH_FORWARD;
+    bool vertex_pulling = true;
+    iris::uint32 point_light_count = 0;
+    iris::uint32 texture_budget = 256;
+};
+
+// everything that feeds a frame, replaying these in order reproduces the run
+struct capture_frame_t {
+    glm::vec3 camera_position = {};
+    iris::float32 camera_yaw = 0.0f;
+    iris::float32 camera_pitch = 0.0f;
+    iris::float32 delta_time = 0.0f;
+    iris::int32 width = 0;
+    iris::int32 height = 0;
+    // bit i is set while captured_keys[i] is held
+    iris::uint32 keys = 0;
+    // random() is reseeded with this every frame so point lights do not depend on earlier frames
+    iris::uint64 seed = 0;
+    ui_state_t ui_state = {};
+    directional_light_t sun = {};
 };
 
-static auto group_indirect_commands(const std::vector<iris::model_t>& models) noexcept
+// the only keys the frame reads besides camera movement
+constexpr auto captured_keys = std::to_array<int>({ GLFW_KEY_H, GLFW_KEY_C, GLFW_KEY_F });
+
+// with a vertex pulling VAO every object lands in a single group, vertices are fetched from the pool blocks instead
+static auto group_indirect_commands(const std::vector<iris::model_t>& models, iris::uint32 pulling_vao = 0) noexcept
     -> std::unordered_map<iris::uint64, indirect_group_t> {
+    iris_cpu_zone("group_indirect_commands");
     auto groups = std::unordered_map<iris::uint64, indirect_group_t>();
     auto model_index = 0_u32;
     for (const auto& model : models) {
         for (const auto& object : model.objects()) {
             const auto& mesh = model.acquire_mesh(object.mesh);
             auto hash = 0_u64;
-            hash = iris::hash_combine(hash, mesh.vao);
-            hash = iris::hash_combine(hash, mesh.vbo);
-            hash = iris::hash_combine(hash, mesh.ebo);
-            hash = iris::hash_combine(hash, mesh.vertex_slice.index());
-            hash = iris::hash_combine(hash, mesh.index_slice.index());
-            groups[hash].objects.push_back(std::cref(object));
-            groups[hash].vao = mesh.vao;
-            groups[hash].vbo = mesh.vbo;
-            groups[hash].ebo = mesh.ebo;
-            groups[hash].vertex_size = mesh.vertex_size;
-            groups[hash].model_index = model_index;
+            if (!pulling_vao) {
+                hash = iris::hash_combine(hash, mesh.vao);
+                hash = iris::hash_combine(hash, mesh.vbo);
+                hash = iris::hash_combine(hash, mesh.ebo);
+                hash = iris::hash_combine(hash, mesh.vertex_slice.index());
+                hash = iris::hash_combine(hash, mesh.index_slice.index());
+            } else {
+                // indices still go through the fixed function index fetch, the caller only passes
+                // a pulling VAO when the whole pool fits in the bound blocks
+                assert(mesh.index_block == 0 && "vertex pulling expects a single index block");
+                assert(mesh.vertex_block < MAX_VERTEX_BLOCKS && "too many vertex blocks");
+            }
+            auto& group = groups[hash];
+            group.objects.push_back(std::cref(object));
+            group.model_indices.push_back(model_index);
+            group.vao = pulling_vao ? pulling_vao : mesh.vao;
+            group.vbo = pulling_vao ? 0 : mesh.vbo;
+            group.ebo = mesh.ebo;
+            group.vertex_size = mesh.vertex_size;
+            group.vertex_block = mesh.vertex_block;
         }
         model_index++;
     }
@@ -226,53 +326,141 @@ static auto calculate_global_projection(const iris::camera_t& camera, const glm:
     return uv_scale_bias * pv;
 }
 
-static auto calculate_wg_from_resolution(iris::uint32 width, iris::uint32 height) noexcept -> std::vector<glm::uvec2> {
-    constexpr auto wg_size = 16_u32;
-    auto wg_count = std::vector<glm::uvec2>();
-    wg_count.reserve(16);
-    wg_count.emplace_back(
-        (width + wg_size - 1) / wg_size,
-        (height + wg_size - 1) / wg_size);
-    while (wg_count.back() != glm::uvec2(1)) {
-        const auto& previous = wg_count.back();
-        const auto current_size = glm::uvec2(
-            (previous.x + wg_size - 1) / wg_size,
-            (previous.y + wg_size - 1) / wg_size);
-        wg_count.emplace_back(glm::max(current_size, glm::uvec2(1)));
+static auto make_point_lights(iris::uint32 count, const iris::aabb_t& bounds) noexcept -> std::vector<point_light_t> {
+    // light radius scales with the scene, attenuation falls to 1/256 at the radius
+    const auto radius = glm::length(bounds.max - bounds.min) * 0.025f;
+    auto point_lights = std::vector<point_light_t>();
+    point_lights.reserve(count);
+    for (auto i = 0_u32; i < count; ++i) {
+        const auto color = glm::normalize(0.25f + glm::vec3(
+            iris::random(0.0f, 1.0f),
+            iris::random(0.0f, 1.0f),
+            iris::random(0.0f, 1.0f)));
+        point_lights.push_back({
+            .position = glm::vec3(
+                iris::random(bounds.min.x, bounds.max.x),
+                iris::random(bounds.min.y, bounds.max.y),
+                iris::random(bounds.min.z, bounds.max.z)),
+            .ambient = glm::vec3(0.0f),
+            .diffuse = color,
+            .specular = color,
+            .constant = 1.0f,
+            .linear = 0.0f,
+            .quadratic = 255.0f / (radius * radius),
+            .radius = radius
+        });
     }
-    return wg_count;
+    return point_lights;
 }
 
-int main() {
-    if (!glfwInit()) {
-        return -1;
+static auto previous_power_two(iris::uint32 v) noexcept -> iris::uint32 {
+    auto r = 1_u32;
+    while ((r << 1) < v) {
+        r <<= 1;
     }
+    return r;
+}
 
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
+static auto make_depth_pyramid_info(iris::uint32 width, iris::uint32 height) noexcept -> iris::frame_graph_attachment_info_t {
+    const auto size = glm::uvec2(
+        previous_power_two(width),
+        previous_power_two(height));
+    return {
+        .width = size.x,
+        .height = size.y,
+        .levels = static_cast<iris::uint32>(1 + std::floor(std::log2(std::max(size.x, size.y)))),
+        .format = GL_RGBA32F,
+        .base_format = GL_RGBA,
+        .type = GL_FLOAT,
+        .border = false,
+        .image_access = GL_READ_WRITE,
+    };
+}
 
-    iris_defer([]() {
-        glfwTerminate();
-    });
+static auto calculate_depth_pyramid_wg(const iris::frame_graph_attachment_info_t& pyramid) noexcept -> glm::uvec2 {
+    // one workgroup per 32x32 tile of the first level
+    constexpr auto tile_size = 32_u32;
+    return {
+        (pyramid.width + tile_size - 1) / tile_size,
+        (pyramid.height + tile_size - 1) / tile_size
+    };
+}
 
-    auto window = iris::window_t();
-    window.width = WINDOW_WIDTH;
-    window.height = WINDOW_HEIGHT;
-    window.handle = glfwCreateWindow(window.width, window.height, "Iris", nullptr, nullptr);
-    if (!window.handle) {
-        return -1;
+int main(int argc, char** argv) {
+    iris_cpu_thread_name("main");
+    const auto benchmark_options = iris::parse_benchmark_options(argc, argv);
+    const auto is_headless = benchmark_options.is_headless;
+    auto replay = iris::capture_t();
+    if (!benchmark_options.replay_path.empty()) {
+        replay = iris::capture_t::load(benchmark_options.replay_path, sizeof(capture_frame_t));
+        if (replay.is_empty()) {
+            return -1;
+        }
+    }
+    const auto is_replaying = !replay.is_empty();
+    // timed runs, the frame count of a replay comes from the capture
+    const auto is_benchmarking = is_headless || is_replaying;
+    const auto benchmark_warmup = is_replaying
+        ? std::min(benchmark_options.warmup_frames, replay.frame_count())
+        : benchmark_options.warmup_frames;
+    const auto benchmark_frames = is_replaying
+        ? replay.frame_count() - benchmark_warmup
+        : benchmark_options.measured_frames;
+    auto capture = iris::capture_t();
+    if (!benchmark_options.capture_path.empty()) {
+        const auto seed = benchmark_options.seed ? benchmark_options.seed : std::random_device()();
+        capture = iris::capture_t::create(seed, sizeof(capture_frame_t));
+    }
+    const auto is_capturing = !benchmark_options.capture_path.empty();
+    if (!benchmark_options.dump_directory.empty()) {
+        auto error = std::error_code();
+        std::filesystem::create_directories(benchmark_options.dump_directory, error);
     }
 
-    glfwSetWindowUserPointer(window.handle, &window);
-    glfwMakeContextCurrent(window.handle);
+    auto window = iris::window_t();
+    auto headless = iris::headless_context_t();
+    if (is_headless) {
+        // no window and no input, the camera follows benchmark_options.camera_path or the replay
+        window.width = benchmark_options.width;
+        window.height = benchmark_options.height;
+        headless = iris::headless_context_t::create(window.width, window.height);
+        if (!headless.is_valid() || !gladLoadGL(iris::headless_context_t::load_function)) {
+            return -1;
+        }
+    } else {
+        if (!glfwInit()) {
+            return -1;
+        }
+
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
+
+        window.width = WINDOW_WIDTH;
+        window.height = WINDOW_HEIGHT;
+        window.handle = glfwCreateWindow(window.width, window.height, "Iris", nullptr, nullptr);
+        if (!window.handle) {
+            glfwTerminate();
+            return -1;
+        }
 
-    if (!gladLoadGL(glfwGetProcAddress)) {
-        return -1;
+        glfwSetWindowUserPointer(window.handle, &window);
+        glfwMakeContextCurrent(window.handle);
+
+        if (!gladLoadGL(glfwGetProcAddress)) {
+            glfwTerminate();
+            return -1;
+        }
     }
 
+    iris_defer([is_headless]() {
+        if (!is_headless) {
+            glfwTerminate();
+        }
+    });
+
 #if !defined(NDEBUG)
     glEnable(GL_DEBUG_OUTPUT);
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
@@ -295,32 +483,34 @@ int main() {
 #endif
 
     glViewport(0, 0, window.width, window.height);
-    glfwFocusWindow(window.handle);
-
-    glfwSetFramebufferSizeCallback(window.handle, [](GLFWwindow* handle, int width, int height) {
-        auto& window = *static_cast<iris::window_t*>(glfwGetWindowUserPointer(handle));
-        glViewport(0, 0, width, height);
-        window.width = width;
-        window.height = height;
-        window.is_resized = true;
-    });
+    if (!is_headless) {
+        glfwFocusWindow(window.handle);
+
+        glfwSetFramebufferSizeCallback(window.handle, [](GLFWwindow* handle, int width, int height) {
+            auto& window = *static_cast<iris::window_t*>(glfwGetWindowUserPointer(handle));
+            glViewport(0, 0, width, height);
+            window.width = width;
+            window.height = height;
+            window.is_resized = true;
+        });
 
-    glfwSetWindowFocusCallback(window.handle, [](GLFWwindow* handle, int focus) {
-        auto& window = *static_cast<iris::window_t*>(glfwGetWindowUserPointer(handle));
-        window.is_focused = focus;
-    });
+        glfwSetWindowFocusCallback(window.handle, [](GLFWwindow* handle, int focus) {
+            auto& window = *static_cast<iris::window_t*>(glfwGetWindowUserPointer(handle));
+            window.is_focused = focus;
+        });
 
-    glfwSetMouseButtonCallback(window.handle, [](GLFWwindow* handle, int button, int action, int mods) {
-        auto& window = *static_cast<iris::window_t*>(glfwGetWindowUserPointer(handle));
-        if (glfwGetMouseButton(handle, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
-            glfwSetInputMode(handle, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-            window.is_mouse_captured = true;
-        } else if (glfwGetMouseButton(handle, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_RELEASE) {
-            glfwSetInputMode(handle, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-            window.is_mouse_captured = false;
-        }
-        window.cursor_position = {};
-    });
+        glfwSetMouseButtonCallback(window.handle, [](GLFWwindow* handle, int button, int action, int mods) {
+            auto& window = *static_cast<iris::window_t*>(glfwGetWindowUserPointer(handle));
+            if (glfwGetMouseButton(handle, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+                glfwSetInputMode(handle, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+                window.is_mouse_captured = true;
+            } else if (glfwGetMouseButton(handle, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_RELEASE) {
+                glfwSetInputMode(handle, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+                window.is_mouse_captured = false;
+            }
+            window.cursor_position = {};
+        });
+    }
 
     //glEnable(GL_FRAMEBUFFER_SRGB);
     glEnable(GL_REPRESENTATIVE_FRAGMENT_TEST_NV);
@@ -329,21 +519,75 @@ int main() {
     glCullFace(GL_BACK);
     glFrontFace(GL_CCW);
 
-    auto main_shader = iris::shader_t::create("../shaders/5.2/main.vert", "../shaders/5.2/main.frag");
-    auto atmosphere_shader = iris::shader_t::create("../shaders/5.2/atmosphere.vert", "../shaders/5.2/atmosphere.frag");
-    auto depth_only_shader = iris::shader_t::create("../shaders/5.2/depth_only.vert", "../shaders/5.2/depth_only.frag");
-    auto depth_reduce_init_shader = iris::shader_t::create_compute("../shaders/5.2/depth_reduce_init.comp");
-    auto depth_reduce_shader = iris::shader_t::create_compute("../shaders/5.2/depth_reduce.comp");
-    auto setup_cascades_shader = iris::shader_t::create_compute("../shaders/5.2/setup_shadows.comp");
-    auto shadow_shader = iris::shader_t::create("../shaders/5.2/shadow.vert", "../shaders/5.2/shadow.frag");
-    auto fullscreen_shader = iris::shader_t::create("../shaders/5.2/fullscreen.vert", "../shaders/5.2/fullscreen.frag");
-    auto cull_shader = iris::shader_t::create_compute("../shaders/5.2/generic_cull.comp");
-    auto roc_shader = iris::shader_t::create("../shaders/5.2/roc.vert", "../shaders/5.2/roc.frag");
-    auto roc_cull_shader = iris::shader_t::create_compute("../shaders/5.2/roc_cull.comp");
-    auto taa_resolve_shader = iris::shader_t::create("../shaders/5.2/taa_resolve.vert", "../shaders/5.2/taa_resolve.frag");
+    // every bind in the frame loop goes through the state cache
+    iris::gl_state::set_tracking(true);
+
+    // the shaders read these from the host instead of repeating them
+    iris::shader_t::set_global_defines(std::to_array<iris::shader_define_t>({
+        { "CASCADE_COUNT", std::to_string(CASCADE_COUNT) },
+        { "PASS_PARAMETERS_BINDING", std::to_string(PASS_PARAMETERS_BINDING) },
+        { "MAX_VERTEX_BLOCKS", std::to_string(MAX_VERTEX_BLOCKS) },
+        { "CLUSTER_SIZE_X", std::to_string(CLUSTER_SIZE_X) },
+        { "CLUSTER_SIZE_Y", std::to_string(CLUSTER_SIZE_Y) },
+        { "CLUSTER_SIZE_Z", std::to_string(CLUSTER_SIZE_Z) },
+        { "MAX_LIGHTS_PER_CLUSTER", std::to_string(MAX_LIGHTS_PER_CLUSTER) },
+    }));
+    // indexed by whether the specular term is compiled out, then by shadow filter mode
+    const auto shading_defines = std::to_array({
+        std::to_array({
+            std::vector<iris::shader_define_t>({ { "SHADOW_FILTER", std::to_string(SHADOW_FILTER_FIXED) } }),
+            std::vector<iris::shader_define_t>({ { "SHADOW_FILTER", std::to_string(SHADOW_FILTER_ADAPTIVE) } }),
+        }),
+        std::to_array({
+            std::vector<iris::shader_define_t>({ { "SHADOW_FILTER", std::to_string(SHADOW_FILTER_FIXED) }, { "DISABLE_SPECULAR", "1" } }),
+            std::vector<iris::shader_define_t>({ { "SHADOW_FILTER", std::to_string(SHADOW_FILTER_ADAPTIVE) }, { "DISABLE_SPECULAR", "1" } }),
+        }),
+    });
+    const auto cull_defines = std::to_array<iris::shader_define_t>({
+        { "INVOCATION_SIZE", std::to_string(CULL_INVOCATION_SIZE) },
+    });
+    const auto cull_no_near_defines = std::to_array<iris::shader_define_t>({
+        { "INVOCATION_SIZE", std::to_string(CULL_INVOCATION_SIZE) },
+        { "DISABLE_NEAR_CULLING", "1" },
+    });
+
+    // compiled by the driver while the models load, resolved right after
+    auto shader_batch = iris::shader_batch_t::create();
+    auto main_shaders = iris::shader_permutations_t::create("../shaders/5.2/main.vert", "../shaders/5.2/main.frag");
+    auto visbuffer_resolve_shaders = iris::shader_permutations_t::create("../shaders/5.2/fullscreen.vert", "../shaders/5.2/visbuffer_resolve.frag");
+    auto cull_shaders = iris::shader_permutations_t::create_compute("../shaders/5.2/generic_cull.comp");
+    // indexed like shading_defines
+    auto main_shader_variants = std::vector<std::array<std::reference_wrapper<const iris::shader_t>, 2>>();
+    auto visbuffer_resolve_shader_variants = std::vector<std::array<std::reference_wrapper<const iris::shader_t>, 2>>();
+    for (const auto& filter_defines : shading_defines) {
+        main_shader_variants.push_back(std::to_array<std::reference_wrapper<const iris::shader_t>>({
+            main_shaders.prepare(shader_batch, filter_defines[SHADOW_FILTER_FIXED]),
+            main_shaders.prepare(shader_batch, filter_defines[SHADOW_FILTER_ADAPTIVE]),
+        }));
+        visbuffer_resolve_shader_variants.push_back(std::to_array<std::reference_wrapper<const iris::shader_t>>({
+            visbuffer_resolve_shaders.prepare(shader_batch, filter_defines[SHADOW_FILTER_FIXED]),
+            visbuffer_resolve_shaders.prepare(shader_batch, filter_defines[SHADOW_FILTER_ADAPTIVE]),
+        }));
+    }
+    // indexed by whether the near plane is tested, shadow cascades skip it
+    const auto cull_shader_variants = std::to_array<std::reference_wrapper<const iris::shader_t>>({
+        cull_shaders.prepare(shader_batch, cull_defines),
+        cull_shaders.prepare(shader_batch, cull_no_near_defines),
+    });
+    auto atmosphere_shader = shader_batch.submit("../shaders/5.2/atmosphere.vert", "../shaders/5.2/atmosphere.frag");
+    auto depth_only_shader = shader_batch.submit("../shaders/5.2/depth_only.vert", "../shaders/5.2/depth_only.frag");
+    auto depth_pyramid_shader = shader_batch.submit_compute("../shaders/5.2/depth_pyramid.comp");
+    auto setup_cascades_shader = shader_batch.submit_compute("../shaders/5.2/setup_shadows.comp");
+    auto shadow_shader = shader_batch.submit("../shaders/5.2/shadow.vert", "../shaders/5.2/shadow.frag");
+    auto fullscreen_shader = shader_batch.submit("../shaders/5.2/fullscreen.vert", "../shaders/5.2/fullscreen.frag");
+    auto roc_shader = shader_batch.submit("../shaders/5.2/roc.vert", "../shaders/5.2/roc.frag");
+    auto roc_cull_shader = shader_batch.submit_compute("../shaders/5.2/roc_cull.comp");
+    auto cluster_build_shader = shader_batch.submit_compute("../shaders/5.2/cluster_build.comp");
+    auto taa_resolve_shader = shader_batch.submit("../shaders/5.2/taa_resolve.vert", "../shaders/5.2/taa_resolve.frag");
+    auto visbuffer_shader = shader_batch.submit("../shaders/5.2/visbuffer.vert", "../shaders/5.2/visbuffer.frag");
 
     // DEBUG
-    auto debug_aabb_shader = iris::shader_t::create("../shaders/5.2/debug_aabb.vert", "../shaders/5.2/debug_aabb.frag");
+    auto debug_aabb_shader = shader_batch.submit("../shaders/5.2/debug_aabb.vert", "../shaders/5.2/debug_aabb.frag");
 
     auto blue_noise_texture = iris::texture_t::create("../textures/1024_1024/LDR_RGBA_0.png", iris::texture_type_t::linear_r8g8b8_unorm);
 
@@ -351,13 +595,19 @@ int main() {
 
     auto mesh_pool = iris::mesh_pool_t::create();
     auto models = std::vector<iris::model_t>();
+    iris_cpu_push("load_models");
     //models.emplace_back(iris::model_t::create(mesh_pool, "../models/compressed/power_plant/power_plant.glb"));
-    models.emplace_back(iris::model_t::create(mesh_pool, "../models/compressed/sponza/sponza.glb"));
+    models.emplace_back(iris::model_t::create(mesh_pool, "../models/compressed/sponza/sponza.glb", true));
     //models.emplace_back(iris::model_t::create(mesh_pool, "../models/compressed/Small_City_LVL/small_city_lvl.glb"));
     //models.emplace_back(iris::model_t::create(mesh_pool, "../models/compressed/bistro/bistro.glb"));
     //models.emplace_back(iris::model_t::create(mesh_pool, "../models/compressed/san_miguel/san_miguel.glb"));
     //models.emplace_back(iris::model_t::create(mesh_pool, "../models/compressed/cube/cube.glb"));
     //models.emplace_back(iris::model_t::create(mesh_pool, "../models/compressed/deccer_cubes/deccer_cubes.glb"));
+    iris_cpu_pop();
+    {
+        iris_cpu_zone("shader_batch_wait");
+        shader_batch.wait();
+    }
 
     auto local_transforms = std::vector<glm::mat4>();
     local_transforms.reserve(16384);
@@ -376,6 +626,24 @@ int main() {
         });
     }
 
+    // the specular term is zero without a specular map, a scene without any uses the variants that skip it
+    const auto is_specular_disabled = std::ranges::none_of(objects, [](const auto& object) {
+        return object.get().specular_texture != static_cast<iris::uint32>(-1);
+    });
+
+    auto scene_bounds = iris::aabb_t {
+        .min = glm::vec3(std::numeric_limits<iris::float32>::max()),
+        .max = glm::vec3(std::numeric_limits<iris::float32>::lowest())
+    };
+    for (auto i = 0_u32; i < objects.size(); ++i) {
+        const auto& aabb = objects[i].get().aabb;
+        const auto min = glm::vec3(local_transforms[i] * glm::vec4(aabb.min, 1.0f));
+        const auto max = glm::vec3(local_transforms[i] * glm::vec4(aabb.max, 1.0f));
+        scene_bounds.min = glm::min(scene_bounds.min, glm::min(min, max));
+        scene_bounds.max = glm::max(scene_bounds.max, glm::max(min, max));
+    }
+    auto point_lights = std::vector<point_light_t>();
+
     auto directional_lights = std::vector<directional_light_t>();
     directional_lights.push_back({
         .direction = glm::normalize(glm::vec3(-0.275f, 1.0f, 0.195f)),
@@ -386,6 +654,20 @@ int main() {
     auto empty_vao = 0_u32;
     glCreateVertexArrays(1, &empty_vao);
 
+    // no attributes, only carries the element buffer
+    auto vertex_pulling_vao = 0_u32;
+    glCreateVertexArrays(1, &vertex_pulling_vao);
+    // pulling binds every vertex block at once and shares one index block, larger scenes
+    // fall back to one multi-draw per vertex layout group
+    const auto vertex_pulling_supported =
+        mesh_pool.vertex_blocks().size() <= MAX_VERTEX_BLOCKS &&
+        mesh_pool.index_blocks().size() <= 1;
+    if (!vertex_pulling_supported) {
+        iris::log(
+            "vertex pulling: ", mesh_pool.vertex_blocks().size(), " vertex blocks and ",
+            mesh_pool.index_blocks().size(), " index blocks do not fit, falling back to per group draws");
+    }
+
     auto aabb_vao = 0_u32;
     auto aabb_vbo = 0_u32;
 
@@ -434,6 +716,18 @@ int main() {
     auto cascade_setup_buffer = iris::buffer_t::create(sizeof(cascade_setup_data_t), GL_UNIFORM_BUFFER);
     auto directional_lights_buffer = iris::buffer_t::create(sizeof(directional_light_t[4]), GL_UNIFORM_BUFFER);
     auto cascade_buffer = iris::buffer_t::create(sizeof(cascade_data_t[CASCADE_COUNT]), GL_SHADER_STORAGE_BUFFER, GL_NONE);
+    auto point_light_buffer = iris::buffer_t::create(sizeof(point_light_t[MAX_POINT_LIGHTS]), GL_SHADER_STORAGE_BUFFER);
+    auto cluster_light_count_buffer = iris::buffer_t::create(sizeof(iris::uint32[CLUSTER_COUNT]), GL_SHADER_STORAGE_BUFFER, GL_NONE);
+    auto cluster_light_index_buffer = iris::buffer_t::create(sizeof(iris::uint32[CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER]), GL_SHADER_STORAGE_BUFFER, GL_NONE);
+    auto depth_pyramid_counter_buffer = iris::buffer_t::create(sizeof(iris::uint32), GL_SHADER_STORAGE_BUFFER, GL_NONE);
+    glClearNamedBufferSubData(
+        depth_pyramid_counter_buffer.id(),
+        GL_R32UI,
+        0,
+        depth_pyramid_counter_buffer.size(),
+        GL_RED_INTEGER,
+        GL_UNSIGNED_INT,
+        nullptr);
 
     auto prev_camera_buffer = iris::buffer_t::create(sizeof(camera_data_t), GL_UNIFORM_BUFFER);
     auto prev_local_transform_buffer = iris::buffer_t::create(sizeof(glm::mat4[163840]), GL_SHADER_STORAGE_BUFFER);
@@ -465,46 +759,23 @@ int main() {
         GL_UNSIGNED_BYTE,
         false,
         false);
-    taa_pass.velocity = iris::framebuffer_attachment_t::create(
-        window.width,
-        window.height,
-        1,
-        GL_RG16F,
-        GL_RG,
-        GL_FLOAT,
-        true,
-        false);
-    taa_pass.output = iris::framebuffer_attachment_t::create(
-        window.width,
-        window.height,
-        1,
-        GL_RGBA8,
-        GL_RGBA,
-        GL_UNSIGNED_BYTE,
-        false);
-    taa_pass.output_fbo = iris::framebuffer_t::create({
-        std::cref(taa_pass.output)
-    });
 
-    auto offscreen_attachment = std::vector<iris::framebuffer_attachment_t>(2);
-    offscreen_attachment[0] = iris::framebuffer_attachment_t::create(
-        window.width,
-        window.height,
-        1,
-        GL_RGBA8,
-        GL_RGBA,
-        GL_UNSIGNED_BYTE,
-        true,
-        true);
-    offscreen_attachment[1] = iris::framebuffer_attachment_t::create(
-        window.width,
-        window.height,
-        1,
-        GL_DEPTH_COMPONENT32F,
-        GL_DEPTH_COMPONENT,
-        GL_FLOAT,
-        true,
-        false);
+    // the scene depth outlives the frame, occlusion culling tests the bounding boxes against last frame's depth
+    const auto make_scene_depth = [](iris::uint32 width, iris::uint32 height) {
+        auto depth = iris::framebuffer_attachment_t::create(
+            width,
+            height,
+            1,
+            GL_DEPTH_COMPONENT32F,
+            GL_DEPTH_COMPONENT,
+            GL_FLOAT,
+            true,
+            false);
+        const auto clear_depth = 1.0f;
+        glClearTexImage(depth.id(), 0, GL_DEPTH_COMPONENT, GL_FLOAT, &clear_depth);
+        return depth;
+    };
+    auto scene_depth = make_scene_depth(window.width, window.height);
 
     auto shadow_attachment = iris::framebuffer_attachment_t::create(
         4096,
@@ -523,38 +794,31 @@ int main() {
         glTextureView(shadow_views[i], GL_TEXTURE_2D, shadow_attachment.id(), GL_DEPTH_COMPONENT16, 0, 1, i, 1);
     }
 
-    auto depth_reduce_wgc = calculate_wg_from_resolution(window.width, window.height);
-    auto depth_reduce_attachments = std::vector<iris::framebuffer_attachment_t>();
-    depth_reduce_attachments.reserve(depth_reduce_wgc.size());
-    for (const auto& each : depth_reduce_wgc) {
-        depth_reduce_attachments.emplace_back(iris::framebuffer_attachment_t::create(
-            each.x,
-            each.y,
-            1,
-            GL_RG32F,
-            GL_RG,
-            GL_FLOAT));
-    }
-
-    auto offscreen_fbo = iris::framebuffer_t::create({
-        std::cref(offscreen_attachment[0]),
-        std::cref(taa_pass.velocity),
-        std::cref(offscreen_attachment[1])
-    });
-    glNamedFramebufferDrawBuffers(offscreen_fbo.id(), 2, std::to_array<iris::uint32>({
-        GL_COLOR_ATTACHMENT0,
-        GL_COLOR_ATTACHMENT1
-    }).data());
-
-    auto depth_only_fbo = iris::framebuffer_t::create({
-        std::cref(offscreen_attachment[1])
-    });
-    depth_only_fbo.clear_depth(1.0f);
+    // raw depth view of the cascades for the blocker search (no depth comparison)
+    auto shadow_depth_view = 0_u32;
+    glGenTextures(1, &shadow_depth_view);
+    glTextureView(shadow_depth_view, GL_TEXTURE_2D_ARRAY, shadow_attachment.id(), GL_DEPTH_COMPONENT16, 0, 1, 0, CASCADE_COUNT);
+    glTextureParameteri(shadow_depth_view, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glTextureParameteri(shadow_depth_view, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(shadow_depth_view, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     auto shadow_fbo = iris::framebuffer_t::create({
         std::cref(shadow_attachment)
     });
 
+    // every other attachment is a transient of the frame graph
+    auto frame_graph = iris::frame_graph_t::create();
+
+    // streamed levels go through the pixel unpack ring, a level bigger than the frame budget takes several frames
+    auto upload_queue = iris::upload_queue_t::create(16_MiB);
+    // indices follow the order of texture_handles
+    auto texture_streamer = iris::texture_streamer_t::create(ui_state_t().texture_budget * 1_MiB, 64_MiB, &upload_queue);
+    for (auto& model : models) {
+        for (auto& texture : model.textures()) {
+            texture_streamer.add(texture);
+        }
+    }
+
     auto ui_state = ui_state_t();
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -641,12 +905,24 @@ int main() {
         style.Colors[ImGuiCol_NavWindowingDimBg] = ImVec4(0.80f, 0.80f, 0.80f, 0.20f);
         style.Colors[ImGuiCol_ModalWindowDimBg] = ImVec4(0.80f, 0.80f, 0.80f, 0.35f);
     }
-    ImGui_ImplGlfw_InitForOpenGL(window.handle, true);
+    if (!is_headless) {
+        ImGui_ImplGlfw_InitForOpenGL(window.handle, true);
+    }
     ImGui_ImplOpenGL3_Init("#version 460 core");
 
     auto delta_time = 0.0f;
-    auto last_time = 0.0f;
-    glfwSwapInterval(0);
+    auto last_time = 0.0_f64;
+    if (!is_headless) {
+        glfwSwapInterval(0);
+    }
+    auto key_state = 0_u32;
+    const auto is_key_pressed = [&key_state](int key) {
+        const auto index = static_cast<iris::uint32>(std::ranges::find(captured_keys, key) - captured_keys.begin());
+        assert(index < captured_keys.size() && "key is not captured");
+        return (key_state & (1_u32 << index)) != 0;
+    };
+    auto capture_frame = capture_frame_t();
+    auto frame_pixels = std::vector<iris::uint8>();
     auto last_key_c = false;
     auto freeze_frustum_culling = false;
     auto prev_camera_data = camera_data_t {
@@ -662,10 +938,64 @@ int main() {
     auto prev_local_transforms = local_transforms;
     auto sun_angular_measure = 0.0f;
     auto sun_pitch_inv = false;
-    while (!glfwWindowShouldClose(window.handle)) {
-        glfwPollEvents();
+    constexpr auto gpu_profiler_latency = 4_u32;
+    auto gpu_profiler = iris::gpu_profiler_t::create(
+        gpu_profiler_latency,
+        // a benchmark keeps every measured frame and never drops one
+        is_benchmarking ? benchmark_warmup + benchmark_frames + gpu_profiler_latency : 256);
+    gpu_profiler.set_blocking(is_benchmarking);
+    // a handful of blocks per frame, the ring waits on the frame that used a region three frames ago
+    // and grows if a frame ever pushes more than a region holds
+    auto parameter_ring = iris::parameter_ring_t::create(4096);
+    auto benchmark = iris::frame_benchmark_t::create(benchmark_warmup, benchmark_frames);
+    auto camera_path = iris::camera_path_t();
+    if (!benchmark_options.camera_path.empty()) {
+        camera_path = iris::camera_path_t::create(benchmark_options.camera_path);
+    }
+    auto light_benchmark = light_benchmark_t();
+    constexpr auto light_benchmark_counts = std::to_array<iris::uint32>({ 256, 1024, 2048, 4096, 8192, 16384 });
+    constexpr auto light_benchmark_warmup = 16_u32;
+    constexpr auto light_benchmark_frames = 128_u32;
+    const auto is_running = [&]() {
+        if (is_benchmarking && benchmark.is_done()) {
+            return false;
+        }
+        return is_headless || !glfwWindowShouldClose(window.handle);
+    };
+    while (is_running()) {
+        iris_cpu_zone("frame");
+        if (is_benchmarking) {
+            benchmark.begin_frame(gpu_profiler.frames());
+        }
+        if (is_headless && !camera_path.is_empty()) {
+            const auto keyframe = camera_path.sample(benchmark.frame_index() * benchmark_options.time_step);
+            camera.set_view(keyframe.position, keyframe.yaw, keyframe.pitch);
+        }
+        if (!is_headless) {
+            glfwPollEvents();
+        }
+        if (is_replaying) {
+            capture_frame = replay.frame<capture_frame_t>(benchmark.frame_index());
+            key_state = capture_frame.keys;
+            if (capture_frame.width != window.width || capture_frame.height != window.height) {
+                window.width = capture_frame.width;
+                window.height = capture_frame.height;
+                window.is_resized = true;
+            }
+        } else {
+            key_state = 0;
+            for (auto i = 0_u32; i < captured_keys.size(); ++i) {
+                if (window.handle && glfwGetKey(window.handle, captured_keys[i]) == GLFW_PRESS) {
+                    key_state |= 1_u32 << i;
+                }
+            }
+        }
+        gpu_profiler.begin_frame();
+        parameter_ring.begin_frame();
         if (window.is_resized) {
-            glFinish();
+            // transients of the old size are released once no pass asks for them, no need to wait for the GPU
+            frame_graph.forget_attachment(scene_depth);
+            scene_depth = make_scene_depth(window.width, window.height);
             taa_pass.history = iris::framebuffer_attachment_t::create(
                 window.width,
                 window.height,
@@ -675,85 +1005,25 @@ int main() {
                 GL_UNSIGNED_BYTE,
                 false,
                 false);
-            taa_pass.velocity = iris::framebuffer_attachment_t::create(
-                window.width,
-                window.height,
-                1,
-                GL_RG16F,
-                GL_RG,
-                GL_FLOAT,
-                true,
-                false);
             taa_pass.frames = 0;
-
-            offscreen_attachment[0] = iris::framebuffer_attachment_t::create(
-                window.width,
-                window.height,
-                1,
-                GL_RGBA8,
-                GL_RGBA,
-                GL_UNSIGNED_BYTE,
-                false,
-                true);
-            offscreen_attachment[1] = iris::framebuffer_attachment_t::create(
-                window.width,
-                window.height,
-                1,
-                GL_DEPTH_COMPONENT32F,
-                GL_DEPTH_COMPONENT,
-                GL_FLOAT,
-                true,
-                false);
-            offscreen_fbo = iris::framebuffer_t::create({
-                std::cref(offscreen_attachment[0]),
-                std::cref(taa_pass.velocity),
-                std::cref(offscreen_attachment[1])
-            });
-            glNamedFramebufferDrawBuffers(offscreen_fbo.id(), 2, std::to_array<iris::uint32>({
-                GL_COLOR_ATTACHMENT0,
-                GL_COLOR_ATTACHMENT1
-            }).data());
-
-            taa_pass.output = iris::framebuffer_attachment_t::create(
-                window.width,
-                window.height,
-                1,
-                GL_RGBA8,
-                GL_RGBA,
-                GL_UNSIGNED_BYTE,
-                false);
-
-            depth_only_fbo = iris::framebuffer_t::create({
-                std::cref(offscreen_attachment[1])
-            });
-
-            depth_reduce_wgc = calculate_wg_from_resolution(window.width, window.height);
-            depth_reduce_attachments.clear();
-            for (const auto& each : depth_reduce_wgc) {
-                depth_reduce_attachments.emplace_back(iris::framebuffer_attachment_t::create(
-                    each.x,
-                    each.y,
-                    1,
-                    GL_RG32F,
-                    GL_RG,
-                    GL_FLOAT));
-            }
-
-            taa_pass.output_fbo = iris::framebuffer_t::create({
-                std::cref(taa_pass.output)
-            });
-
             window.is_resized = false;
         }
-        if (glfwGetKey(window.handle, GLFW_KEY_H) == GLFW_PRESS) {
+        if (is_key_pressed(GLFW_KEY_H)) {
             taa_pass.frames = 0;
         }
 
-        const auto current_time = static_cast<iris::float32>(glfwGetTime());
-        delta_time = current_time - last_time;
+        // headless runs advance by the fixed step so every run sees the same animation,
+        // kept in double since a float clock loses precision as the run grows
+        const auto current_time = is_headless
+            ? benchmark.frame_index() * static_cast<iris::float64>(benchmark_options.time_step)
+            : glfwGetTime();
+        delta_time = static_cast<iris::float32>(current_time - last_time);
         last_time = current_time;
+        if (is_replaying) {
+            delta_time = capture_frame.delta_time;
+        }
 
-        const auto key_c_pressed = glfwGetKey(window.handle, GLFW_KEY_C) == GLFW_PRESS;
+        const auto key_c_pressed = is_key_pressed(GLFW_KEY_C);
         if (key_c_pressed && !last_key_c) {
             freeze_frustum_culling = !freeze_frustum_culling;
         }
@@ -778,41 +1048,105 @@ int main() {
             ui_state.sun_pitch = 0;
             sun_pitch_inv = false;
         }*/
+        if (light_benchmark.is_running) {
+            ui_state.point_light_count = light_benchmark_counts[light_benchmark.step];
+        }
+
+        // frame inputs are final from here on
+        if (is_replaying) {
+            camera.set_view(capture_frame.camera_position, capture_frame.camera_yaw, capture_frame.camera_pitch);
+            ui_state = capture_frame.ui_state;
+            iris::seed_random(capture_frame.seed);
+        } else if (is_capturing) {
+            capture_frame = capture_frame_t {
+                .camera_position = camera.position(),
+                .camera_yaw = camera.yaw(),
+                .camera_pitch = camera.pitch(),
+                .delta_time = delta_time,
+                .width = window.width,
+                .height = window.height,
+                .keys = key_state,
+                .seed = iris::hash_combine(capture.seed(), capture.frame_count()),
+                .ui_state = ui_state,
+            };
+            iris::seed_random(capture_frame.seed);
+        }
+
         directional_lights[0].direction = glm::normalize(glm::vec3(
             glm::cos(ui_state.sun_pitch) * glm::sin(ui_state.sun_heading),
             glm::sin(ui_state.sun_pitch),
             glm::cos(ui_state.sun_pitch) * glm::cos(ui_state.sun_heading)));
+        if (is_replaying) {
+            directional_lights[0] = capture_frame.sun;
+        } else if (is_capturing) {
+            capture_frame.sun = directional_lights[0];
+            capture.push_frame(capture_frame);
+        }
+
+        if (point_lights.size() != ui_state.point_light_count) {
+            point_lights = make_point_lights(ui_state.point_light_count, scene_bounds);
+            point_light_buffer.write(point_lights.data(), iris::size_bytes(point_lights));
+        }
+
+        // a cheap stand-in for sampler feedback: the projected size of the bounds of every object in view
+        const auto camera_frustum = iris::make_perspective_frustum(camera.projection() * camera.view());
+        const auto pixel_scale = camera.projection()[1][1] * 0.5f * static_cast<iris::float32>(window.height);
+        const auto request_textures = [&](const iris::object_t& object, iris::uint32 texture_offset, const glm::mat4& transform) {
+            const auto center = glm::vec3(transform * glm::vec4((object.aabb.min + object.aabb.max) * 0.5f, 1.0f));
+            const auto radius = glm::length(glm::mat3(transform) * ((object.aabb.max - object.aabb.min) * 0.5f));
+            for (const auto& plane : camera_frustum.planes) {
+                if (glm::dot(plane.normal, center) - plane.distance < -radius) {
+                    return;
+                }
+            }
+            const auto distance = glm::distance(center, camera.position());
+            const auto size = distance > radius ?
+                2.0f * radius / distance * pixel_scale :
+                static_cast<iris::float32>(std::max(window.width, window.height));
+            for (const auto texture : { object.diffuse_texture, object.normal_texture, object.specular_texture }) {
+                if (texture != static_cast<iris::uint32>(-1)) {
+                    texture_streamer.request(texture + texture_offset, size);
+                }
+            }
+        };
 
         auto object_infos = std::vector<object_info_t>();
         object_infos.reserve(objects.size());
-        const auto indirect_groups = group_indirect_commands(models);
+        const auto vertex_pulling = static_cast<iris::uint32>(ui_state.vertex_pulling && vertex_pulling_supported);
+        const auto indirect_groups = group_indirect_commands(models, vertex_pulling ? vertex_pulling_vao : 0);
         {
+            iris_cpu_zone("object_info_assembly");
             auto mesh_index = 0_u32;
             auto group_index = 0_u32;
             auto group_offset = 0_u32;
             for (auto& [_, group] : indirect_groups) {
-                for (auto& object : group.objects) {
+                for (auto i = 0_u32; i < group.objects.size(); ++i) {
+                    const auto model_index = group.model_indices[i];
                     auto texture_offset = 0_u32;
-                    for (auto i = 0_u32; i < group.model_index; ++i) {
-                        texture_offset += models[i].textures().size();
+                    for (auto j = 0_u32; j < model_index; ++j) {
+                        texture_offset += models[j].textures().size();
                     }
-                    auto& u_object = object.get();
-                    const auto& mesh = models[group.model_index].acquire_mesh(u_object.mesh);
+                    auto& u_object = group.objects[i].get();
+                    const auto& mesh = models[model_index].acquire_mesh(u_object.mesh);
+                    request_textures(u_object, texture_offset, global_transforms[model_index] * local_transforms[mesh_index]);
+                    // the base instance carries the object index to the vertex shaders
                     auto command = draw_elements_indirect_t {
                         static_cast<iris::uint32>(mesh.index_count),
                         1,
                         static_cast<iris::uint32>(mesh.index_offset),
                         static_cast<iris::int32>(mesh.vertex_offset),
-                        0
+                        static_cast<iris::uint32>(object_infos.size())
                     };
                     object_infos.push_back({
                         .local_transform = mesh_index,
-                        .global_transform = group.model_index,
+                        .global_transform = model_index,
                         .diffuse_texture = u_object.diffuse_texture + texture_offset,
                         .normal_texture = u_object.normal_texture + texture_offset,
                         .specular_texture = u_object.specular_texture + texture_offset,
                         .group_index = group_index,
                         .group_offset = group_offset,
+                        .vertex_block = mesh.vertex_block,
+                        .vertex_stride = static_cast<iris::uint32>(mesh.vertex_size / sizeof(iris::float32)),
                         .scale = glm::make_vec4(u_object.scale),
                         .sphere = u_object.sphere,
                         .aabb = u_object.aabb,
@@ -825,12 +1159,10 @@ int main() {
             }
         }
 
-        roc_indirect_buffer.write(iris::as_const_ptr(draw_arrays_indirect_t {
-            .count = 24,
-            .instance_count = 0,
-            .first = 0,
-            .base_instance = 0
-        }), sizeof(draw_arrays_indirect_t));
+        // streaming replaces textures, the handles have to be gathered after
+        texture_streamer.set_budget(ui_state.texture_budget * 1_MiB);
+        texture_streamer.update();
+        upload_queue.update();
 
         auto texture_handles = std::vector<iris::uint64>();
         texture_handles.reserve(object_infos.size());
@@ -840,7 +1172,6 @@ int main() {
             });
         }
 
-        const auto camera_frustum = iris::make_perspective_frustum(camera.projection() * camera.view());
         const auto camera_data = camera_data_t {
             camera.projection(true),
             camera.projection(),
@@ -861,143 +1192,169 @@ int main() {
             .resolution = static_cast<iris::float32>(shadow_attachment.width()),
         }), sizeof(cascade_setup_data_t));
 
-        local_transform_buffer.write(local_transforms.data(), iris::size_bytes(local_transforms));
-        global_transform_buffer.write(global_transforms.data(), iris::size_bytes(global_transforms));
-        object_info_buffer.write(object_infos.data(), iris::size_bytes(object_infos));
-        texture_buffer.write(texture_handles.data(), iris::size_bytes(texture_handles));
-        directional_lights_buffer.write(directional_lights.data(), iris::size_bytes(directional_lights));
+        {
+            iris_cpu_zone("buffer_upload");
+            local_transform_buffer.write(local_transforms.data(), iris::size_bytes(local_transforms));
+            global_transform_buffer.write(global_transforms.data(), iris::size_bytes(global_transforms));
+            object_info_buffer.write(object_infos.data(), iris::size_bytes(object_infos));
+            texture_buffer.write(texture_handles.data(), iris::size_bytes(texture_handles));
+            directional_lights_buffer.write(directional_lights.data(), iris::size_bytes(directional_lights));
+            frustum_buffer.write(iris::as_const_ptr(camera_frustum), iris::size_bytes(camera_frustum));
+
+            prev_local_transform_buffer.write(prev_local_transforms.data(), iris::size_bytes(prev_local_transforms));
+            prev_global_transform_buffer.write(prev_global_transforms.data(), iris::size_bytes(prev_global_transforms));
+        }
 
-        prev_local_transform_buffer.write(prev_local_transforms.data(), iris::size_bytes(prev_local_transforms));
-        prev_global_transform_buffer.write(prev_global_transforms.data(), iris::size_bytes(prev_global_transforms));
+        // unused slots alias the first block, every storage block a shader declares must have a buffer bound
+        const auto vertex_blocks = mesh_pool.vertex_blocks();
+        for (auto i = 0_u32; i < MAX_VERTEX_BLOCKS; ++i) {
+            iris::gl_state::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 16 + i, vertex_blocks[std::min<iris::uint64>(i, vertex_blocks.size() - 1)]);
+        }
 
-        auto frustum_cull_scene = [&](
-            cull_input_package_t package,
-            iris::uint32 disable_near,
-            iris::uint32 cascade_layer = -1) {
-            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "frustum_cull_pass");
-            cull_shader
-                .bind()
-                .set(0, { static_cast<iris::uint32>(indirect_groups.size()) })
-                .set(1, { static_cast<iris::uint32>(object_infos.size()) })
-                .set(2, { 0_u32 })
-                .set(3, { disable_near })
-                .set(4, { cascade_layer });
-            local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-            global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-            object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-            package.indirect.get().bind_base(GL_SHADER_STORAGE_BUFFER, 4);
-            package.count.get().bind_base(GL_SHADER_STORAGE_BUFFER, 5);
-            package.shift.get().bind_base(6);
-            cascade_buffer.bind_base(7);
-            camera_buffer.bind_base(8);
-            roc_indirect_buffer.bind_base(GL_SHADER_STORAGE_BUFFER, 9);
-            roc_object_shift_buffer.bind_base(10);
-
-            glClearNamedBufferSubData(
-                package.count.get().id(),
-                GL_R32UI,
-                0,
-                package.count.get().size(),
-                GL_RED_INTEGER,
-                GL_UNSIGNED_INT,
-                nullptr);
-            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-            glDispatchCompute((object_infos.size() + 255) / 256, 1, 1);
-            glMemoryBarrier(GL_SHADER_STORAGE_BUFFER | GL_COMMAND_BARRIER_BIT);
-            glPopDebugGroup();
-        };
+        // buffers only ever written by the CPU never need a barrier and are not declared
+        frame_graph.reset();
+        const auto main_indirect = frame_graph.import_buffer("main_indirect", main_indirect_buffer);
+        const auto main_count = frame_graph.import_buffer("main_count", main_count_buffer);
+        const auto main_shift = frame_graph.import_buffer("main_object_shift", main_object_shift_buffer);
+        const auto shadow_indirect = frame_graph.import_buffer("shadow_indirect", shadow_indirect_buffer);
+        const auto shadow_count = frame_graph.import_buffer("shadow_count", shadow_count_buffer);
+        const auto shadow_shift = frame_graph.import_buffer("shadow_object_shift", shadow_object_shift_buffer);
+        const auto roc_indirect = frame_graph.import_buffer("roc_indirect", roc_indirect_buffer);
+        const auto roc_shift = frame_graph.import_buffer("roc_object_shift", roc_object_shift_buffer);
+        const auto roc_visibility = frame_graph.import_buffer("roc_visibility", roc_visibility_buffer);
+        const auto frustums = frame_graph.import_buffer("frustums", frustum_buffer);
+        const auto cascades = frame_graph.import_buffer("cascades", cascade_buffer);
+        const auto depth_pyramid_counter = frame_graph.import_buffer("depth_pyramid_counter", depth_pyramid_counter_buffer);
+        const auto cluster_light_counts = frame_graph.import_buffer("cluster_light_count", cluster_light_count_buffer);
+        const auto cluster_light_indices = frame_graph.import_buffer("cluster_light_index", cluster_light_index_buffer);
+        const auto debug_aabb_indirect = frame_graph.import_buffer("debug_aabb_indirect", debug_aabb_indirect_buffer);
+        const auto depth = frame_graph.import_attachment("scene_depth", scene_depth);
+        const auto shadow_map = frame_graph.import_attachment("shadow_map", shadow_attachment);
+
+        const auto frame_width = static_cast<iris::uint32>(window.width);
+        const auto frame_height = static_cast<iris::uint32>(window.height);
+        const auto color = frame_graph.create_attachment("color", {
+            .width = frame_width,
+            .height = frame_height,
+            .format = GL_RGBA8,
+            .base_format = GL_RGBA,
+            .type = GL_UNSIGNED_BYTE,
+            .nearest = false,
+        });
+        const auto velocity = frame_graph.create_attachment("velocity", {
+            .width = frame_width,
+            .height = frame_height,
+            .format = GL_RG16F,
+            .base_format = GL_RG,
+            .type = GL_FLOAT,
+            .border = false,
+        });
+        // x => object id + 1, y => triangle id, shares the depth attachment with the rest of the frame
+        const auto visbuffer = frame_graph.create_attachment("visbuffer", {
+            .width = frame_width,
+            .height = frame_height,
+            .format = GL_RG32UI,
+            .base_format = GL_RG_INTEGER,
+            .type = GL_UNSIGNED_INT,
+            .border = false,
+        });
+        const auto depth_pyramid_info = make_depth_pyramid_info(frame_width, frame_height);
+        const auto depth_pyramid_wgc = calculate_depth_pyramid_wg(depth_pyramid_info);
+        const auto depth_pyramid = frame_graph.create_attachment("depth_pyramid", depth_pyramid_info);
+        const auto depth_reduce_output = frame_graph.create_attachment("depth_reduce_output", {
+            .width = 1,
+            .height = 1,
+            .format = GL_RG32F,
+            .base_format = GL_RG,
+            .type = GL_FLOAT,
+        });
+        // read by the viewport and the frame dump after the graph ran
+        frame_graph.export_attachment(color);
+        frame_graph.export_attachment(velocity);
 
         auto main_indirect_package = cull_input_package_t {
             .indirect = std::ref(main_indirect_buffer),
             .count = std::ref(main_count_buffer),
-            .shift = std::ref(main_object_shift_buffer)
+            .shift = std::ref(main_object_shift_buffer),
+            .indirect_resource = main_indirect,
+            .count_resource = main_count,
+            .shift_resource = main_shift
         };
         auto shadow_indirect_package = cull_input_package_t {
             .indirect = std::ref(shadow_indirect_buffer),
             .count = std::ref(shadow_count_buffer),
-            .shift = std::ref(shadow_object_shift_buffer)
+            .shift = std::ref(shadow_object_shift_buffer),
+            .indirect_resource = shadow_indirect,
+            .count_resource = shadow_count,
+            .shift_resource = shadow_shift
         };
 
-        glViewport(0, 0, window.width, window.height);
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "depth_prepass");
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_CULL_FACE);
-        glDepthMask(GL_TRUE);
-        glDepthFunc(GL_LESS);
-
-        frustum_buffer.write(iris::as_const_ptr(camera_frustum), iris::size_bytes(camera_frustum));
-        frustum_buffer.bind_range(0, 0, iris::size_bytes(camera_frustum));
-        if (!freeze_frustum_culling) {
-            frustum_cull_scene(main_indirect_package, 0);
-            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "main_roc");
-            glDisable(GL_CULL_FACE);
-            glDepthMask(GL_FALSE);
-            glClearNamedBufferSubData(
-                roc_visibility_buffer.id(),
-                GL_R32UI,
-                0,
-                roc_visibility_buffer.size(),
-                GL_RED_INTEGER,
-                GL_UNSIGNED_INT,
-                nullptr);
-            depth_only_fbo.bind();
-            roc_shader.bind();
-            camera_buffer.bind_base(0);
-            local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-            global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-            object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-            roc_object_shift_buffer.bind_base(4);
-            roc_visibility_buffer.bind_base(5);
-            roc_indirect_buffer.bind();
-            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-            glBindVertexArray(empty_vao);
-            glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr, 1, 0);
-            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
-            glDepthMask(GL_TRUE);
-            glEnable(GL_CULL_FACE);
-            roc_cull_shader
-                .bind()
-                .set(0, { static_cast<iris::uint32>(objects.size()) });
-            object_info_buffer.bind_range(0, 0, iris::size_bytes(object_infos));
-            roc_visibility_buffer.bind_base(1);
-            main_indirect_buffer.bind_base(GL_SHADER_STORAGE_BUFFER, 2);
-            main_count_buffer.bind_base(GL_SHADER_STORAGE_BUFFER, 3);
-            main_object_shift_buffer.bind_base(4);
-            glClearNamedBufferSubData(
-                main_count_buffer.id(),
-                GL_R32UI,
-                0,
-                main_count_buffer.size(),
-                GL_RED_INTEGER,
-                GL_UNSIGNED_INT,
-                nullptr);
-            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-            glDispatchCompute((objects.size() + 255) / 256, 1, 1);
-            glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
-            glPopDebugGroup();
-        }
+        auto add_frustum_cull_pass = [&](
+            cull_input_package_t package,
+            iris::uint32 disable_near,
+            iris::uint32 cascade_layer = -1) {
+            const auto is_camera = cascade_layer == static_cast<iris::uint32>(-1);
+            auto pass = frame_graph.add_pass("frustum_cull_pass");
+            pass
+                .read(frustums, iris::frame_graph_access_t::storage)
+                .read(cascades, iris::frame_graph_access_t::storage)
+                .write(package.indirect_resource, iris::frame_graph_access_t::storage)
+                .write(package.count_resource, iris::frame_graph_access_t::transfer)
+                .write(package.count_resource, iris::frame_graph_access_t::storage)
+                .write(package.shift_resource, iris::frame_graph_access_t::storage);
+            if (is_camera) {
+                // only the camera cull appends the bounding boxes the occlusion pass draws
+                pass
+                    .write(roc_indirect, iris::frame_graph_access_t::transfer)
+                    .write(roc_indirect, iris::frame_graph_access_t::storage)
+                    .write(roc_shift, iris::frame_graph_access_t::storage);
+            }
+            pass.execute([&, package, disable_near, cascade_layer, is_camera]() {
+                if (is_camera) {
+                    roc_indirect_buffer.write(iris::as_const_ptr(draw_arrays_indirect_t {
+                        .count = 24,
+                        .instance_count = 0,
+                        .first = 0,
+                        .base_instance = 0
+                    }), sizeof(draw_arrays_indirect_t));
+                    frustum_buffer.bind_range(0, 0, sizeof(iris::frustum_t));
+                } else {
+                    frustum_buffer.bind_range(0, (cascade_layer + 1) * sizeof(iris::frustum_t), sizeof(iris::frustum_t));
+                }
+                cull_shader_variants[disable_near].get()
+                    .bind()
+                    .set(0, { static_cast<iris::uint32>(indirect_groups.size()) })
+                    .set(1, { static_cast<iris::uint32>(object_infos.size()) })
+                    .set(2, { 0_u32 })
+                    .set(4, { cascade_layer });
+                local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                package.indirect.get().bind_base(GL_SHADER_STORAGE_BUFFER, 4);
+                package.count.get().bind_base(GL_SHADER_STORAGE_BUFFER, 5);
+                package.shift.get().bind_base(6);
+                cascade_buffer.bind_base(7);
+                camera_buffer.bind_base(8);
+                roc_indirect_buffer.bind_base(GL_SHADER_STORAGE_BUFFER, 9);
+                roc_object_shift_buffer.bind_base(10);
+
+                glClearNamedBufferSubData(
+                    package.count.get().id(),
+                    GL_R32UI,
+                    0,
+                    package.count.get().size(),
+                    GL_RED_INTEGER,
+                    GL_UNSIGNED_INT,
+                    nullptr);
+                glDispatchCompute((object_infos.size() + CULL_INVOCATION_SIZE - 1) / CULL_INVOCATION_SIZE, 1, 1);
+            });
+        };
 
-        const auto n_jitter = glm::vec2(0.0f);
-        depth_only_fbo.clear_depth(1.0f);
-        depth_only_fbo.bind();
-        depth_only_shader
-            .bind()
-            .set(1, n_jitter);
-        camera_buffer.bind_base(0);
-        local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-        global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-        object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-        main_object_shift_buffer.bind_base(4);
-        main_indirect_buffer.bind();
-        main_count_buffer.bind();
-        {
+        auto draw_indirect_groups = [&]() {
             auto indirect_offset = 0_u32;
-            auto group_offset = 0_u32;
             auto group_count_offset = 0_u64;
             for (auto& [_, group] : indirect_groups) {
-                depth_only_shader.set(0, { group_offset });
-                glBindVertexArray(group.vao);
+                iris::gl_state::bind_vertex_array(group.vao);
                 glVertexArrayVertexBuffer(group.vao, 0, group.vbo, 0, group.vertex_size);
                 glVertexArrayElementBuffer(group.vao, group.ebo);
                 glMultiDrawElementsIndirectCount(
@@ -1008,213 +1365,416 @@ int main() {
                     static_cast<iris::int32>(group.objects.size()),
                     0);
                 indirect_offset += group.objects.size() * sizeof(draw_elements_indirect_t);
-                group_offset += group.objects.size();
                 group_count_offset += sizeof(iris::uint32);
             }
+        };
+
+        // the visibility buffer path rasterizes once here and shades every pixel exactly once in the resolve
+        // the resolve fetches from every pool block at once, so it shares the pulling limits
+        const auto is_visbuffer = ui_state.render_path == RENDER_PATH_VISIBILITY_BUFFER && vertex_pulling_supported;
+        const auto n_jitter = glm::vec2(0.0f);
+
+        frame_graph.begin_group("depth_prepass");
+        if (!freeze_frustum_culling) {
+            add_frustum_cull_pass(main_indirect_package, 0);
+            // bounding boxes of the frustum survivors against last frame's depth
+            frame_graph.add_pass("main_roc")
+                .read(roc_indirect, iris::frame_graph_access_t::indirect)
+                .read(roc_shift, iris::frame_graph_access_t::storage)
+                .write(roc_visibility, iris::frame_graph_access_t::transfer)
+                .write(roc_visibility, iris::frame_graph_access_t::storage)
+                .read(depth, iris::frame_graph_access_t::attachment)
+                .execute([&]() {
+                    glViewport(0, 0, window.width, window.height);
+                    iris::gl_state::enable(GL_DEPTH_TEST);
+                    iris::gl_state::disable(GL_CULL_FACE);
+                    glDepthMask(GL_FALSE);
+                    glDepthFunc(GL_LESS);
+                    glClearNamedBufferSubData(
+                        roc_visibility_buffer.id(),
+                        GL_R32UI,
+                        0,
+                        roc_visibility_buffer.size(),
+                        GL_RED_INTEGER,
+                        GL_UNSIGNED_INT,
+                        nullptr);
+                    frame_graph.framebuffer({ depth }).bind();
+                    roc_shader.bind();
+                    camera_buffer.bind_base(0);
+                    local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                    global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                    object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                    roc_object_shift_buffer.bind_base(4);
+                    roc_visibility_buffer.bind_base(5);
+                    roc_indirect_buffer.bind();
+                    iris::gl_state::bind_vertex_array(empty_vao);
+                    glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr, 1, 0);
+                    glDepthMask(GL_TRUE);
+                    iris::gl_state::enable(GL_CULL_FACE);
+                });
+            frame_graph.add_pass("roc_cull")
+                .read(roc_visibility, iris::frame_graph_access_t::storage)
+                .write(main_indirect, iris::frame_graph_access_t::storage)
+                .write(main_count, iris::frame_graph_access_t::transfer)
+                .write(main_count, iris::frame_graph_access_t::storage)
+                .write(main_shift, iris::frame_graph_access_t::storage)
+                .execute([&]() {
+                    roc_cull_shader
+                        .bind()
+                        .set(0, { static_cast<iris::uint32>(objects.size()) });
+                    object_info_buffer.bind_range(0, 0, iris::size_bytes(object_infos));
+                    roc_visibility_buffer.bind_base(1);
+                    main_indirect_buffer.bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+                    main_count_buffer.bind_base(GL_SHADER_STORAGE_BUFFER, 3);
+                    main_object_shift_buffer.bind_base(4);
+                    glClearNamedBufferSubData(
+                        main_count_buffer.id(),
+                        GL_R32UI,
+                        0,
+                        main_count_buffer.size(),
+                        GL_RED_INTEGER,
+                        GL_UNSIGNED_INT,
+                        nullptr);
+                    glDispatchCompute((objects.size() + 255) / 256, 1, 1);
+                });
         }
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "depth_reduce");
-        depth_reduce_init_shader.bind();
-        offscreen_attachment[1].bind_texture(0);
-        depth_reduce_attachments[0].bind_image_texture(0, 0, false, 0, GL_WRITE_ONLY);
-        camera_buffer.bind_base(1);
-        glDispatchCompute(depth_reduce_wgc[0].x, depth_reduce_wgc[0].y, 1);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-        depth_reduce_shader.bind();
-        for (auto i = 1; i < depth_reduce_wgc.size(); i++) {
-            depth_reduce_attachments[i - 1].bind_image_texture(0, 0, false, 0, GL_READ_ONLY);
-            depth_reduce_attachments[i].bind_image_texture(1, 0, false, 0, GL_WRITE_ONLY);
-            glDispatchCompute(depth_reduce_wgc[i].x, depth_reduce_wgc[i].y, 1);
-            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        auto prepass = frame_graph.add_pass("prepass_draw");
+        prepass
+            .read(main_indirect, iris::frame_graph_access_t::indirect)
+            .read(main_count, iris::frame_graph_access_t::indirect)
+            .write(depth, iris::frame_graph_access_t::attachment);
+        if (is_visbuffer) {
+            prepass.write(visbuffer, iris::frame_graph_access_t::attachment);
         }
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "shadow_setup");
-        setup_cascades_shader.bind();
-        depth_reduce_attachments.back().bind_image_texture(0, 0, false, 0, GL_READ_ONLY);
-        cascade_setup_buffer.bind_base(1);
-        camera_buffer.bind_base(2);
-        cascade_buffer.bind_base(3);
-        frustum_buffer.bind_range(4, sizeof(iris::frustum_t), sizeof(iris::frustum_t[CASCADE_COUNT]));
-        glDispatchCompute(1, 1, 1);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "shadow_render");
-        //glCullFace(GL_FRONT);
-        glEnable(GL_DEPTH_CLAMP);
-        for (auto layer = 0_u32; layer < CASCADE_COUNT; layer++) {
-            // cull first
-            shadow_fbo.bind();
-            shadow_fbo.set_layer(0, layer);
-            frustum_buffer.bind_range(0, (layer + 1) * sizeof(iris::frustum_t), sizeof(iris::frustum_t));
-            // occlusion culling is disabled for shadows (for now)
-            frustum_cull_scene(shadow_indirect_package, 1, layer);
-
-            glViewport(0, 0, shadow_attachment.width(), shadow_attachment.height());
-            shadow_shader
-                .bind()
-                .set(0, { layer });
-            cascade_buffer.bind_base(0);
+        prepass.execute([&]() {
+            glViewport(0, 0, window.width, window.height);
+            iris::gl_state::enable(GL_DEPTH_TEST);
+            iris::gl_state::enable(GL_CULL_FACE);
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS);
+            const auto& prepass_shader = is_visbuffer ? visbuffer_shader : depth_only_shader;
+            const auto& prepass_fbo = is_visbuffer
+                ? frame_graph.framebuffer({ visbuffer, depth })
+                : frame_graph.framebuffer({ depth });
+            if (is_visbuffer) {
+                prepass_fbo.clear_color(0, { 0_u32, 0_u32, 0_u32, 0_u32 });
+            }
+            prepass_fbo.clear_depth(1.0f);
+            prepass_fbo.bind();
+            prepass_shader.bind();
+            parameter_ring.bind(PASS_PARAMETERS_BINDING, parameter_ring.push(prepass_parameters_t {
+                .jitter = n_jitter,
+                .vertex_pulling = vertex_pulling,
+            }));
+            camera_buffer.bind_base(0);
             local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
             global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
             object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-            shadow_object_shift_buffer.bind_base(4);
-            texture_buffer.bind_range(5, 0, iris::size_bytes(texture_handles));
-            shadow_count_buffer.bind();
-            shadow_indirect_buffer.bind();
+            main_indirect_buffer.bind();
+            main_count_buffer.bind();
+            draw_indirect_groups();
+        });
+        frame_graph.end_group();
+
+        frame_graph.add_pass("depth_reduce")
+            .read(depth, iris::frame_graph_access_t::texture)
+            .write(depth_pyramid, iris::frame_graph_access_t::image)
+            .write(depth_pyramid_counter, iris::frame_graph_access_t::storage)
+            .write(depth_reduce_output, iris::frame_graph_access_t::image)
+            .execute([&]() {
+                const auto& pyramid = frame_graph.attachment(depth_pyramid);
+                depth_pyramid_shader
+                    .bind()
+                    .set(0, { 0_i32 })
+                    .set(1, { pyramid.levels() })
+                    .set(2, { depth_pyramid_wgc.x * depth_pyramid_wgc.y })
+                    .set(3, pyramid.image_handles());
+                scene_depth.bind_texture(0);
+                frame_graph.attachment(depth_reduce_output).bind_image_texture(0, 0, false, 0, GL_WRITE_ONLY);
+                depth_pyramid_counter_buffer.bind_base(0);
+                camera_buffer.bind_base(1);
+                glDispatchCompute(depth_pyramid_wgc.x, depth_pyramid_wgc.y, 1);
+            });
 
-            shadow_fbo.clear_depth(1.0f);
+        frame_graph.add_pass("shadow_setup")
+            .read(depth_reduce_output, iris::frame_graph_access_t::image)
+            .write(cascades, iris::frame_graph_access_t::storage)
+            .write(frustums, iris::frame_graph_access_t::storage)
+            .execute([&]() {
+                setup_cascades_shader.bind();
+                frame_graph.attachment(depth_reduce_output).bind_image_texture(0, 0, false, 0, GL_READ_ONLY);
+                cascade_setup_buffer.bind_base(1);
+                camera_buffer.bind_base(2);
+                cascade_buffer.bind_base(3);
+                frustum_buffer.bind_range(4, sizeof(iris::frustum_t), sizeof(iris::frustum_t[CASCADE_COUNT]));
+                glDispatchCompute(1, 1, 1);
+            });
 
-            auto indirect_offset = 0_u32;
-            auto group_offset = 0_u32;
-            auto group_count_offset = 0_u64;
-            for (auto& [_, group] : indirect_groups) {
-                shadow_shader.set(1, { group_offset });
-                glBindVertexArray(group.vao);
-                glVertexArrayVertexBuffer(group.vao, 0, group.vbo, 0, group.vertex_size);
-                glVertexArrayElementBuffer(group.vao, group.ebo);
-                glMultiDrawElementsIndirectCount(
-                    GL_TRIANGLES,
-                    GL_UNSIGNED_INT,
-                    reinterpret_cast<const void*>(indirect_offset),
-                    static_cast<std::intptr_t>(group_count_offset),
-                    static_cast<iris::int32>(group.objects.size()),
-                    0);
-                indirect_offset += group.objects.size() * sizeof(draw_elements_indirect_t);
-                group_offset += group.objects.size();
-                group_count_offset += sizeof(iris::uint32);
-            }
+        frame_graph.begin_group("shadow_render");
+        for (auto layer = 0_u32; layer < CASCADE_COUNT; layer++) {
+            // occlusion culling is disabled for shadows (for now)
+            add_frustum_cull_pass(shadow_indirect_package, 1, layer);
+            frame_graph.add_pass("shadow_draw")
+                .read(shadow_indirect, iris::frame_graph_access_t::indirect)
+                .read(shadow_count, iris::frame_graph_access_t::indirect)
+                .read(cascades, iris::frame_graph_access_t::storage)
+                .write(shadow_map, iris::frame_graph_access_t::attachment)
+                .execute([&, layer]() {
+                    //glCullFace(GL_FRONT);
+                    iris::gl_state::enable(GL_DEPTH_TEST);
+                    iris::gl_state::enable(GL_CULL_FACE);
+                    iris::gl_state::enable(GL_DEPTH_CLAMP);
+                    glDepthMask(GL_TRUE);
+                    glDepthFunc(GL_LESS);
+                    shadow_fbo.bind();
+                    shadow_fbo.set_layer(0, layer);
+                    glViewport(0, 0, shadow_attachment.width(), shadow_attachment.height());
+                    shadow_shader.bind();
+                    parameter_ring.bind(PASS_PARAMETERS_BINDING, parameter_ring.push(shadow_parameters_t {
+                        .layer = layer,
+                        .vertex_pulling = vertex_pulling,
+                    }));
+                    cascade_buffer.bind_base(0);
+                    local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                    global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                    object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                    texture_buffer.bind_range(5, 0, iris::size_bytes(texture_handles));
+                    shadow_count_buffer.bind();
+                    shadow_indirect_buffer.bind();
+
+                    shadow_fbo.clear_depth(1.0f);
+                    draw_indirect_groups();
+                    iris::gl_state::disable(GL_DEPTH_CLAMP);
+                    //glCullFace(GL_BACK);
+                });
         }
-        glDisable(GL_DEPTH_CLAMP);
-        //glCullFace(GL_BACK);
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "final_color_pass");
-        glViewport(0, 0, window.width, window.height);
-        glDepthMask(GL_FALSE);
-        glDepthFunc(GL_EQUAL);
-
-        offscreen_fbo.bind();
-        offscreen_fbo.clear_color(0, { 0_u32, 0_u32, 0_u32, 255_u32 });
-        frustum_buffer.bind_range(0, 0, iris::size_bytes(camera_frustum));
-
-        glDisable(GL_DEPTH_TEST);
-        atmosphere_shader
-            .bind()
-            .set(0, glm::vec2(window.width, window.height))
-            .set(1, { sun_angular_measure });
-        camera_buffer.bind_base(0);
-        directional_lights_buffer.bind_range(1, 0, iris::size_bytes(directional_lights));
-        glBindVertexArray(empty_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-
-        auto max_samplers = 0_i32;
-        glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_samplers);
-        for (auto i = 0_u32; i < max_samplers; ++i) {
-            glBindSampler(i, 0);
+        frame_graph.end_group();
+
+        frame_graph.add_pass("cluster_build")
+            .write(cluster_light_counts, iris::frame_graph_access_t::storage)
+            .write(cluster_light_indices, iris::frame_graph_access_t::storage)
+            .execute([&]() {
+                cluster_build_shader
+                    .bind()
+                    .set(0, { static_cast<iris::uint32>(point_lights.size()) })
+                    .set(1, glm::inverse(camera.projection()));
+                camera_buffer.bind_base(0);
+                point_light_buffer.bind_base(1);
+                cluster_light_count_buffer.bind_base(2);
+                cluster_light_index_buffer.bind_base(3);
+                glDispatchCompute((CLUSTER_COUNT + 127) / 128, 1, 1);
+            });
+
+        frame_graph.begin_group("final_color_pass");
+        frame_graph.add_pass("atmosphere")
+            .read(depth, iris::frame_graph_access_t::attachment)
+            .write(color, iris::frame_graph_access_t::attachment)
+            .write(velocity, iris::frame_graph_access_t::attachment)
+            .execute([&]() {
+                glViewport(0, 0, window.width, window.height);
+                glDepthMask(GL_FALSE);
+                glDepthFunc(GL_EQUAL);
+
+                const auto& offscreen_fbo = frame_graph.framebuffer({ color, velocity, depth });
+                offscreen_fbo.bind();
+                offscreen_fbo.clear_color(0, { 0_u32, 0_u32, 0_u32, 255_u32 });
+                frustum_buffer.bind_range(0, 0, iris::size_bytes(camera_frustum));
+
+                iris::gl_state::disable(GL_DEPTH_TEST);
+                atmosphere_shader
+                    .bind()
+                    .set(0, glm::vec2(window.width, window.height))
+                    .set(1, { sun_angular_measure });
+                camera_buffer.bind_base(0);
+                directional_lights_buffer.bind_range(1, 0, iris::size_bytes(directional_lights));
+                iris::gl_state::bind_vertex_array(empty_vao);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            });
+        auto lighting = frame_graph.add_pass("lighting");
+        lighting
+            .read(cluster_light_counts, iris::frame_graph_access_t::storage)
+            .read(cluster_light_indices, iris::frame_graph_access_t::storage)
+            .read(shadow_map, iris::frame_graph_access_t::texture)
+            .read(depth, iris::frame_graph_access_t::attachment)
+            .write(color, iris::frame_graph_access_t::attachment)
+            .write(velocity, iris::frame_graph_access_t::attachment);
+        if (is_visbuffer) {
+            lighting.read(visbuffer, iris::frame_graph_access_t::texture);
+        } else {
+            lighting
+                .read(main_indirect, iris::frame_graph_access_t::indirect)
+                .read(main_count, iris::frame_graph_access_t::indirect);
         }
-        glEnable(GL_DEPTH_TEST);
-        offscreen_fbo.bind();
-        offscreen_fbo.clear_color(1, { 0_u32, 0_u32, 0_u32, 255_u32 });
-        glDepthFunc(GL_EQUAL);
-        main_shader
-            .bind()
-            .set(1, n_jitter)
-            .set(4, glm::vec2(window.width, window.height));
-        camera_buffer.bind_base(0);
-        local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-        global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-        object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-        main_object_shift_buffer.bind_base(4);
-        directional_lights_buffer.bind_range(5, 0, iris::size_bytes(directional_lights));
-        texture_buffer.bind_range(6, 0, iris::size_bytes(texture_handles));
-        cascade_buffer.bind_base(7);
-        prev_camera_buffer.bind_base(8);
-        prev_local_transform_buffer.bind_range(9, 0, iris::size_bytes(prev_local_transforms));
-        prev_global_transform_buffer.bind_range(10, 0, iris::size_bytes(prev_global_transforms));
-        shadow_attachment.bind_texture(0);
-        blue_noise_texture.bind(1);
-        main_indirect_buffer.bind();
-        main_count_buffer.bind();
-        {
-            auto indirect_offset = 0_u32;
-            auto group_offset = 0_u32;
-            auto group_count_offset = 0_u64;
-            main_shader
-                .set(2, { 0_i32 })
-                .set(3, { 1_i32 });
-            for (auto& [_, group] : indirect_groups) {
-                main_shader.set(0, { group_offset });
-                glBindVertexArray(group.vao);
-                glVertexArrayVertexBuffer(group.vao, 0, group.vbo, 0, group.vertex_size);
-                glVertexArrayElementBuffer(group.vao, group.ebo);
-                glMultiDrawElementsIndirectCount(
-                    GL_TRIANGLES,
-                    GL_UNSIGNED_INT,
-                    reinterpret_cast<const void*>(indirect_offset),
-                    static_cast<std::intptr_t>(group_count_offset),
-                    static_cast<iris::int32>(group.objects.size()),
-                    0);
-                indirect_offset += group.objects.size() * sizeof(draw_elements_indirect_t);
-                group_offset += group.objects.size();
-                group_count_offset += sizeof(iris::uint32);
+        lighting.execute([&]() {
+            const auto& offscreen_fbo = frame_graph.framebuffer({ color, velocity, depth });
+            offscreen_fbo.bind();
+            offscreen_fbo.clear_color(1, { 0_u32, 0_u32, 0_u32, 255_u32 });
+            point_light_buffer.bind_base(13);
+            cluster_light_count_buffer.bind_base(14);
+            cluster_light_index_buffer.bind_base(15);
+            const auto lighting_parameters = parameter_ring.push(lighting_parameters_t {
+                .jitter = n_jitter,
+                .resolution = glm::vec2(window.width, window.height),
+                .vertex_pulling = vertex_pulling,
+                .shadow_max_taps = ui_state.shadow_max_taps,
+            });
+            if (is_visbuffer) {
+                const auto& visbuffer_resolve_shader = visbuffer_resolve_shader_variants[is_specular_disabled][ui_state.shadow_filter_mode].get();
+                iris::gl_state::disable(GL_DEPTH_TEST);
+                visbuffer_resolve_shader.bind();
+                parameter_ring.bind(PASS_PARAMETERS_BINDING, lighting_parameters);
+                camera_buffer.bind_base(0);
+                local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                directional_lights_buffer.bind_range(5, 0, iris::size_bytes(directional_lights));
+                texture_buffer.bind_range(6, 0, iris::size_bytes(texture_handles));
+                cascade_buffer.bind_base(7);
+                prev_camera_buffer.bind_base(8);
+                prev_local_transform_buffer.bind_range(9, 0, iris::size_bytes(prev_local_transforms));
+                prev_global_transform_buffer.bind_range(10, 0, iris::size_bytes(prev_global_transforms));
+                frame_graph.attachment(visbuffer).bind_texture(0);
+                shadow_attachment.bind_texture(1);
+                blue_noise_texture.bind(2);
+                iris::gl_state::bind_texture_unit(3, shadow_depth_view);
+                iris::gl_state::bind_vertex_array(empty_vao);
+                // one pass over the screen, the visibility id selects the object and its vertex block
+                iris::gl_state::bind_buffer_base(GL_SHADER_STORAGE_BUFFER, 12, mesh_pool.index_blocks()[0]);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                iris::gl_state::enable(GL_DEPTH_TEST);
+            } else {
+                const auto& main_shader = main_shader_variants[is_specular_disabled][ui_state.shadow_filter_mode].get();
+                iris::gl_state::enable(GL_DEPTH_TEST);
+                glDepthFunc(GL_EQUAL);
+                main_shader.bind();
+                parameter_ring.bind(PASS_PARAMETERS_BINDING, lighting_parameters);
+                camera_buffer.bind_base(0);
+                local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                directional_lights_buffer.bind_range(5, 0, iris::size_bytes(directional_lights));
+                texture_buffer.bind_range(6, 0, iris::size_bytes(texture_handles));
+                cascade_buffer.bind_base(7);
+                prev_camera_buffer.bind_base(8);
+                prev_local_transform_buffer.bind_range(9, 0, iris::size_bytes(prev_local_transforms));
+                prev_global_transform_buffer.bind_range(10, 0, iris::size_bytes(prev_global_transforms));
+                shadow_attachment.bind_texture(0);
+                blue_noise_texture.bind(1);
+                iris::gl_state::bind_texture_unit(2, shadow_depth_view);
+                main_indirect_buffer.bind();
+                main_count_buffer.bind();
+                draw_indirect_groups();
             }
+        });
+        frame_graph.end_group();
+
+        frame_graph.add_pass("fsr_pass");
+
+        if (is_key_pressed(GLFW_KEY_F)) {
+            frame_graph.add_pass("debug_aabbs")
+                .read(main_count, iris::frame_graph_access_t::transfer)
+                .read(main_shift, iris::frame_graph_access_t::storage)
+                .write(debug_aabb_indirect, iris::frame_graph_access_t::transfer)
+                .read(debug_aabb_indirect, iris::frame_graph_access_t::indirect)
+                .read(depth, iris::frame_graph_access_t::attachment)
+                .write(color, iris::frame_graph_access_t::attachment)
+                .write(velocity, iris::frame_graph_access_t::attachment)
+                .execute([&]() {
+                    iris::gl_state::disable(GL_DEPTH_TEST);
+                    iris::gl_state::disable(GL_CULL_FACE);
+                    frame_graph.framebuffer({ color, velocity, depth }).bind();
+                    debug_aabb_shader.bind();
+                    camera_buffer.bind_base(0);
+                    local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
+                    global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
+                    object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
+                    main_object_shift_buffer.bind_base(4);
+                    auto group_offset = 0_u32;
+                    auto group_count_offset = 0_u64;
+                    debug_aabb_indirect_buffer.bind();
+                    // updates and copies are ordered with the draws, only the cull output needed a barrier
+                    for (auto& [_, group] : indirect_groups) {
+                        auto command = draw_arrays_indirect_t {
+                            .count = 24,
+                            .instance_count = 0,
+                            .first = 0,
+                            .base_instance = group_offset
+                        };
+                        debug_aabb_indirect_buffer.write(&command, sizeof(command));
+                        glCopyNamedBufferSubData(
+                            main_count_buffer.id(),
+                            debug_aabb_indirect_buffer.id(),
+                            group_count_offset,
+                            sizeof(iris::uint32),
+                            sizeof(iris::uint32));
+                        iris::gl_state::bind_vertex_array(aabb_vao);
+                        glMultiDrawArraysIndirect(GL_LINES, nullptr, 1, 0);
+                        group_offset += group.objects.size();
+                        group_count_offset += sizeof(iris::uint32);
+                    }
+                });
         }
-        glPopDebugGroup();
-
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "fsr_pass");
-        glPopDebugGroup();
 
-        glDisable(GL_DEPTH_TEST);
-        offscreen_fbo.bind();
-        if (glfwGetKey(window.handle, GLFW_KEY_F) == GLFW_PRESS) {
-            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "debug_aabbs");
-            glDisable(GL_CULL_FACE);
-            debug_aabb_shader.bind();
-            camera_buffer.bind_base(0);
-            local_transform_buffer.bind_range(1, 0, iris::size_bytes(local_transforms));
-            global_transform_buffer.bind_range(2, 0, iris::size_bytes(global_transforms));
-            object_info_buffer.bind_range(3, 0, iris::size_bytes(object_infos));
-            main_object_shift_buffer.bind_base(4);
-            {
-                auto group_offset = 0_u32;
-                auto group_count_offset = 0_u64;
-                debug_aabb_indirect_buffer.bind();
-                for (auto& [_, group] : indirect_groups) {
-                    auto command = draw_arrays_indirect_t {
-                        .count = 24,
-                        .instance_count = 0,
-                        .first = 0,
-                        .base_instance = group_offset
-                    };
-                    debug_aabb_indirect_buffer.write(&command, sizeof(command));
-                    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
-                    glCopyNamedBufferSubData(
-                        main_count_buffer.id(),
-                        debug_aabb_indirect_buffer.id(),
-                        group_count_offset,
-                        sizeof(iris::uint32),
-                        sizeof(iris::uint32));
-                    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
-                    glBindVertexArray(aabb_vao);
-                    glMultiDrawArraysIndirect(GL_LINES, nullptr, 1, 0);
-                    group_offset += group.objects.size();
-                    group_count_offset += sizeof(iris::uint32);
+        frame_graph.execute(&gpu_profiler);
+
+        // a zone is missing until its pass first ran, or when the profiler ran out of queries
+        const auto* cluster_build_zone = gpu_profiler.zone("cluster_build");
+        const auto* lighting_zone = gpu_profiler.zone("lighting");
+        const auto cluster_build_time = cluster_build_zone ? cluster_build_zone->latest : 0.0f;
+        const auto lighting_time = lighting_zone ? lighting_zone->latest : 0.0f;
+        if (light_benchmark.is_running) {
+            // the warmup also covers the profiler latency
+            if (light_benchmark.step_frame >= light_benchmark_warmup) {
+                light_benchmark.build_accumulator += cluster_build_time;
+                light_benchmark.shading_accumulator += lighting_time;
+            }
+            light_benchmark.step_frame++;
+            if (light_benchmark.step_frame == light_benchmark_warmup + light_benchmark_frames) {
+                const auto count = light_benchmark_counts[light_benchmark.step];
+                const auto build = static_cast<iris::float32>(light_benchmark.build_accumulator / light_benchmark_frames);
+                const auto shading = static_cast<iris::float32>(light_benchmark.shading_accumulator / light_benchmark_frames);
+                iris::log("clustered lighting: lights = ", count, ", build = ", build, "ms, shading = ", shading, "ms");
+                light_benchmark.results.emplace_back(count, build, shading);
+                light_benchmark.step++;
+                light_benchmark.step_frame = 0;
+                light_benchmark.build_accumulator = 0.0;
+                light_benchmark.shading_accumulator = 0.0;
+                if (light_benchmark.step == light_benchmark_counts.size()) {
+                    light_benchmark.is_running = false;
+                    ui_state.point_light_count = light_benchmark.restore_light_count;
                 }
             }
-            glPopDebugGroup();
         }
 
-        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "draw_ui");
-        glDisable(GL_DEPTH_TEST);
-        glDisable(GL_CULL_FACE);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!benchmark_options.dump_directory.empty()) {
+            iris_cpu_zone("dump_frame");
+            frame_pixels.resize(static_cast<iris::uint64>(window.width) * window.height * 4);
+            glGetTextureImage(
+                frame_graph.attachment(color).id(),
+                0,
+                GL_RGBA,
+                GL_UNSIGNED_BYTE,
+                frame_pixels.size(),
+                frame_pixels.data());
+            auto name = std::array<char, 32>();
+            std::snprintf(name.data(), name.size(), "frame_%05llu.png", static_cast<unsigned long long>(gpu_profiler.frames()));
+            iris::save_frame_image(benchmark_options.dump_directory / name.data(), window.width, window.height, frame_pixels);
+        }
+
+        gpu_profiler.push("draw_ui");
+        iris::gl_state::disable(GL_DEPTH_TEST);
+        iris::gl_state::disable(GL_CULL_FACE);
+        iris::gl_state::bind_framebuffer(0);
 
+        iris_cpu_push("imgui");
         ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
+        if (is_headless) {
+            auto& io = ImGui::GetIO();
+            io.DisplaySize = ImVec2(window.width, window.height);
+            io.DeltaTime = glm::max(delta_time, 1.0f / 1000.0f);
+        } else {
+            ImGui_ImplGlfw_NewFrame();
+        }
         ImGui::NewFrame();
         //ImGui::ShowDemoWindow();
         const ImGuiViewport* viewport = ImGui::GetMainViewport();
@@ -1242,10 +1802,10 @@ int main() {
         ImGui::Begin("Viewport", nullptr, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
         ImGui::SetWindowSize(ImGui::GetContentRegionAvail(), ImGuiCond_Once);
         auto viewport_size = ImGui::GetContentRegionAvail();
-        ImGui::Image(reinterpret_cast<ImTextureID>(offscreen_attachment[0].id()), viewport_size, ImVec2(0, 1), ImVec2(1, 0));
+        ImGui::Image(reinterpret_cast<ImTextureID>(frame_graph.attachment(color).id()), viewport_size, ImVec2(0, 1), ImVec2(1, 0));
         if (ImGui::IsAnyMouseDown()) {
             viewport_size = ImGui::GetContentRegionAvail();
-        } else {
+        } else if (!is_headless && !is_replaying) {
             if (glm::any(glm::notEqual(
                     glm::uvec2(viewport_size.x, viewport_size.y),
                     glm::uvec2(window.width, window.height)))) {
@@ -1281,6 +1841,22 @@ int main() {
             ImGui::PushID("sun_heading");
             ImGui::SliderFloat("", &ui_state.sun_heading, 0.0f, glm::two_pi<iris::float32>());
             ImGui::PopID();
+
+            ImGui::Text("Render Path:");
+            ImGui::SameLine();
+            ImGui::PushID("render_path");
+            ImGui::BeginDisabled(!vertex_pulling_supported);
+            ImGui::Combo("", reinterpret_cast<int*>(&ui_state.render_path), "Forward\0Visibility Buffer\0");
+            ImGui::EndDisabled();
+            ImGui::PopID();
+
+            ImGui::Text("Vertex Pulling:");
+            ImGui::SameLine();
+            ImGui::PushID("vertex_pulling");
+            ImGui::BeginDisabled(!vertex_pulling_supported);
+            ImGui::Checkbox("", &ui_state.vertex_pulling);
+            ImGui::EndDisabled();
+            ImGui::PopID();
         }
 
 
@@ -1294,16 +1870,139 @@ int main() {
             ImGui::PushID("select_cascade");
             ImGui::SliderInt("", reinterpret_cast<int*>(&ui_state.cascade_index), 0, CASCADE_COUNT - 1);
             ImGui::PopID();
+
+            ImGui::Text("Shadow Filter: ");
+            ImGui::SameLine();
+            ImGui::PushID("shadow_filter_mode");
+            ImGui::Combo("", reinterpret_cast<int*>(&ui_state.shadow_filter_mode), "Fixed\0Adaptive\0");
+            ImGui::PopID();
+
+            ImGui::Text("Shadow Tap Budget: ");
+            ImGui::SameLine();
+            ImGui::PushID("shadow_max_taps");
+            ImGui::SliderInt("", reinterpret_cast<int*>(&ui_state.shadow_max_taps), 8, 128);
+            ImGui::PopID();
+        }
+        if (ImGui::CollapsingHeader("GPU Profiler", ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_FramePadding)) {
+            if (ImGui::BeginTable("gpu_zones", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+                ImGui::TableSetupColumn("Pass");
+                ImGui::TableSetupColumn("Time");
+                ImGui::TableSetupColumn("Average");
+                ImGui::TableSetupColumn("History", ImGuiTableColumnFlags_WidthStretch);
+                ImGui::TableHeadersRow();
+                for (const auto& zone : gpu_profiler.zones()) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%*s%s", static_cast<int>(zone.depth * 2), "", zone.name.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3fms", zone.latest);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3fms", zone.average);
+                    ImGui::TableNextColumn();
+                    ImGui::PushID(zone.name.c_str());
+                    ImGui::PlotLines(
+                        "",
+                        zone.history.data(),
+                        static_cast<int>(zone.history.size()),
+                        static_cast<int>(zone.history_offset),
+                        nullptr,
+                        0.0f,
+                        zone.max,
+                        ImVec2(-1.0f, 16.0f));
+                    ImGui::PopID();
+                }
+                ImGui::EndTable();
+            }
+            if (ImGui::Button("Export CSV")) {
+                if (gpu_profiler.export_csv("gpu_profile.csv")) {
+                    iris::log("gpu profile written to gpu_profile.csv");
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Export JSON")) {
+                if (gpu_profiler.export_json("gpu_profile.json")) {
+                    iris::log("gpu profile written to gpu_profile.json");
+                }
+            }
+
+            ImGui::Text("CPU Events: %llu", static_cast<unsigned long long>(iris::cpu_profiler::event_count()));
+            if (ImGui::Button("Export CPU Trace")) {
+                if (iris::cpu_profiler::export_chrome_trace("cpu_trace.json")) {
+                    iris::log("cpu trace written to cpu_trace.json");
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Clear CPU Trace")) {
+                iris::cpu_profiler::clear();
+            }
+
+            const auto gl_stats = iris::gl_state::frame_stats();
+            ImGui::Text("GL State Changes: %u issued, %u elided", gl_stats.issued, gl_stats.elided);
+            const auto graph_stats = frame_graph.stats();
+            ImGui::Text("Frame Graph: %u passes, %u barriers", graph_stats.passes, graph_stats.barriers);
+            ImGui::Text(
+                "Transients: %u in %u textures, %.2fMiB of %.2fMiB",
+                graph_stats.transients,
+                graph_stats.textures,
+                graph_stats.texture_bytes / (1024.0f * 1024.0f),
+                graph_stats.transient_bytes / (1024.0f * 1024.0f));
+        }
+        if (ImGui::CollapsingHeader("Texture Streaming", ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_FramePadding)) {
+            ImGui::Text("Budget (MiB): ");
+            ImGui::SameLine();
+            ImGui::PushID("texture_budget");
+            ImGui::SliderInt("", reinterpret_cast<int*>(&ui_state.texture_budget), 16, 2048);
+            ImGui::PopID();
+
+            const auto streaming_stats = texture_streamer.stats();
+            ImGui::Text(
+                "Resident: %.2fMiB of %.2fMiB in %u textures",
+                streaming_stats.resident_bytes / (1024.0f * 1024.0f),
+                streaming_stats.full_bytes / (1024.0f * 1024.0f),
+                streaming_stats.textures);
+            ImGui::Text(
+                "Streamed: %u uploads (%.2fMiB), %u evictions",
+                streaming_stats.uploads,
+                streaming_stats.uploaded_bytes / (1024.0f * 1024.0f),
+                streaming_stats.evictions);
+            const auto upload_stats = upload_queue.stats();
+            ImGui::Text(
+                "Upload Queue: %u pending (%.2fMiB), %.2fMiB this frame, %u stalls",
+                upload_stats.pending,
+                upload_stats.pending_bytes / (1024.0f * 1024.0f),
+                upload_stats.uploaded_bytes / (1024.0f * 1024.0f),
+                upload_stats.stalls);
+        }
+        if (ImGui::CollapsingHeader("Clustered Lighting", ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_FramePadding)) {
+            ImGui::Text("Point Lights: ");
+            ImGui::SameLine();
+            ImGui::PushID("point_light_count");
+            ImGui::SliderInt("", reinterpret_cast<int*>(&ui_state.point_light_count), 0, MAX_POINT_LIGHTS);
+            ImGui::PopID();
+
+            ImGui::Text("Cluster Build: %.3fms", cluster_build_time);
+            ImGui::Text("Shading: %.3fms", lighting_time);
+
+            if (ImGui::Button("Run Benchmark") && !light_benchmark.is_running) {
+                light_benchmark.is_running = true;
+                light_benchmark.step = 0;
+                light_benchmark.step_frame = 0;
+                light_benchmark.restore_light_count = ui_state.point_light_count;
+                light_benchmark.results.clear();
+            }
+            for (const auto& [count, build, shading] : light_benchmark.results) {
+                ImGui::Text("%5u lights: build %.3fms, shading %.3fms", count, build, shading);
+            }
         }
         if (ImGui::CollapsingHeader("Motion Vectors", ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_FramePadding)) {
-            ImGui::Image(reinterpret_cast<ImTextureID>(taa_pass.velocity.id()), ImVec2(512, 512), ImVec2(0, 1), ImVec2(1, 0));
+            ImGui::Image(reinterpret_cast<ImTextureID>(frame_graph.attachment(velocity).id()), ImVec2(512, 512), ImVec2(0, 1), ImVec2(1, 0));
         }
         ImGui::End();
 
         ImGui::End();
         ImGui::BeginMainMenuBar();
         if (ImGui::BeginMenu("File")) {
-            if (ImGui::MenuItem("Exit")) {
+            if (ImGui::MenuItem("Exit") && window.handle) {
                 glfwSetWindowShouldClose(window.handle, GLFW_TRUE);
             }
             ImGui::EndMenu();
@@ -1311,15 +2010,46 @@ int main() {
         ImGui::EndMainMenuBar();
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        glPopDebugGroup();
-
-        glfwSwapBuffers(window.handle);
-        window.update();
-        camera.update(delta_time);
+        // the backend restores what it touches, but through raw GL calls the cache can not see
+        iris::gl_state::invalidate();
+        iris_cpu_pop();
+        gpu_profiler.pop();
+
+        parameter_ring.end_frame();
+        gpu_profiler.end_frame();
+        iris::gl_state::end_frame();
+        if (is_headless) {
+            headless.swap_buffers();
+        } else {
+            glfwSwapBuffers(window.handle);
+            window.update();
+            if (!is_replaying) {
+                camera.update(delta_time);
+            }
+        }
         prev_camera_data = camera_data;
         prev_global_transforms = global_transforms;
         prev_local_transforms = local_transforms;
         taa_pass.frames++;
+        if (is_benchmarking) {
+            benchmark.end_frame();
+        }
+    }
+
+    if (is_capturing) {
+        if (!capture.save(benchmark_options.capture_path)) {
+            iris::log("capture: failed to write ", benchmark_options.capture_path.generic_string());
+            return -1;
+        }
+        iris::log("capture: ", capture.frame_count(), " frames written to ", benchmark_options.capture_path.generic_string());
+    }
+    if (is_benchmarking) {
+        gpu_profiler.flush();
+        if (!benchmark.export_csv(benchmark_options.output, gpu_profiler)) {
+            iris::log("benchmark: failed to write ", benchmark_options.output.generic_string());
+            return -1;
+        }
+        iris::log("benchmark: results written to ", benchmark_options.output.generic_string());
     }
     return 0;
 }
\ No newline at end of file
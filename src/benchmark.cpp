@@ -0,0 +1,205 @@
+#include <benchmark.hpp>
+#include <cpu_profiler.hpp>
+#include <gpu_profiler.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <string_view>
+#include <cstdlib>
+#include <sstream>
+
+namespace iris {
+    static auto percentile(std::vector<float32> values, float32 p) noexcept -> float32 {
+        if (values.empty()) {
+            return 0.0f;
+        }
+        std::ranges::sort(values);
+        return values[static_cast<uint64>(p * (values.size() - 1))];
+    }
+
+    static auto average(const std::vector<float32>& values) noexcept -> float32 {
+        auto sum = 0.0;
+        for (const auto value : values) {
+            sum += value;
+        }
+        return values.empty() ? 0.0f : static_cast<float32>(sum / values.size());
+    }
+
+    auto parse_benchmark_options(int32 argc, char** argv) noexcept -> benchmark_options_t {
+        auto options = benchmark_options_t();
+        for (auto i = 1_i32; i < argc; ++i) {
+            const auto argument = std::string_view(argv[i]);
+            const auto* value = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (argument == "--headless") {
+                options.is_headless = true;
+                continue;
+            }
+            if (!value) {
+                iris::log("benchmark: missing value for ", argument);
+                break;
+            }
+            if (argument == "--width") {
+                options.width = std::strtoul(value, nullptr, 10);
+            } else if (argument == "--height") {
+                options.height = std::strtoul(value, nullptr, 10);
+            } else if (argument == "--warmup") {
+                options.warmup_frames = std::strtoul(value, nullptr, 10);
+            } else if (argument == "--frames") {
+                options.measured_frames = std::strtoul(value, nullptr, 10);
+            } else if (argument == "--time-step") {
+                options.time_step = std::strtof(value, nullptr);
+            } else if (argument == "--camera-path") {
+                options.camera_path = value;
+            } else if (argument == "--output") {
+                options.output = value;
+            } else if (argument == "--capture") {
+                options.capture_path = value;
+            } else if (argument == "--replay") {
+                options.replay_path = value;
+            } else if (argument == "--dump-frames") {
+                options.dump_directory = value;
+            } else if (argument == "--seed") {
+                options.seed = std::strtoull(value, nullptr, 10);
+            } else {
+                iris::log("benchmark: unknown option ", argument);
+                continue;
+            }
+            ++i;
+        }
+        options.width = std::max(options.width, 1_u32);
+        options.height = std::max(options.height, 1_u32);
+        options.measured_frames = std::max(options.measured_frames, 1_u32);
+        return options;
+    }
+
+    auto camera_path_t::create(const fs::path& path) noexcept -> self {
+        auto camera_path = self();
+        auto file = std::ifstream(path);
+        if (!file) {
+            iris::log("benchmark: failed to open camera path ", path.generic_string());
+            return camera_path;
+        }
+        auto line = std::string();
+        while (std::getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            auto stream = std::istringstream(line);
+            auto keyframe = camera_keyframe_t();
+            if (stream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> keyframe.yaw >> keyframe.pitch) {
+                camera_path._keyframes.push_back(keyframe);
+            }
+        }
+        std::ranges::stable_sort(camera_path._keyframes, {}, &camera_keyframe_t::time);
+        return camera_path;
+    }
+
+    auto camera_path_t::is_empty() const noexcept -> bool {
+        return _keyframes.empty();
+    }
+
+    auto camera_path_t::duration() const noexcept -> float32 {
+        return _keyframes.empty() ? 0.0f : _keyframes.back().time;
+    }
+
+    auto camera_path_t::sample(float32 time) const noexcept -> camera_keyframe_t {
+        if (_keyframes.size() < 2 || duration() <= 0.0f) {
+            return _keyframes.empty() ? camera_keyframe_t() : _keyframes.front();
+        }
+        time = glm::mod(time, duration());
+        const auto next = std::ranges::upper_bound(_keyframes, time, {}, &camera_keyframe_t::time);
+        if (next == _keyframes.begin()) {
+            return _keyframes.front();
+        }
+        if (next == _keyframes.end()) {
+            return _keyframes.back();
+        }
+        const auto& a = *(next - 1);
+        const auto& b = *next;
+        const auto t = (time - a.time) / glm::max(b.time - a.time, 1e-6f);
+        return {
+            .time = time,
+            .position = glm::mix(a.position, b.position, t),
+            .yaw = glm::mix(a.yaw, b.yaw, t),
+            .pitch = glm::mix(a.pitch, b.pitch, t),
+        };
+    }
+
+    auto frame_benchmark_t::create(uint32 warmup_frames, uint32 measured_frames) noexcept -> self {
+        auto benchmark = self();
+        benchmark._warmup_frames = warmup_frames;
+        benchmark._measured_frames = measured_frames;
+        benchmark._frames.reserve(measured_frames);
+        return benchmark;
+    }
+
+    auto frame_benchmark_t::begin_frame(uint64 frame) noexcept -> void {
+        _frame = frame;
+        _begin = cpu_profiler::now();
+    }
+
+    auto frame_benchmark_t::end_frame() noexcept -> void {
+        if (!is_warmup() && !is_done()) {
+            _frames.push_back({
+                .frame = _frame,
+                .cpu_time = (cpu_profiler::now() - _begin) / 1'000'000.0f,
+            });
+        }
+        _frame_index++;
+    }
+
+    auto frame_benchmark_t::is_warmup() const noexcept -> bool {
+        return _frame_index < _warmup_frames;
+    }
+
+    auto frame_benchmark_t::is_done() const noexcept -> bool {
+        return _frame_index >= _warmup_frames + _measured_frames;
+    }
+
+    auto frame_benchmark_t::frame_index() const noexcept -> uint32 {
+        return _frame_index;
+    }
+
+    auto frame_benchmark_t::export_csv(const fs::path& path, const gpu_profiler_t& profiler) const noexcept -> bool {
+        auto file = std::ofstream(path);
+        if (!file) {
+            return false;
+        }
+        const auto zones = profiler.zones();
+        file << "frame,cpu_ms,gpu_ms";
+        for (const auto& zone : zones) {
+            file << ',' << zone.name;
+        }
+        file << '\n';
+
+        auto cpu_times = std::vector<float32>();
+        auto gpu_times = std::vector<float32>();
+        for (const auto& frame : _frames) {
+            file << frame.frame << ',' << frame.cpu_time;
+            cpu_times.push_back(frame.cpu_time);
+            const auto times = profiler.frame_times(frame.frame);
+            if (!times) {
+                // the profiler history was too short or the frame was dropped
+                file << ",\n";
+                continue;
+            }
+            auto gpu_time = 0.0f;
+            for (auto i = 0_u32; i < times->size(); ++i) {
+                if (zones[i].depth == 0) {
+                    gpu_time += (*times)[i];
+                }
+            }
+            gpu_times.push_back(gpu_time);
+            file << ',' << gpu_time;
+            for (const auto time : *times) {
+                file << ',' << time;
+            }
+            file << '\n';
+        }
+
+        iris::log(
+            "benchmark: ", _frames.size(), " frames, cpu avg ", average(cpu_times), "ms p50 ", percentile(cpu_times, 0.5f),
+            "ms p99 ", percentile(cpu_times, 0.99f), "ms, gpu avg ", average(gpu_times), "ms p50 ", percentile(gpu_times, 0.5f),
+            "ms p99 ", percentile(gpu_times, 0.99f), "ms");
+        return true;
+    }
+} // namespace iris
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <utilities.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <vector>
+
+namespace iris {
+    class gpu_profiler_t;
+
+    struct benchmark_options_t {
+        bool is_headless = false;
+        uint32 width = 1920;
+        uint32 height = 1080;
+        uint32 warmup_frames = 64;
+        uint32 measured_frames = 512;
+        // seconds of camera path advanced per frame, fixed so every run renders the same views
+        float32 time_step = 1.0f / 60.0f;
+        fs::path camera_path;
+        fs::path output = "benchmark.csv";
+        // record every frame's inputs, or drive every frame from a previous recording
+        fs::path capture_path;
+        fs::path replay_path;
+        // writes the final color of every frame as frame_NNNNN.png, stalls on the readback
+        fs::path dump_directory;
+        // seed of a capture, random when 0
+        uint64 seed = 0;
+    };
+
+    // --headless --width W --height H --warmup N --frames M --camera-path file --time-step s --output file.csv
+    // --capture file --replay file --dump-frames directory --seed S
+    auto parse_benchmark_options(int32 argc, char** argv) noexcept -> benchmark_options_t;
+
+    struct camera_keyframe_t {
+        float32 time = 0.0f;
+        glm::vec3 position = {};
+        float32 yaw = 0.0f;
+        float32 pitch = 0.0f;
+    };
+
+    // text file, one "time x y z yaw pitch" keyframe per line sorted by time, '#' starts a comment
+    class camera_path_t {
+    public:
+        using self = camera_path_t;
+
+        static auto create(const fs::path& path) noexcept -> self;
+
+        auto is_empty() const noexcept -> bool;
+        auto duration() const noexcept -> float32;
+        // linear between keyframes, wraps around past the last one
+        auto sample(float32 time) const noexcept -> camera_keyframe_t;
+
+    private:
+        std::vector<camera_keyframe_t> _keyframes;
+    };
+
+    struct benchmark_frame_t {
+        uint64 frame = 0;
+        float32 cpu_time = 0.0f;
+    };
+
+    // counts warmup and measured frames and keeps the CPU time of the measured ones,
+    // GPU times are taken from the profiler history when exporting
+    class frame_benchmark_t {
+    public:
+        using self = frame_benchmark_t;
+
+        static auto create(uint32 warmup_frames, uint32 measured_frames) noexcept -> self;
+
+        auto begin_frame(uint64 frame) noexcept -> void;
+        auto end_frame() noexcept -> void;
+
+        auto is_warmup() const noexcept -> bool;
+        auto is_done() const noexcept -> bool;
+        // elapsed frames since the run started, warmup included
+        auto frame_index() const noexcept -> uint32;
+
+        // frame, cpu_ms, gpu_ms (sum of top level zones) then one column per profiler zone
+        auto export_csv(const fs::path& path, const gpu_profiler_t& profiler) const noexcept -> bool;
+
+    private:
+        std::vector<benchmark_frame_t> _frames;
+        uint32 _warmup_frames = 0;
+        uint32 _measured_frames = 0;
+        uint32 _frame_index = 0;
+        uint64 _frame = 0;
+        uint64 _begin = 0;
+    };
+} // namespace iris
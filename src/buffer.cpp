@@ -1,4 +1,5 @@
 #include <buffer.hpp>
+#include <gl_state.hpp>
 
 #include <glad/gl.h>
 
@@ -12,6 +13,7 @@ namespace iris {
             glUnmapNamedBuffer(_id);
         }
         if (_id) {
+            gl_state::forget_buffer(_id);
             glDeleteBuffers(1, &_id);
         }
     }
@@ -31,7 +33,9 @@ namespace iris {
         glNamedBufferStorage(buffer._id, size, nullptr, storage);
 
         if (mapped) {
-            buffer._mapped = glMapNamedBuffer(buffer._id, GL_READ_WRITE);
+            // persistent storage can only be mapped through a range with the same flags
+            const auto access = storage & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+            buffer._mapped = glMapNamedBufferRange(buffer._id, 0, size, access);
         }
 
         buffer._type = type;
@@ -73,17 +77,17 @@ namespace iris {
     }
 
     auto buffer_t::bind(uint32 type) const noexcept -> void {
-        glBindBuffer(type, _id);
+        gl_state::bind_buffer(type, _id);
     }
 
     auto buffer_t::bind_base(uint32 type, uint32 index) const noexcept -> const self& {
-        glBindBufferBase(type, index, _id);
+        gl_state::bind_buffer_base(type, index, _id);
         return *this;
     }
 
     auto buffer_t::bind_range(uint32 type, uint32 index, uint64 offset, uint64 size) const noexcept -> const self& {
         if (size != 0) {
-            glBindBufferRange(type, index, _id, offset, size);
+            gl_state::bind_buffer_range(type, index, _id, offset, size);
         }
         return *this;
     }
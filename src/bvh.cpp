@@ -0,0 +1,165 @@
+#include <cpu_profiler.hpp>
+#include <bvh.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <array>
+
+namespace iris {
+    constexpr static auto bvh_bins = 16_u32;
+    // relative to testing a single primitive
+    constexpr static auto bvh_traversal_cost = 1.0f;
+
+    static auto grow(bvh_bounds_t& bounds, const glm::vec3& point) noexcept -> void {
+        bounds.min = glm::min(bounds.min, point);
+        bounds.max = glm::max(bounds.max, point);
+    }
+
+    static auto grow(bvh_bounds_t& bounds, const bvh_bounds_t& other) noexcept -> void {
+        bounds.min = glm::min(bounds.min, other.min);
+        bounds.max = glm::max(bounds.max, other.max);
+    }
+
+    static auto half_area(const bvh_bounds_t& bounds) noexcept -> float32 {
+        const auto extent = glm::max(bounds.max - bounds.min, glm::vec3(0.0f));
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    auto bvh_t::create(std::span<const bvh_bounds_t> primitives, uint32 max_leaf_size, uint32 max_depth) noexcept -> self {
+        iris_cpu_zone("bvh_t::create");
+        assert(max_leaf_size > 0 && "leaves need room for at least one primitive");
+        assert(max_depth > 0 && "a tree has at least its root");
+        auto bvh = self();
+        bvh._max_leaf_size = max_leaf_size;
+        bvh._max_depth = max_depth;
+        if (primitives.empty()) {
+            const auto empty = bvh_bounds_t();
+            bvh._nodes.push_back({ .min = empty.min, .max = empty.max });
+            bvh._depth = 1;
+            return bvh;
+        }
+
+        auto centroids = std::vector<glm::vec3>(primitives.size());
+        for (auto i = 0_u64; i < primitives.size(); ++i) {
+            centroids[i] = (primitives[i].min + primitives[i].max) * 0.5f;
+        }
+        bvh._indices.resize(primitives.size());
+        std::iota(bvh._indices.begin(), bvh._indices.end(), 0_u32);
+        bvh._nodes.reserve(2 * primitives.size());
+        bvh._build(primitives, centroids, 0, primitives.size(), 1);
+        return bvh;
+    }
+
+    auto bvh_t::nodes() const noexcept -> std::span<const bvh_node_t> {
+        return _nodes;
+    }
+
+    auto bvh_t::indices() const noexcept -> std::span<const uint32> {
+        return _indices;
+    }
+
+    auto bvh_t::bounds() const noexcept -> bvh_bounds_t {
+        return { _nodes[0].min, _nodes[0].max };
+    }
+
+    auto bvh_t::depth() const noexcept -> uint32 {
+        return _depth;
+    }
+
+    auto bvh_t::_build(
+        std::span<const bvh_bounds_t> primitives,
+        std::span<const glm::vec3> centroids,
+        uint32 begin,
+        uint32 end,
+        uint32 depth
+    ) noexcept -> uint32 {
+        _depth = std::max(_depth, depth);
+        auto bounds = bvh_bounds_t();
+        auto centroid_bounds = bvh_bounds_t();
+        for (auto i = begin; i < end; ++i) {
+            grow(bounds, primitives[_indices[i]]);
+            grow(centroid_bounds, centroids[_indices[i]]);
+        }
+        const auto node = static_cast<uint32>(_nodes.size());
+        _nodes.push_back({ .min = bounds.min, .offset = begin, .max = bounds.max, .count = end - begin });
+
+        const auto count = end - begin;
+        if (count == 1 || depth == _max_depth) {
+            return node;
+        }
+
+        // cheapest plane between bins over all three axes, swept once from each side
+        struct bin_t {
+            bvh_bounds_t bounds;
+            uint32 count = 0;
+        };
+        const auto centroid_extent = centroid_bounds.max - centroid_bounds.min;
+        auto best_cost = std::numeric_limits<float32>::max();
+        auto best_axis = -1_i32;
+        auto best_plane = 0_u32;
+        for (auto axis = 0_i32; axis < 3; ++axis) {
+            if (centroid_extent[axis] <= 0.0f) {
+                continue;
+            }
+            const auto scale = bvh_bins / centroid_extent[axis];
+            auto bins = std::array<bin_t, bvh_bins>();
+            for (auto i = begin; i < end; ++i) {
+                const auto offset = centroids[_indices[i]][axis] - centroid_bounds.min[axis];
+                auto& bin = bins[std::min(static_cast<uint32>(offset * scale), bvh_bins - 1)];
+                grow(bin.bounds, primitives[_indices[i]]);
+                bin.count++;
+            }
+
+            auto right_costs = std::array<float32, bvh_bins>();
+            auto right = bvh_bounds_t();
+            auto right_count = 0_u32;
+            for (auto plane = bvh_bins - 1; plane > 0; --plane) {
+                grow(right, bins[plane].bounds);
+                right_count += bins[plane].count;
+                right_costs[plane] = half_area(right) * right_count;
+            }
+            auto left = bvh_bounds_t();
+            auto left_count = 0_u32;
+            for (auto plane = 1_u32; plane < bvh_bins; ++plane) {
+                grow(left, bins[plane - 1].bounds);
+                left_count += bins[plane - 1].count;
+                if (left_count == 0 || left_count == count) {
+                    continue;
+                }
+                const auto cost = half_area(left) * left_count + right_costs[plane];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_plane = plane;
+                }
+            }
+        }
+
+        auto middle = begin + count / 2;
+        if (best_axis != -1) {
+            const auto split_cost = bvh_traversal_cost + best_cost / half_area(bounds);
+            if (count <= _max_leaf_size && static_cast<float32>(count) <= split_cost) {
+                return node;
+            }
+            const auto axis = best_axis;
+            const auto scale = bvh_bins / centroid_extent[axis];
+            const auto minimum = centroid_bounds.min[axis];
+            const auto* split = std::partition(_indices.data() + begin, _indices.data() + end, [&](uint32 index) {
+                const auto offset = centroids[index][axis] - minimum;
+                return std::min(static_cast<uint32>(offset * scale), bvh_bins - 1) < best_plane;
+            });
+            middle = static_cast<uint32>(split - _indices.data());
+        } else if (count <= _max_leaf_size) {
+            // every centroid is the same point, no plane separates them
+            return node;
+        }
+
+        _nodes[node].count = 0;
+        _build(primitives, centroids, begin, middle, depth + 1);
+        const auto second = _build(primitives, centroids, middle, end, depth + 1);
+        _nodes[node].offset = second;
+        return node;
+    }
+} // namespace iris
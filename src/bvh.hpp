@@ -0,0 +1,65 @@
+#pragma once
+
+#include <utilities.hpp>
+
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <limits>
+#include <span>
+
+namespace iris {
+    struct bvh_bounds_t {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float32>::max());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float32>::max());
+    };
+
+    // matches a std430 array of { vec3 min; uint offset; vec3 max; uint count; }. nodes are stored depth first,
+    // the first child of an inner node always follows it so only the second one needs an index
+    struct bvh_node_t {
+        glm::vec3 min = {};
+        // leaves: first entry in bvh_t::indices(), inner nodes: index of the second child
+        uint32 offset = 0;
+        glm::vec3 max = {};
+        // primitives of a leaf, 0 for inner nodes
+        uint32 count = 0;
+    };
+    static_assert(sizeof(bvh_node_t) == 32);
+
+    // no path from the root is longer than this, a deeper subtree ends in one larger leaf. keeps the fixed
+    // traversal stack of the 4.2 shaders (BVH_STACK_SIZE in include/scene.glsl) from overflowing
+    constexpr auto bvh_max_depth = 33_u32;
+
+    // binned SAH bounding volume hierarchy over arbitrary primitive bounds. the tree of no primitives is a single
+    // node with inverted bounds, a slab test does not reject those so traversals have to check for min > max first
+    class bvh_t {
+    public:
+        using self = bvh_t;
+
+        static auto create(
+            std::span<const bvh_bounds_t> primitives,
+            uint32 max_leaf_size = 4,
+            uint32 max_depth = bvh_max_depth) noexcept -> self;
+
+        auto nodes() const noexcept -> std::span<const bvh_node_t>;
+        // primitive indices in leaf order, a leaf covers indices()[offset, offset + count)
+        auto indices() const noexcept -> std::span<const uint32>;
+        auto bounds() const noexcept -> bvh_bounds_t;
+        // nodes on the longest path from the root, a traversal stack needs one less entry than that
+        auto depth() const noexcept -> uint32;
+
+    private:
+        auto _build(
+            std::span<const bvh_bounds_t> primitives,
+            std::span<const glm::vec3> centroids,
+            uint32 begin,
+            uint32 end,
+            uint32 depth) noexcept -> uint32;
+
+        std::vector<bvh_node_t> _nodes;
+        std::vector<uint32> _indices;
+        uint32 _max_leaf_size = 0;
+        uint32 _max_depth = 0;
+        uint32 _depth = 0;
+    };
+} // namespace iris
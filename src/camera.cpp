@@ -124,9 +124,12 @@ namespace iris {
             _pitch = -89.9f;
         }
         const auto r_yaw = glm::radians(_yaw);
-        const auto r_pitch = glm::radians(_pitch);
 
-        // keyboard handling
+        // keyboard handling, a headless window has no handle to poll
+        if (!window.handle) {
+            _update_vectors();
+            return;
+        }
         const auto p_y = _position.y;
         if (glfwGetKey(window.handle, GLFW_KEY_W) == GLFW_PRESS) {
             _position.x += glm::cos(r_yaw) * speed;
@@ -149,7 +152,19 @@ namespace iris {
         if (glfwGetKey(window.handle, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
             _position.y -= speed;
         }
+        _update_vectors();
+    }
 
+    auto camera_t::set_view(const glm::vec3& position, iris::float32 yaw, iris::float32 pitch) noexcept -> void {
+        _position = position;
+        _yaw = yaw;
+        _pitch = glm::clamp(pitch, -89.9f, 89.9f);
+        _update_vectors();
+    }
+
+    auto camera_t::_update_vectors() noexcept -> void {
+        const auto r_yaw = glm::radians(_yaw);
+        const auto r_pitch = glm::radians(_pitch);
         _front = glm::normalize(glm::vec3(
             // x-axis is dependent on: angle (cos(r_pitch)) of y-axis against xz plane and angle (r_yaw) of z-axis against x.
             glm::cos(r_yaw) * glm::cos(r_pitch),
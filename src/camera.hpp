@@ -73,8 +73,12 @@ namespace iris {
         auto projection(bool infinite = false, bool reverse_z = false) const noexcept -> glm::mat4;
 
         auto update(iris::float32 dt) noexcept -> void;
+        // places the camera directly, used by scripted camera paths instead of input
+        auto set_view(const glm::vec3& position, iris::float32 yaw, iris::float32 pitch) noexcept -> void;
 
     private:
+        auto _update_vectors() noexcept -> void;
+
         glm::vec3 _position = { -7.5f, 1.0f, 0.0f };
         glm::vec3 _front = { 0.0f, 0.0f, -1.0f };
         glm::vec3 _up = { 0.0f, 1.0f, 0.0f };
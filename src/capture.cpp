@@ -0,0 +1,78 @@
+#include <capture.hpp>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace iris {
+    static constexpr auto capture_magic = 0x43535249_u32; // "IRSC"
+    // bump whenever a sample changes the layout of its frame record
+    static constexpr auto capture_version = 2_u32;
+
+    auto capture_t::create(uint64 seed, uint32 frame_size) noexcept -> self {
+        auto capture = self();
+        capture._header = {
+            .magic = capture_magic,
+            .version = capture_version,
+            .frame_size = frame_size,
+            .frame_count = 0,
+            .seed = seed,
+        };
+        return capture;
+    }
+
+    auto capture_t::load(const fs::path& path, uint32 frame_size) noexcept -> self {
+        auto capture = self();
+        auto file = std::ifstream(path, std::ios::binary);
+        if (!file) {
+            iris::log("capture: failed to open ", path.generic_string());
+            return capture;
+        }
+        auto header = capture_header_t();
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != capture_magic || header.version != capture_version) {
+            iris::log("capture: ", path.generic_string(), " is not a version ", capture_version, " capture");
+            return capture;
+        }
+        if (header.frame_size != frame_size) {
+            iris::log("capture: ", path.generic_string(), " has ", header.frame_size, " byte frames, expected ", frame_size);
+            return capture;
+        }
+        capture._frames.resize(static_cast<uint64>(header.frame_size) * header.frame_count);
+        file.read(reinterpret_cast<char*>(capture._frames.data()), capture._frames.size());
+        if (!file) {
+            iris::log("capture: ", path.generic_string(), " is truncated");
+            capture._frames.clear();
+            return capture;
+        }
+        capture._header = header;
+        return capture;
+    }
+
+    auto capture_t::save(const fs::path& path) const noexcept -> bool {
+        auto file = std::ofstream(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+        file.write(reinterpret_cast<const char*>(_frames.data()), _frames.size());
+        return static_cast<bool>(file);
+    }
+
+    auto capture_t::is_empty() const noexcept -> bool {
+        return _header.frame_count == 0;
+    }
+
+    auto capture_t::seed() const noexcept -> uint64 {
+        return _header.seed;
+    }
+
+    auto capture_t::frame_count() const noexcept -> uint32 {
+        return _header.frame_count;
+    }
+
+    auto save_frame_image(const fs::path& path, uint32 width, uint32 height, std::span<const uint8> pixels) noexcept -> bool {
+        assert(pixels.size() >= static_cast<uint64>(width) * height * 4 && "frame image too small");
+        stbi_flip_vertically_on_write(1);
+        return stbi_write_png(path.generic_string().c_str(), width, height, 4, pixels.data(), width * 4) != 0;
+    }
+} // namespace iris
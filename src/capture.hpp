@@ -0,0 +1,62 @@
+#pragma once
+
+#include <utilities.hpp>
+
+#include <type_traits>
+#include <cstring>
+#include <vector>
+#include <span>
+
+namespace iris {
+    struct capture_header_t {
+        uint32 magic = 0;
+        uint32 version = 0;
+        // size of one frame record, a capture only replays with the record type it was written with
+        uint32 frame_size = 0;
+        uint32 frame_count = 0;
+        uint64 seed = 0;
+    };
+
+    // per frame records of everything that feeds a frame (input, ui, timing, rng seed), replayed in order.
+    // the record type is owned by the sample, it has to be trivially copyable
+    class capture_t {
+    public:
+        using self = capture_t;
+
+        static auto create(uint64 seed, uint32 frame_size) noexcept -> self;
+        // empty on failure, version mismatch or when the records were written with a different frame_size
+        static auto load(const fs::path& path, uint32 frame_size) noexcept -> self;
+
+        auto save(const fs::path& path) const noexcept -> bool;
+
+        auto is_empty() const noexcept -> bool;
+        auto seed() const noexcept -> uint64;
+        auto frame_count() const noexcept -> uint32;
+
+        template <typename T>
+        auto push_frame(const T& frame) noexcept -> void {
+            static_assert(std::is_trivially_copyable_v<T>);
+            assert(sizeof(T) == _header.frame_size && "capture record size mismatch");
+            const auto* bytes = reinterpret_cast<const uint8*>(&frame);
+            _frames.insert(_frames.end(), bytes, bytes + sizeof(T));
+            _header.frame_count++;
+        }
+
+        template <typename T>
+        auto frame(uint32 index) const noexcept -> T {
+            static_assert(std::is_trivially_copyable_v<T>);
+            assert(sizeof(T) == _header.frame_size && "capture record size mismatch");
+            assert(index < _header.frame_count && "capture frame out of range");
+            auto frame = T();
+            std::memcpy(&frame, _frames.data() + static_cast<uint64>(index) * sizeof(T), sizeof(T));
+            return frame;
+        }
+
+    private:
+        capture_header_t _header = {};
+        std::vector<uint8> _frames;
+    };
+
+    // rgba8 rows bottom to top as returned by glGetTextureImage, written top to bottom
+    auto save_frame_image(const fs::path& path, uint32 width, uint32 height, std::span<const uint8> pixels) noexcept -> bool;
+} // namespace iris
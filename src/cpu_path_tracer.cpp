@@ -0,0 +1,595 @@
+#include <cpu_profiler.hpp>
+#include <cpu_path_tracer.hpp>
+
+#include <glm/glm.hpp>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define IRIS_CPU_PATH_TRACER_AVX2
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <limits>
+#include <array>
+#include <bit>
+
+namespace iris {
+    constexpr static auto infinity = std::numeric_limits<float32>::infinity();
+    constexpr static auto pi = 3.14159265358979f;
+    // 8 wide nodes push at most 7 entries per level
+    constexpr static auto traversal_stack_size = 256_u32;
+
+    struct cpu_path_tracer_t::_ray_t {
+        glm::vec3 origin = {};
+        glm::vec3 direction = {};
+    };
+
+    struct cpu_path_tracer_t::_hit_t {
+        float32 t = 0.0f;
+        glm::vec3 point = {};
+        glm::vec3 normal = {};
+        bool front_face = false;
+        uint32 material = 0;
+        uint32 light = -1_u32;
+    };
+
+    // same generator as trace.frag
+    static auto pcg(uint32& state) noexcept -> uint32 {
+        state = state * 747796405u + 2891336453u;
+        const auto word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    static auto random(uint32& state) noexcept -> float32 {
+        state = pcg(state);
+        return static_cast<float32>(state) / static_cast<float32>(-1_u32);
+    }
+
+    static auto random(uint32& state, float32 min, float32 max) noexcept -> float32 {
+        return min + (max - min) * random(state);
+    }
+
+    static auto random_vec3(uint32& state, float32 min, float32 max) noexcept -> glm::vec3 {
+        const auto x = random(state, min, max);
+        const auto y = random(state, min, max);
+        const auto z = random(state, min, max);
+        return { x, y, z };
+    }
+
+    static auto random_in_unit_sphere(uint32& state) noexcept -> glm::vec3 {
+        for (auto i = 0_u32; i < 16; ++i) {
+            const auto p = random_vec3(state, -1.0f, 1.0f);
+            if (glm::dot(p, p) < 1.0f) {
+                return p;
+            }
+        }
+        return random_vec3(state, -1.0f, 1.0f) / 4.0f;
+    }
+
+    static auto near_zero(const glm::vec3& v) noexcept -> bool {
+        return std::abs(v.x) < 1e-8f && std::abs(v.y) < 1e-8f && std::abs(v.z) < 1e-8f;
+    }
+
+    static auto reflectance(float32 cosine, float32 refr_index) noexcept -> float32 {
+        const auto r0 = (1.0f - refr_index) / (1.0f + refr_index);
+        const auto r0_2 = r0 * r0;
+        return r0_2 + (1.0f - r0_2) * std::pow(1.0f - cosine, 5.0f);
+    }
+
+    static auto power_heuristic(float32 pdf, float32 other_pdf) noexcept -> float32 {
+        return pdf * pdf / (pdf * pdf + other_pdf * other_pdf);
+    }
+
+    static auto half_area(const bvh_node_t& node) noexcept -> float32 {
+        const auto extent = node.max - node.min;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    auto cpu_path_tracer_t::create(
+        std::vector<cpu_sphere_t> spheres,
+        std::vector<cpu_triangle_t> triangles,
+        std::vector<cpu_material_t> materials
+    ) noexcept -> self {
+        iris_cpu_zone("cpu_path_tracer_t::create");
+        auto tracer = self();
+        tracer._spheres = std::move(spheres);
+        tracer._triangles = std::move(triangles);
+        tracer._materials = std::move(materials);
+        tracer._sphere_lights.assign(tracer._spheres.size(), -1_u32);
+        for (auto i = 0_u64; i < tracer._spheres.size(); ++i) {
+            const auto& sphere = tracer._spheres[i];
+            const auto& material = tracer._materials[sphere.material];
+            const auto radiance = material.emissive * material.e_strength;
+            if (material.type != cpu_material_type_t::lambertian || !glm::any(glm::greaterThan(radiance, glm::vec3(0.0f)))) {
+                continue;
+            }
+            tracer._sphere_lights[i] = static_cast<uint32>(tracer._lights.size());
+            tracer._lights.push_back({ sphere.center, sphere.radius, radiance });
+        }
+
+        auto bounds = std::vector<bvh_bounds_t>();
+        bounds.reserve(tracer._spheres.size() + tracer._triangles.size());
+        for (const auto& sphere : tracer._spheres) {
+            bounds.push_back({ sphere.center - sphere.radius, sphere.center + sphere.radius });
+        }
+        for (const auto& triangle : tracer._triangles) {
+            bounds.push_back({
+                glm::min(glm::min(triangle.v0, triangle.v1), triangle.v2),
+                glm::max(glm::max(triangle.v0, triangle.v1), triangle.v2),
+            });
+        }
+        const auto bvh = bvh_t::create(bounds);
+        tracer._primitives.assign(bvh.indices().begin(), bvh.indices().end());
+
+        const auto& root = bvh.nodes()[0];
+        if (root.count == 0 && !bounds.empty()) {
+            tracer._collapse(bvh, 0);
+        } else {
+            // a single leaf or nothing at all, the root keeps the leaf in its first slot
+            auto& node = tracer._nodes.emplace_back();
+            std::ranges::fill(node.min_x, std::numeric_limits<float32>::max());
+            std::ranges::fill(node.min_y, std::numeric_limits<float32>::max());
+            std::ranges::fill(node.min_z, std::numeric_limits<float32>::max());
+            std::ranges::fill(node.max_x, -std::numeric_limits<float32>::max());
+            std::ranges::fill(node.max_y, -std::numeric_limits<float32>::max());
+            std::ranges::fill(node.max_z, -std::numeric_limits<float32>::max());
+            std::ranges::fill(node.child, 0_u32);
+            std::ranges::fill(node.count, 0_u32);
+            if (!bounds.empty()) {
+                node.min_x[0] = root.min.x;
+                node.min_y[0] = root.min.y;
+                node.min_z[0] = root.min.z;
+                node.max_x[0] = root.max.x;
+                node.max_y[0] = root.max.y;
+                node.max_z[0] = root.max.z;
+                node.child[0] = root.offset;
+                node.count[0] = root.count;
+            }
+        }
+        return tracer;
+    }
+
+    auto cpu_path_tracer_t::render(const cpu_render_options_t& options) noexcept -> std::vector<glm::vec4> {
+        iris_cpu_zone("cpu_path_tracer_t::render");
+        const auto start = std::chrono::steady_clock::now();
+        auto pixels = std::vector<glm::vec4>(static_cast<uint64>(options.width) * options.height);
+        const auto tiles_x = (options.width + options.tile_size - 1) / options.tile_size;
+        const auto tiles_y = (options.height + options.tile_size - 1) / options.tile_size;
+        const auto tile_count = tiles_x * tiles_y;
+        const auto resolution = glm::vec2(options.width, options.height);
+
+        auto next_tile = std::atomic<uint32>(0);
+        auto total_rays = std::atomic<uint64>(0);
+        const auto render_tiles = [&]() {
+            auto rays = 0_u64;
+            for (auto tile = next_tile++; tile < tile_count; tile = next_tile++) {
+                const auto x_begin = (tile % tiles_x) * options.tile_size;
+                const auto y_begin = (tile / tiles_x) * options.tile_size;
+                const auto x_end = std::min(x_begin + options.tile_size, options.width);
+                const auto y_end = std::min(y_begin + options.tile_size, options.height);
+                for (auto y = y_begin; y < y_end; ++y) {
+                    for (auto x = x_begin; x < x_end; ++x) {
+                        auto state = static_cast<uint32>(options.seed + 1) * 719393u + x + y * options.width;
+                        auto color = glm::vec3(0.0f);
+                        for (auto sample = 0_u32; sample < options.samples; ++sample) {
+                            // pixel centers and the jitter of trace.frag
+                            const auto jitter_x = random(state, -1.0f, 1.0f);
+                            const auto jitter_y = random(state, -1.0f, 1.0f);
+                            const auto uv = (glm::vec2(x + 0.5f + jitter_x, y + 0.5f + jitter_y)) / (resolution - 1.0f);
+                            const auto ndc_uv = 2.0f * uv - 1.0f;
+                            auto world_near = options.inv_pv * glm::vec4(ndc_uv.x, ndc_uv.y, -1.0f, 1.0f);
+                            auto world_far = options.inv_pv * glm::vec4(ndc_uv.x, ndc_uv.y, 1.0f, 1.0f);
+                            world_near /= world_near.w;
+                            world_far /= world_far.w;
+                            const auto ray = _ray_t {
+                                glm::vec3(world_near),
+                                glm::normalize(glm::vec3(world_far - world_near)),
+                            };
+                            color += _radiance(ray, state, rays, options);
+                        }
+                        pixels[y * options.width + x] = glm::vec4(color / static_cast<float32>(options.samples), 1.0f);
+                    }
+                }
+            }
+            total_rays += rays;
+        };
+
+        const auto threads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1_u32);
+        {
+            auto workers = std::vector<std::jthread>();
+            for (auto i = 1_u32; i < threads; ++i) {
+                workers.emplace_back(render_tiles);
+            }
+            render_tiles();
+        }
+
+        _stats.seconds = std::chrono::duration<float32>(std::chrono::steady_clock::now() - start).count();
+        _stats.rays = total_rays;
+        _stats.threads = threads;
+        return pixels;
+    }
+
+    auto cpu_path_tracer_t::stats() const noexcept -> cpu_render_stats_t {
+        return _stats;
+    }
+
+    auto cpu_path_tracer_t::_collapse(const bvh_t& bvh, uint32 node) noexcept -> uint32 {
+        const auto nodes = bvh.nodes();
+        // keep opening the largest inner child until all eight slots are used
+        auto children = std::array<uint32, 8>();
+        auto child_count = 2_u32;
+        children[0] = node + 1;
+        children[1] = nodes[node].offset;
+        while (child_count < 8) {
+            auto largest = -1_i32;
+            auto largest_area = -1.0f;
+            for (auto i = 0_u32; i < child_count; ++i) {
+                const auto& child = nodes[children[i]];
+                if (child.count == 0 && half_area(child) > largest_area) {
+                    largest = static_cast<int32>(i);
+                    largest_area = half_area(child);
+                }
+            }
+            if (largest == -1) {
+                break;
+            }
+            const auto opened = children[largest];
+            children[largest] = opened + 1;
+            children[child_count++] = nodes[opened].offset;
+        }
+
+        const auto index = static_cast<uint32>(_nodes.size());
+        {
+            auto& result = _nodes.emplace_back();
+            for (auto i = 0_u32; i < 8; ++i) {
+                const auto is_used = i < child_count;
+                const auto& child = nodes[children[std::min(i, child_count - 1)]];
+                result.min_x[i] = is_used ? child.min.x : std::numeric_limits<float32>::max();
+                result.min_y[i] = is_used ? child.min.y : std::numeric_limits<float32>::max();
+                result.min_z[i] = is_used ? child.min.z : std::numeric_limits<float32>::max();
+                result.max_x[i] = is_used ? child.max.x : -std::numeric_limits<float32>::max();
+                result.max_y[i] = is_used ? child.max.y : -std::numeric_limits<float32>::max();
+                result.max_z[i] = is_used ? child.max.z : -std::numeric_limits<float32>::max();
+                result.child[i] = is_used && child.count != 0 ? child.offset : 0;
+                result.count[i] = is_used ? child.count : 0;
+            }
+        }
+        for (auto i = 0_u32; i < child_count; ++i) {
+            if (nodes[children[i]].count == 0) {
+                // the vector may grow, only index into it after the recursion
+                const auto collapsed = _collapse(bvh, children[i]);
+                _nodes[index].child[i] = collapsed;
+            }
+        }
+        return index;
+    }
+
+    auto cpu_path_tracer_t::_trace(const _ray_t& ray, float32 t_min, float32 t_max, _hit_t& hit) const noexcept -> bool {
+        const auto inv_direction = 1.0f / ray.direction;
+        // the near plane of every slab is picked once per ray from the direction signs
+        const auto is_negative_x = inv_direction.x < 0.0f;
+        const auto is_negative_y = inv_direction.y < 0.0f;
+        const auto is_negative_z = inv_direction.z < 0.0f;
+
+        auto stack = std::array<uint32, traversal_stack_size>();
+        auto stack_t = std::array<float32, traversal_stack_size>();
+        auto top = 0_u32;
+        stack[top] = 0;
+        stack_t[top++] = t_min;
+
+        auto closest = t_max;
+        auto closest_primitive = -1_u32;
+        while (top != 0) {
+            --top;
+            if (stack_t[top] > closest) {
+                continue;
+            }
+            const auto& node = _nodes[stack[top]];
+            const auto* near_x = is_negative_x ? node.max_x : node.min_x;
+            const auto* near_y = is_negative_y ? node.max_y : node.min_y;
+            const auto* near_z = is_negative_z ? node.max_z : node.min_z;
+            const auto* far_x = is_negative_x ? node.min_x : node.max_x;
+            const auto* far_y = is_negative_y ? node.min_y : node.max_y;
+            const auto* far_z = is_negative_z ? node.min_z : node.max_z;
+
+            alignas(32) auto t_enter = std::array<float32, 8>();
+            auto mask = 0_u32;
+#if defined(IRIS_CPU_PATH_TRACER_AVX2)
+            {
+                const auto origin_x = _mm256_set1_ps(ray.origin.x);
+                const auto origin_y = _mm256_set1_ps(ray.origin.y);
+                const auto origin_z = _mm256_set1_ps(ray.origin.z);
+                const auto inv_x = _mm256_set1_ps(inv_direction.x);
+                const auto inv_y = _mm256_set1_ps(inv_direction.y);
+                const auto inv_z = _mm256_set1_ps(inv_direction.z);
+                const auto t_near_x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_x), origin_x), inv_x);
+                const auto t_near_y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_y), origin_y), inv_y);
+                const auto t_near_z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near_z), origin_z), inv_z);
+                const auto t_far_x = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_x), origin_x), inv_x);
+                const auto t_far_y = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_y), origin_y), inv_y);
+                const auto t_far_z = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far_z), origin_z), inv_z);
+                // NaNs from an origin on a slab plane lose against the second operand
+                const auto enter = _mm256_max_ps(t_near_x, _mm256_max_ps(t_near_y, _mm256_max_ps(t_near_z, _mm256_set1_ps(t_min))));
+                const auto exit = _mm256_min_ps(t_far_x, _mm256_min_ps(t_far_y, _mm256_min_ps(t_far_z, _mm256_set1_ps(closest))));
+                _mm256_store_ps(t_enter.data(), enter);
+                mask = static_cast<uint32>(_mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ)));
+            }
+#else
+            for (auto i = 0_u32; i < 8; ++i) {
+                const auto enter = std::max({
+                    (near_x[i] - ray.origin.x) * inv_direction.x,
+                    (near_y[i] - ray.origin.y) * inv_direction.y,
+                    (near_z[i] - ray.origin.z) * inv_direction.z,
+                    t_min,
+                });
+                const auto exit = std::min({
+                    (far_x[i] - ray.origin.x) * inv_direction.x,
+                    (far_y[i] - ray.origin.y) * inv_direction.y,
+                    (far_z[i] - ray.origin.z) * inv_direction.z,
+                    closest,
+                });
+                t_enter[i] = enter;
+                mask |= static_cast<uint32>(enter <= exit) << i;
+            }
+#endif
+            if (mask == 0) {
+                continue;
+            }
+
+            // nearest first: leaves are intersected right away, inner nodes go on the stack farthest first
+            auto order = std::array<uint32, 8>();
+            auto hits = 0_u32;
+            for (; mask != 0; mask &= mask - 1) {
+                const auto slot = static_cast<uint32>(std::countr_zero(mask));
+                auto i = hits++;
+                for (; i > 0 && t_enter[order[i - 1]] > t_enter[slot]; --i) {
+                    order[i] = order[i - 1];
+                }
+                order[i] = slot;
+            }
+            for (auto i = 0_u32; i < hits; ++i) {
+                const auto slot = order[i];
+                if (node.count[slot] == 0 || t_enter[slot] > closest) {
+                    continue;
+                }
+                for (auto j = node.child[slot]; j < node.child[slot] + node.count[slot]; ++j) {
+                    const auto primitive = _primitives[j];
+                    if (primitive < _spheres.size()) {
+                        const auto& sphere = _spheres[primitive];
+                        const auto oc = ray.origin - sphere.center;
+                        const auto a = glm::dot(ray.direction, ray.direction);
+                        const auto b = glm::dot(oc, ray.direction);
+                        const auto c = glm::dot(oc, oc) - sphere.radius * sphere.radius;
+                        const auto discriminant = b * b - a * c;
+                        if (discriminant < 0.0f) {
+                            continue;
+                        }
+                        const auto sq_d = std::sqrt(discriminant);
+                        auto root = (-b - sq_d) / a;
+                        if (root < t_min || closest < root) {
+                            root = (-b + sq_d) / a;
+                            if (root < t_min || closest < root) {
+                                continue;
+                            }
+                        }
+                        closest = root;
+                        closest_primitive = primitive;
+                    } else {
+                        const auto& triangle = _triangles[primitive - _spheres.size()];
+                        const auto e1 = triangle.v1 - triangle.v0;
+                        const auto e2 = triangle.v2 - triangle.v0;
+                        const auto p = glm::cross(ray.direction, e2);
+                        const auto determinant = glm::dot(e1, p);
+                        if (determinant == 0.0f) {
+                            continue;
+                        }
+                        const auto inv_determinant = 1.0f / determinant;
+                        const auto s = ray.origin - triangle.v0;
+                        const auto u = glm::dot(s, p) * inv_determinant;
+                        if (u < 0.0f || u > 1.0f) {
+                            continue;
+                        }
+                        const auto q = glm::cross(s, e1);
+                        const auto v = glm::dot(ray.direction, q) * inv_determinant;
+                        if (v < 0.0f || u + v > 1.0f) {
+                            continue;
+                        }
+                        const auto t = glm::dot(e2, q) * inv_determinant;
+                        if (t < t_min || t > closest) {
+                            continue;
+                        }
+                        closest = t;
+                        closest_primitive = primitive;
+                    }
+                }
+            }
+            for (auto i = hits; i > 0; --i) {
+                const auto slot = order[i - 1];
+                if (node.count[slot] != 0) {
+                    continue;
+                }
+                assert(top < traversal_stack_size && "traversal stack overflow");
+                stack[top] = node.child[slot];
+                stack_t[top++] = t_enter[slot];
+            }
+        }
+        if (closest_primitive == -1_u32) {
+            return false;
+        }
+
+        hit.t = closest;
+        hit.point = ray.origin + closest * ray.direction;
+        auto normal = glm::vec3();
+        if (closest_primitive < _spheres.size()) {
+            const auto& sphere = _spheres[closest_primitive];
+            normal = (hit.point - sphere.center) / sphere.radius;
+            hit.material = sphere.material;
+            hit.light = _sphere_lights[closest_primitive];
+        } else {
+            const auto& triangle = _triangles[closest_primitive - _spheres.size()];
+            normal = glm::normalize(glm::cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0));
+            hit.material = triangle.material;
+            hit.light = -1_u32;
+        }
+        hit.front_face = glm::dot(ray.direction, normal) < 0.0f;
+        hit.normal = hit.front_face ? normal : -normal;
+        return true;
+    }
+
+    auto cpu_path_tracer_t::_light_cone(const glm::vec3& origin, uint32 light) const noexcept -> float32 {
+        const auto to_center = _lights[light].center - origin;
+        const auto distance2 = glm::dot(to_center, to_center);
+        const auto radius2 = _lights[light].radius * _lights[light].radius;
+        if (distance2 <= radius2 * 1.001f) {
+            return 0.0f;
+        }
+        const auto sin2_max = radius2 / distance2;
+        return sin2_max / (1.0f + std::sqrt(1.0f - sin2_max));
+    }
+
+    auto cpu_path_tracer_t::_light_pdf(float32 cone) const noexcept -> float32 {
+        return 1.0f / (static_cast<float32>(_lights.size()) * 2.0f * pi * cone);
+    }
+
+    auto cpu_path_tracer_t::_sample_light(
+        const _hit_t& hit,
+        uint32& state,
+        _ray_t& shadow,
+        float32& t_max,
+        glm::vec3& light
+    ) const noexcept -> bool {
+        const auto light_count = static_cast<uint32>(_lights.size());
+        if (light_count == 0) {
+            return false;
+        }
+        const auto index = std::min(static_cast<uint32>(random(state) * static_cast<float32>(light_count)), light_count - 1);
+        const auto cone = _light_cone(hit.point, index);
+        if (cone == 0.0f) {
+            return false;
+        }
+        const auto u_x = random(state);
+        const auto u_y = random(state);
+        const auto cos_t = 1.0f - u_x * cone;
+        const auto sin_t = std::sqrt(std::max(1.0f - cos_t * cos_t, 0.0f));
+        const auto phi = 2.0f * pi * u_y;
+
+        const auto to_center = _lights[index].center - hit.point;
+        const auto distance = glm::length(to_center);
+        const auto axis = to_center / distance;
+        const auto sign_z = axis.z >= 0.0f ? 1.0f : -1.0f;
+        const auto a = -1.0f / (sign_z + axis.z);
+        const auto b = axis.x * axis.y * a;
+        const auto tangent = glm::vec3(1.0f + sign_z * axis.x * axis.x * a, sign_z * b, -sign_z * axis.x);
+        const auto bitangent = glm::vec3(b, sign_z + axis.y * axis.y * a, -axis.y);
+        const auto direction = glm::normalize((tangent * std::cos(phi) + bitangent * std::sin(phi)) * sin_t + axis * cos_t);
+        const auto cosine = glm::dot(hit.normal, direction);
+        if (cosine <= 0.0f) {
+            return false;
+        }
+
+        const auto radius = _lights[index].radius;
+        const auto half_chord = std::sqrt(std::max(radius * radius - distance * distance * sin_t * sin_t, 0.0f));
+        t_max = (distance * cos_t - half_chord) * 0.999f;
+        shadow = { hit.point, direction };
+        const auto pdf = _light_pdf(cone);
+        light = _lights[index].radiance * (cosine / pi) * power_heuristic(pdf, cosine / pi) / pdf;
+        return true;
+    }
+
+    auto cpu_path_tracer_t::_radiance(
+        _ray_t ray,
+        uint32& state,
+        uint64& rays,
+        const cpu_render_options_t& options
+    ) const noexcept -> glm::vec3 {
+        auto hit = _hit_t();
+        auto incoming_light = glm::vec3(0.0f);
+        auto color = glm::vec3(1.0f);
+        auto hits = 0_u32;
+        // of the last lambertian bounce, 0 for the camera ray and after specular bounces
+        auto bsdf_pdf = 0.0f;
+        while (true) {
+            ++rays;
+            if (!_trace(ray, 0.01f, 100000.0f, hit)) {
+                break;
+            }
+            // a path that ends early keeps the light it gathered so far
+            if (hits++ == options.max_bounces) {
+                return incoming_light;
+            }
+            const auto& material = _materials[hit.material];
+            auto attenuation = glm::vec3(1.0f);
+            auto direction = glm::vec3();
+            switch (material.type) {
+                case cpu_material_type_t::lambertian: {
+                    direction = hit.normal + glm::normalize(random_in_unit_sphere(state));
+                    if (near_zero(direction)) {
+                        direction = hit.normal;
+                    }
+                    attenuation = material.albedo;
+                    auto weight = 1.0f;
+                    if (options.is_light_sampling && bsdf_pdf != 0.0f && hit.light != -1_u32) {
+                        const auto cone = _light_cone(ray.origin, hit.light);
+                        if (cone != 0.0f) {
+                            weight = power_heuristic(bsdf_pdf, _light_pdf(cone));
+                        }
+                    }
+                    incoming_light += material.emissive * material.e_strength * color * weight;
+
+                    auto shadow = _ray_t();
+                    auto t_max = 0.0f;
+                    auto light = glm::vec3();
+                    auto shadow_hit = _hit_t();
+                    if (options.is_light_sampling && _sample_light(hit, state, shadow, t_max, light)) {
+                        ++rays;
+                        if (!_trace(shadow, 0.01f, t_max, shadow_hit)) {
+                            incoming_light += light * attenuation * color;
+                        }
+                    }
+                    bsdf_pdf = std::max(glm::dot(hit.normal, glm::normalize(direction)), 0.0f) / pi;
+                } break;
+
+                case cpu_material_type_t::metal: {
+                    direction = glm::reflect(glm::normalize(ray.direction), hit.normal);
+                    attenuation = material.albedo;
+                    if (glm::dot(direction, hit.normal) <= 0.0f) {
+                        return incoming_light;
+                    }
+                    bsdf_pdf = 0.0f;
+                } break;
+
+                case cpu_material_type_t::dielectric: {
+                    const auto refr_ratio = hit.front_face ? (1.0f / material.refr_index) : material.refr_index;
+                    const auto r_dir = glm::normalize(ray.direction);
+                    const auto cos_t = std::min(glm::dot(-r_dir, hit.normal), 1.0f);
+                    const auto sin_t = std::sqrt(1.0f - cos_t * cos_t);
+                    const auto cannot_refract = refr_ratio * sin_t > 1.0f;
+                    if (cannot_refract || reflectance(cos_t, refr_ratio) > random(state)) {
+                        direction = glm::reflect(r_dir, hit.normal);
+                    } else {
+                        direction = glm::refract(r_dir, hit.normal, refr_ratio);
+                    }
+                    bsdf_pdf = 0.0f;
+                } break;
+            }
+            color *= attenuation;
+            // from the fourth bounce on a path survives with the probability of its throughput
+            if (options.is_russian_roulette && hits > 3) {
+                const auto survival = std::min(std::max({ color.x, color.y, color.z }), 0.95f);
+                if (random(state) >= survival) {
+                    return incoming_light;
+                }
+                color /= survival;
+            }
+            ray = { hit.point, direction };
+        }
+        constexpr auto intensity = 0.9325f;
+        const auto n_dir = glm::normalize(ray.direction);
+        const auto t = 0.5f * (n_dir.y + 1.0f);
+        const auto sky_gradient = glm::vec3(0.4f, 0.4f, 1.0f);
+        return glm::mix(glm::vec3(1.0f), sky_gradient, t) * color * intensity + incoming_light;
+    }
+} // namespace iris
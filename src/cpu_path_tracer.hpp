@@ -0,0 +1,132 @@
+#pragma once
+
+#include <utilities.hpp>
+#include <bvh.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <glm/vec3.hpp>
+
+#include <vector>
+#include <span>
+
+namespace iris {
+    // the material model of trace.frag, fields a type does not use are ignored. like there metals are perfect mirrors
+    enum class cpu_material_type_t : uint32 {
+        lambertian,
+        metal,
+        dielectric,
+    };
+
+    struct cpu_material_t {
+        cpu_material_type_t type = cpu_material_type_t::lambertian;
+        glm::vec3 albedo = glm::vec3(1.0f);
+        glm::vec3 emissive = {};
+        float32 e_strength = 0.0f;
+        float32 refr_index = 1.0f;
+    };
+
+    struct cpu_sphere_t {
+        glm::vec3 center = {};
+        float32 radius = 0.0f;
+        uint32 material = 0;
+    };
+
+    // world space
+    struct cpu_triangle_t {
+        glm::vec3 v0 = {};
+        glm::vec3 v1 = {};
+        glm::vec3 v2 = {};
+        uint32 material = 0;
+    };
+
+    struct cpu_render_options_t {
+        uint32 width = 1280;
+        uint32 height = 720;
+        uint32 samples = 64;
+        // a path that bounces more often than this ends, like in trace.frag
+        uint32 max_bounces = 32;
+        // next event estimation towards emissive spheres, weighted against the bounces with MIS
+        bool is_light_sampling = true;
+        bool is_russian_roulette = true;
+        glm::mat4 inv_pv = glm::mat4(1.0f);
+        uint64 seed = 0;
+        // 0 uses every core
+        uint32 threads = 0;
+        uint32 tile_size = 16;
+    };
+
+    struct cpu_render_stats_t {
+        float32 seconds = 0.0f;
+        uint64 rays = 0;
+        uint32 threads = 0;
+    };
+
+    // offline reference for trace.frag: the same hit, scatter and light sampling code on the CPU, tiles are rendered
+    // by all cores and every ray walks an 8 wide BVH collapsed from bvh_t, testing all children of a node at once.
+    // spheres of emissive lambertians are the lights
+    class cpu_path_tracer_t {
+    public:
+        using self = cpu_path_tracer_t;
+
+        static auto create(
+            std::vector<cpu_sphere_t> spheres,
+            std::vector<cpu_triangle_t> triangles,
+            std::vector<cpu_material_t> materials) noexcept -> self;
+
+        // linear radiance, rows bottom to top like a GL framebuffer
+        auto render(const cpu_render_options_t& options) noexcept -> std::vector<glm::vec4>;
+
+        auto stats() const noexcept -> cpu_render_stats_t;
+
+    private:
+        struct alignas(32) _node_t {
+            float32 min_x[8];
+            float32 min_y[8];
+            float32 min_z[8];
+            float32 max_x[8];
+            float32 max_y[8];
+            float32 max_z[8];
+            // inner children: node index, leaves: first entry of _primitives
+            uint32 child[8];
+            // primitives of a leaf child, 0 for inner children. unused slots have inverted bounds
+            uint32 count[8];
+        };
+
+        struct _light_t {
+            glm::vec3 center = {};
+            float32 radius = 0.0f;
+            glm::vec3 radiance = {};
+        };
+
+        struct _hit_t;
+        struct _ray_t;
+
+        auto _collapse(const bvh_t& bvh, uint32 node) noexcept -> uint32;
+        auto _trace(const _ray_t& ray, float32 t_min, float32 t_max, _hit_t& hit) const noexcept -> bool;
+        auto _light_cone(const glm::vec3& origin, uint32 light) const noexcept -> float32;
+        auto _light_pdf(float32 cone) const noexcept -> float32;
+        auto _sample_light(
+            const _hit_t& hit,
+            uint32& state,
+            _ray_t& shadow,
+            float32& t_max,
+            glm::vec3& light) const noexcept -> bool;
+        auto _radiance(
+            _ray_t ray,
+            uint32& state,
+            uint64& rays,
+            const cpu_render_options_t& options) const noexcept -> glm::vec3;
+
+        std::vector<_node_t> _nodes;
+        // sphere index below the sphere count, triangle index plus the sphere count above
+        std::vector<uint32> _primitives;
+        std::vector<cpu_sphere_t> _spheres;
+        std::vector<cpu_triangle_t> _triangles;
+        std::vector<cpu_material_t> _materials;
+        std::vector<_light_t> _lights;
+        // index into _lights per sphere, -1 for spheres that do not emit
+        std::vector<uint32> _sphere_lights;
+        cpu_render_stats_t _stats = {};
+    };
+} // namespace iris
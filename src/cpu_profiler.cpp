@@ -0,0 +1,143 @@
+#include <cpu_profiler.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <mutex>
+
+namespace iris::cpu_profiler {
+    // caps memory when zones are left running for a long session, later events are dropped
+    static constexpr auto max_events_per_thread = 1_u64 << 20;
+
+    struct _thread_buffer_t {
+        // only contended while exporting, the owning thread is the sole writer otherwise
+        std::mutex lock;
+        std::vector<cpu_event_t> events;
+        // open push/pop zones, never read by other threads
+        std::vector<cpu_event_t> stack;
+        std::string name;
+        uint32 id = 0;
+    };
+
+    struct _registry_t {
+        std::mutex lock;
+        // buffers are shared so that events of threads which already exited can still be exported
+        std::vector<std::shared_ptr<_thread_buffer_t>> buffers;
+    };
+
+    static auto registry() noexcept -> _registry_t& {
+        static auto instance = _registry_t();
+        return instance;
+    }
+
+    static auto thread_buffer() noexcept -> _thread_buffer_t& {
+        thread_local auto buffer = [] {
+            auto buffer = std::make_shared<_thread_buffer_t>();
+            buffer->events.reserve(4096);
+            auto& registry = cpu_profiler::registry();
+            auto guard = std::lock_guard(registry.lock);
+            buffer->id = registry.buffers.size();
+            buffer->name = "thread " + std::to_string(buffer->id);
+            registry.buffers.push_back(buffer);
+            return buffer;
+        }();
+        return *buffer;
+    }
+
+    static auto write_escaped(std::ofstream& file, std::string_view string) noexcept -> void {
+        for (const auto c : string) {
+            if (c == '"' || c == '\\') {
+                file << '\\';
+            }
+            file << c;
+        }
+    }
+
+    auto now() noexcept -> uint64 {
+        static const auto epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    auto set_thread_name(std::string_view name) noexcept -> void {
+        auto& buffer = thread_buffer();
+        auto guard = std::lock_guard(buffer.lock);
+        buffer.name = name;
+    }
+
+    auto record(const char* name, uint64 begin, uint64 end) noexcept -> void {
+        auto& buffer = thread_buffer();
+        auto guard = std::lock_guard(buffer.lock);
+        if (buffer.events.size() < max_events_per_thread) {
+            buffer.events.push_back({ name, begin, end });
+        }
+    }
+
+    auto push(const char* name) noexcept -> void {
+        thread_buffer().stack.push_back({ name, now(), 0 });
+    }
+
+    auto pop() noexcept -> void {
+        auto& buffer = thread_buffer();
+        assert(!buffer.stack.empty() && "unbalanced cpu zones");
+        const auto event = buffer.stack.back();
+        buffer.stack.pop_back();
+        record(event.name, event.begin, now());
+    }
+
+    auto clear() noexcept -> void {
+        auto& registry = cpu_profiler::registry();
+        auto guard = std::lock_guard(registry.lock);
+        for (auto& buffer : registry.buffers) {
+            auto buffer_guard = std::lock_guard(buffer->lock);
+            buffer->events.clear();
+        }
+    }
+
+    auto event_count() noexcept -> uint64 {
+        auto& registry = cpu_profiler::registry();
+        auto guard = std::lock_guard(registry.lock);
+        auto count = 0_u64;
+        for (auto& buffer : registry.buffers) {
+            auto buffer_guard = std::lock_guard(buffer->lock);
+            count += buffer->events.size();
+        }
+        return count;
+    }
+
+    auto export_chrome_trace(const fs::path& path) noexcept -> bool {
+        auto file = std::ofstream(path);
+        if (!file) {
+            return false;
+        }
+        auto& registry = cpu_profiler::registry();
+        auto guard = std::lock_guard(registry.lock);
+
+        // timestamps are in microseconds, fractional parts keep the nanosecond resolution
+        file << std::fixed;
+        file.precision(3);
+        file << "{\n  \"displayTimeUnit\": \"ns\",\n  \"traceEvents\": [";
+        auto is_first = true;
+        for (auto& buffer : registry.buffers) {
+            auto buffer_guard = std::lock_guard(buffer->lock);
+            file << (is_first ? "" : ",") << "\n    { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->id;
+            file << ", \"args\": { \"name\": \"";
+            write_escaped(file, buffer->name);
+            file << "\" } }";
+            file << ",\n    { \"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->id;
+            file << ", \"args\": { \"sort_index\": " << buffer->id << " } }";
+            is_first = false;
+
+            // complete events, the viewer nests them by time range per thread
+            for (const auto& event : buffer->events) {
+                file << ",\n    { \"name\": \"";
+                write_escaped(file, event.name);
+                file << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << buffer->id;
+                file << ", \"ts\": " << event.begin / 1000.0;
+                file << ", \"dur\": " << (event.end - event.begin) / 1000.0 << " }";
+            }
+        }
+        file << "\n  ]\n}\n";
+        return true;
+    }
+} // namespace iris::cpu_profiler
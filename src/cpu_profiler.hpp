@@ -0,0 +1,64 @@
+#pragma once
+
+#include <utilities.hpp>
+
+#include <string_view>
+#include <string>
+
+namespace iris {
+    struct cpu_event_t {
+        // must outlive the profiler, zones only ever pass string literals
+        const char* name = nullptr;
+        uint64 begin = 0;
+        uint64 end = 0;
+    };
+
+    // scoped CPU zones recorded into thread local buffers, every thread that records a zone
+    // shows up as its own track in the exported chrome trace (chrome://tracing, ui.perfetto.dev)
+    namespace cpu_profiler {
+        // nanoseconds since the first call in the process
+        auto now() noexcept -> uint64;
+
+        auto set_thread_name(std::string_view name) noexcept -> void;
+        auto record(const char* name, uint64 begin, uint64 end) noexcept -> void;
+
+        // for zones that do not map to a C++ scope, must be balanced on the same thread
+        auto push(const char* name) noexcept -> void;
+        auto pop() noexcept -> void;
+
+        // drops all recorded events, thread names are kept
+        auto clear() noexcept -> void;
+        auto event_count() noexcept -> uint64;
+        auto export_chrome_trace(const fs::path& path) noexcept -> bool;
+    } // namespace cpu_profiler
+
+    class cpu_zone_t {
+    public:
+        cpu_zone_t(const char* name) noexcept
+            : _name(name),
+              _begin(cpu_profiler::now()) {}
+
+        ~cpu_zone_t() noexcept {
+            cpu_profiler::record(_name, _begin, cpu_profiler::now());
+        }
+
+        cpu_zone_t(const cpu_zone_t&) noexcept = delete;
+        auto operator =(const cpu_zone_t&) noexcept -> cpu_zone_t& = delete;
+
+    private:
+        const char* _name = nullptr;
+        uint64 _begin = 0;
+    };
+
+#if defined(IRIS_DISABLE_CPU_PROFILER)
+    #define iris_cpu_zone(name) ((void)0)
+    #define iris_cpu_thread_name(name) ((void)0)
+    #define iris_cpu_push(name) ((void)0)
+    #define iris_cpu_pop() ((void)0)
+#else
+    #define iris_cpu_zone(name) auto iris_concat(__cpu_zone_, __LINE__) = iris::cpu_zone_t(name)
+    #define iris_cpu_thread_name(name) iris::cpu_profiler::set_thread_name(name)
+    #define iris_cpu_push(name) iris::cpu_profiler::push(name)
+    #define iris_cpu_pop() iris::cpu_profiler::pop()
+#endif
+} // namespace iris
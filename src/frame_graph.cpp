@@ -0,0 +1,371 @@
+#include <frame_graph.hpp>
+#include <gpu_profiler.hpp>
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace iris {
+    static auto is_incoherent(frame_graph_access_t access) noexcept -> bool {
+        return access == frame_graph_access_t::storage || access == frame_graph_access_t::image;
+    }
+
+    // the glMemoryBarrier bit that makes incoherent writes visible to this access
+    static auto barrier_bit(frame_graph_access_t access, bool is_texture) noexcept -> uint32 {
+        switch (access) {
+            case frame_graph_access_t::indirect: return GL_COMMAND_BARRIER_BIT;
+            case frame_graph_access_t::uniform: return GL_UNIFORM_BARRIER_BIT;
+            case frame_graph_access_t::storage: return GL_SHADER_STORAGE_BARRIER_BIT;
+            case frame_graph_access_t::texture: return GL_TEXTURE_FETCH_BARRIER_BIT;
+            case frame_graph_access_t::image: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+            case frame_graph_access_t::attachment: return GL_FRAMEBUFFER_BARRIER_BIT;
+            case frame_graph_access_t::transfer:
+                // glReadPixels goes through the framebuffer
+                return is_texture ? GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT : GL_BUFFER_UPDATE_BARRIER_BIT;
+        }
+        return GL_ALL_BARRIER_BITS;
+    }
+
+    static auto texel_size(int32 format) noexcept -> uint64 {
+        switch (format) {
+            case GL_R8: return 1;
+            case GL_R16F:
+            case GL_RG8:
+            case GL_DEPTH_COMPONENT16: return 2;
+            case GL_RGBA16F:
+            case GL_RG32F:
+            case GL_RG32UI:
+            case GL_DEPTH32F_STENCIL8: return 8;
+            case GL_RGBA32F:
+            case GL_RGBA32UI: return 16;
+            default: return 4;
+        }
+    }
+
+    static auto texture_size(const frame_graph_attachment_info_t& info) noexcept -> uint64 {
+        auto size = 0_u64;
+        for (auto level = 0_u32; level < info.levels; ++level) {
+            size += static_cast<uint64>(std::max(info.width >> level, 1_u32)) * std::max(info.height >> level, 1_u32);
+        }
+        return size * info.layers * texel_size(info.format);
+    }
+
+    static auto is_color(uint32 base_format) noexcept -> bool {
+        return
+            base_format != GL_DEPTH_COMPONENT &&
+            base_format != GL_STENCIL_INDEX &&
+            base_format != GL_DEPTH_STENCIL;
+    }
+
+    frame_graph_pass_builder_t::frame_graph_pass_builder_t(frame_graph_t& graph, uint32 pass) noexcept
+        : _graph(&graph),
+          _pass(pass) {}
+
+    auto frame_graph_pass_builder_t::read(frame_graph_resource_t resource, frame_graph_access_t access) noexcept -> self& {
+        assert(resource.index < _graph->_resources.size() && "invalid frame graph resource");
+        _graph->_passes[_pass].accesses.push_back({ resource.index, access, false });
+        return *this;
+    }
+
+    auto frame_graph_pass_builder_t::write(frame_graph_resource_t resource, frame_graph_access_t access) noexcept -> self& {
+        assert(resource.index < _graph->_resources.size() && "invalid frame graph resource");
+        _graph->_passes[_pass].accesses.push_back({ resource.index, access, true });
+        return *this;
+    }
+
+    auto frame_graph_pass_builder_t::execute(std::function<void()> callback) noexcept -> void {
+        _graph->_passes[_pass].callback = std::move(callback);
+    }
+
+    frame_graph_t::frame_graph_t() noexcept = default;
+
+    frame_graph_t::~frame_graph_t() noexcept = default;
+
+    frame_graph_t::frame_graph_t(self&& other) noexcept {
+        swap(other);
+    }
+
+    auto frame_graph_t::operator =(self&& other) noexcept -> self& {
+        self(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    auto frame_graph_t::create() noexcept -> self {
+        return self();
+    }
+
+    auto frame_graph_t::reset() noexcept -> void {
+        _resources.clear();
+        _passes.clear();
+        _pending_groups.clear();
+        std::erase_if(_framebuffers, [](const auto& framebuffer) {
+            return !framebuffer.is_used;
+        });
+        for (auto& framebuffer : _framebuffers) {
+            framebuffer.is_used = false;
+        }
+    }
+
+    auto frame_graph_t::import_buffer(const char* name, const buffer_t& buffer) noexcept -> frame_graph_resource_t {
+        return _import(name, _resource_kind_t::buffer, buffer.id());
+    }
+
+    auto frame_graph_t::import_attachment(const char* name, const framebuffer_attachment_t& attachment) noexcept -> frame_graph_resource_t {
+        const auto resource = _import(name, _resource_kind_t::attachment, attachment.id());
+        _resources[resource.index].attachment = &attachment;
+        return resource;
+    }
+
+    auto frame_graph_t::create_attachment(const char* name, const frame_graph_attachment_info_t& info) noexcept -> frame_graph_resource_t {
+        auto& resource = _resources.emplace_back();
+        resource.name = name;
+        resource.kind = _resource_kind_t::transient;
+        resource.info = info;
+        return { static_cast<uint32>(_resources.size() - 1) };
+    }
+
+    auto frame_graph_t::export_attachment(frame_graph_resource_t resource) noexcept -> void {
+        assert(resource.index < _resources.size() && "invalid frame graph resource");
+        _resources[resource.index].is_exported = true;
+    }
+
+    auto frame_graph_t::forget_attachment(const framebuffer_attachment_t& attachment) noexcept -> void {
+        _imported_states.erase(static_cast<uint64>(_resource_kind_t::attachment) << 32 | attachment.id());
+        _forget_texture(attachment.id());
+    }
+
+    auto frame_graph_t::add_pass(const char* name) noexcept -> frame_graph_pass_builder_t {
+        auto& pass = _passes.emplace_back();
+        pass.name = name;
+        pass.groups = std::move(_pending_groups);
+        _pending_groups.clear();
+        return { *this, static_cast<uint32>(_passes.size() - 1) };
+    }
+
+    auto frame_graph_t::begin_group(const char* name) noexcept -> void {
+        _pending_groups.emplace_back(name);
+    }
+
+    auto frame_graph_t::end_group() noexcept -> void {
+        assert(!_passes.empty() && _pending_groups.empty() && "empty frame graph group");
+        _passes.back().closes++;
+    }
+
+    auto frame_graph_t::execute(gpu_profiler_t* profiler) noexcept -> void {
+        for (auto i = 0_u32; i < _passes.size(); ++i) {
+            for (const auto& access : _passes[i].accesses) {
+                auto& resource = _resources[access.resource];
+                if (resource.first == -1) {
+                    resource.first = i;
+                }
+                resource.last = i;
+            }
+        }
+        _allocate_transients();
+
+        const auto push = [&](const std::string& name) {
+            if (profiler) {
+                profiler->push(name.c_str());
+            } else {
+                glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name.c_str());
+            }
+        };
+        const auto pop = [&]() {
+            if (profiler) {
+                profiler->pop();
+            } else {
+                glPopDebugGroup();
+            }
+        };
+
+        _stats.passes = _passes.size();
+        _stats.barriers = 0;
+        auto depth = 0_u32;
+        for (auto& pass : _passes) {
+            for (const auto& group : pass.groups) {
+                push(group);
+            }
+            depth += pass.groups.size();
+            push(pass.name);
+
+            auto barriers = 0_u32;
+            for (const auto& access : pass.accesses) {
+                const auto& resource = _resources[access.resource];
+                const auto bit = barrier_bit(access.access, resource.kind != _resource_kind_t::buffer);
+                if (resource.state->is_dirty && (resource.state->visible & bit) != bit) {
+                    barriers |= bit;
+                }
+            }
+            if (barriers) {
+                glMemoryBarrier(barriers);
+                _stats.barriers++;
+                // the barrier covers every incoherent write issued so far, not only the ones this pass asked for
+                for (auto& resource : _resources) {
+                    if (resource.state && resource.state->is_dirty) {
+                        resource.state->visible |= barriers;
+                    }
+                }
+            }
+
+            if (pass.callback) {
+                pass.callback();
+            }
+            for (const auto& access : pass.accesses) {
+                if (access.is_write && is_incoherent(access.access)) {
+                    *_resources[access.resource].state = { true, 0 };
+                }
+            }
+
+            pop();
+            assert(pass.closes <= depth && "unbalanced frame graph groups");
+            for (auto i = 0_u32; i < pass.closes; ++i) {
+                pop();
+            }
+            depth -= pass.closes;
+        }
+        assert(depth == 0 && "unbalanced frame graph groups");
+    }
+
+    auto frame_graph_t::attachment(frame_graph_resource_t resource) const noexcept -> const framebuffer_attachment_t& {
+        assert(resource.index < _resources.size() && "invalid frame graph resource");
+        const auto& u_resource = _resources[resource.index];
+        assert(u_resource.kind != _resource_kind_t::buffer && "frame graph resource is not an attachment");
+        if (u_resource.kind == _resource_kind_t::attachment) {
+            return *u_resource.attachment;
+        }
+        assert(u_resource.texture && "transient attachment is not used by any pass");
+        return u_resource.texture->attachment;
+    }
+
+    auto frame_graph_t::framebuffer(std::initializer_list<frame_graph_resource_t> attachments) noexcept -> const framebuffer_t& {
+        auto textures = std::vector<uint32>();
+        textures.reserve(attachments.size());
+        for (const auto resource : attachments) {
+            textures.emplace_back(attachment(resource).id());
+        }
+        auto cached = std::ranges::find(_framebuffers, textures, &_framebuffer_t::textures);
+        if (cached == _framebuffers.end()) {
+            auto references = std::vector<std::reference_wrapper<const framebuffer_attachment_t>>();
+            auto draw_buffers = std::vector<uint32>();
+            for (const auto resource : attachments) {
+                const auto& u_attachment = attachment(resource);
+                references.emplace_back(u_attachment);
+                if (is_color(u_attachment.base_format())) {
+                    draw_buffers.emplace_back(GL_COLOR_ATTACHMENT0 + draw_buffers.size());
+                }
+            }
+            auto& framebuffer = _framebuffers.emplace_back();
+            framebuffer.textures = std::move(textures);
+            framebuffer.framebuffer = framebuffer_t::create(std::move(references));
+            if (draw_buffers.size() > 1) {
+                glNamedFramebufferDrawBuffers(framebuffer.framebuffer.id(), draw_buffers.size(), draw_buffers.data());
+            }
+            cached = std::prev(_framebuffers.end());
+        }
+        cached->is_used = true;
+        return cached->framebuffer;
+    }
+
+    auto frame_graph_t::stats() const noexcept -> frame_graph_stats_t {
+        return _stats;
+    }
+
+    auto frame_graph_t::swap(self& other) noexcept -> void {
+        using std::swap;
+        swap(_resources, other._resources);
+        swap(_passes, other._passes);
+        swap(_pending_groups, other._pending_groups);
+        swap(_imported_states, other._imported_states);
+        swap(_textures, other._textures);
+        swap(_framebuffers, other._framebuffers);
+        swap(_stats, other._stats);
+    }
+
+    auto frame_graph_t::_import(const char* name, _resource_kind_t kind, uint32 id) noexcept -> frame_graph_resource_t {
+        auto& resource = _resources.emplace_back();
+        resource.name = name;
+        resource.kind = kind;
+        resource.id = id;
+        resource.state = &_imported_states[static_cast<uint64>(kind) << 32 | id];
+        return { static_cast<uint32>(_resources.size() - 1) };
+    }
+
+    auto frame_graph_t::_allocate_transients() noexcept -> void {
+        for (auto& texture : _textures) {
+            texture.busy_until = -1;
+            texture.is_used = false;
+        }
+
+        auto transients = std::vector<uint32>();
+        for (auto i = 0_u32; i < _resources.size(); ++i) {
+            auto& resource = _resources[i];
+            if (resource.kind != _resource_kind_t::transient) {
+                continue;
+            }
+            if (resource.is_exported) {
+                resource.last = _passes.size();
+                if (resource.first == -1) {
+                    resource.first = resource.last;
+                }
+            }
+            if (resource.first != -1) {
+                transients.emplace_back(i);
+            }
+        }
+        std::ranges::stable_sort(transients, {}, [&](uint32 index) {
+            return _resources[index].first;
+        });
+
+        _stats.transients = transients.size();
+        _stats.transient_bytes = 0;
+        for (const auto index : transients) {
+            auto& resource = _resources[index];
+            auto texture = std::ranges::find_if(_textures, [&](const _texture_t& texture) {
+                return texture.info == resource.info && texture.busy_until < resource.first;
+            });
+            if (texture == _textures.end()) {
+                const auto& info = resource.info;
+                auto& created = _textures.emplace_back();
+                created.info = info;
+                if (info.levels > 1) {
+                    created.attachment = framebuffer_attachment_t::create_mips(
+                        info.width, info.height, info.layers, info.levels, info.format, info.base_format, info.type, info.nearest, info.border);
+                } else {
+                    created.attachment = framebuffer_attachment_t::create(
+                        info.width, info.height, info.layers, info.format, info.base_format, info.type, info.nearest, info.border);
+                }
+                if (info.image_access) {
+                    created.attachment.make_image_handles_resident(info.image_access);
+                }
+                texture = std::prev(_textures.end());
+            }
+            texture->busy_until = resource.last;
+            texture->is_used = true;
+            resource.texture = &*texture;
+            resource.state = &texture->state;
+            resource.id = texture->attachment.id();
+            _stats.transient_bytes += texture_size(resource.info);
+        }
+
+        // whatever was not needed this frame, e.g. every attachment of the old size after a resize
+        for (auto texture = _textures.begin(); texture != _textures.end();) {
+            if (!texture->is_used) {
+                _forget_texture(texture->attachment.id());
+                texture = _textures.erase(texture);
+            } else {
+                ++texture;
+            }
+        }
+        _stats.textures = _textures.size();
+        _stats.texture_bytes = std::accumulate(_textures.begin(), _textures.end(), 0_u64, [](uint64 size, const _texture_t& texture) {
+            return size + texture_size(texture.info);
+        });
+    }
+
+    auto frame_graph_t::_forget_texture(uint32 id) noexcept -> void {
+        std::erase_if(_framebuffers, [id](const _framebuffer_t& framebuffer) {
+            return std::ranges::find(framebuffer.textures, id) != framebuffer.textures.end();
+        });
+    }
+} // namespace iris
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <utilities.hpp>
+#include <buffer.hpp>
+#include <framebuffer.hpp>
+
+#include <initializer_list>
+#include <unordered_map>
+#include <functional>
+#include <vector>
+#include <string>
+#include <list>
+
+namespace iris {
+    class gpu_profiler_t;
+
+    // how a pass touches a resource, a later access only waits for incoherent (storage and image) writes
+    // and only with the barrier bit that matches the way it reads them
+    enum class frame_graph_access_t : uint32 {
+        // draw and dispatch indirect commands, indirect count parameters
+        indirect,
+        uniform,
+        // shader storage loads, stores and atomics
+        storage,
+        // sampled through a texture unit
+        texture,
+        // image load, store and bindless image handles
+        image,
+        // framebuffer color and depth
+        attachment,
+        // clears, copies, sub data uploads and readbacks
+        transfer,
+    };
+
+    struct frame_graph_resource_t {
+        uint32 index = -1;
+    };
+
+    // a transient attachment only lives between the first and the last pass that declares it
+    struct frame_graph_attachment_info_t {
+        uint32 width = 0;
+        uint32 height = 0;
+        uint32 layers = 1;
+        uint32 levels = 1;
+        int32 format = 0;
+        int32 base_format = 0;
+        uint32 type = 0;
+        bool nearest = true;
+        bool border = true;
+        // non zero makes one bindless image handle per level resident with this access
+        uint32 image_access = 0;
+
+        auto operator ==(const frame_graph_attachment_info_t&) const noexcept -> bool = default;
+    };
+
+    struct frame_graph_stats_t {
+        uint32 passes = 0;
+        uint32 barriers = 0;
+        uint32 transients = 0;
+        // textures backing the transients, lower than transients when some of them alias
+        uint32 textures = 0;
+        uint64 transient_bytes = 0;
+        uint64 texture_bytes = 0;
+    };
+
+    class frame_graph_t;
+
+    class frame_graph_pass_builder_t {
+    public:
+        using self = frame_graph_pass_builder_t;
+
+        frame_graph_pass_builder_t(frame_graph_t& graph, uint32 pass) noexcept;
+
+        auto read(frame_graph_resource_t resource, frame_graph_access_t access) noexcept -> self&;
+        auto write(frame_graph_resource_t resource, frame_graph_access_t access) noexcept -> self&;
+        auto execute(std::function<void()> callback) noexcept -> void;
+
+    private:
+        frame_graph_t* _graph = nullptr;
+        uint32 _pass = 0;
+    };
+
+    // passes run in declaration order, each one gets a single glMemoryBarrier with exactly the bits its declared
+    // accesses need. GL has no placed memory so transients alias at texture granularity: attachments with the same
+    // description and disjoint lifetimes share one texture, textures no pass asked for in a frame are released.
+    // declare everything again every frame after reset(), resources resolve until the next reset()
+    class frame_graph_t {
+    public:
+        using self = frame_graph_t;
+
+        frame_graph_t() noexcept;
+        ~frame_graph_t() noexcept;
+
+        frame_graph_t(const self&) noexcept = delete;
+        auto operator =(const self&) noexcept -> self& = delete;
+        frame_graph_t(self&& other) noexcept;
+        auto operator =(self&& other) noexcept -> self&;
+
+        static auto create() noexcept -> self;
+
+        auto reset() noexcept -> void;
+
+        // owned outside of the graph, pending writes carry over to the next frame
+        auto import_buffer(const char* name, const buffer_t& buffer) noexcept -> frame_graph_resource_t;
+        auto import_attachment(const char* name, const framebuffer_attachment_t& attachment) noexcept -> frame_graph_resource_t;
+        auto create_attachment(const char* name, const frame_graph_attachment_info_t& info) noexcept -> frame_graph_resource_t;
+        // keeps a transient alive past the last pass, for reads after execute()
+        auto export_attachment(frame_graph_resource_t resource) noexcept -> void;
+        // GL hands out deleted names again, an imported attachment has to be forgotten before it is destroyed
+        auto forget_attachment(const framebuffer_attachment_t& attachment) noexcept -> void;
+
+        auto add_pass(const char* name) noexcept -> frame_graph_pass_builder_t;
+        // nests the passes declared until end_group() in a profiler zone or debug group
+        auto begin_group(const char* name) noexcept -> void;
+        auto end_group() noexcept -> void;
+
+        // with a profiler every pass and group is a gpu zone, otherwise a debug group
+        auto execute(gpu_profiler_t* profiler = nullptr) noexcept -> void;
+
+        auto attachment(frame_graph_resource_t resource) const noexcept -> const framebuffer_attachment_t&;
+        // cached per set of textures, color attachments draw in declaration order
+        auto framebuffer(std::initializer_list<frame_graph_resource_t> attachments) noexcept -> const framebuffer_t&;
+
+        auto stats() const noexcept -> frame_graph_stats_t;
+
+        auto swap(self& other) noexcept -> void;
+
+    private:
+        friend class frame_graph_pass_builder_t;
+
+        enum class _resource_kind_t : uint32 {
+            buffer,
+            attachment,
+            transient,
+        };
+
+        // whether the last write was incoherent and which barrier bits were issued since
+        struct _barrier_state_t {
+            bool is_dirty = false;
+            uint32 visible = 0;
+        };
+
+        struct _texture_t {
+            frame_graph_attachment_info_t info;
+            framebuffer_attachment_t attachment;
+            _barrier_state_t state;
+            // last pass of the transient currently holding it, -1 when free
+            int32 busy_until = -1;
+            bool is_used = false;
+        };
+
+        struct _resource_t {
+            std::string name;
+            _resource_kind_t kind = _resource_kind_t::buffer;
+            uint32 id = 0;
+            const framebuffer_attachment_t* attachment = nullptr;
+            frame_graph_attachment_info_t info;
+            _texture_t* texture = nullptr;
+            _barrier_state_t* state = nullptr;
+            int32 first = -1;
+            int32 last = -1;
+            bool is_exported = false;
+        };
+
+        struct _access_t {
+            uint32 resource = 0;
+            frame_graph_access_t access = frame_graph_access_t::storage;
+            bool is_write = false;
+        };
+
+        struct _pass_t {
+            std::string name;
+            std::vector<_access_t> accesses;
+            std::function<void()> callback;
+            // groups opened before and closed after the pass
+            std::vector<std::string> groups;
+            uint32 closes = 0;
+        };
+
+        struct _framebuffer_t {
+            std::vector<uint32> textures;
+            framebuffer_t framebuffer;
+            bool is_used = false;
+        };
+
+        auto _import(const char* name, _resource_kind_t kind, uint32 id) noexcept -> frame_graph_resource_t;
+        auto _allocate_transients() noexcept -> void;
+        auto _forget_texture(uint32 id) noexcept -> void;
+
+        std::vector<_resource_t> _resources;
+        std::vector<_pass_t> _passes;
+        std::vector<std::string> _pending_groups;
+        // kind and GL name of imported resources
+        std::unordered_map<uint64, _barrier_state_t> _imported_states;
+        std::list<_texture_t> _textures;
+        std::list<_framebuffer_t> _framebuffers;
+        frame_graph_stats_t _stats = {};
+    };
+} // namespace iris
@@ -1,4 +1,5 @@
 #include <framebuffer.hpp>
+#include <gl_state.hpp>
 
 #include <glad/gl.h>
 
@@ -17,6 +18,10 @@ namespace iris {
     framebuffer_attachment_t::framebuffer_attachment_t() noexcept = default;
 
     framebuffer_attachment_t::~framebuffer_attachment_t() noexcept {
+        for (const auto handle : _image_handles) {
+            glMakeImageHandleNonResidentARB(handle);
+        }
+        gl_state::forget_texture(_id);
         glDeleteTextures(1, &_id);
     }
 
@@ -163,11 +168,11 @@ namespace iris {
     }
 
     auto framebuffer_attachment_t::bind() const noexcept -> void {
-        glBindTexture(_target, _id);
+        gl_state::bind_texture(_target, _id);
     }
 
     auto framebuffer_attachment_t::bind_texture(uint32 index) const noexcept -> void {
-        glBindTextureUnit(index, _id);
+        gl_state::bind_texture_unit(index, _id);
     }
 
     auto
@@ -176,6 +181,23 @@ namespace iris {
         glBindImageTexture(index, _id, level, layered, layer, access, _format);
     }
 
+    auto framebuffer_attachment_t::make_image_handles_resident(uint32 access) noexcept -> void {
+        for (const auto handle : _image_handles) {
+            glMakeImageHandleNonResidentARB(handle);
+        }
+        _image_handles.clear();
+        _image_handles.reserve(_levels);
+        for (auto level = 0_u32; level < _levels; ++level) {
+            const auto handle = glGetImageHandleARB(_id, level, _layers > 1, 0, _format);
+            glMakeImageHandleResidentARB(handle, access);
+            _image_handles.emplace_back(handle);
+        }
+    }
+
+    auto framebuffer_attachment_t::image_handles() const noexcept -> std::span<const uint64> {
+        return _image_handles;
+    }
+
     auto framebuffer_attachment_t::swap(self& other) noexcept -> void {
         using std::swap;
         swap(_id, other._id);
@@ -187,12 +209,14 @@ namespace iris {
         swap(_base_format, other._base_format);
         swap(_type, other._type);
         swap(_target, other._target);
+        swap(_image_handles, other._image_handles);
     }
 
     framebuffer_t::framebuffer_t() noexcept = default;
 
     framebuffer_t::~framebuffer_t() noexcept {
         _attachments.clear();
+        gl_state::forget_framebuffer(_id);
         glDeleteFramebuffers(1, &_id);
     }
 
@@ -238,7 +262,7 @@ namespace iris {
     }
 
     auto framebuffer_t::bind() const noexcept -> void {
-        glBindFramebuffer(GL_FRAMEBUFFER, _id);
+        gl_state::bind_framebuffer(_id);
     }
 
     auto framebuffer_t::clear_depth(float32 depth) const noexcept -> void {
@@ -52,6 +52,10 @@ namespace iris {
         auto bind_texture(uint32 index) const noexcept -> void;
         auto bind_image_texture(uint32 index, uint32 level, bool layered, uint32 layer, uint32 access) const noexcept -> void;
 
+        // one resident bindless image handle per mip level, lets a single dispatch address every level
+        auto make_image_handles_resident(uint32 access) noexcept -> void;
+        auto image_handles() const noexcept -> std::span<const uint64>;
+
         auto swap(self& other) noexcept -> void;
 
     private:
@@ -65,6 +69,8 @@ namespace iris {
         uint32 _type = 0;
 
         uint32 _target = 0;
+
+        std::vector<uint64> _image_handles;
     };
 
     class framebuffer_t {
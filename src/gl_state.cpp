@@ -0,0 +1,301 @@
+#include <gl_state.hpp>
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <array>
+
+namespace iris::gl_state {
+    // a slot that may hold anything, the next bind is always issued
+    static constexpr auto unknown = 0xffffffff_u32;
+    // bindings past these are passed straight through
+    static constexpr auto max_indexed_bindings = 128_u32;
+    static constexpr auto max_texture_units = 256_u32;
+    static constexpr auto generic_buffer_targets = 15_u32;
+    static constexpr auto indexed_buffer_targets = 4_u32;
+
+    struct _buffer_range_t {
+        uint32 id = unknown;
+        // both zero for glBindBufferBase
+        uint64 offset = 0;
+        uint64 size = 0;
+    };
+
+    struct _state_t {
+        std::array<uint32, generic_buffer_targets> buffers = {};
+        std::array<std::array<_buffer_range_t, max_indexed_bindings>, indexed_buffer_targets> indexed_buffers = {};
+        std::array<uint32, max_texture_units> textures = {};
+        std::array<uint32, max_texture_units> samplers = {};
+        std::vector<std::pair<uint32, bool>> capabilities;
+        uint32 program = unknown;
+        uint32 vertex_array = unknown;
+        uint32 framebuffer = unknown;
+
+        gl_state_stats_t current = {};
+        gl_state_stats_t last = {};
+        bool is_tracking = false;
+    };
+
+    static auto reset(_state_t& state) noexcept -> void {
+        state.buffers.fill(unknown);
+        for (auto& bindings : state.indexed_buffers) {
+            bindings.fill({});
+        }
+        state.textures.fill(unknown);
+        state.samplers.fill(unknown);
+        state.capabilities.clear();
+        state.program = unknown;
+        state.vertex_array = unknown;
+        state.framebuffer = unknown;
+    }
+
+    static auto state() noexcept -> _state_t& {
+        static auto instance = [] {
+            auto state = _state_t();
+            reset(state);
+            return state;
+        }();
+        return instance;
+    }
+
+    static auto generic_slot(uint32 target) noexcept -> uint32 {
+        switch (target) {
+            case GL_ARRAY_BUFFER: return 0;
+            case GL_ELEMENT_ARRAY_BUFFER: return 1;
+            case GL_DRAW_INDIRECT_BUFFER: return 2;
+            case GL_PARAMETER_BUFFER: return 3;
+            case GL_DISPATCH_INDIRECT_BUFFER: return 4;
+            case GL_SHADER_STORAGE_BUFFER: return 5;
+            case GL_UNIFORM_BUFFER: return 6;
+            case GL_ATOMIC_COUNTER_BUFFER: return 7;
+            case GL_TRANSFORM_FEEDBACK_BUFFER: return 8;
+            case GL_PIXEL_PACK_BUFFER: return 9;
+            case GL_PIXEL_UNPACK_BUFFER: return 10;
+            case GL_COPY_READ_BUFFER: return 11;
+            case GL_COPY_WRITE_BUFFER: return 12;
+            case GL_QUERY_BUFFER: return 13;
+            case GL_TEXTURE_BUFFER: return 14;
+            default: return unknown;
+        }
+    }
+
+    static auto indexed_slot(uint32 target) noexcept -> uint32 {
+        switch (target) {
+            case GL_SHADER_STORAGE_BUFFER: return 0;
+            case GL_UNIFORM_BUFFER: return 1;
+            case GL_ATOMIC_COUNTER_BUFFER: return 2;
+            case GL_TRANSFORM_FEEDBACK_BUFFER: return 3;
+            default: return unknown;
+        }
+    }
+
+    // true when the call can be skipped, otherwise counts it as issued
+    static auto is_redundant(_state_t& state, bool is_same) noexcept -> bool {
+        if (state.is_tracking && is_same) {
+            state.current.elided++;
+            return true;
+        }
+        state.current.issued++;
+        return false;
+    }
+
+    static auto set_generic(_state_t& state, uint32 target, uint32 id) noexcept -> void {
+        if (const auto slot = generic_slot(target); slot != unknown) {
+            state.buffers[slot] = id;
+        }
+    }
+
+    static auto bind_indexed(uint32 target, uint32 index, _buffer_range_t range, auto&& bind) noexcept -> void {
+        auto& state = gl_state::state();
+        const auto slot = indexed_slot(target);
+        auto* binding = slot != unknown && index < max_indexed_bindings ? &state.indexed_buffers[slot][index] : nullptr;
+        const auto is_same =
+            binding &&
+            binding->id == range.id &&
+            binding->offset == range.offset &&
+            binding->size == range.size;
+        if (is_redundant(state, is_same)) {
+            return;
+        }
+        bind();
+        // indexed binds also replace the generic binding of the target
+        set_generic(state, target, range.id);
+        if (binding) {
+            *binding = range;
+        }
+    }
+
+    static auto set_capability(uint32 capability, bool is_enabled) noexcept -> void {
+        auto& state = gl_state::state();
+        auto entry = std::ranges::find(state.capabilities, capability, &std::pair<uint32, bool>::first);
+        if (is_redundant(state, entry != state.capabilities.end() && entry->second == is_enabled)) {
+            return;
+        }
+        if (is_enabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+        if (entry != state.capabilities.end()) {
+            entry->second = is_enabled;
+        } else {
+            state.capabilities.emplace_back(capability, is_enabled);
+        }
+    }
+
+    auto set_tracking(bool is_tracking) noexcept -> void {
+        auto& state = gl_state::state();
+        if (is_tracking && !state.is_tracking) {
+            // whatever was bound while not tracking is unknown
+            reset(state);
+        }
+        state.is_tracking = is_tracking;
+    }
+
+    auto is_tracking() noexcept -> bool {
+        return state().is_tracking;
+    }
+
+    auto invalidate() noexcept -> void {
+        reset(state());
+    }
+
+    auto forget_buffer(uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        std::ranges::replace(state.buffers, id, unknown);
+        for (auto& bindings : state.indexed_buffers) {
+            for (auto& binding : bindings) {
+                if (binding.id == id) {
+                    binding = {};
+                }
+            }
+        }
+    }
+
+    auto forget_texture(uint32 id) noexcept -> void {
+        std::ranges::replace(state().textures, id, unknown);
+    }
+
+    auto forget_program(uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        if (state.program == id) {
+            state.program = unknown;
+        }
+    }
+
+    auto forget_vertex_array(uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        if (state.vertex_array == id) {
+            state.vertex_array = unknown;
+        }
+    }
+
+    auto forget_framebuffer(uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        if (state.framebuffer == id) {
+            state.framebuffer = unknown;
+        }
+    }
+
+    auto bind_buffer(uint32 target, uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        const auto slot = generic_slot(target);
+        if (is_redundant(state, slot != unknown && state.buffers[slot] == id)) {
+            return;
+        }
+        glBindBuffer(target, id);
+        set_generic(state, target, id);
+    }
+
+    auto bind_buffer_base(uint32 target, uint32 index, uint32 id) noexcept -> void {
+        bind_indexed(target, index, { id, 0, 0 }, [&] {
+            glBindBufferBase(target, index, id);
+        });
+    }
+
+    auto bind_buffer_range(uint32 target, uint32 index, uint32 id, uint64 offset, uint64 size) noexcept -> void {
+        bind_indexed(target, index, { id, offset, size }, [&] {
+            glBindBufferRange(target, index, id, offset, size);
+        });
+    }
+
+    auto use_program(uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        if (is_redundant(state, state.program == id)) {
+            return;
+        }
+        glUseProgram(id);
+        state.program = id;
+    }
+
+    auto bind_vertex_array(uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        if (is_redundant(state, state.vertex_array == id)) {
+            return;
+        }
+        glBindVertexArray(id);
+        state.vertex_array = id;
+        // the element buffer binding is vertex array state
+        state.buffers[generic_slot(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+    }
+
+    auto bind_framebuffer(uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        if (is_redundant(state, state.framebuffer == id)) {
+            return;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, id);
+        state.framebuffer = id;
+    }
+
+    auto bind_texture_unit(uint32 unit, uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        if (is_redundant(state, unit < max_texture_units && state.textures[unit] == id)) {
+            return;
+        }
+        glBindTextureUnit(unit, id);
+        if (unit < max_texture_units) {
+            state.textures[unit] = id;
+        }
+    }
+
+    auto bind_texture(uint32 target, uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        if (is_redundant(state, id != 0 && state.textures[0] == id)) {
+            return;
+        }
+        glBindTexture(target, id);
+        // unbinding a single target leaves the other targets of the unit bound
+        state.textures[0] = id != 0 ? id : unknown;
+    }
+
+    auto bind_sampler(uint32 unit, uint32 id) noexcept -> void {
+        auto& state = gl_state::state();
+        if (is_redundant(state, unit < max_texture_units && state.samplers[unit] == id)) {
+            return;
+        }
+        glBindSampler(unit, id);
+        if (unit < max_texture_units) {
+            state.samplers[unit] = id;
+        }
+    }
+
+    auto enable(uint32 capability) noexcept -> void {
+        set_capability(capability, true);
+    }
+
+    auto disable(uint32 capability) noexcept -> void {
+        set_capability(capability, false);
+    }
+
+    auto end_frame() noexcept -> void {
+        auto& state = gl_state::state();
+        state.last = std::exchange(state.current, {});
+    }
+
+    auto frame_stats() noexcept -> gl_state_stats_t {
+        return state().last;
+    }
+} // namespace iris::gl_state
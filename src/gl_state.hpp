@@ -0,0 +1,45 @@
+#pragma once
+
+#include <utilities.hpp>
+
+namespace iris {
+    struct gl_state_stats_t {
+        // calls that reached the driver and calls that matched the cached state
+        uint32 issued = 0;
+        uint32 elided = 0;
+    };
+
+    // shadow copy of the binding state buffer_t, shader_t, texture_t and framebuffer_t bind through, redundant
+    // binds never reach the driver. the cache is only trusted while tracking is on, a sample that still binds
+    // through raw GL calls has to keep it off or call invalidate() after them
+    namespace gl_state {
+        auto set_tracking(bool is_tracking) noexcept -> void;
+        auto is_tracking() noexcept -> bool;
+        // forgets everything, the next bind of every slot is issued
+        auto invalidate() noexcept -> void;
+        // deleted names are reset to zero by GL and may be handed out again, objects forget them on destruction
+        auto forget_buffer(uint32 id) noexcept -> void;
+        auto forget_texture(uint32 id) noexcept -> void;
+        auto forget_program(uint32 id) noexcept -> void;
+        auto forget_vertex_array(uint32 id) noexcept -> void;
+        auto forget_framebuffer(uint32 id) noexcept -> void;
+
+        auto bind_buffer(uint32 target, uint32 id) noexcept -> void;
+        auto bind_buffer_base(uint32 target, uint32 index, uint32 id) noexcept -> void;
+        auto bind_buffer_range(uint32 target, uint32 index, uint32 id, uint64 offset, uint64 size) noexcept -> void;
+        auto use_program(uint32 id) noexcept -> void;
+        auto bind_vertex_array(uint32 id) noexcept -> void;
+        // both draw and read
+        auto bind_framebuffer(uint32 id) noexcept -> void;
+        auto bind_texture_unit(uint32 unit, uint32 id) noexcept -> void;
+        // non DSA, binds to the active unit which is never changed from 0 outside of ImGui
+        auto bind_texture(uint32 target, uint32 id) noexcept -> void;
+        auto bind_sampler(uint32 unit, uint32 id) noexcept -> void;
+        auto enable(uint32 capability) noexcept -> void;
+        auto disable(uint32 capability) noexcept -> void;
+
+        // latches the counters of the frame that just ended and starts counting the next one
+        auto end_frame() noexcept -> void;
+        auto frame_stats() noexcept -> gl_state_stats_t;
+    } // namespace gl_state
+} // namespace iris
@@ -0,0 +1,258 @@
+#include <gpu_profiler.hpp>
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace iris {
+    static constexpr auto invalid_frame = std::numeric_limits<uint64>::max();
+    static constexpr auto invalid_record = std::numeric_limits<uint32>::max();
+
+    gpu_profiler_t::gpu_profiler_t() noexcept = default;
+
+    gpu_profiler_t::~gpu_profiler_t() noexcept {
+        for (auto& frame : _frames) {
+            glDeleteQueries(frame.queries.size(), frame.queries.data());
+        }
+    }
+
+    gpu_profiler_t::gpu_profiler_t(self&& other) noexcept {
+        swap(other);
+    }
+
+    auto gpu_profiler_t::operator =(self&& other) noexcept -> self& {
+        self(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    auto gpu_profiler_t::create(uint32 latency, uint32 history, uint32 max_zones) noexcept -> self {
+        auto profiler = self();
+        profiler._frames.resize(latency);
+        for (auto& frame : profiler._frames) {
+            // one begin and one end timestamp per zone
+            frame.queries.resize(max_zones * 2);
+            glCreateQueries(GL_TIMESTAMP, frame.queries.size(), frame.queries.data());
+            frame.records.reserve(max_zones);
+        }
+        profiler._history_frames.resize(history, invalid_frame);
+        profiler._history_size = history;
+        return profiler;
+    }
+
+    auto gpu_profiler_t::begin_frame() noexcept -> void {
+        auto& frame = _frames[_frame % _frames.size()];
+        if (!frame.records.empty()) {
+            _resolve(frame);
+        }
+        frame.records.clear();
+        frame.query_count = 0;
+        frame.frame = _frame;
+    }
+
+    auto gpu_profiler_t::end_frame() noexcept -> void {
+        assert(_stack.empty() && "unbalanced gpu zones");
+        _frame++;
+    }
+
+    auto gpu_profiler_t::flush() noexcept -> void {
+        // oldest frame first so the history stays in frame order
+        const auto is_blocking = _is_blocking;
+        _is_blocking = true;
+        for (auto i = 0_u32; i < _frames.size(); ++i) {
+            auto& frame = _frames[(_frame + i) % _frames.size()];
+            if (!frame.records.empty()) {
+                _resolve(frame);
+            }
+            frame.records.clear();
+            frame.query_count = 0;
+        }
+        _is_blocking = is_blocking;
+    }
+
+    auto gpu_profiler_t::set_blocking(bool is_blocking) noexcept -> void {
+        _is_blocking = is_blocking;
+    }
+
+    auto gpu_profiler_t::push(const char* name) noexcept -> void {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+        auto& frame = _frames[_frame % _frames.size()];
+        // every zone still open needs its end query later, at most one per stack entry
+        if (frame.query_count + 2 + _stack.size() > frame.queries.size()) {
+            // out of queries, the debug group is still pushed
+            _stack.push_back(invalid_record);
+            return;
+        }
+
+        auto [iterator, is_new] = _zone_indices.try_emplace(name, _zones.size());
+        if (is_new) {
+            auto& zone = _zones.emplace_back();
+            zone.name = name;
+            zone.depth = _stack.size();
+            zone.history.resize(_history_size, 0.0f);
+            zone.history_offset = _history_offset;
+        }
+
+        glQueryCounter(frame.queries[frame.query_count], GL_TIMESTAMP);
+        frame.records.push_back({
+            .zone = iterator->second,
+            .begin_query = frame.query_count++,
+        });
+        _stack.push_back(frame.records.size() - 1);
+    }
+
+    auto gpu_profiler_t::pop() noexcept -> void {
+        assert(!_stack.empty() && "unbalanced gpu zones");
+        const auto record = _stack.back();
+        _stack.pop_back();
+        if (record != invalid_record) {
+            auto& frame = _frames[_frame % _frames.size()];
+            glQueryCounter(frame.queries[frame.query_count], GL_TIMESTAMP);
+            frame.records[record].end_query = frame.query_count++;
+        }
+        glPopDebugGroup();
+    }
+
+    auto gpu_profiler_t::zones() const noexcept -> std::span<const gpu_zone_stats_t> {
+        return _zones;
+    }
+
+    auto gpu_profiler_t::zone(const std::string& name) const noexcept -> const gpu_zone_stats_t* {
+        const auto iterator = _zone_indices.find(name);
+        if (iterator == _zone_indices.end()) {
+            return nullptr;
+        }
+        return &_zones[iterator->second];
+    }
+
+    auto gpu_profiler_t::frames() const noexcept -> uint64 {
+        return _frame;
+    }
+
+    auto gpu_profiler_t::frame_times(uint64 frame) const noexcept -> std::optional<std::vector<float32>> {
+        const auto slot = std::ranges::find(_history_frames, frame);
+        if (frame == invalid_frame || slot == _history_frames.end()) {
+            return std::nullopt;
+        }
+        const auto index = std::distance(_history_frames.begin(), slot);
+        auto times = std::vector<float32>();
+        times.reserve(_zones.size());
+        for (const auto& zone : _zones) {
+            times.push_back(zone.history[index]);
+        }
+        return times;
+    }
+
+    auto gpu_profiler_t::export_csv(const fs::path& path) const noexcept -> bool {
+        auto file = std::ofstream(path);
+        if (!file) {
+            return false;
+        }
+        file << "frame";
+        for (const auto& zone : _zones) {
+            file << ',' << zone.name;
+        }
+        file << '\n';
+        for (auto i = 0_u32; i < _history_size; ++i) {
+            const auto slot = (_history_offset + i) % _history_size;
+            if (_history_frames[slot] == invalid_frame) {
+                continue;
+            }
+            file << _history_frames[slot];
+            for (const auto& zone : _zones) {
+                file << ',' << zone.history[slot];
+            }
+            file << '\n';
+        }
+        return true;
+    }
+
+    auto gpu_profiler_t::export_json(const fs::path& path) const noexcept -> bool {
+        auto file = std::ofstream(path);
+        if (!file) {
+            return false;
+        }
+        auto slots = std::vector<uint32>();
+        slots.reserve(_history_size);
+        for (auto i = 0_u32; i < _history_size; ++i) {
+            const auto slot = (_history_offset + i) % _history_size;
+            if (_history_frames[slot] != invalid_frame) {
+                slots.push_back(slot);
+            }
+        }
+
+        file << "{\n  \"frames\": [";
+        for (auto i = 0_u32; i < slots.size(); ++i) {
+            file << (i ? ", " : "") << _history_frames[slots[i]];
+        }
+        file << "],\n  \"zones\": [";
+        for (auto i = 0_u32; i < _zones.size(); ++i) {
+            const auto& zone = _zones[i];
+            file << (i ? "," : "") << "\n    {\n";
+            file << "      \"name\": \"" << zone.name << "\",\n";
+            file << "      \"depth\": " << zone.depth << ",\n";
+            file << "      \"average_ms\": " << zone.average << ",\n";
+            file << "      \"max_ms\": " << zone.max << ",\n";
+            file << "      \"history_ms\": [";
+            for (auto j = 0_u32; j < slots.size(); ++j) {
+                file << (j ? ", " : "") << zone.history[slots[j]];
+            }
+            file << "]\n    }";
+        }
+        file << "\n  ]\n}\n";
+        return true;
+    }
+
+    auto gpu_profiler_t::swap(self& other) noexcept -> void {
+        using std::swap;
+        swap(_frames, other._frames);
+        swap(_zones, other._zones);
+        swap(_zone_indices, other._zone_indices);
+        swap(_stack, other._stack);
+        swap(_history_frames, other._history_frames);
+        swap(_history_offset, other._history_offset);
+        swap(_history_size, other._history_size);
+        swap(_frame, other._frame);
+        swap(_is_blocking, other._is_blocking);
+    }
+
+    auto gpu_profiler_t::_resolve(_frame_t& frame) noexcept -> void {
+        // never wait on the GPU unless asked to, a frame that is still in flight is dropped
+        auto available = 0_i32;
+        glGetQueryObjectiv(frame.queries[frame.query_count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && !_is_blocking) {
+            return;
+        }
+
+        // zones that run more than once per frame (i.e. culling per cascade) are summed
+        auto times = std::vector<float32>(_zones.size(), 0.0f);
+        for (const auto& record : frame.records) {
+            auto begin = 0_u64;
+            auto end = 0_u64;
+            glGetQueryObjectui64v(frame.queries[record.begin_query], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.queries[record.end_query], GL_QUERY_RESULT, &end);
+            times[record.zone] += (end - begin) / 1'000'000.0f;
+        }
+
+        const auto slot = _history_offset;
+        _history_frames[slot] = frame.frame;
+        _history_offset = (_history_offset + 1) % _history_size;
+        for (auto i = 0_u32; i < _zones.size(); ++i) {
+            auto& zone = _zones[i];
+            zone.history[slot] = times[i];
+            zone.history_offset = _history_offset;
+            zone.latest = times[i];
+            zone.average = 0.0f;
+            zone.max = 0.0f;
+            auto samples = 0_u32;
+            for (auto j = 0_u32; j < _history_size; ++j) {
+                if (_history_frames[j] != invalid_frame) {
+                    zone.average += zone.history[j];
+                    zone.max = std::max(zone.max, zone.history[j]);
+                    samples++;
+                }
+            }
+            zone.average /= std::max(samples, 1_u32);
+        }
+    }
+} // namespace iris
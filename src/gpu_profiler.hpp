@@ -0,0 +1,108 @@
+#pragma once
+
+#include <utilities.hpp>
+
+#include <unordered_map>
+#include <optional>
+#include <vector>
+#include <string>
+#include <span>
+
+namespace iris {
+    struct gpu_zone_stats_t {
+        std::string name;
+        uint32 depth = 0;
+        // ring buffer of per frame times in milliseconds, oldest at history_offset
+        std::vector<float32> history;
+        uint32 history_offset = 0;
+        float32 latest = 0.0f;
+        float32 average = 0.0f;
+        float32 max = 0.0f;
+    };
+
+    // GL_TIMESTAMP queries around debug groups, results are read back `latency` frames later so readback never stalls
+    class gpu_profiler_t {
+    public:
+        using self = gpu_profiler_t;
+
+        gpu_profiler_t() noexcept;
+        ~gpu_profiler_t() noexcept;
+
+        gpu_profiler_t(const self&) noexcept = delete;
+        auto operator =(const self&) noexcept -> self& = delete;
+        gpu_profiler_t(self&& other) noexcept;
+        auto operator =(self&& other) noexcept -> self&;
+
+        static auto create(uint32 latency = 4, uint32 history = 256, uint32 max_zones = 128) noexcept -> self;
+
+        auto begin_frame() noexcept -> void;
+        auto end_frame() noexcept -> void;
+        // waits for every frame still in flight, used before exporting a benchmark
+        auto flush() noexcept -> void;
+        // a blocking profiler waits for late results instead of dropping the frame
+        auto set_blocking(bool is_blocking) noexcept -> void;
+
+        // also pushes a debug group with the same name
+        auto push(const char* name) noexcept -> void;
+        auto pop() noexcept -> void;
+
+        auto zones() const noexcept -> std::span<const gpu_zone_stats_t>;
+        auto zone(const std::string& name) const noexcept -> const gpu_zone_stats_t*;
+        auto frames() const noexcept -> uint64;
+        // per zone times of a frame that is still in the history, in zones() order
+        auto frame_times(uint64 frame) const noexcept -> std::optional<std::vector<float32>>;
+
+        auto export_csv(const fs::path& path) const noexcept -> bool;
+        auto export_json(const fs::path& path) const noexcept -> bool;
+
+        auto swap(self& other) noexcept -> void;
+
+    private:
+        struct _zone_record_t {
+            uint32 zone = 0;
+            uint32 begin_query = 0;
+            uint32 end_query = 0;
+        };
+
+        struct _frame_t {
+            std::vector<uint32> queries;
+            std::vector<_zone_record_t> records;
+            uint32 query_count = 0;
+            uint64 frame = 0;
+        };
+
+        auto _resolve(_frame_t& frame) noexcept -> void;
+
+        std::vector<_frame_t> _frames;
+        std::vector<gpu_zone_stats_t> _zones;
+        std::unordered_map<std::string, uint32> _zone_indices;
+        std::vector<uint32> _stack;
+        // frame number of every history slot
+        std::vector<uint64> _history_frames;
+        uint32 _history_offset = 0;
+        uint32 _history_size = 0;
+        uint64 _frame = 0;
+        bool _is_blocking = false;
+    };
+
+    // scoped zone for passes that are not already bracketed by push/pop
+    class gpu_zone_t {
+    public:
+        gpu_zone_t(gpu_profiler_t& profiler, const char* name) noexcept
+            : _profiler(profiler) {
+            _profiler.push(name);
+        }
+
+        ~gpu_zone_t() noexcept {
+            _profiler.pop();
+        }
+
+        gpu_zone_t(const gpu_zone_t&) noexcept = delete;
+        auto operator =(const gpu_zone_t&) noexcept -> gpu_zone_t& = delete;
+
+    private:
+        gpu_profiler_t& _profiler;
+    };
+
+    #define iris_gpu_zone(profiler, name) auto iris_concat(__gpu_zone_, __LINE__) = iris::gpu_zone_t(profiler, name)
+} // namespace iris
@@ -0,0 +1,151 @@
+#include <headless.hpp>
+
+#if defined(IRIS_HEADLESS_EGL)
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+#include <string_view>
+#include <array>
+
+namespace iris {
+    headless_context_t::headless_context_t() noexcept = default;
+
+    headless_context_t::~headless_context_t() noexcept {
+#if defined(IRIS_HEADLESS_EGL)
+        if (_display) {
+            eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (_context) {
+                eglDestroyContext(_display, _context);
+            }
+            if (_surface) {
+                eglDestroySurface(_display, _surface);
+            }
+            eglTerminate(_display);
+        }
+#endif
+    }
+
+    headless_context_t::headless_context_t(self&& other) noexcept {
+        swap(other);
+    }
+
+    auto headless_context_t::operator =(self&& other) noexcept -> self& {
+        self(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    auto headless_context_t::create(uint32 width, uint32 height) noexcept -> self {
+        auto headless = self();
+#if defined(IRIS_HEADLESS_EGL)
+        auto display = EGL_NO_DISPLAY;
+        const auto* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        const auto has_surfaceless =
+            client_extensions &&
+            std::string_view(client_extensions).find("EGL_MESA_platform_surfaceless") != std::string_view::npos;
+        const auto get_platform_display =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (has_surfaceless && get_platform_display) {
+            display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (display == EGL_NO_DISPLAY) {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+
+        auto major = 0_i32;
+        auto minor = 0_i32;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+            iris::log("headless: failed to initialize an EGL display");
+            return headless;
+        }
+        headless._display = display;
+        iris::log("headless: EGL ", major, ".", minor, ", ", eglQueryString(display, EGL_VENDOR));
+
+        const auto config_attributes = std::to_array<EGLint>({
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+        });
+        auto config = EGLConfig();
+        auto config_count = 0_i32;
+        if (!eglChooseConfig(display, config_attributes.data(), &config, 1, &config_count) || config_count == 0) {
+            iris::log("headless: no pbuffer capable EGL config");
+            return headless;
+        }
+
+        const auto surface_attributes = std::to_array<EGLint>({
+            EGL_WIDTH, static_cast<EGLint>(width),
+            EGL_HEIGHT, static_cast<EGLint>(height),
+            EGL_NONE
+        });
+        headless._surface = eglCreatePbufferSurface(display, config, surface_attributes.data());
+        if (headless._surface == EGL_NO_SURFACE) {
+            iris::log("headless: failed to create a ", width, "x", height, " pbuffer");
+            return headless;
+        }
+
+        eglBindAPI(EGL_OPENGL_API);
+        // older llvmpipe stops at 4.5, the samples then rely on the extensions it exposes
+        for (const auto minor_version : { 6, 5 }) {
+            const auto context_attributes = std::to_array<EGLint>({
+                EGL_CONTEXT_MAJOR_VERSION, 4,
+                EGL_CONTEXT_MINOR_VERSION, minor_version,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#if !defined(NDEBUG)
+                EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+                EGL_NONE
+            });
+            headless._context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes.data());
+            if (headless._context != EGL_NO_CONTEXT) {
+                break;
+            }
+        }
+        if (headless._context == EGL_NO_CONTEXT) {
+            iris::log("headless: failed to create an OpenGL 4.5+ core context");
+            headless._context = nullptr;
+            return headless;
+        }
+        if (!eglMakeCurrent(display, headless._surface, headless._surface, headless._context)) {
+            iris::log("headless: failed to make the context current");
+            eglDestroyContext(display, headless._context);
+            headless._context = nullptr;
+        }
+#else
+        static_cast<void>(width);
+        static_cast<void>(height);
+        iris::log("headless: this build has no EGL support");
+#endif
+        return headless;
+    }
+
+    auto headless_context_t::load_function(const char* name) noexcept -> void(*)() {
+#if defined(IRIS_HEADLESS_EGL)
+        return reinterpret_cast<void(*)()>(eglGetProcAddress(name));
+#else
+        static_cast<void>(name);
+        return nullptr;
+#endif
+    }
+
+    auto headless_context_t::is_valid() const noexcept -> bool {
+        return _context != nullptr;
+    }
+
+    auto headless_context_t::swap_buffers() const noexcept -> void {
+#if defined(IRIS_HEADLESS_EGL)
+        eglSwapBuffers(_display, _surface);
+#endif
+    }
+
+    auto headless_context_t::swap(self& other) noexcept -> void {
+        using std::swap;
+        swap(_display, other._display);
+        swap(_surface, other._surface);
+        swap(_context, other._context);
+    }
+} // namespace iris
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <utilities.hpp>
+
+namespace iris {
+    // offscreen GL 4.6 core context without a window or display server, backed by a fixed size pbuffer.
+    // prefers the Mesa surfaceless platform (works with llvmpipe) and falls back to the default EGL display
+    class headless_context_t {
+    public:
+        using self = headless_context_t;
+
+        headless_context_t() noexcept;
+        ~headless_context_t() noexcept;
+
+        headless_context_t(const self&) noexcept = delete;
+        auto operator =(const self&) noexcept -> self& = delete;
+        headless_context_t(self&& other) noexcept;
+        auto operator =(self&& other) noexcept -> self&;
+
+        // the returned context is current on success, check is_valid()
+        static auto create(uint32 width, uint32 height) noexcept -> self;
+        // suitable for gladLoadGL
+        static auto load_function(const char* name) noexcept -> void(*)();
+
+        auto is_valid() const noexcept -> bool;
+        auto swap_buffers() const noexcept -> void;
+
+        auto swap(self& other) noexcept -> void;
+
+    private:
+        void* _display = nullptr;
+        void* _surface = nullptr;
+        void* _context = nullptr;
+    };
+} // namespace iris
@@ -1,14 +1,22 @@
 #include <mesh_pool.hpp>
+#include <gl_state.hpp>
 
 namespace iris {
     mesh_pool_t::mesh_pool_t() noexcept = default;
 
     mesh_pool_t::~mesh_pool_t() noexcept {
         for (auto& [_, vbp] : _vbps) {
+            gl_state::forget_vertex_array(vbp.vao);
             glDeleteVertexArrays(1, &vbp.vao);
+            for (const auto vbo : vbp.vbos) {
+                gl_state::forget_buffer(vbo);
+            }
             glDeleteBuffers(vbp.vbos.size(), vbp.vbos.data());
         }
 
+        for (const auto ebo : _ebos) {
+            gl_state::forget_buffer(ebo);
+        }
         glDeleteBuffers(_ebos.size(), _ebos.data());
     }
 
@@ -27,9 +35,18 @@ namespace iris {
         return mesh_pool;
     }
 
+    auto mesh_pool_t::vertex_blocks() const noexcept -> std::span<const uint32> {
+        return _vertex_blocks;
+    }
+
+    auto mesh_pool_t::index_blocks() const noexcept -> std::span<const uint32> {
+        return _ebos;
+    }
+
     auto mesh_pool_t::swap(self& other) noexcept -> void {
         using std::swap;
         swap(_vbps, other._vbps);
+        swap(_vertex_blocks, other._vertex_blocks);
         swap(_ebos, other._ebos);
         swap(allocator, other.allocator);
     }
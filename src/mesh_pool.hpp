@@ -6,6 +6,7 @@
 #include <glad/gl.h>
 
 #include <vector>
+#include <span>
 
 namespace iris {
     struct mesh_t {
@@ -20,6 +21,10 @@ namespace iris {
         uint32 vao = 0;
         uint32 vbo = 0;
         uint32 ebo = 0;
+
+        // index into mesh_pool_t::vertex_blocks() and mesh_pool_t::index_blocks()
+        uint32 vertex_block = 0;
+        uint32 index_block = 0;
     };
 
     // assumed all components are type = GL_FLOAT and binding = 0
@@ -48,16 +53,23 @@ namespace iris {
             const std::vector<uint32>& indices,
             const std::vector<vertex_attribute_t>& vertex_format) noexcept -> mesh_t;
 
+        // every vertex buffer of every vertex size, in creation order
+        auto vertex_blocks() const noexcept -> std::span<const uint32>;
+        auto index_blocks() const noexcept -> std::span<const uint32>;
+
         auto swap(self& other) noexcept -> void;
 
     private:
         struct _vertex_buffer_package {
             uint32 vao = 0;
             std::vector<uint32> vbos;
+            // slice index -> vertex block
+            std::vector<uint32> blocks;
             allocator_t allocator;
         };
 
         std::unordered_map<uint64, _vertex_buffer_package> _vbps;
+        std::vector<uint32> _vertex_blocks;
         std::vector<uint32> _ebos;
         allocator_t allocator;
     };
@@ -87,17 +99,22 @@ namespace iris {
             glCreateBuffers(1, &vbo);
             glNamedBufferStorage(vbo, vbp.allocator.capacity(), nullptr, GL_DYNAMIC_STORAGE_BIT);
             glVertexArrayVertexBuffer(vbp.vao, 0, vbo, 0, vertex_size);
+            vbp.blocks.emplace_back(_vertex_blocks.size());
+            _vertex_blocks.emplace_back(vbo);
         }
 
         // copy vertices
         auto vertex_slice = vbp.allocator.allocate(size_bytes(vertices));
         if (vertex_slice.index() >= vbp.vbos.size()) {
             vbp.vbos.resize(vertex_slice.index() + 1);
+            vbp.blocks.resize(vertex_slice.index() + 1);
         }
         if (!vbp.vbos[vertex_slice.index()]) {
             glCreateBuffers(1, &vbp.vbos[vertex_slice.index()]);
             glNamedBufferStorage(vbp.vbos[vertex_slice.index()], vbp.allocator.capacity(), nullptr, GL_DYNAMIC_STORAGE_BIT);
             glVertexArrayVertexBuffer(vbp.vao, vertex_slice.index(), vbp.vbos[vertex_slice.index()], 0, vertex_size);
+            vbp.blocks[vertex_slice.index()] = _vertex_blocks.size();
+            _vertex_blocks.emplace_back(vbp.vbos[vertex_slice.index()]);
         }
         glNamedBufferSubData(vbp.vbos[vertex_slice.index()], vertex_slice.offset(), vertex_slice.size(), vertices.data());
 
@@ -122,6 +139,8 @@ namespace iris {
         mesh.vao = vbp.vao;
         mesh.vbo = vbp.vbos[vertex_slice.index()];
         mesh.ebo = _ebos[index_slice.index()];
+        mesh.vertex_block = vbp.blocks[vertex_slice.index()];
+        mesh.index_block = index_slice.index();
 
         mesh.vertex_slice = std::move(vertex_slice);
         mesh.index_slice = std::move(index_slice);
@@ -1,3 +1,4 @@
+#include <cpu_profiler.hpp>
 #include <texture.hpp>
 #include <model.hpp>
 #include <mesh_pool.hpp>
@@ -60,14 +61,18 @@ namespace iris {
     }
 
     // TODO: temporary, "model_t" should be a simple container, it should NOT upload things to the GPU nor invoke "mesh_pool_t"
-    auto model_t::create(mesh_pool_t& mesh_pool, const fs::path& path) noexcept -> self {
+    auto model_t::create(mesh_pool_t& mesh_pool, const fs::path& path, bool stream_textures) noexcept -> self {
+        iris_cpu_zone("model_t::create");
         auto model = self();
 
         auto options = cgltf_options();
         auto* gltf = (cgltf_data*)(nullptr);
         const auto s_path = path.generic_string();
-        cgltf_parse_file(&options, s_path.c_str(), &gltf);
-        cgltf_load_buffers(&options, gltf, s_path.c_str());
+        {
+            iris_cpu_zone("cgltf_load");
+            cgltf_parse_file(&options, s_path.c_str(), &gltf);
+            cgltf_load_buffers(&options, gltf, s_path.c_str());
+        }
 
         auto mesh_cache = std::unordered_map<uint64, uint64>();
         auto texture_cache = std::unordered_map<const void*, uint32>();
@@ -79,7 +84,7 @@ namespace iris {
                 const auto* ptr = static_cast<const uint8*>(buffer.data) + buffer_view.offset;
                 if (!texture_cache.contains(ptr)) {
                     texture_cache[ptr] = model._textures.size();
-                    model._textures.emplace_back(texture_t::create_compressed(std::span(ptr, buffer.size), type));
+                    model._textures.emplace_back(texture_t::create_compressed(std::span(ptr, buffer.size), type, true, stream_textures));
                 }
             }
         };
@@ -292,6 +297,10 @@ namespace iris {
         return _textures;
     }
 
+    auto model_t::textures() noexcept -> std::span<texture_t> {
+        return _textures;
+    }
+
     auto model_t::acquire_mesh(uint32 index) const noexcept -> const mesh_t& {
         return _meshes[index];
     }
@@ -60,11 +60,12 @@ namespace iris {
         model_t(self&& other) noexcept;
         auto operator =(self&& other) noexcept -> self&;
 
-        static auto create(mesh_pool_t& mesh_pool, const fs::path& path) noexcept -> self;
+        static auto create(mesh_pool_t& mesh_pool, const fs::path& path, bool stream_textures = false) noexcept -> self;
 
         auto objects() const noexcept -> std::span<const object_t>;
         auto transforms() const noexcept -> std::span<const glm::mat4>;
         auto textures() const noexcept -> std::span<const texture_t>;
+        auto textures() noexcept -> std::span<texture_t>;
 
         auto acquire_mesh(uint32 index) const noexcept -> const mesh_t&;
 
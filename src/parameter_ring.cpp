@@ -0,0 +1,121 @@
+#include <parameter_ring.hpp>
+#include <gl_state.hpp>
+
+#include <glad/gl.h>
+
+#include <algorithm>
+
+namespace iris {
+    parameter_ring_t::parameter_ring_t() noexcept = default;
+
+    parameter_ring_t::~parameter_ring_t() noexcept {
+        for (auto fence : _fences) {
+            if (fence) {
+                glDeleteSync(fence);
+            }
+        }
+    }
+
+    parameter_ring_t::parameter_ring_t(self&& other) noexcept {
+        swap(other);
+    }
+
+    auto parameter_ring_t::operator =(self&& other) noexcept -> self& {
+        self(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    auto parameter_ring_t::create(uint64 frame_size, uint32 frames) noexcept -> self {
+        auto ring = self();
+        auto alignment = 0_i32;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        ring._alignment = std::max(alignment, 1_i32);
+        // every region starts aligned so the first slice of a frame is too
+        ring._frame_size = (frame_size + ring._alignment - 1) / ring._alignment * ring._alignment;
+        ring._buffer = buffer_t::create(
+            ring._frame_size * frames,
+            GL_UNIFORM_BUFFER,
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT,
+            true);
+        ring._fences.resize(frames, nullptr);
+        return ring;
+    }
+
+    auto parameter_ring_t::begin_frame() noexcept -> void {
+        // slices of the last frame are all bound by now, deleting a buffer the GPU still reads is deferred by GL
+        _retired.clear();
+        _frame = (_frame + 1) % _fences.size();
+        _offset = 0;
+        auto& fence = _fences[_frame];
+        if (!fence) {
+            return;
+        }
+        while (true) {
+            const auto status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED) {
+                break;
+            }
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    auto parameter_ring_t::end_frame() noexcept -> void {
+        auto& fence = _fences[_frame];
+        if (fence) {
+            glDeleteSync(fence);
+        }
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    auto parameter_ring_t::bind(uint32 index, parameter_slice_t slice) const noexcept -> void {
+        gl_state::bind_buffer_range(GL_UNIFORM_BUFFER, index, slice.buffer, slice.offset, slice.size);
+    }
+
+    auto parameter_ring_t::buffer() const noexcept -> const buffer_t& {
+        return _buffer;
+    }
+
+    auto parameter_ring_t::used() const noexcept -> uint64 {
+        return _offset;
+    }
+
+    auto parameter_ring_t::swap(self& other) noexcept -> void {
+        using std::swap;
+        swap(_buffer, other._buffer);
+        swap(_retired, other._retired);
+        swap(_fences, other._fences);
+        swap(_frame_size, other._frame_size);
+        swap(_alignment, other._alignment);
+        swap(_frame, other._frame);
+        swap(_offset, other._offset);
+    }
+
+    auto parameter_ring_t::_allocate(uint64 size) noexcept -> parameter_slice_t {
+        if (_offset + size > _frame_size) {
+            _grow(size);
+        }
+        const auto slice = parameter_slice_t {
+            .buffer = _buffer.id(),
+            .offset = _frame * _frame_size + _offset,
+            .size = size,
+        };
+        _offset = (_offset + size + _alignment - 1) / _alignment * _alignment;
+        return slice;
+    }
+
+    auto parameter_ring_t::_grow(uint64 size) noexcept -> void {
+        const auto frames = static_cast<uint64>(_fences.size());
+        const auto frame_size = std::max(_frame_size * 2, (_offset + size + _alignment - 1) / _alignment * _alignment);
+        iris::log("parameter ring: ", _offset + size, " bytes in one frame, growing regions from ", _frame_size, " to ", frame_size, " bytes");
+        // the regions of the new buffer were never used, only this frame's slices move over
+        _retired.emplace_back(std::move(_buffer));
+        _buffer = buffer_t::create(
+            frame_size * frames,
+            GL_UNIFORM_BUFFER,
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT,
+            true);
+        _frame_size = frame_size;
+        _offset = 0;
+    }
+} // namespace iris
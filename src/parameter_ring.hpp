@@ -0,0 +1,73 @@
+#pragma once
+
+#include <utilities.hpp>
+#include <buffer.hpp>
+
+#include <type_traits>
+#include <cstring>
+#include <vector>
+
+namespace iris {
+    struct parameter_slice_t {
+        // the ring may have grown since, a slice keeps pointing at the buffer it was written to
+        uint32 buffer = 0;
+        uint64 offset = 0;
+        uint64 size = 0;
+    };
+
+    // persistently mapped uniform buffer split in one region per frame in flight, parameter blocks are copied
+    // into the region of the current frame and bound once per pass instead of setting every uniform by hand.
+    // a region is only reused after the fence of the frame that last wrote it has signaled.
+    // a frame that outgrows its region moves the ring to a larger buffer, the old one lives until the next frame
+    class parameter_ring_t {
+    public:
+        using self = parameter_ring_t;
+
+        parameter_ring_t() noexcept;
+        ~parameter_ring_t() noexcept;
+
+        parameter_ring_t(const self&) noexcept = delete;
+        auto operator =(const self&) noexcept -> self& = delete;
+        parameter_ring_t(self&& other) noexcept;
+        auto operator =(self&& other) noexcept -> self&;
+
+        static auto create(uint64 frame_size, uint32 frames = 3) noexcept -> self;
+
+        // waits for the GPU to release the next region
+        auto begin_frame() noexcept -> void;
+        auto end_frame() noexcept -> void;
+
+        // T has to match the std140 layout of the block it is bound to
+        template <typename T>
+        auto push(const T& parameters) noexcept -> parameter_slice_t;
+        auto bind(uint32 index, parameter_slice_t slice) const noexcept -> void;
+
+        auto buffer() const noexcept -> const buffer_t&;
+        // bytes pushed during the current frame
+        auto used() const noexcept -> uint64;
+
+        auto swap(self& other) noexcept -> void;
+
+    private:
+        auto _allocate(uint64 size) noexcept -> parameter_slice_t;
+        auto _grow(uint64 size) noexcept -> void;
+
+        buffer_t _buffer;
+        std::vector<buffer_t> _retired;
+        std::vector<GLsync> _fences;
+        uint64 _frame_size = 0;
+        uint64 _alignment = 0;
+        uint32 _frame = 0;
+        uint64 _offset = 0;
+    };
+
+    template <typename T>
+    auto parameter_ring_t::push(const T& parameters) noexcept -> parameter_slice_t {
+        static_assert(std::is_trivially_copyable_v<T>, "parameter blocks are copied byte for byte");
+        // std140 rounds the size of a block up to a vec4, the bound range must cover all of it
+        static_assert(sizeof(T) % 16 == 0, "parameter blocks have to be padded to 16 bytes");
+        const auto slice = _allocate(sizeof(T));
+        std::memcpy(static_cast<uint8*>(_buffer.mapped()) + slice.offset, &parameters, sizeof(T));
+        return slice;
+    }
+} // namespace iris
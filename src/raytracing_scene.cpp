@@ -0,0 +1,182 @@
+#include <cpu_profiler.hpp>
+#include <raytracing_scene.hpp>
+#include <mesh_pool.hpp>
+#include <texture.hpp>
+#include <model.hpp>
+
+#include <glad/gl.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace iris {
+    struct mesh_geometry_t {
+        std::vector<vertex_format_t> vertices;
+        std::vector<uint32> indices;
+        bvh_t blas;
+    };
+
+    static auto transform_bounds(const glm::mat4& transform, const bvh_bounds_t& bounds) noexcept -> bvh_bounds_t {
+        auto result = bvh_bounds_t();
+        for (auto i = 0_u32; i < 8; ++i) {
+            const auto corner = glm::vec3(
+                i & 1 ? bounds.max.x : bounds.min.x,
+                i & 2 ? bounds.max.y : bounds.min.y,
+                i & 4 ? bounds.max.z : bounds.min.z);
+            const auto point = glm::vec3(transform * glm::vec4(corner, 1.0f));
+            result.min = glm::min(result.min, point);
+            result.max = glm::max(result.max, point);
+        }
+        return result;
+    }
+
+    auto raytracing_scene_t::create(const model_t& model) noexcept -> self {
+        iris_cpu_zone("raytracing_scene_t::create");
+        auto scene = self();
+        const auto objects = model.objects();
+        const auto transforms = model.transforms();
+        auto mesh_count = 0_u32;
+        for (const auto& object : objects) {
+            mesh_count = std::max(mesh_count, object.mesh + 1);
+        }
+
+        auto meshes = std::vector<mesh_geometry_t>(mesh_count);
+        {
+            iris_cpu_zone("read back meshes");
+            for (auto i = 0_u32; i < mesh_count; ++i) {
+                const auto& mesh = model.acquire_mesh(i);
+                assert(mesh.vertex_size == sizeof(vertex_format_t) && "unexpected vertex format");
+                auto& geometry = meshes[i];
+                geometry.vertices.resize(mesh.vertex_slice.size() / sizeof(vertex_format_t));
+                geometry.indices.resize(mesh.index_count);
+                glGetNamedBufferSubData(
+                    mesh.vbo,
+                    mesh.vertex_offset * mesh.vertex_size,
+                    size_bytes(geometry.vertices),
+                    geometry.vertices.data());
+                glGetNamedBufferSubData(
+                    mesh.ebo,
+                    mesh.index_offset * sizeof(uint32),
+                    size_bytes(geometry.indices),
+                    geometry.indices.data());
+            }
+        }
+
+        {
+            iris_cpu_zone("build BLAS");
+            auto next = std::atomic<uint32>(0);
+            const auto build = [&]() {
+                for (auto i = next++; i < mesh_count; i = next++) {
+                    auto& geometry = meshes[i];
+                    auto bounds = std::vector<bvh_bounds_t>(geometry.indices.size() / 3);
+                    for (auto j = 0_u64; j < bounds.size(); ++j) {
+                        for (auto k = 0_u32; k < 3; ++k) {
+                            const auto& position = geometry.vertices[geometry.indices[j * 3 + k]].position;
+                            bounds[j].min = glm::min(bounds[j].min, position);
+                            bounds[j].max = glm::max(bounds[j].max, position);
+                        }
+                    }
+                    geometry.blas = bvh_t::create(bounds);
+                }
+            };
+            auto workers = std::vector<std::jthread>();
+            const auto worker_count = std::min(std::max(std::thread::hardware_concurrency(), 1_u32), mesh_count);
+            for (auto i = 1_u32; i < worker_count; ++i) {
+                workers.emplace_back(build);
+            }
+            build();
+        }
+
+        // BLASes are concatenated, each keeps its own relative offsets
+        auto node_offsets = std::vector<uint32>(mesh_count);
+        auto triangle_offsets = std::vector<uint32>(mesh_count);
+        for (auto i = 0_u32; i < mesh_count; ++i) {
+            const auto& geometry = meshes[i];
+            node_offsets[i] = scene._blas_nodes.size();
+            triangle_offsets[i] = scene._triangles.size();
+            scene._blas_nodes.insert(scene._blas_nodes.end(), geometry.blas.nodes().begin(), geometry.blas.nodes().end());
+            scene._depth = std::max(scene._depth, geometry.blas.depth());
+            for (const auto index : geometry.blas.indices()) {
+                const auto& v0 = geometry.vertices[geometry.indices[index * 3 + 0]];
+                const auto& v1 = geometry.vertices[geometry.indices[index * 3 + 1]];
+                const auto& v2 = geometry.vertices[geometry.indices[index * 3 + 2]];
+                scene._triangles.push_back({
+                    .v0 = glm::vec4(v0.position, 0.0f),
+                    .e1 = glm::vec4(v1.position - v0.position, 0.0f),
+                    .e2 = glm::vec4(v2.position - v0.position, 0.0f),
+                });
+                scene._triangle_attributes.push_back({
+                    .normals = {
+                        glm::vec4(v0.normal, 0.0f),
+                        glm::vec4(v1.normal, 0.0f),
+                        glm::vec4(v2.normal, 0.0f),
+                    },
+                    .uv = {
+                        glm::vec4(v0.uv.x, v0.uv.y, v1.uv.x, v1.uv.y),
+                        glm::vec4(v2.uv.x, v2.uv.y, 0.0f, 0.0f),
+                    },
+                });
+            }
+        }
+
+        auto instances = std::vector<raytracing_instance_t>();
+        auto instance_bounds = std::vector<bvh_bounds_t>();
+        instances.reserve(objects.size());
+        instance_bounds.reserve(objects.size());
+        for (auto i = 0_u64; i < objects.size(); ++i) {
+            const auto& object = objects[i];
+            if (meshes[object.mesh].indices.size() < 3) {
+                continue;
+            }
+            const auto is_textured = object.diffuse_texture != -1_u32;
+            const auto is_alpha_tested = is_textured && !model.textures()[object.diffuse_texture].is_opaque();
+            instances.push_back({
+                .world_to_object = glm::inverse(transforms[i]),
+                .node_offset = node_offsets[object.mesh],
+                .triangle_offset = triangle_offsets[object.mesh],
+                .diffuse_texture = object.diffuse_texture,
+                .alpha_texture = is_alpha_tested ? object.diffuse_texture : -1_u32,
+            });
+            instance_bounds.push_back(transform_bounds(transforms[i], meshes[object.mesh].blas.bounds()));
+        }
+
+        const auto tlas = bvh_t::create(instance_bounds, 1);
+        scene._tlas_nodes.assign(tlas.nodes().begin(), tlas.nodes().end());
+        scene._depth = std::max(scene._depth, tlas.depth());
+        scene._instances.reserve(instances.size());
+        for (const auto index : tlas.indices()) {
+            scene._instances.push_back(instances[index]);
+        }
+        iris::log(
+            "raytracing scene: ", scene._triangles.size(), " triangles in ", mesh_count, " BLAS, ",
+            scene._instances.size(), " instances, depth ", scene._depth);
+        return scene;
+    }
+
+    auto raytracing_scene_t::triangles() const noexcept -> std::span<const raytracing_triangle_t> {
+        return _triangles;
+    }
+
+    auto raytracing_scene_t::triangle_attributes() const noexcept -> std::span<const raytracing_triangle_attributes_t> {
+        return _triangle_attributes;
+    }
+
+    auto raytracing_scene_t::blas_nodes() const noexcept -> std::span<const bvh_node_t> {
+        return _blas_nodes;
+    }
+
+    auto raytracing_scene_t::instances() const noexcept -> std::span<const raytracing_instance_t> {
+        return _instances;
+    }
+
+    auto raytracing_scene_t::tlas_nodes() const noexcept -> std::span<const bvh_node_t> {
+        return _tlas_nodes;
+    }
+
+    auto raytracing_scene_t::depth() const noexcept -> uint32 {
+        return _depth;
+    }
+} // namespace iris
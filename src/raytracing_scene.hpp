@@ -0,0 +1,65 @@
+#pragma once
+
+#include <utilities.hpp>
+#include <bvh.hpp>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <vector>
+#include <span>
+
+namespace iris {
+    class model_t;
+
+    // object space positions, the edges are precomputed for the ray triangle test
+    struct raytracing_triangle_t {
+        glm::vec4 v0 = {};
+        glm::vec4 e1 = {};
+        glm::vec4 e2 = {};
+    };
+
+    // everything that is only needed once a triangle was hit, "uv" is { u0, v0, u1, v1 } and { u2, v2, -, - }
+    struct raytracing_triangle_attributes_t {
+        glm::vec4 normals[3] = {};
+        glm::vec4 uv[2] = {};
+    };
+
+    struct raytracing_instance_t {
+        glm::mat4 world_to_object = {};
+        // into raytracing_scene_t::blas_nodes() and raytracing_scene_t::triangles()
+        uint32 node_offset = 0;
+        uint32 triangle_offset = 0;
+        // into model_t::textures(), -1 without one, the alpha texture is only set for textures that are not opaque
+        uint32 diffuse_texture = -1;
+        uint32 alpha_texture = -1;
+    };
+
+    // two level BVH over the geometry of a model: a BLAS per mesh in object space, a TLAS over the world bounds
+    // of every object. node offsets of the BLASes are relative to their own root and triangle offsets relative to
+    // the first triangle of their mesh, triangles and their attributes are in leaf order
+    class raytracing_scene_t {
+    public:
+        using self = raytracing_scene_t;
+
+        // reads the geometry back from the mesh pool, the model has to be loaded with vertex_format_t
+        static auto create(const model_t& model) noexcept -> self;
+
+        auto triangles() const noexcept -> std::span<const raytracing_triangle_t>;
+        auto triangle_attributes() const noexcept -> std::span<const raytracing_triangle_attributes_t>;
+        auto blas_nodes() const noexcept -> std::span<const bvh_node_t>;
+        // in TLAS leaf order
+        auto instances() const noexcept -> std::span<const raytracing_instance_t>;
+        auto tlas_nodes() const noexcept -> std::span<const bvh_node_t>;
+        // deepest of the TLAS and every BLAS
+        auto depth() const noexcept -> uint32;
+
+    private:
+        std::vector<raytracing_triangle_t> _triangles;
+        std::vector<raytracing_triangle_attributes_t> _triangle_attributes;
+        std::vector<bvh_node_t> _blas_nodes;
+        std::vector<raytracing_instance_t> _instances;
+        std::vector<bvh_node_t> _tlas_nodes;
+        uint32 _depth = 0;
+    };
+} // namespace iris
@@ -1,23 +1,54 @@
+#include <gl_state.hpp>
 #include <shader.hpp>
 
 #include <glad/gl.h>
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <string_view>
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+#include <vector>
+#include <string>
 #include <array>
 
 namespace iris {
-    static auto shader_compile_status(iris::uint32 shader) -> void {
+    struct program_binary_header_t {
+        uint32 magic = 0;
+        uint32 format = 0;
+        uint64 key = 0;
+        uint64 size = 0;
+    };
+
+    struct shader_stage_t {
+        uint32 type = 0;
+        fs::path path;
+    };
+
+    // a stage with its includes expanded and defines injected
+    struct shader_source_t {
+        std::string text;
+        std::vector<fs::path> files;
+    };
+
+    static constexpr auto program_binary_magic = 0x4e425249_u32; // "IRBN"
+
+    static auto shader_cache_directory = fs::path("shader_cache");
+    static auto shader_global_defines = std::vector<shader_define_t>();
+
+    static auto shader_compile_status(iris::uint32 shader, std::string_view files) -> void {
         auto success = 0;
         glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
         if (!success) {
             auto info = std::array<char, 1024>();
             glGetShaderInfoLog(shader, info.size(), nullptr, info.data());
             iris::log("err: shader compilation failed with: ", info.data());
+            iris::log("err: source strings: ", files);
         }
     }
 
-    static auto program_link_status(iris::uint32 program) -> void {
+    static auto program_link_status(iris::uint32 program) -> bool {
         auto success = 0;
         glGetProgramiv(program, GL_LINK_STATUS, &success);
         if (!success) {
@@ -25,11 +56,262 @@ namespace iris {
             glGetProgramInfoLog(program, info.size(), nullptr, info.data());
             iris::log("err: shader program linking failed with: ", info.data());
         }
+        return success;
+    }
+
+    // a driver update invalidates every binary, so the driver is part of every key
+    static auto driver_hash() noexcept -> uint64 {
+        static const auto hash = [] {
+            auto hash = fnv1a_offset_basis;
+            for (const auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+                hash = hash_fnv1a(reinterpret_cast<const char*>(glGetString(name)), hash);
+            }
+            return hash;
+        }();
+        return hash;
+    }
+
+    static auto is_binary_cache_supported() noexcept -> bool {
+        static const auto is_supported = [] {
+            auto formats = 0_i32;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            return formats > 0;
+        }();
+        return !shader_cache_directory.empty() && is_supported;
+    }
+
+    static auto program_binary_path(uint64 key) noexcept -> fs::path {
+        auto name = std::array<char, 24>();
+        std::snprintf(name.data(), name.size(), "%016llx.bin", static_cast<unsigned long long>(key));
+        return shader_cache_directory / name.data();
+    }
+
+    static auto load_program_binary(uint32 program, uint64 key) noexcept -> bool {
+        auto file = std::ifstream(program_binary_path(key), std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        auto header = program_binary_header_t();
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != program_binary_magic || header.key != key) {
+            return false;
+        }
+        auto binary = std::vector<char>(header.size);
+        file.read(binary.data(), binary.size());
+        if (!file) {
+            return false;
+        }
+        glProgramBinary(program, header.format, binary.data(), binary.size());
+        // drivers reject binaries they no longer understand, the caller then compiles from source
+        auto success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        return success;
+    }
+
+    static auto store_program_binary(uint32 program, uint64 key) noexcept -> void {
+        auto size = 0_i32;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+        if (size <= 0) {
+            return;
+        }
+        auto header = program_binary_header_t {
+            .magic = program_binary_magic,
+            .key = key,
+        };
+        auto binary = std::vector<char>(size);
+        glGetProgramBinary(program, size, nullptr, &header.format, binary.data());
+        header.size = binary.size();
+
+        auto error = std::error_code();
+        fs::create_directories(shader_cache_directory, error);
+        auto file = std::ofstream(program_binary_path(key), std::ios::binary);
+        if (!file) {
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), binary.size());
+    }
+
+    // the quoted path of an #include line, empty for every other line
+    static auto include_path(std::string_view line) noexcept -> std::string_view {
+        const auto begin = line.find_first_not_of(" \t");
+        if (begin == std::string_view::npos || !line.substr(begin).starts_with("#include")) {
+            return {};
+        }
+        const auto open = line.find('"', begin);
+        const auto close = open == std::string_view::npos ? open : line.find('"', open + 1);
+        if (close == std::string_view::npos) {
+            return {};
+        }
+        return line.substr(open + 1, close - open - 1);
+    }
+
+    static auto line_directive(uint32 line, uint64 file) noexcept -> std::string {
+        return "#line " + std::to_string(line) + " " + std::to_string(file) + "\n";
+    }
+
+    // GLSL has no #include without ARB_shading_language_include, so files are pasted in place. #line keeps the
+    // driver's line numbers per file, the source string number is the file's index in source.files
+    static auto expand_source(
+        const fs::path& path,
+        std::span<const shader_define_t> defines,
+        shader_source_t& source) noexcept -> void {
+        const auto index = source.files.size();
+        source.files.push_back(path);
+        if (!fs::exists(path)) {
+            iris::log("err: shader source ", path.generic_string(), " does not exist");
+            return;
+        }
+        if (index != 0) {
+            source.text += line_directive(1, index);
+        }
+        auto stream = std::istringstream(iris::whole_file(path));
+        auto line = std::string();
+        for (auto number = 1_u32; std::getline(stream, line); ++number) {
+            if (line.ends_with('\r')) {
+                line.pop_back();
+            }
+            if (const auto include = include_path(line); !include.empty()) {
+                const auto included = (path.parent_path() / include).lexically_normal();
+                if (std::ranges::find(source.files, included) == source.files.end()) {
+                    expand_source(included, {}, source);
+                }
+                source.text += line_directive(number + 1, index);
+                continue;
+            }
+            source.text += line;
+            source.text += '\n';
+            // defines can only follow #version
+            if (line.starts_with("#version")) {
+                for (const auto& define : shader_global_defines) {
+                    source.text += "#define " + define.name + " " + define.value + "\n";
+                }
+                for (const auto& define : defines) {
+                    source.text += "#define " + define.name + " " + define.value + "\n";
+                }
+                source.text += line_directive(number + 1, index);
+            }
+        }
+    }
+
+    static auto file_table(const shader_source_t& source) noexcept -> std::string {
+        auto table = std::string();
+        for (auto i = 0_u64; i < source.files.size(); ++i) {
+            table += (i != 0 ? ", " : "") + std::to_string(i) + ": " + source.files[i].generic_string();
+        }
+        return table;
+    }
+
+    // the key of a define set regardless of the order it was written in
+    static auto hash_defines(std::span<const shader_define_t> defines) noexcept -> uint64 {
+        auto entries = std::vector<std::string>();
+        for (const auto& define : defines) {
+            entries.push_back(define.name + "=" + define.value);
+        }
+        std::ranges::sort(entries);
+        auto hash = fnv1a_offset_basis;
+        for (const auto& entry : entries) {
+            hash = hash_fnv1a(entry, hash);
+            hash = hash_fnv1a("\n", hash);
+        }
+        return hash;
+    }
+
+    // compiles and links without querying any status, so a parallel compiling driver does not block here.
+    // a program loaded from the cache comes back without shaders, there is nothing left to resolve
+    static auto submit_program(
+        std::span<const shader_stage_t> stages,
+        std::span<const shader_define_t> defines) noexcept -> pending_program_t {
+        auto sources = std::vector<shader_source_t>(stages.size());
+        auto key = driver_hash();
+        for (auto i = 0_u32; i < stages.size(); ++i) {
+            // includes and defines are part of the expanded text, so they are part of the key too
+            expand_source(stages[i].path, defines, sources[i]);
+            key = hash_fnv1a(std::string_view(reinterpret_cast<const char*>(&stages[i].type), sizeof(stages[i].type)), key);
+            key = hash_fnv1a(sources[i].text, key);
+        }
+
+        auto pending = pending_program_t {
+            .program = glCreateProgram(),
+            .shaders = {},
+            .file_tables = {},
+            .key = key,
+            .is_cached = is_binary_cache_supported(),
+        };
+        if (pending.is_cached && load_program_binary(pending.program, key)) {
+            return pending;
+        }
+
+        for (auto i = 0_u32; i < stages.size(); ++i) {
+            const auto shader = glCreateShader(stages[i].type);
+            const auto* source = sources[i].text.c_str();
+            glShaderSource(shader, 1, &source, nullptr);
+            glCompileShader(shader);
+            glAttachShader(pending.program, shader);
+            pending.shaders.push_back(shader);
+            pending.file_tables.push_back(file_table(sources[i]));
+        }
+        if (pending.is_cached) {
+            glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(pending.program);
+        return pending;
+    }
+
+    static auto resolve_program(pending_program_t& pending) noexcept -> void {
+        if (pending.shaders.empty()) {
+            return;
+        }
+        for (auto i = 0_u32; i < pending.shaders.size(); ++i) {
+            shader_compile_status(pending.shaders[i], pending.file_tables[i]);
+        }
+        const auto is_linked = program_link_status(pending.program);
+        for (const auto shader : pending.shaders) {
+            glDetachShader(pending.program, shader);
+            glDeleteShader(shader);
+        }
+        pending.shaders.clear();
+        pending.file_tables.clear();
+        if (pending.is_cached && is_linked) {
+            store_program_binary(pending.program, pending.key);
+        }
+    }
+
+    static auto is_program_complete(const pending_program_t& pending) noexcept -> bool {
+        auto is_complete = 1_i32;
+        glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &is_complete);
+        return is_complete;
+    }
+
+    static auto make_program(
+        std::span<const shader_stage_t> stages,
+        std::span<const shader_define_t> defines) noexcept -> uint32 {
+        auto pending = submit_program(stages, defines);
+        resolve_program(pending);
+        return pending.program;
+    }
+
+    static auto vertex_fragment_stages(const fs::path& vertex, const fs::path& fragment) noexcept {
+        return std::to_array<shader_stage_t>({
+            { GL_VERTEX_SHADER, vertex },
+            { GL_FRAGMENT_SHADER, fragment },
+        });
+    }
+
+    static auto mesh_stages(const fs::path& task, const fs::path& mesh, const fs::path& fragment) noexcept -> std::vector<shader_stage_t> {
+        auto stages = std::vector<shader_stage_t>();
+        if (!task.empty()) {
+            stages.push_back({ GL_TASK_SHADER_NV, task });
+        }
+        stages.push_back({ GL_MESH_SHADER_NV, mesh });
+        stages.push_back({ GL_FRAGMENT_SHADER, fragment });
+        return stages;
     }
 
     shader_t::shader_t() noexcept = default;
 
     shader_t::~shader_t() noexcept {
+        gl_state::forget_program(_id);
         glDeleteProgram(_id);
     }
 
@@ -42,97 +324,44 @@ namespace iris {
         return *this;
     }
 
-    auto shader_t::create(const fs::path& vertex, const fs::path& fragment) noexcept -> self {
+    auto shader_t::create(
+        const fs::path& vertex,
+        const fs::path& fragment,
+        std::span<const shader_define_t> defines) noexcept -> self {
         auto shader = self();
-        shader._id = glCreateProgram();
-        auto vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-        const auto vertex_shader_file = iris::whole_file(vertex);
-        const auto* vertex_shader_source = vertex_shader_file.c_str();
-        glShaderSource(vertex_shader, 1, &vertex_shader_source, nullptr);
-        glCompileShader(vertex_shader);
-        shader_compile_status(vertex_shader);
-
-        auto fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-        const auto fragment_shader_file = iris::whole_file(fragment);
-        const auto* fragment_shader_source = fragment_shader_file.c_str();
-        glShaderSource(fragment_shader, 1, &fragment_shader_source, nullptr);
-        glCompileShader(fragment_shader);
-        shader_compile_status(fragment_shader);
-
-        glAttachShader(shader._id, vertex_shader);
-        glAttachShader(shader._id, fragment_shader);
-        glLinkProgram(shader._id);
-        program_link_status(shader._id);
-
-        glDeleteShader(fragment_shader);
-        glDeleteShader(vertex_shader);
+        shader._id = make_program(vertex_fragment_stages(vertex, fragment), defines);
         return shader;
     }
 
-    auto shader_t::create_compute(const fs::path& compute) noexcept -> self {
+    auto shader_t::create_compute(const fs::path& compute, std::span<const shader_define_t> defines) noexcept -> self {
         auto shader = self();
-        shader._id = glCreateProgram();
-        auto compute_shader = glCreateShader(GL_COMPUTE_SHADER);
-        const auto compute_shader_file = iris::whole_file(compute);
-        const auto* compute_shader_source = compute_shader_file.c_str();
-        glShaderSource(compute_shader, 1, &compute_shader_source, nullptr);
-        glCompileShader(compute_shader);
-        shader_compile_status(compute_shader);
-
-        glAttachShader(shader._id, compute_shader);
-        glLinkProgram(shader._id);
-        program_link_status(shader._id);
-
-        glDeleteShader(compute_shader);
+        const auto stages = std::to_array<shader_stage_t>({
+            { GL_COMPUTE_SHADER, compute },
+        });
+        shader._id = make_program(stages, defines);
         return shader;
     }
 
-    auto shader_t::create_mesh(const fs::path& task, const fs::path& mesh, const fs::path& fragment) noexcept -> self {
+    auto shader_t::create_mesh(
+        const fs::path& task,
+        const fs::path& mesh,
+        const fs::path& fragment,
+        std::span<const shader_define_t> defines) noexcept -> self {
         auto shader = self();
-        shader._id = glCreateProgram();
-        auto task_shader = 0_u32;
-        if (!task.empty()) {
-            task_shader = glCreateShader(GL_TASK_SHADER_NV);
-            const auto task_shader_file = iris::whole_file(task);
-            const auto* task_shader_source = task_shader_file.c_str();
-            glShaderSource(task_shader, 1, &task_shader_source, nullptr);
-            glCompileShader(task_shader);
-            shader_compile_status(task_shader);
-        }
-
-        auto mesh_shader = glCreateShader(GL_MESH_SHADER_NV);
-        const auto mesh_shader_file = iris::whole_file(mesh);
-        const auto* mesh_shader_source = mesh_shader_file.c_str();
-        glShaderSource(mesh_shader, 1, &mesh_shader_source, nullptr);
-        glCompileShader(mesh_shader);
-        shader_compile_status(mesh_shader);
-
-        auto fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-        const auto fragment_shader_file = iris::whole_file(fragment);
-        const auto* fragment_shader_source = fragment_shader_file.c_str();
-        glShaderSource(fragment_shader, 1, &fragment_shader_source, nullptr);
-        glCompileShader(fragment_shader);
-        shader_compile_status(fragment_shader);
-
-        if (!task.empty()) {
-            glAttachShader(shader._id, task_shader);
-        }
-        glAttachShader(shader._id, mesh_shader);
-        glAttachShader(shader._id, fragment_shader);
-        glLinkProgram(shader._id);
-        program_link_status(shader._id);
+        shader._id = make_program(mesh_stages(task, mesh, fragment), defines);
+        return shader;
+    }
 
-        if (!task.empty()) {
-            glDeleteShader(task_shader);
-        }
-        glDeleteShader(mesh_shader);
-        glDeleteShader(fragment_shader);
+    auto shader_t::set_cache_directory(const fs::path& directory) noexcept -> void {
+        shader_cache_directory = directory;
+    }
 
-        return shader;
+    auto shader_t::set_global_defines(std::span<const shader_define_t> defines) noexcept -> void {
+        shader_global_defines.assign(defines.begin(), defines.end());
     }
 
     auto shader_t::bind() const noexcept -> const self& {
-        glUseProgram(_id);
+        gl_state::use_program(_id);
         return *this;
     }
 
@@ -165,8 +394,146 @@ namespace iris {
         return *this;
     }
 
+    auto shader_t::set(int32 location, std::span<const uint64> handles) const noexcept -> const self& {
+        glProgramUniformHandleui64vARB(_id, location, handles.size(), handles.data());
+        return *this;
+    }
+
     auto shader_t::swap(self& other) noexcept -> void {
         using std::swap;
         swap(_id, other._id);
     }
+
+    shader_batch_t::shader_batch_t() noexcept = default;
+
+    shader_batch_t::~shader_batch_t() noexcept {
+        // the shaders of unresolved programs would leak otherwise
+        wait();
+    }
+
+    shader_batch_t::shader_batch_t(self&& other) noexcept {
+        swap(other);
+    }
+
+    auto shader_batch_t::operator =(self&& other) noexcept -> self& {
+        self(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    auto shader_batch_t::create() noexcept -> self {
+        auto batch = self();
+        batch._is_parallel = GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+        if (GLAD_GL_KHR_parallel_shader_compile) {
+            // let the driver pick as many threads as it wants
+            glMaxShaderCompilerThreadsKHR(0xffffffff);
+        } else if (GLAD_GL_ARB_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsARB(0xffffffff);
+        }
+        return batch;
+    }
+
+    auto shader_batch_t::submit(
+        const fs::path& vertex,
+        const fs::path& fragment,
+        std::span<const shader_define_t> defines) noexcept -> shader_t {
+        return _push(submit_program(vertex_fragment_stages(vertex, fragment), defines));
+    }
+
+    auto shader_batch_t::submit_compute(const fs::path& compute, std::span<const shader_define_t> defines) noexcept -> shader_t {
+        const auto stages = std::to_array<shader_stage_t>({
+            { GL_COMPUTE_SHADER, compute },
+        });
+        return _push(submit_program(stages, defines));
+    }
+
+    auto shader_batch_t::submit_mesh(
+        const fs::path& task,
+        const fs::path& mesh,
+        const fs::path& fragment,
+        std::span<const shader_define_t> defines) noexcept -> shader_t {
+        return _push(submit_program(mesh_stages(task, mesh, fragment), defines));
+    }
+
+    auto shader_batch_t::poll() noexcept -> bool {
+        if (!_is_parallel) {
+            // completion can not be queried without blocking, resolve everything now
+            wait();
+            return true;
+        }
+        for (auto i = 0_u64; i < _pending.size();) {
+            if (!is_program_complete(_pending[i])) {
+                ++i;
+                continue;
+            }
+            resolve_program(_pending[i]);
+            _pending[i] = std::move(_pending.back());
+            _pending.pop_back();
+        }
+        return _pending.empty();
+    }
+
+    auto shader_batch_t::wait() noexcept -> void {
+        for (auto& pending : _pending) {
+            resolve_program(pending);
+        }
+        _pending.clear();
+    }
+
+    auto shader_batch_t::pending_count() const noexcept -> uint32 {
+        return _pending.size();
+    }
+
+    auto shader_batch_t::swap(self& other) noexcept -> void {
+        using std::swap;
+        swap(_pending, other._pending);
+        swap(_is_parallel, other._is_parallel);
+    }
+
+    auto shader_batch_t::_push(pending_program_t&& pending) noexcept -> shader_t {
+        auto shader = shader_t();
+        shader._id = pending.program;
+        if (!pending.shaders.empty()) {
+            _pending.emplace_back(std::move(pending));
+        }
+        return shader;
+    }
+
+    auto shader_permutations_t::create(const fs::path& vertex, const fs::path& fragment) noexcept -> self {
+        auto permutations = self();
+        permutations._vertex = vertex;
+        permutations._fragment = fragment;
+        return permutations;
+    }
+
+    auto shader_permutations_t::create_compute(const fs::path& compute) noexcept -> self {
+        auto permutations = self();
+        permutations._compute = compute;
+        return permutations;
+    }
+
+    auto shader_permutations_t::prepare(shader_batch_t& batch, std::span<const shader_define_t> defines) noexcept -> const shader_t& {
+        const auto key = hash_defines(defines);
+        if (const auto it = _permutations.find(key); it != _permutations.end()) {
+            return it->second;
+        }
+        auto shader = _compute.empty()
+            ? batch.submit(_vertex, _fragment, defines)
+            : batch.submit_compute(_compute, defines);
+        return _permutations.emplace(key, std::move(shader)).first->second;
+    }
+
+    auto shader_permutations_t::get(std::span<const shader_define_t> defines) noexcept -> const shader_t& {
+        const auto key = hash_defines(defines);
+        if (const auto it = _permutations.find(key); it != _permutations.end()) {
+            return it->second;
+        }
+        auto shader = _compute.empty()
+            ? shader_t::create(_vertex, _fragment, defines)
+            : shader_t::create_compute(_compute, defines);
+        return _permutations.emplace(key, std::move(shader)).first->second;
+    }
+
+    auto shader_permutations_t::count() const noexcept -> uint32 {
+        return _permutations.size();
+    }
 } // namespace iris
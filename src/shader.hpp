@@ -6,10 +6,29 @@
 
 #include <glm/mat4x4.hpp>
 
+#include <unordered_map>
 #include <cassert>
+#include <vector>
+#include <string>
 #include <span>
 
 namespace iris {
+    // injected as "#define name value" right after #version
+    struct shader_define_t {
+        std::string name;
+        std::string value;
+    };
+
+    // a program whose stages are compiled and linked but whose status was not queried yet
+    struct pending_program_t {
+        uint32 program = 0;
+        std::vector<uint32> shaders;
+        // "index: path" of every file a stage was expanded from, #line directives refer to these indices
+        std::vector<std::string> file_tables;
+        uint64 key = 0;
+        bool is_cached = false;
+    };
+
     class shader_t {
     public:
         using self = shader_t;
@@ -22,9 +41,22 @@ namespace iris {
         shader_t(self&& other) noexcept;
         auto operator =(self&& other) noexcept -> self&;
 
-        static auto create(const fs::path& vertex, const fs::path& fragment) noexcept -> self;
-        static auto create_compute(const fs::path& compute) noexcept -> self;
-        static auto create_mesh(const fs::path& task, const fs::path& mesh, const fs::path& fragment) noexcept -> self;
+        // sources may #include "file" relative to the including file, every file is included at most once
+        static auto create(
+            const fs::path& vertex,
+            const fs::path& fragment,
+            std::span<const shader_define_t> defines = {}) noexcept -> self;
+        static auto create_compute(const fs::path& compute, std::span<const shader_define_t> defines = {}) noexcept -> self;
+        static auto create_mesh(
+            const fs::path& task,
+            const fs::path& mesh,
+            const fs::path& fragment,
+            std::span<const shader_define_t> defines = {}) noexcept -> self;
+
+        // linked programs are cached here as driver binaries keyed by source and driver, empty disables the cache
+        static auto set_cache_directory(const fs::path& directory) noexcept -> void;
+        // injected into every program created afterwards, before the per program defines
+        static auto set_global_defines(std::span<const shader_define_t> defines) noexcept -> void;
 
         auto bind() const noexcept -> const self&;
 
@@ -50,13 +82,83 @@ namespace iris {
 
         auto set(int32 location, const glm::mat4& values) const noexcept -> const self&;
         auto set(int32 location, std::span<const glm::mat4> values) const noexcept -> const self&;
+        auto set(int32 location, std::span<const uint64> handles) const noexcept -> const self&;
 
         auto swap(self& other) noexcept -> void;
 
     private:
+        friend class shader_batch_t;
+
         uint32 _id = 0;
     };
 
+    // submits every program up front and checks compile and link status later, with KHR_parallel_shader_compile
+    // the driver compiles on its own threads while the caller keeps loading. programs may be used before
+    // they are resolved, the driver then blocks on them, but errors are only logged once resolved
+    class shader_batch_t {
+    public:
+        using self = shader_batch_t;
+
+        shader_batch_t() noexcept;
+        ~shader_batch_t() noexcept;
+
+        shader_batch_t(const self&) noexcept = delete;
+        auto operator =(const self&) noexcept -> self& = delete;
+        shader_batch_t(self&& other) noexcept;
+        auto operator =(self&& other) noexcept -> self&;
+
+        static auto create() noexcept -> self;
+
+        auto submit(
+            const fs::path& vertex,
+            const fs::path& fragment,
+            std::span<const shader_define_t> defines = {}) noexcept -> shader_t;
+        auto submit_compute(const fs::path& compute, std::span<const shader_define_t> defines = {}) noexcept -> shader_t;
+        auto submit_mesh(
+            const fs::path& task,
+            const fs::path& mesh,
+            const fs::path& fragment,
+            std::span<const shader_define_t> defines = {}) noexcept -> shader_t;
+
+        // resolves the programs the driver finished, true once nothing is pending
+        auto poll() noexcept -> bool;
+        // resolves everything, blocks on the driver
+        auto wait() noexcept -> void;
+
+        auto pending_count() const noexcept -> uint32;
+
+        auto swap(self& other) noexcept -> void;
+
+    private:
+        auto _push(pending_program_t&& pending) noexcept -> shader_t;
+
+        std::vector<pending_program_t> _pending;
+        bool _is_parallel = false;
+    };
+
+    // variants of the same stages specialized by define set, each one built once and kept.
+    // the order of the defines does not matter, returned references stay valid
+    class shader_permutations_t {
+    public:
+        using self = shader_permutations_t;
+
+        static auto create(const fs::path& vertex, const fs::path& fragment) noexcept -> self;
+        static auto create_compute(const fs::path& compute) noexcept -> self;
+
+        // builds the variant through the batch ahead of its first use
+        auto prepare(shader_batch_t& batch, std::span<const shader_define_t> defines) noexcept -> const shader_t&;
+        // builds the variant on a miss, stalls on the compiler
+        auto get(std::span<const shader_define_t> defines) noexcept -> const shader_t&;
+
+        auto count() const noexcept -> uint32;
+
+    private:
+        fs::path _vertex;
+        fs::path _fragment;
+        fs::path _compute;
+        std::unordered_map<uint64, shader_t> _permutations;
+    };
+
     template <uint64 N>
     auto shader_t::set(int32 location, const int32(&values)[N]) const noexcept -> const self& {
         switch (N) {
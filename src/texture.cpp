@@ -1,3 +1,7 @@
+#include <texture_encoder.hpp>
+#include <cpu_profiler.hpp>
+#include <upload_queue.hpp>
+#include <gl_state.hpp>
 #include <texture.hpp>
 
 #include <glad/gl.h>
@@ -6,12 +10,147 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <numeric>
 #include <cassert>
+#include <cstdio>
 
 namespace iris {
+    // streamed textures never drop the levels at or below this size
+    constexpr static auto streamed_tail_size = 128_u32;
+
+    static auto make_compressed_texture(uint32 width, uint32 height, uint32 levels, uint32 format, bool is_opaque) noexcept -> uint32 {
+        auto id = 0_u32;
+        glCreateTextures(GL_TEXTURE_2D, 1, &id);
+        if (!is_opaque) {
+            glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        } else {
+            glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        }
+        glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameterf(id, GL_TEXTURE_MAX_ANISOTROPY, 16.0f);
+        glTextureStorage2D(id, levels, format, width, height);
+        return id;
+    }
+
+    // uploads the source levels from "first_level" on into the levels of "id" starting at 0
+    static auto upload_compressed_levels(
+        uint32 id,
+        uint32 format,
+        uint32 width,
+        uint32 height,
+        uint32 first_level,
+        const uint8* data,
+        std::span<const uint64> offsets,
+        std::span<const uint64> sizes
+    ) noexcept -> void {
+        for (auto level = first_level; level < offsets.size(); ++level) {
+            const auto l_width = std::max(width >> level, 1_u32);
+            const auto l_height = std::max(height >> level, 1_u32);
+            glCompressedTextureSubImage2D(
+                id,
+                level - first_level,
+                0,
+                0,
+                l_width,
+                l_height,
+                format,
+                sizes[level],
+                data + offsets[level]);
+        }
+    }
+
+    struct texture_cache_header_t {
+        uint32 magic = 0;
+        uint32 format = 0;
+        uint64 key = 0;
+        uint32 width = 0;
+        uint32 height = 0;
+        uint32 levels = 0;
+        uint32 channels = 0;
+        uint32 is_opaque = 0;
+        uint32 is_compressed = 0;
+    };
+
+    static constexpr auto texture_cache_magic = 0x58545249_u32; // "IRTX"
+    // bumped whenever the encoder output changes, stale entries then miss
+    static constexpr auto texture_encoder_version = 1_u64;
+
+    static auto texture_cache_directory = fs::path("texture_cache");
+
+    // fnv-1a over the encoded file and everything that changes the output
+    static auto texture_cache_key(std::string_view file, texture_type_t type, bool is_compressed) noexcept -> uint64 {
+        auto hash = hash_fnv1a(file);
+        hash = hash_combine(hash, static_cast<uint64>(type));
+        hash = hash_combine(hash, is_compressed);
+        return hash_combine(hash, texture_encoder_version);
+    }
+
+    static auto texture_cache_path(uint64 key) noexcept -> fs::path {
+        auto name = std::array<char, 24>();
+        std::snprintf(name.data(), name.size(), "%016llx.tex", static_cast<unsigned long long>(key));
+        return texture_cache_directory / name.data();
+    }
+
+    static auto load_cached_texture(uint64 key, texture_cache_header_t& header, texture_encoding_t& encoding) noexcept -> bool {
+        if (texture_cache_directory.empty()) {
+            return false;
+        }
+        auto file = std::ifstream(texture_cache_path(key), std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != texture_cache_magic || header.key != key) {
+            return false;
+        }
+        encoding.width = header.width;
+        encoding.height = header.height;
+        encoding.format = header.format;
+        encoding.is_compressed = header.is_compressed;
+        encoding.level_sizes.resize(header.levels);
+        file.read(reinterpret_cast<char*>(encoding.level_sizes.data()), encoding.level_sizes.size() * sizeof(uint64));
+        if (!file) {
+            return false;
+        }
+        encoding.level_offsets.resize(header.levels);
+        std::exclusive_scan(encoding.level_sizes.begin(), encoding.level_sizes.end(), encoding.level_offsets.begin(), 0_u64);
+        encoding.data.resize(std::accumulate(encoding.level_sizes.begin(), encoding.level_sizes.end(), 0_u64));
+        file.read(reinterpret_cast<char*>(encoding.data.data()), encoding.data.size());
+        return static_cast<bool>(file);
+    }
+
+    static auto store_cached_texture(uint64 key, texture_cache_header_t header, const texture_encoding_t& encoding) noexcept -> void {
+        if (texture_cache_directory.empty()) {
+            return;
+        }
+        header.magic = texture_cache_magic;
+        header.key = key;
+        header.format = encoding.format;
+        header.width = encoding.width;
+        header.height = encoding.height;
+        header.levels = encoding.level_sizes.size();
+        header.is_compressed = encoding.is_compressed;
+
+        auto error = std::error_code();
+        fs::create_directories(texture_cache_directory, error);
+        auto file = std::ofstream(texture_cache_path(key), std::ios::binary);
+        if (!file) {
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(encoding.level_sizes.data()), encoding.level_sizes.size() * sizeof(uint64));
+        file.write(reinterpret_cast<const char*>(encoding.data.data()), encoding.data.size());
+    }
+
     texture_t::texture_t() noexcept = default;
 
     texture_t::~texture_t() noexcept {
+        _discard_pending();
+        gl_state::forget_texture(_id);
         glDeleteTextures(1, &_id);
     }
 
@@ -24,7 +163,8 @@ namespace iris {
         return *this;
     }
 
-    auto texture_t::create_compressed(std::span<const uint8> data, texture_type_t type, bool make_resident) noexcept -> self {
+    auto texture_t::create_compressed(std::span<const uint8> data, texture_type_t type, bool make_resident, bool is_streamed) noexcept -> self {
+        iris_cpu_zone("texture_t::create_compressed");
         auto texture = self();
         auto* ktx = (ktxTexture2*)(nullptr);
         auto result = ktxTexture2_CreateFromMemory(&data[0], data.size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktx);
@@ -87,68 +227,88 @@ namespace iris {
                 break;
         }
 
-        glCreateTextures(GL_TEXTURE_2D, 1, &texture._id);
-        if (!texture._is_opaque) {
-            glTextureParameteri(texture._id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTextureParameteri(texture._id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        } else {
-            glTextureParameteri(texture._id, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTextureParameteri(texture._id, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        }
-        glTextureParameteri(texture._id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTextureParameteri(texture._id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTextureParameterf(texture._id, GL_TEXTURE_MAX_ANISOTROPY, 16.0f);
-
-        glTextureStorage2D(texture._id, ktx->numLevels, format, width, height);
-        for (auto level = 0_u32; level < ktx->numLevels; ++level) {
-            auto offset = 0_u64;
-            ktxTexture_GetImageOffset(ktxTexture(ktx), level, 0, 0, &offset);
-            auto image_size = ktxTexture_GetImageSize(ktxTexture(ktx), level);
-            const auto l_width = std::max(width >> level, 1_u32);
-            const auto l_height = std::max(height >> level, 1_u32);
-            glCompressedTextureSubImage2D(
-                texture._id,
-                level,
-                0,
-                0,
-                l_width,
-                l_height,
-                format,
-                image_size,
-                ktx->pData + offset);
+        texture._format = format;
+        texture._levels = ktx->numLevels;
+        texture._level_offsets.resize(texture._levels);
+        texture._level_sizes.resize(texture._levels);
+        for (auto level = 0_u32; level < texture._levels; ++level) {
+            ktxTexture_GetImageOffset(ktxTexture(ktx), level, 0, 0, &texture._level_offsets[level]);
+            texture._level_sizes[level] = ktxTexture_GetImageSize(ktxTexture(ktx), level);
         }
 
-        if (make_resident) {
-            texture._handle = glGetTextureHandleARB(texture._id);
-            glMakeTextureHandleResidentARB(texture._handle);
-            texture._is_resident = true;
+        if (is_streamed) {
+            // the tail is the first level that fits, or the smallest one when nothing does
+            texture._tail_level = texture._levels - 1;
+            for (auto level = 0_u32; level < texture._levels; ++level) {
+                if (std::max(width >> level, height >> level) <= streamed_tail_size) {
+                    texture._tail_level = level;
+                    break;
+                }
+            }
+            texture._data.assign(ktx->pData, ktx->pData + ktx->dataSize);
+            texture._is_streamed = true;
+            texture._is_resident = make_resident;
+            texture._resident_level = texture._levels;
+            texture.stream(texture._tail_level);
+        } else {
+            texture._id = make_compressed_texture(width, height, texture._levels, format, texture._is_opaque);
+            upload_compressed_levels(texture._id, format, width, height, 0, ktx->pData, texture._level_offsets, texture._level_sizes);
+            if (make_resident) {
+                texture._handle = glGetTextureHandleARB(texture._id);
+                glMakeTextureHandleResidentARB(texture._handle);
+                texture._is_resident = true;
+            }
         }
         ktxTexture_Destroy(ktxTexture(ktx));
         return texture;
     }
 
-    auto texture_t::create(const fs::path& path, texture_type_t type, bool make_resident) noexcept -> self {
+    auto texture_t::create(const fs::path& path, texture_type_t type, bool make_resident, bool is_compressed) noexcept -> self {
+        iris_cpu_zone("texture_t::create");
         auto texture = self();
-        auto width = 0_i32;
-        auto height = 0_i32;
-        auto channels = 4_i32;
-        auto* data = stbi_load(path.string().c_str(), &width, &height, &channels, channels);
-        assert(data && "failed to load texture");
-
-        iris::log("loaded texture: \"", path.string(), "\" (", width, "x", height, ")");
-        texture._width = width;
-        texture._height = height;
-        texture._channels = channels;
-
-        if (channels == 4 && path.extension() == ".png") {
-            for (auto i = 0_i32; i < width * height * channels; i += channels) {
-                if (data[i + 3] != 255) {
-                    texture._is_opaque = false;
-                    break;
+        const auto file = whole_file(path);
+        assert(!file.empty() && "failed to load texture");
+        const auto key = texture_cache_key(file, type, is_compressed);
+
+        auto encoding = texture_encoding_t();
+        auto header = texture_cache_header_t();
+        if (!load_cached_texture(key, header, encoding)) {
+            auto width = 0_i32;
+            auto height = 0_i32;
+            auto channels = 4_i32;
+            auto* data = stbi_load_from_memory(
+                reinterpret_cast<const uint8*>(file.data()),
+                static_cast<int32>(file.size()),
+                &width,
+                &height,
+                &channels,
+                4);
+            assert(data && "failed to decode texture");
+
+            header.channels = channels;
+            header.is_opaque = true;
+            if (channels == 4 && path.extension() == ".png") {
+                for (auto i = 0_i32; i < width * height * 4; i += 4) {
+                    if (data[i + 3] != 255) {
+                        header.is_opaque = false;
+                        break;
+                    }
                 }
             }
+            encoding = encode_texture(std::span(data, width * height * 4), width, height, type, is_compressed);
+            stbi_image_free(data);
+            store_cached_texture(key, header, encoding);
         }
 
+        iris::log("loaded texture: \"", path.string(), "\" (", encoding.width, "x", encoding.height, ")");
+        texture._width = encoding.width;
+        texture._height = encoding.height;
+        texture._channels = header.channels;
+        texture._is_opaque = header.is_opaque;
+        texture._format = encoding.format;
+        texture._levels = encoding.level_sizes.size();
+        texture._level_sizes = encoding.level_sizes;
+
         glCreateTextures(GL_TEXTURE_2D, 1, &texture._id);
 
         if (!texture._is_opaque) {
@@ -162,12 +322,31 @@ namespace iris {
         glTextureParameteri(texture._id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTextureParameterf(texture._id, GL_TEXTURE_MAX_ANISOTROPY, 16.0f);
 
-        const auto internal_format = type != texture_type_t::non_linear_r8g8b8a8_unorm ? GL_RGBA8 : GL_SRGB8_ALPHA8;
-        const auto level_count = std::floor(std::log2(std::max(width, height))) + 1;
-        glTextureStorage2D(texture._id, level_count, internal_format, width, height);
-        glTextureSubImage2D(texture._id, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateTextureMipmap(texture._id);
-        stbi_image_free(data);
+        glTextureStorage2D(texture._id, texture._levels, encoding.format, encoding.width, encoding.height);
+        if (encoding.is_compressed) {
+            upload_compressed_levels(
+                texture._id,
+                encoding.format,
+                encoding.width,
+                encoding.height,
+                0,
+                encoding.data.data(),
+                encoding.level_offsets,
+                encoding.level_sizes);
+        } else {
+            for (auto level = 0_u32; level < texture._levels; ++level) {
+                glTextureSubImage2D(
+                    texture._id,
+                    level,
+                    0,
+                    0,
+                    std::max(encoding.width >> level, 1_u32),
+                    std::max(encoding.height >> level, 1_u32),
+                    GL_RGBA,
+                    GL_UNSIGNED_BYTE,
+                    encoding.data.data() + encoding.level_offsets[level]);
+            }
+        }
 
         if (make_resident) {
             texture._handle = glGetTextureHandleARB(texture._id);
@@ -177,6 +356,10 @@ namespace iris {
         return texture;
     }
 
+    auto texture_t::set_cache_directory(const fs::path& directory) noexcept -> void {
+        texture_cache_directory = directory;
+    }
+
     auto texture_t::id() const noexcept -> uint32 {
         return _id;
     }
@@ -201,8 +384,105 @@ namespace iris {
         return _is_opaque;
     }
 
+    auto texture_t::is_streamed() const noexcept -> bool {
+        return _is_streamed;
+    }
+
+    auto texture_t::levels() const noexcept -> uint32 {
+        return _levels;
+    }
+
+    auto texture_t::resident_level() const noexcept -> uint32 {
+        return _resident_level;
+    }
+
+    auto texture_t::target_level() const noexcept -> uint32 {
+        return _pending_id ? _pending_level : _resident_level;
+    }
+
+    auto texture_t::tail_level() const noexcept -> uint32 {
+        return _tail_level;
+    }
+
+    auto texture_t::size_bytes(uint32 level) const noexcept -> uint64 {
+        if (level >= _level_sizes.size()) {
+            return 0;
+        }
+        return std::accumulate(_level_sizes.begin() + level, _level_sizes.end(), 0_u64);
+    }
+
+    auto texture_t::stream(uint32 level, upload_queue_t* queue) noexcept -> void {
+        iris_cpu_zone("texture_t::stream");
+        assert(_is_streamed && "texture is not streamed");
+        level = std::min(level, _levels - 1);
+        if (level == target_level()) {
+            return;
+        }
+        _discard_pending();
+        if (level == _resident_level) {
+            return;
+        }
+        // GL cannot grow or shrink immutable storage, the new range goes into a new texture and the old one is released
+        const auto width = std::max(_width >> level, 1_u32);
+        const auto height = std::max(_height >> level, 1_u32);
+        const auto id = make_compressed_texture(width, height, _levels - level, _format, _is_opaque);
+        if (!queue) {
+            upload_compressed_levels(id, _format, _width, _height, level, _data.data(), _level_offsets, _level_sizes);
+            _replace(id, level);
+            return;
+        }
+        for (auto source = level; source < _levels; ++source) {
+            _pending_ticket = queue->upload_compressed(
+                id,
+                source - level,
+                std::max(_width >> source, 1_u32),
+                std::max(_height >> source, 1_u32),
+                _format,
+                std::span(_data.data() + _level_offsets[source], _level_sizes[source]));
+        }
+        _pending_id = id;
+        _pending_level = level;
+        _upload_queue = queue;
+    }
+
+    auto texture_t::resolve() noexcept -> bool {
+        if (!_pending_id || !_upload_queue->is_complete(_pending_ticket)) {
+            return false;
+        }
+        _replace(_pending_id, _pending_level);
+        _pending_id = 0;
+        _upload_queue = nullptr;
+        return true;
+    }
+
+    auto texture_t::_replace(uint32 id, uint32 level) noexcept -> void {
+        auto handle = 0_u64;
+        if (_is_resident) {
+            handle = glGetTextureHandleARB(id);
+            glMakeTextureHandleResidentARB(handle);
+            if (_handle) {
+                glMakeTextureHandleNonResidentARB(_handle);
+            }
+        }
+        gl_state::forget_texture(_id);
+        glDeleteTextures(1, &_id);
+        _id = id;
+        _handle = handle;
+        _resident_level = level;
+    }
+
+    auto texture_t::_discard_pending() noexcept -> void {
+        if (!_pending_id) {
+            return;
+        }
+        _upload_queue->cancel(_pending_id);
+        glDeleteTextures(1, &_pending_id);
+        _pending_id = 0;
+        _upload_queue = nullptr;
+    }
+
     auto texture_t::bind(uint32 index) const noexcept -> void {
-        glBindTextureUnit(index, _id);
+        gl_state::bind_texture_unit(index, _id);
     }
 
     auto texture_t::swap(self& other) noexcept -> void {
@@ -211,8 +491,20 @@ namespace iris {
         swap(other._width, _width);
         swap(other._height, _height);
         swap(other._channels, _channels);
+        swap(other._format, _format);
+        swap(other._levels, _levels);
+        swap(other._resident_level, _resident_level);
+        swap(other._tail_level, _tail_level);
         swap(other._handle, _handle);
+        swap(other._pending_id, _pending_id);
+        swap(other._pending_level, _pending_level);
+        swap(other._pending_ticket, _pending_ticket);
+        swap(other._upload_queue, _upload_queue);
+        swap(other._data, _data);
+        swap(other._level_offsets, _level_offsets);
+        swap(other._level_sizes, _level_sizes);
         swap(other._is_opaque, _is_opaque);
         swap(other._is_resident, _is_resident);
+        swap(other._is_streamed, _is_streamed);
     }
 } // namespace iris
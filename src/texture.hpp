@@ -2,9 +2,12 @@
 
 #include <utilities.hpp>
 
+#include <vector>
 #include <span>
 
 namespace iris {
+    class upload_queue_t;
+
     enum class texture_type_t : uint32 {
         linear_r8g8_unorm,
         linear_r8g8b8_unorm,
@@ -24,8 +27,12 @@ namespace iris {
         texture_t(self&& other) noexcept;
         auto operator =(self&& other) noexcept -> self&;
 
-        static auto create_compressed(std::span<const uint8> data, texture_type_t type, bool make_resident = true) noexcept -> self;
-        static auto create(const fs::path& path, texture_type_t type, bool make_resident = true) noexcept -> self;
+        // a streamed texture keeps its transcoded levels in system memory and only starts with the small tail mips
+        static auto create_compressed(std::span<const uint8> data, texture_type_t type, bool make_resident = true, bool is_streamed = false) noexcept -> self;
+        // mips are built on the CPU and optionally block compressed, the result is cached on disk by file contents
+        static auto create(const fs::path& path, texture_type_t type, bool make_resident = true, bool is_compressed = false) noexcept -> self;
+        // empty disables the cache
+        static auto set_cache_directory(const fs::path& directory) noexcept -> void;
 
         auto id() const noexcept -> uint32;
         auto width() const noexcept -> uint32;
@@ -33,20 +40,56 @@ namespace iris {
         auto channels() const noexcept -> uint32;
         auto handle() const noexcept -> uint64;
         auto is_opaque() const noexcept -> bool;
+        auto is_streamed() const noexcept -> bool;
+
+        auto levels() const noexcept -> uint32;
+        // finest level currently in video memory, width() and height() stay the size of level 0
+        auto resident_level() const noexcept -> uint32;
+        // resident level once the pending upload completes
+        auto target_level() const noexcept -> uint32;
+        // coarsest level a streamed texture ever drops to
+        auto tail_level() const noexcept -> uint32;
+        // video memory taken by the levels from "level" down to the smallest one
+        auto size_bytes(uint32 level) const noexcept -> uint64;
+
+        // reallocates with "level" as the finest level, the handle changes and has to be fetched again. with a queue
+        // the levels upload over the next frames and the current texture stays in use until resolve() swaps them
+        auto stream(uint32 level, upload_queue_t* queue = nullptr) noexcept -> void;
+        // true when a pending stream finished and the texture now has its target level
+        auto resolve() noexcept -> bool;
 
         auto bind(uint32 index) const noexcept -> void;
 
         auto swap(self& other) noexcept -> void;
 
     private:
+        auto _replace(uint32 id, uint32 level) noexcept -> void;
+        auto _discard_pending() noexcept -> void;
+
         uint32 _id = 0;
         uint32 _width = 0;
         uint32 _height = 0;
         uint32 _channels = 0;
+        uint32 _format = 0;
+        uint32 _levels = 1;
+        uint32 _resident_level = 0;
+        uint32 _tail_level = 0;
 
         uint64 _handle = 0;
 
+        // texture being filled by the upload queue, swapped in by resolve()
+        uint32 _pending_id = 0;
+        uint32 _pending_level = 0;
+        uint64 _pending_ticket = 0;
+        upload_queue_t* _upload_queue = nullptr;
+
+        // transcoded levels, only kept for streamed textures
+        std::vector<uint8> _data;
+        std::vector<uint64> _level_offsets;
+        std::vector<uint64> _level_sizes;
+
         bool _is_opaque = true;
         bool _is_resident = false;
+        bool _is_streamed = false;
     };
 } // namespace iris
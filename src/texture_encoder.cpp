@@ -0,0 +1,509 @@
+#include <cpu_profiler.hpp>
+#include <texture_encoder.hpp>
+
+#include <glad/gl.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define IRIS_TEXTURE_ENCODER_SSE2
+    #include <emmintrin.h>
+#endif
+
+#include <functional>
+#include <algorithm>
+#include <cassert>
+#include <thread>
+#include <limits>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace iris {
+    // one texel in linear space, exactly one SSE register
+    struct alignas(16) texel_t {
+        float32 r = 0.0f;
+        float32 g = 0.0f;
+        float32 b = 0.0f;
+        float32 a = 0.0f;
+    };
+
+    using block_t = std::array<std::array<uint8, 4>, 16>;
+
+    enum class block_format_t : uint32 {
+        none,
+        bc1,
+        bc3,
+        bc5,
+        bc7,
+    };
+
+    // rows below this are not worth a thread
+    constexpr static auto parallel_threshold = 32_u32;
+
+    // splits [0, count) in one contiguous range per core, the calling thread takes the first one
+    static auto parallel_for(uint32 count, const std::function<void(uint32, uint32)>& task) noexcept -> void {
+        const auto workers = std::min(std::max(std::thread::hardware_concurrency(), 1_u32), count);
+        if (workers <= 1 || count < parallel_threshold) {
+            task(0, count);
+            return;
+        }
+        const auto chunk = (count + workers - 1) / workers;
+        auto threads = std::vector<std::jthread>();
+        threads.reserve(workers - 1);
+        for (auto begin = chunk; begin < count; begin += chunk) {
+            threads.emplace_back(task, begin, std::min(begin + chunk, count));
+        }
+        task(0, std::min(chunk, count));
+    }
+
+    static auto srgb_to_linear(uint8 value) noexcept -> float32 {
+        static const auto table = [] {
+            auto table = std::array<float32, 256>();
+            for (auto i = 0_u32; i < table.size(); ++i) {
+                const auto c = i / 255.0f;
+                table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return table;
+        }();
+        return table[value];
+    }
+
+    static auto linear_to_srgb(float32 value) noexcept -> uint8 {
+        // 4096 steps keep the darkest sRGB codes apart
+        static const auto table = [] {
+            auto table = std::array<uint8, 4096>();
+            for (auto i = 0_u32; i < table.size(); ++i) {
+                const auto c = i / 4095.0f;
+                const auto s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                table[i] = static_cast<uint8>(std::clamp(s, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+            return table;
+        }();
+        return table[static_cast<uint32>(std::clamp(value, 0.0f, 1.0f) * 4095.0f + 0.5f)];
+    }
+
+    static auto unorm_to_uint8(float32 value) noexcept -> uint8 {
+        return static_cast<uint8>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    static auto average(const texel_t& a, const texel_t& b, const texel_t& c, const texel_t& d, texel_t& output) noexcept -> void {
+#if defined(IRIS_TEXTURE_ENCODER_SSE2)
+        const auto sum = _mm_add_ps(
+            _mm_add_ps(_mm_load_ps(&a.r), _mm_load_ps(&b.r)),
+            _mm_add_ps(_mm_load_ps(&c.r), _mm_load_ps(&d.r)));
+        _mm_store_ps(&output.r, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+        output.r = (a.r + b.r + c.r + d.r) * 0.25f;
+        output.g = (a.g + b.g + c.g + d.g) * 0.25f;
+        output.b = (a.b + b.b + c.b + d.b) * 0.25f;
+        output.a = (a.a + b.a + c.a + d.a) * 0.25f;
+#endif
+    }
+
+    // 2x2 box, odd edges repeat their last row or column
+    static auto downsample(std::span<const texel_t> source, uint32 width, uint32 height, std::span<texel_t> output) noexcept -> void {
+        const auto l_width = std::max(width >> 1, 1_u32);
+        const auto l_height = std::max(height >> 1, 1_u32);
+        parallel_for(l_height, [&](uint32 begin, uint32 end) {
+            for (auto y = begin; y < end; ++y) {
+                const auto* row_0 = &source[std::min(2 * y, height - 1) * width];
+                const auto* row_1 = &source[std::min(2 * y + 1, height - 1) * width];
+                for (auto x = 0_u32; x < l_width; ++x) {
+                    const auto x_0 = std::min(2 * x, width - 1);
+                    const auto x_1 = std::min(2 * x + 1, width - 1);
+                    average(row_0[x_0], row_0[x_1], row_1[x_0], row_1[x_1], output[y * l_width + x]);
+                }
+            }
+        });
+    }
+
+    static auto rgb565(const std::array<float32, 3>& color) noexcept -> uint16 {
+        const auto r = static_cast<uint32>(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+        const auto g = static_cast<uint32>(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+        const auto b = static_cast<uint32>(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16>((r << 11) | (g << 5) | b);
+    }
+
+    static auto expand565(uint16 color) noexcept -> std::array<int32, 3> {
+        const auto r = (color >> 11) & 31;
+        const auto g = (color >> 5) & 63;
+        const auto b = color & 31;
+        return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+    }
+
+    // bounding box diagonal picked by the sign of the covariance, inset by a sixteenth
+    static auto encode_bc1(const block_t& block, uint8* output) noexcept -> void {
+        auto min = std::array<float32, 3> { 255.0f, 255.0f, 255.0f };
+        auto max = std::array<float32, 3> { 0.0f, 0.0f, 0.0f };
+        auto mean = std::array<float32, 3>();
+        for (const auto& texel : block) {
+            for (auto c = 0_u32; c < 3; ++c) {
+                min[c] = std::min(min[c], static_cast<float32>(texel[c]));
+                max[c] = std::max(max[c], static_cast<float32>(texel[c]));
+                mean[c] += texel[c] / 16.0f;
+            }
+        }
+        auto covariance_rg = 0.0f;
+        auto covariance_gb = 0.0f;
+        for (const auto& texel : block) {
+            covariance_rg += (texel[0] - mean[0]) * (texel[1] - mean[1]);
+            covariance_gb += (texel[2] - mean[2]) * (texel[1] - mean[1]);
+        }
+        if (covariance_rg < 0.0f) {
+            std::swap(min[0], max[0]);
+        }
+        if (covariance_gb < 0.0f) {
+            std::swap(min[2], max[2]);
+        }
+        for (auto c = 0_u32; c < 3; ++c) {
+            const auto inset = (max[c] - min[c]) / 16.0f;
+            min[c] += inset;
+            max[c] -= inset;
+        }
+
+        auto color_0 = rgb565(max);
+        auto color_1 = rgb565(min);
+        // color_0 > color_1 selects the four color mode
+        if (color_0 < color_1) {
+            std::swap(color_0, color_1);
+        }
+        auto indices = 0_u32;
+        if (color_0 != color_1) {
+            const auto e_0 = expand565(color_0);
+            const auto e_1 = expand565(color_1);
+            auto palette = std::array<std::array<int32, 3>, 4>();
+            for (auto c = 0_u32; c < 3; ++c) {
+                palette[0][c] = e_0[c];
+                palette[1][c] = e_1[c];
+                palette[2][c] = (2 * e_0[c] + e_1[c]) / 3;
+                palette[3][c] = (e_0[c] + 2 * e_1[c]) / 3;
+            }
+            for (auto i = 0_u32; i < block.size(); ++i) {
+                auto best = 0_u32;
+                auto best_error = std::numeric_limits<int32>::max();
+                for (auto p = 0_u32; p < palette.size(); ++p) {
+                    auto error = 0_i32;
+                    for (auto c = 0_u32; c < 3; ++c) {
+                        const auto d = block[i][c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < best_error) {
+                        best = p;
+                        best_error = error;
+                    }
+                }
+                indices |= best << (2 * i);
+            }
+        }
+        std::memcpy(output, &color_0, sizeof(color_0));
+        std::memcpy(output + 2, &color_1, sizeof(color_1));
+        std::memcpy(output + 4, &indices, sizeof(indices));
+    }
+
+    // single channel, always in the eight value mode
+    static auto encode_bc4(const block_t& block, uint32 channel, uint8* output) noexcept -> void {
+        auto min = 255_u32;
+        auto max = 0_u32;
+        for (const auto& texel : block) {
+            min = std::min<uint32>(min, texel[channel]);
+            max = std::max<uint32>(max, texel[channel]);
+        }
+        auto indices = 0_u64;
+        if (min != max) {
+            auto palette = std::array<int32, 8>();
+            palette[0] = max;
+            palette[1] = min;
+            for (auto i = 2_u32; i < palette.size(); ++i) {
+                palette[i] = ((8 - i) * max + (i - 1) * min) / 7;
+            }
+            for (auto i = 0_u32; i < block.size(); ++i) {
+                auto best = 0_u64;
+                auto best_error = std::numeric_limits<int32>::max();
+                for (auto p = 0_u32; p < palette.size(); ++p) {
+                    const auto error = std::abs(block[i][channel] - palette[p]);
+                    if (error < best_error) {
+                        best = p;
+                        best_error = error;
+                    }
+                }
+                indices |= best << (3 * i);
+            }
+        }
+        output[0] = static_cast<uint8>(max);
+        output[1] = static_cast<uint8>(min);
+        for (auto i = 0_u32; i < 6; ++i) {
+            output[2 + i] = static_cast<uint8>(indices >> (8 * i));
+        }
+    }
+
+    struct bit_writer_t {
+        std::array<uint64, 2> bits = {};
+        uint32 offset = 0;
+
+        auto write(uint64 value, uint32 count) noexcept -> void {
+            for (auto i = 0_u32; i < count; ++i, ++offset) {
+                bits[offset / 64] |= ((value >> i) & 1) << (offset % 64);
+            }
+        }
+    };
+
+    // mode 6: one subset, 7.7.7.7 endpoints with a p-bit each and 4-bit indices, fitted along the principal axis
+    static auto encode_bc7(const block_t& block, uint8* output) noexcept -> void {
+        constexpr auto weights = std::to_array<int32>({ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 });
+        auto mean = std::array<float32, 4>();
+        for (const auto& texel : block) {
+            for (auto c = 0_u32; c < 4; ++c) {
+                mean[c] += texel[c] / 16.0f;
+            }
+        }
+        auto covariance = std::array<std::array<float32, 4>, 4>();
+        for (const auto& texel : block) {
+            for (auto i = 0_u32; i < 4; ++i) {
+                for (auto j = 0_u32; j < 4; ++j) {
+                    covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+                }
+            }
+        }
+        auto axis = std::array<float32, 4> { 1.0f, 1.0f, 1.0f, 1.0f };
+        for (auto iteration = 0_u32; iteration < 8; ++iteration) {
+            auto next = std::array<float32, 4>();
+            for (auto i = 0_u32; i < 4; ++i) {
+                for (auto j = 0_u32; j < 4; ++j) {
+                    next[i] += covariance[i][j] * axis[j];
+                }
+            }
+            const auto length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+            if (length < 1e-6f) {
+                break;
+            }
+            for (auto i = 0_u32; i < 4; ++i) {
+                axis[i] = next[i] / length;
+            }
+        }
+        auto t_min = std::numeric_limits<float32>::max();
+        auto t_max = std::numeric_limits<float32>::lowest();
+        for (const auto& texel : block) {
+            auto t = 0.0f;
+            for (auto c = 0_u32; c < 4; ++c) {
+                t += (texel[c] - mean[c]) * axis[c];
+            }
+            t_min = std::min(t_min, t);
+            t_max = std::max(t_max, t);
+        }
+
+        // the p-bit is the shared lowest bit of all four channels, keep the one closer to the fitted endpoint
+        auto endpoints = std::array<std::array<int32, 4>, 2>();
+        auto quantized = std::array<std::array<uint32, 4>, 2>();
+        auto p_bits = std::array<uint32, 2>();
+        for (auto e = 0_u32; e < 2; ++e) {
+            const auto t = e == 0 ? t_min : t_max;
+            auto best_error = std::numeric_limits<float32>::max();
+            for (auto p = 0_u32; p < 2; ++p) {
+                auto error = 0.0f;
+                auto candidate = std::array<uint32, 4>();
+                for (auto c = 0_u32; c < 4; ++c) {
+                    const auto value = std::clamp(mean[c] + t * axis[c], 0.0f, 255.0f);
+                    candidate[c] = static_cast<uint32>(std::clamp(std::round((value - p) / 2.0f), 0.0f, 127.0f));
+                    const auto d = static_cast<float32>(candidate[c] * 2 + p) - value;
+                    error += d * d;
+                }
+                if (error < best_error) {
+                    best_error = error;
+                    quantized[e] = candidate;
+                    p_bits[e] = p;
+                }
+            }
+            for (auto c = 0_u32; c < 4; ++c) {
+                endpoints[e][c] = static_cast<int32>(quantized[e][c] * 2 + p_bits[e]);
+            }
+        }
+
+        auto indices = std::array<uint32, 16>();
+        for (auto i = 0_u32; i < block.size(); ++i) {
+            auto best_error = std::numeric_limits<int32>::max();
+            for (auto w = 0_u32; w < weights.size(); ++w) {
+                auto error = 0_i32;
+                for (auto c = 0_u32; c < 4; ++c) {
+                    const auto value = ((64 - weights[w]) * endpoints[0][c] + weights[w] * endpoints[1][c] + 32) >> 6;
+                    const auto d = block[i][c] - value;
+                    error += d * d;
+                }
+                if (error < best_error) {
+                    best_error = error;
+                    indices[i] = w;
+                }
+            }
+        }
+        // the top bit of the first index is implied zero
+        if (indices[0] & 8) {
+            std::swap(quantized[0], quantized[1]);
+            std::swap(p_bits[0], p_bits[1]);
+            for (auto& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        auto writer = bit_writer_t();
+        writer.write(1 << 6, 7);
+        for (auto c = 0_u32; c < 4; ++c) {
+            writer.write(quantized[0][c], 7);
+            writer.write(quantized[1][c], 7);
+        }
+        writer.write(p_bits[0], 1);
+        writer.write(p_bits[1], 1);
+        writer.write(indices[0], 3);
+        for (auto i = 1_u32; i < indices.size(); ++i) {
+            writer.write(indices[i], 4);
+        }
+        std::memcpy(output, writer.bits.data(), sizeof(writer.bits));
+    }
+
+    static auto block_size(block_format_t format) noexcept -> uint32 {
+        return format == block_format_t::bc1 ? 8 : 16;
+    }
+
+    static auto encode_block(const block_t& block, block_format_t format, uint8* output) noexcept -> void {
+        switch (format) {
+            case block_format_t::bc1:
+                encode_bc1(block, output);
+                break;
+
+            case block_format_t::bc3:
+                encode_bc4(block, 3, output);
+                encode_bc1(block, output + 8);
+                break;
+
+            case block_format_t::bc5:
+                encode_bc4(block, 0, output);
+                encode_bc4(block, 1, output + 8);
+                break;
+
+            case block_format_t::bc7:
+                encode_bc7(block, output);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    // appends one level, rgba8 texels or blocks
+    static auto store_level(
+        std::span<const texel_t> level,
+        uint32 width,
+        uint32 height,
+        bool is_srgb,
+        block_format_t format,
+        texture_encoding_t& encoding
+    ) noexcept -> void {
+        auto texels = std::vector<uint8>(static_cast<uint64>(width) * height * 4);
+        parallel_for(height, [&](uint32 begin, uint32 end) {
+            for (auto i = begin * width; i < end * width; ++i) {
+                const auto& texel = level[i];
+                texels[i * 4 + 0] = is_srgb ? linear_to_srgb(texel.r) : unorm_to_uint8(texel.r);
+                texels[i * 4 + 1] = is_srgb ? linear_to_srgb(texel.g) : unorm_to_uint8(texel.g);
+                texels[i * 4 + 2] = is_srgb ? linear_to_srgb(texel.b) : unorm_to_uint8(texel.b);
+                texels[i * 4 + 3] = unorm_to_uint8(texel.a);
+            }
+        });
+
+        const auto offset = encoding.data.size();
+        encoding.level_offsets.emplace_back(offset);
+        if (format == block_format_t::none) {
+            encoding.level_sizes.emplace_back(texels.size());
+            encoding.data.insert(encoding.data.end(), texels.begin(), texels.end());
+            return;
+        }
+
+        const auto blocks_x = (width + 3) / 4;
+        const auto blocks_y = (height + 3) / 4;
+        const auto size = static_cast<uint64>(blocks_x) * blocks_y * block_size(format);
+        encoding.level_sizes.emplace_back(size);
+        encoding.data.resize(offset + size);
+        parallel_for(blocks_y, [&](uint32 begin, uint32 end) {
+            auto block = block_t();
+            for (auto by = begin; by < end; ++by) {
+                for (auto bx = 0_u32; bx < blocks_x; ++bx) {
+                    // blocks past the edge repeat the last texel
+                    for (auto i = 0_u32; i < 16; ++i) {
+                        const auto x = std::min(bx * 4 + i % 4, width - 1);
+                        const auto y = std::min(by * 4 + i / 4, height - 1);
+                        std::memcpy(block[i].data(), &texels[(y * width + x) * 4], 4);
+                    }
+                    encode_block(block, format, &encoding.data[offset + (by * blocks_x + bx) * block_size(format)]);
+                }
+            }
+        });
+    }
+
+    auto encode_texture(
+        std::span<const uint8> texels,
+        uint32 width,
+        uint32 height,
+        texture_type_t type,
+        bool is_compressed
+    ) noexcept -> texture_encoding_t {
+        iris_cpu_zone("encode_texture");
+        assert(texels.size() >= static_cast<uint64>(width) * height * 4 && "expected rgba8 texels");
+        const auto is_srgb = type == texture_type_t::non_linear_r8g8b8a8_unorm;
+        auto format = block_format_t::none;
+        auto encoding = texture_encoding_t();
+        encoding.width = width;
+        encoding.height = height;
+        encoding.is_compressed = is_compressed;
+        if (is_compressed) {
+            switch (type) {
+                case texture_type_t::linear_r8g8_unorm:
+                    format = block_format_t::bc5;
+                    encoding.format = GL_COMPRESSED_RG_RGTC2;
+                    break;
+
+                case texture_type_t::linear_r8g8b8_unorm:
+                    format = block_format_t::bc1;
+                    encoding.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+                    break;
+
+                case texture_type_t::linear_r8g8b8a8_unorm:
+                    format = block_format_t::bc3;
+                    encoding.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+                    break;
+
+                case texture_type_t::non_linear_r8g8b8a8_unorm:
+                    format = block_format_t::bc7;
+                    encoding.format = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+                    break;
+            }
+        } else {
+            encoding.format = is_srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        }
+
+        auto level = std::vector<texel_t>(static_cast<uint64>(width) * height);
+        parallel_for(height, [&](uint32 begin, uint32 end) {
+            for (auto i = begin * width; i < end * width; ++i) {
+                const auto* texel = &texels[i * 4];
+                level[i] = {
+                    is_srgb ? srgb_to_linear(texel[0]) : texel[0] / 255.0f,
+                    is_srgb ? srgb_to_linear(texel[1]) : texel[1] / 255.0f,
+                    is_srgb ? srgb_to_linear(texel[2]) : texel[2] / 255.0f,
+                    texel[3] / 255.0f,
+                };
+            }
+        });
+
+        const auto levels = static_cast<uint32>(std::floor(std::log2(std::max(width, height)))) + 1;
+        auto next = std::vector<texel_t>();
+        auto l_width = width;
+        auto l_height = height;
+        for (auto i = 0_u32; i < levels; ++i) {
+            store_level(level, l_width, l_height, is_srgb, format, encoding);
+            if (i + 1 == levels) {
+                break;
+            }
+            next.resize(static_cast<uint64>(std::max(l_width >> 1, 1_u32)) * std::max(l_height >> 1, 1_u32));
+            downsample(level, l_width, l_height, next);
+            level.swap(next);
+            l_width = std::max(l_width >> 1, 1_u32);
+            l_height = std::max(l_height >> 1, 1_u32);
+        }
+        return encoding;
+    }
+} // namespace iris
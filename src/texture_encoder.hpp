@@ -0,0 +1,31 @@
+#pragma once
+
+#include <utilities.hpp>
+#include <texture.hpp>
+
+#include <vector>
+#include <span>
+
+namespace iris {
+    // a full mip chain ready for glTextureStorage2D, levels are tightly packed one after the other
+    struct texture_encoding_t {
+        uint32 width = 0;
+        uint32 height = 0;
+        // GL internal format
+        uint32 format = 0;
+        bool is_compressed = false;
+        std::vector<uint8> data;
+        std::vector<uint64> level_offsets;
+        std::vector<uint64> level_sizes;
+    };
+
+    // builds the mip chain of tightly packed rgba8 texels on all cores, filtering in linear space for the
+    // non linear type. compression picks the block format create_compressed transcodes the same type to:
+    // BC5 for two channels, BC1 for three, BC3 for linear four and BC7 (mode 6 only) for sRGB four
+    auto encode_texture(
+        std::span<const uint8> texels,
+        uint32 width,
+        uint32 height,
+        texture_type_t type,
+        bool is_compressed) noexcept -> texture_encoding_t;
+} // namespace iris
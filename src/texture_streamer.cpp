@@ -0,0 +1,163 @@
+#include <cpu_profiler.hpp>
+#include <texture_streamer.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace iris {
+    texture_streamer_t::texture_streamer_t() noexcept = default;
+
+    texture_streamer_t::~texture_streamer_t() noexcept = default;
+
+    texture_streamer_t::texture_streamer_t(self&& other) noexcept {
+        swap(other);
+    }
+
+    auto texture_streamer_t::operator =(self&& other) noexcept -> self& {
+        self(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    auto texture_streamer_t::create(uint64 budget, uint64 upload_budget, upload_queue_t* queue) noexcept -> self {
+        auto streamer = self();
+        streamer._queue = queue;
+        streamer._budget = budget;
+        streamer._upload_budget = upload_budget;
+        streamer._stats.budget = budget;
+        return streamer;
+    }
+
+    auto texture_streamer_t::add(texture_t& texture) noexcept -> uint32 {
+        assert(texture.is_streamed() && "texture was not created for streaming");
+        const auto index = static_cast<uint32>(_entries.size());
+        const auto& entry = _entries.emplace_back(_entry_t {
+            .texture = &texture,
+            .requested = texture.tail_level(),
+            .last_used = 0
+        });
+        _resident_bytes += _resident_size(entry);
+        _stats.textures = _entries.size();
+        _stats.full_bytes += texture.size_bytes(0);
+        return index;
+    }
+
+    auto texture_streamer_t::request(uint32 index, float32 size) noexcept -> void {
+        assert(index < _entries.size() && "texture is not streamed by this streamer");
+        auto& entry = _entries[index];
+        const auto& texture = *entry.texture;
+        auto level = texture.tail_level();
+        if (size >= 1.0f) {
+            // one texel per pixel across the larger side
+            const auto extent = static_cast<float32>(std::max(texture.width(), texture.height()));
+            const auto ideal = std::floor(std::log2(extent / size));
+            level = static_cast<uint32>(std::clamp(ideal, 0.0f, static_cast<float32>(level)));
+        }
+        entry.requested = std::min(entry.requested, level);
+        entry.last_used = _frame;
+    }
+
+    auto texture_streamer_t::update() noexcept -> void {
+        iris_cpu_zone("texture_streamer_t::update");
+        _stats.uploads = 0;
+        _stats.evictions = 0;
+        _stats.uploaded_bytes = 0;
+        for (auto& entry : _entries) {
+            entry.texture->resolve();
+        }
+        // a lowered budget only has to be met by textures nobody needs
+        _make_room(0, -1);
+
+        auto missing = std::vector<uint32>();
+        for (auto i = 0_u32; i < _entries.size(); ++i) {
+            const auto& entry = _entries[i];
+            if (entry.requested < entry.texture->target_level()) {
+                missing.emplace_back(i);
+            }
+        }
+        // the textures furthest from what they should look like go first
+        std::ranges::stable_sort(missing, [this](uint32 a, uint32 b) {
+            const auto& entry_a = _entries[a];
+            const auto& entry_b = _entries[b];
+            return entry_a.texture->target_level() - entry_a.requested > entry_b.texture->target_level() - entry_b.requested;
+        });
+
+        for (const auto index : missing) {
+            auto& texture = *_entries[index].texture;
+            const auto resident = texture.target_level();
+            // settle for a coarser level when the finest one does not fit
+            for (auto level = _entries[index].requested; level < resident; ++level) {
+                const auto size = texture.size_bytes(level);
+                const auto growth = size - texture.size_bytes(resident);
+                if (_stats.uploaded_bytes + size > _upload_budget || !_make_room(growth, index)) {
+                    continue;
+                }
+                texture.stream(level, _queue);
+                _resident_bytes += growth;
+                _stats.uploaded_bytes += size;
+                _stats.uploads++;
+                break;
+            }
+        }
+
+        _stats.resident_bytes = 0;
+        for (auto& entry : _entries) {
+            _stats.resident_bytes += entry.texture->size_bytes(entry.texture->target_level());
+            entry.requested = entry.texture->tail_level();
+        }
+        _frame++;
+    }
+
+    auto texture_streamer_t::set_budget(uint64 budget) noexcept -> void {
+        _budget = budget;
+        _stats.budget = budget;
+    }
+
+    auto texture_streamer_t::stats() const noexcept -> texture_streamer_stats_t {
+        return _stats;
+    }
+
+    auto texture_streamer_t::swap(self& other) noexcept -> void {
+        using std::swap;
+        swap(_entries, other._entries);
+        swap(_queue, other._queue);
+        swap(_budget, other._budget);
+        swap(_upload_budget, other._upload_budget);
+        swap(_resident_bytes, other._resident_bytes);
+        swap(_frame, other._frame);
+        swap(_stats, other._stats);
+    }
+
+    auto texture_streamer_t::_make_room(uint64 size, uint32 keep) noexcept -> bool {
+        while (_resident_bytes + size > _budget) {
+            // textures requested this frame only give up the levels finer than what they asked for
+            auto* victim = (_entry_t*)(nullptr);
+            auto victim_level = 0_u32;
+            for (auto i = 0_u32; i < _entries.size(); ++i) {
+                auto& entry = _entries[i];
+                const auto level = entry.last_used == _frame ? entry.requested : entry.texture->tail_level();
+                if (i == keep || entry.texture->target_level() >= level) {
+                    continue;
+                }
+                if (!victim || entry.last_used < victim->last_used) {
+                    victim = &entry;
+                    victim_level = level;
+                }
+            }
+            if (!victim) {
+                return false;
+            }
+            const auto freed = victim->texture->size_bytes(victim->texture->target_level()) - victim->texture->size_bytes(victim_level);
+            victim->texture->stream(victim_level, _queue);
+            _resident_bytes -= freed;
+            _stats.evictions++;
+        }
+        return true;
+    }
+
+    auto texture_streamer_t::_resident_size(const _entry_t& entry) const noexcept -> uint64 {
+        const auto& texture = *entry.texture;
+        const auto tail = texture.size_bytes(texture.tail_level());
+        return texture.size_bytes(texture.target_level()) - tail;
+    }
+} // namespace iris
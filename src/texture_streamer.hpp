@@ -0,0 +1,74 @@
+#pragma once
+
+#include <utilities.hpp>
+#include <texture.hpp>
+#include <upload_queue.hpp>
+
+#include <vector>
+
+namespace iris {
+    struct texture_streamer_stats_t {
+        uint32 textures = 0;
+        // levels streamed in and textures dropped by the last update()
+        uint32 uploads = 0;
+        uint32 evictions = 0;
+        uint64 resident_bytes = 0;
+        uint64 uploaded_bytes = 0;
+        // what every texture would take with all of its levels resident
+        uint64 full_bytes = 0;
+        uint64 budget = 0;
+    };
+
+    // keeps the resident mips of streamed textures within a byte budget. textures start at their tail levels, every
+    // frame the caller requests the on screen size a texture is drawn at and update() streams in the missing levels,
+    // making room by dropping the least recently requested textures back down. the tails never count against the
+    // budget, they are always resident
+    class texture_streamer_t {
+    public:
+        using self = texture_streamer_t;
+
+        texture_streamer_t() noexcept;
+        ~texture_streamer_t() noexcept;
+
+        texture_streamer_t(const self&) noexcept = delete;
+        auto operator =(const self&) noexcept -> self& = delete;
+        texture_streamer_t(self&& other) noexcept;
+        auto operator =(self&& other) noexcept -> self&;
+
+        // "upload_budget" caps the bytes streamed in by a single update() so a camera cut does not stall a frame.
+        // with a queue levels arrive over the next frames and count against the budget from the moment they are queued
+        static auto create(uint64 budget, uint64 upload_budget = 64_MiB, upload_queue_t* queue = nullptr) noexcept -> self;
+
+        // the texture has to outlive the streamer and must not move, indices follow the order of add()
+        auto add(texture_t& texture) noexcept -> uint32;
+        // "size" is the larger side in pixels the texture covers on screen, the finest request of a frame wins
+        auto request(uint32 index, float32 size) noexcept -> void;
+        auto update() noexcept -> void;
+
+        auto set_budget(uint64 budget) noexcept -> void;
+        auto stats() const noexcept -> texture_streamer_stats_t;
+
+        auto swap(self& other) noexcept -> void;
+
+    private:
+        struct _entry_t {
+            texture_t* texture = nullptr;
+            // finest level asked for this frame, the tail when nobody asked
+            uint32 requested = 0;
+            uint64 last_used = 0;
+        };
+
+        // drops least recently used textures until "size" more bytes fit, never touches "keep"
+        auto _make_room(uint64 size, uint32 keep) noexcept -> bool;
+        auto _resident_size(const _entry_t& entry) const noexcept -> uint64;
+
+        std::vector<_entry_t> _entries;
+        upload_queue_t* _queue = nullptr;
+        uint64 _budget = 0;
+        uint64 _upload_budget = 0;
+        uint64 _resident_bytes = 0;
+        // starts at 1 so textures nobody asked for yet are older than any request
+        uint64 _frame = 1;
+        texture_streamer_stats_t _stats = {};
+    };
+} // namespace iris
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <map>
+
+#include <utilities.hpp>
+
+#include <stb_image.h>
+
+// compares two runs of the same capture: timing CSVs written by --replay and frame dumps written by --dump-frames
+// usage: CompareRuns baseline.csv candidate.csv [--images baseline_dir candidate_dir] [--tolerance t] [--threshold p]
+
+using namespace iris::literals;
+
+struct timing_table_t {
+    std::vector<std::string> columns;
+    std::map<std::string, std::vector<iris::float32>> values;
+};
+
+struct timing_stats_t {
+    iris::float32 average = 0.0f;
+    iris::float32 p50 = 0.0f;
+    iris::float32 p99 = 0.0f;
+};
+
+struct image_diff_t {
+    bool is_comparable = false;
+    iris::uint32 max_difference = 0;
+    iris::uint64 differing_pixels = 0;
+    iris::float64 psnr = 0.0;
+};
+
+static auto load_timings(const iris::fs::path& path) noexcept -> timing_table_t {
+    auto table = timing_table_t();
+    auto file = std::ifstream(path);
+    auto line = std::string();
+    if (!std::getline(file, line)) {
+        return table;
+    }
+    auto header = std::istringstream(line);
+    auto column = std::string();
+    while (std::getline(header, column, ',')) {
+        table.columns.push_back(column);
+    }
+    while (std::getline(file, line)) {
+        auto row = std::istringstream(line);
+        auto cell = std::string();
+        for (auto i = 0_u32; i < table.columns.size() && std::getline(row, cell, ','); ++i) {
+            // frames without GPU results leave their cells empty
+            if (!cell.empty()) {
+                table.values[table.columns[i]].push_back(std::strtof(cell.c_str(), nullptr));
+            }
+        }
+    }
+    return table;
+}
+
+static auto make_stats(std::vector<iris::float32> values) noexcept -> timing_stats_t {
+    if (values.empty()) {
+        return {};
+    }
+    std::ranges::sort(values);
+    auto sum = 0.0;
+    for (const auto value : values) {
+        sum += value;
+    }
+    return {
+        .average = static_cast<iris::float32>(sum / values.size()),
+        .p50 = values[(values.size() - 1) / 2],
+        .p99 = values[static_cast<iris::uint64>(0.99f * (values.size() - 1))],
+    };
+}
+
+static auto compare_images(const iris::fs::path& a, const iris::fs::path& b, iris::uint32 tolerance) noexcept -> image_diff_t {
+    auto diff = image_diff_t();
+    auto a_width = 0_i32;
+    auto a_height = 0_i32;
+    auto b_width = 0_i32;
+    auto b_height = 0_i32;
+    auto channels = 0_i32;
+    auto* a_pixels = stbi_load(a.generic_string().c_str(), &a_width, &a_height, &channels, 4);
+    auto* b_pixels = stbi_load(b.generic_string().c_str(), &b_width, &b_height, &channels, 4);
+    iris_defer([&]() {
+        stbi_image_free(a_pixels);
+        stbi_image_free(b_pixels);
+    });
+    if (!a_pixels || !b_pixels || a_width != b_width || a_height != b_height) {
+        return diff;
+    }
+
+    diff.is_comparable = true;
+    auto squared_error = 0.0;
+    const auto pixels = static_cast<iris::uint64>(a_width) * a_height;
+    for (auto i = 0_u64; i < pixels; ++i) {
+        auto pixel_difference = 0_u32;
+        for (auto c = 0_u64; c < 4; ++c) {
+            const auto difference = static_cast<iris::uint32>(std::abs(a_pixels[i * 4 + c] - b_pixels[i * 4 + c]));
+            pixel_difference = std::max(pixel_difference, difference);
+            squared_error += difference * difference;
+        }
+        diff.max_difference = std::max(diff.max_difference, pixel_difference);
+        if (pixel_difference > tolerance) {
+            diff.differing_pixels++;
+        }
+    }
+    const auto mse = squared_error / (pixels * 4);
+    diff.psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<iris::float64>::infinity();
+    return diff;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        iris::log("usage: CompareRuns baseline.csv candidate.csv [--images baseline_dir candidate_dir] [--tolerance t] [--threshold p]");
+        return -1;
+    }
+    auto baseline_images = iris::fs::path();
+    auto candidate_images = iris::fs::path();
+    // largest per channel difference that still counts as identical, GPU atomics may reorder draws
+    auto tolerance = 2_u32;
+    // allowed slowdown of the average frame in percent
+    auto threshold = 5.0f;
+    for (auto i = 3_i32; i < argc; ++i) {
+        const auto argument = std::string(argv[i]);
+        if (argument == "--images" && i + 2 < argc) {
+            baseline_images = argv[++i];
+            candidate_images = argv[++i];
+        } else if (argument == "--tolerance" && i + 1 < argc) {
+            tolerance = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--threshold" && i + 1 < argc) {
+            threshold = std::strtof(argv[++i], nullptr);
+        } else {
+            iris::log("unknown option ", argument);
+            return -1;
+        }
+    }
+
+    const auto baseline = load_timings(argv[1]);
+    const auto candidate = load_timings(argv[2]);
+    if (baseline.columns.empty() || candidate.columns.empty()) {
+        iris::log("failed to read timings");
+        return -1;
+    }
+
+    auto is_regression = false;
+    std::printf("%-24s %12s %12s %12s %12s %9s\n", "column", "base avg", "cand avg", "base p99", "cand p99", "delta");
+    for (const auto& column : baseline.columns) {
+        if (column == "frame" || !candidate.values.contains(column) || !baseline.values.contains(column)) {
+            continue;
+        }
+        const auto a = make_stats(baseline.values.at(column));
+        const auto b = make_stats(candidate.values.at(column));
+        const auto delta = a.average > 0.0f ? (b.average - a.average) / a.average * 100.0f : 0.0f;
+        const auto is_total = column == "cpu_ms" || column == "gpu_ms";
+        if (is_total && delta > threshold) {
+            is_regression = true;
+        }
+        std::printf(
+            "%-24s %10.3fms %10.3fms %10.3fms %10.3fms %+8.2f%%%s\n",
+            column.c_str(), a.average, b.average, a.p99, b.p99, delta, is_total && delta > threshold ? " !" : "");
+    }
+
+    auto is_mismatch = false;
+    if (!baseline_images.empty()) {
+        auto frames = std::vector<iris::fs::path>();
+        auto error = std::error_code();
+        for (const auto& entry : iris::fs::directory_iterator(baseline_images, error)) {
+            if (entry.path().extension() == ".png") {
+                frames.push_back(entry.path().filename());
+            }
+        }
+        std::ranges::sort(frames);
+
+        auto worst_psnr = std::numeric_limits<iris::float64>::infinity();
+        auto mismatching_frames = 0_u32;
+        for (const auto& frame : frames) {
+            const auto diff = compare_images(baseline_images / frame, candidate_images / frame, tolerance);
+            if (!diff.is_comparable) {
+                iris::log(frame.generic_string(), ": missing or different size");
+                mismatching_frames++;
+                continue;
+            }
+            worst_psnr = std::min(worst_psnr, diff.psnr);
+            if (diff.differing_pixels) {
+                std::printf(
+                    "%s: %llu pixels differ, max difference %u, psnr %.2fdB\n",
+                    frame.generic_string().c_str(),
+                    static_cast<unsigned long long>(diff.differing_pixels),
+                    diff.max_difference,
+                    diff.psnr);
+                mismatching_frames++;
+            }
+        }
+        std::printf("%u of %zu frames differ, worst psnr %.2fdB\n", mismatching_frames, frames.size(), worst_psnr);
+        is_mismatch = mismatching_frames != 0;
+    }
+    return is_regression || is_mismatch ? 1 : 0;
+}
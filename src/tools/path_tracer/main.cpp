@@ -0,0 +1,212 @@
+#include <cstdlib>
+#include <cstdio>
+#include <optional>
+#include <vector>
+#include <string>
+#include <array>
+#include <cmath>
+
+#include <utilities.hpp>
+#include <cpu_path_tracer.hpp>
+#include <capture.hpp>
+#include <camera.hpp>
+
+#include <glm/glm.hpp>
+
+// renders the sphere scene of 4.2 on the CPU, as a reference image for trace.frag and as a benchmark
+// usage: PathTracer [--output path] [--width w] [--height h] [--samples n] [--bounces n] [--threads n] [--seed s]
+//                   [--position x y z --yaw degrees --pitch degrees] [--no-light-sampling] [--no-russian-roulette]
+//                   [--benchmark]
+// --benchmark measures noise against time instead of writing an image: every power of two up to --samples is
+// rendered with bounces alone and with light sampling and russian roulette, both are compared against a reference
+// of 16 times the samples
+
+using namespace iris::literals;
+
+static auto make_scene(
+    std::vector<iris::cpu_sphere_t>& spheres,
+    std::vector<iris::cpu_material_t>& materials
+) noexcept -> void {
+    using enum iris::cpu_material_type_t;
+    materials.push_back({ .type = lambertian, .albedo = glm::vec3(0.1, 0.2, 0.7) });
+    materials.push_back({ .type = lambertian, .albedo = glm::vec3(0.8, 0.8, 0.0) });
+    materials.push_back({ .type = lambertian, .albedo = glm::vec3(1.0) });
+    materials.push_back({ .type = lambertian, .albedo = glm::vec3(0.6, 0.2, 0.1) });
+    materials.push_back({ .type = lambertian, .albedo = glm::vec3(0.2, 0.8, 0.2) });
+    materials.push_back({ .type = lambertian, .albedo = glm::vec3(1.0f), .emissive = glm::vec3(1.0f), .e_strength = 4.0f });
+
+    spheres.push_back({ glm::vec3(0.0f, 0.0f, -1.0f), 0.5f, 0 });
+    spheres.push_back({ glm::vec3(0.0f, -100.5f, -1.0f), 100.0f, 1 });
+    spheres.push_back({ glm::vec3(-1.025, 0.0, -1.0125), 0.5f, 2 });
+    spheres.push_back({ glm::vec3(1.0125, 0.0, -1.035), 0.5f, 3 });
+    spheres.push_back({ glm::vec3(2.0625, 0.0, -1.035), 0.5f, 4 });
+    spheres.push_back({ glm::vec3(520.0, 35.0, 230.0), 400.0f, 5 });
+
+    // the same random sequence as 4.2, both scenes have to stay identical
+    iris::seed_random(42);
+    for (auto z = -22_i32; z < 22; ++z) {
+        for (auto x = -22_i32; x < 22; ++x) {
+            const auto center = glm::vec3(
+                x * 0.5f + iris::random(0.0f, 0.35f),
+                -0.4f,
+                z * 0.5f + iris::random(0.0f, 0.35f) - 1.0f);
+            if (glm::length(center - glm::vec3(0.5f, -0.4f, -1.0f)) < 2.2f) {
+                continue;
+            }
+            const auto material_id = static_cast<iris::uint32>(materials.size());
+            const auto choice = iris::random(0.0f, 1.0f);
+            if (choice < 0.7f) {
+                const auto r = iris::random(0.0f, 1.0f);
+                const auto g = iris::random(0.0f, 1.0f);
+                const auto b = iris::random(0.0f, 1.0f);
+                materials.push_back({ .type = lambertian, .albedo = glm::vec3(r, g, b) });
+            } else if (choice < 0.9f) {
+                materials.push_back({ .type = metal, .albedo = glm::vec3(iris::random(0.5f, 1.0f)) });
+            } else {
+                materials.push_back({ .type = dielectric, .refr_index = 1.5f });
+            }
+            spheres.push_back({ center, 0.1f, material_id });
+        }
+    }
+
+    // the small lights of 4.2
+    const auto add_light = [&](const glm::vec3& center, const glm::vec3& emissive) {
+        const auto material_id = static_cast<iris::uint32>(materials.size());
+        materials.push_back({ .type = lambertian, .albedo = glm::vec3(1.0f), .emissive = emissive, .e_strength = 30.0f });
+        spheres.push_back({ center, 0.05f, material_id });
+    };
+    add_light(glm::vec3(-0.5f, 0.6f, -0.6f), glm::vec3(1.0f, 0.6f, 0.3f));
+    add_light(glm::vec3(1.5f, 0.6f, -0.6f), glm::vec3(0.3f, 0.6f, 1.0f));
+    add_light(glm::vec3(0.5f, -0.4f, -0.3f), glm::vec3(1.0f));
+}
+
+// root mean square error of the radiance against the reference
+static auto rmse(const std::vector<glm::vec4>& image, const std::vector<glm::vec4>& reference) noexcept -> iris::float64 {
+    auto sum = 0.0;
+    for (auto i = 0_u64; i < image.size(); ++i) {
+        const auto difference = glm::vec3(image[i] - reference[i]);
+        sum += glm::dot(difference, difference) / 3.0;
+    }
+    return std::sqrt(sum / static_cast<iris::float64>(image.size()));
+}
+
+static auto benchmark(iris::cpu_path_tracer_t& tracer, const iris::cpu_render_options_t& options) noexcept -> void {
+    auto reference_options = options;
+    reference_options.samples = options.samples * 16;
+    reference_options.seed = options.seed + 1;
+    reference_options.is_light_sampling = true;
+    reference_options.is_russian_roulette = true;
+    const auto reference = tracer.render(reference_options);
+    std::printf(
+        "reference: %u spp in %.3f s\n"
+        "%8s | %24s | %24s | %s\n",
+        reference_options.samples, tracer.stats().seconds,
+        "spp", "bounces only: s, RMSE", "light sampling: s, RMSE", "efficiency");
+    for (auto samples = 1_u32; samples <= options.samples; samples *= 2) {
+        auto seconds = std::array<iris::float32, 2>();
+        auto errors = std::array<iris::float64, 2>();
+        for (auto i = 0_u32; i < 2; ++i) {
+            auto current = options;
+            current.samples = samples;
+            current.is_light_sampling = i == 1;
+            current.is_russian_roulette = i == 1;
+            errors[i] = rmse(tracer.render(current), reference);
+            seconds[i] = tracer.stats().seconds;
+        }
+        // inverse of error squared times time, how much faster the same noise is reached
+        const auto efficiency = (errors[0] * errors[0] * seconds[0]) / (errors[1] * errors[1] * seconds[1]);
+        std::printf(
+            "%8u | %10.3f s, %10.5f | %10.3f s, %10.5f | %.2fx\n",
+            samples, seconds[0], errors[0], seconds[1], errors[1], efficiency);
+    }
+}
+
+int main(int argc, char** argv) {
+    auto options = iris::cpu_render_options_t();
+    auto output = iris::fs::path("path_tracer.png");
+    auto position = std::optional<glm::vec3>();
+    auto yaw = 0.0f;
+    auto pitch = 0.0f;
+    auto is_benchmark = false;
+    for (auto i = 1_i32; i < argc; ++i) {
+        const auto argument = std::string(argv[i]);
+        if (argument == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argument == "--width" && i + 1 < argc) {
+            options.width = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--height" && i + 1 < argc) {
+            options.height = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--samples" && i + 1 < argc) {
+            options.samples = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--bounces" && i + 1 < argc) {
+            options.max_bounces = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--threads" && i + 1 < argc) {
+            options.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (argument == "--seed" && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argument == "--position" && i + 3 < argc) {
+            const auto x = std::strtof(argv[++i], nullptr);
+            const auto y = std::strtof(argv[++i], nullptr);
+            const auto z = std::strtof(argv[++i], nullptr);
+            position = glm::vec3(x, y, z);
+        } else if (argument == "--yaw" && i + 1 < argc) {
+            yaw = std::strtof(argv[++i], nullptr);
+        } else if (argument == "--pitch" && i + 1 < argc) {
+            pitch = std::strtof(argv[++i], nullptr);
+        } else if (argument == "--no-light-sampling") {
+            options.is_light_sampling = false;
+        } else if (argument == "--no-russian-roulette") {
+            options.is_russian_roulette = false;
+        } else if (argument == "--benchmark") {
+            is_benchmark = true;
+        } else {
+            iris::log("unknown option ", argument);
+            return -1;
+        }
+    }
+    if (options.width < 2 || options.height < 2 || options.samples == 0) {
+        iris::log("the image needs at least 2x2 pixels and one sample");
+        return -1;
+    }
+
+    auto spheres = std::vector<iris::cpu_sphere_t>();
+    auto materials = std::vector<iris::cpu_material_t>();
+    make_scene(spheres, materials);
+
+    // no window is opened, the camera only needs the aspect ratio
+    auto window = iris::window_t();
+    window.width = static_cast<iris::int32>(options.width);
+    window.height = static_cast<iris::int32>(options.height);
+    auto camera = iris::camera_t(window);
+    if (position) {
+        camera.set_view(*position, yaw, pitch);
+    }
+    options.inv_pv = glm::inverse(camera.projection() * camera.view());
+
+    auto tracer = iris::cpu_path_tracer_t::create(std::move(spheres), {}, std::move(materials));
+    if (is_benchmark) {
+        benchmark(tracer, options);
+        return 0;
+    }
+    const auto radiance = tracer.render(options);
+    const auto stats = tracer.stats();
+
+    auto pixels = std::vector<iris::uint8>(radiance.size() * 4);
+    for (auto i = 0_u64; i < radiance.size(); ++i) {
+        const auto color = glm::clamp(radiance[i], glm::vec4(0.0f), glm::vec4(1.0f));
+        pixels[i * 4 + 0] = static_cast<iris::uint8>(std::round(color.x * 255.0f));
+        pixels[i * 4 + 1] = static_cast<iris::uint8>(std::round(color.y * 255.0f));
+        pixels[i * 4 + 2] = static_cast<iris::uint8>(std::round(color.z * 255.0f));
+        pixels[i * 4 + 3] = 255;
+    }
+    if (!iris::save_frame_image(output, options.width, options.height, pixels)) {
+        iris::log("failed to write ", output.string());
+        return -1;
+    }
+    std::printf(
+        "%ux%u, %u spp on %u threads: %.3f s, %llu rays, %.2f Mrays/s\n",
+        options.width, options.height, options.samples, stats.threads, stats.seconds,
+        static_cast<unsigned long long>(stats.rays),
+        stats.seconds > 0.0f ? stats.rays / stats.seconds / 1e6f : 0.0f);
+    return 0;
+}
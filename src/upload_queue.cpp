@@ -0,0 +1,220 @@
+#include <cpu_profiler.hpp>
+#include <upload_queue.hpp>
+#include <gl_state.hpp>
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace iris {
+    // keeps every band offset valid for any texel type
+    constexpr static auto band_alignment = 16_u64;
+
+    upload_queue_t::upload_queue_t() noexcept = default;
+
+    upload_queue_t::~upload_queue_t() noexcept {
+        for (auto fence : _fences) {
+            if (fence) {
+                glDeleteSync(fence);
+            }
+        }
+    }
+
+    upload_queue_t::upload_queue_t(self&& other) noexcept {
+        swap(other);
+    }
+
+    auto upload_queue_t::operator =(self&& other) noexcept -> self& {
+        self(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    auto upload_queue_t::create(uint64 frame_budget, uint32 frames) noexcept -> self {
+        auto queue = self();
+        queue._frame_budget = (frame_budget + band_alignment - 1) / band_alignment * band_alignment;
+        queue._buffer = buffer_t::create(
+            queue._frame_budget * frames,
+            GL_PIXEL_UNPACK_BUFFER,
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT,
+            true);
+        queue._fences.resize(frames, nullptr);
+        return queue;
+    }
+
+    auto upload_queue_t::upload_compressed(
+        uint32 texture,
+        uint32 level,
+        uint32 width,
+        uint32 height,
+        uint32 format,
+        std::span<const uint8> data
+    ) noexcept -> uint64 {
+        const auto blocks_y = (height + 3) / 4;
+        return _enqueue({
+            .texture = texture,
+            .level = level,
+            .width = width,
+            .height = height,
+            .format = format,
+            .is_compressed = true,
+            .data = data,
+            .band_size = data.size() / blocks_y,
+            .band_height = 4,
+        });
+    }
+
+    auto upload_queue_t::upload(
+        uint32 texture,
+        uint32 level,
+        uint32 width,
+        uint32 height,
+        uint32 base_format,
+        uint32 type,
+        std::span<const uint8> data
+    ) noexcept -> uint64 {
+        // rows are read with the default unpack alignment of 4
+        assert((data.size() / height) % 4 == 0 && "rows have to be padded to 4 bytes");
+        return _enqueue({
+            .texture = texture,
+            .level = level,
+            .width = width,
+            .height = height,
+            .base_format = base_format,
+            .type = type,
+            .is_compressed = false,
+            .data = data,
+            .band_size = data.size() / height,
+            .band_height = 1,
+        });
+    }
+
+    auto upload_queue_t::cancel(uint32 texture) noexcept -> void {
+        std::erase_if(_jobs, [this, texture](const auto& job) {
+            if (job.texture != texture) {
+                return false;
+            }
+            _stats.pending_bytes -= job.data.size() - std::min<uint64>(job.row / job.band_height * job.band_size, job.data.size());
+            return true;
+        });
+        if (_jobs.empty()) {
+            _completed = _next_ticket - 1;
+        }
+        _stats.pending = _jobs.size();
+    }
+
+    auto upload_queue_t::update() noexcept -> void {
+        iris_cpu_zone("upload_queue_t::update");
+        _stats.uploaded_bytes = 0;
+        if (_jobs.empty()) {
+            return;
+        }
+
+        _frame = (_frame + 1) % _fences.size();
+        auto& fence = _fences[_frame];
+        if (fence) {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                _stats.stalls++;
+                while (true) {
+                    const auto status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+                    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED) {
+                        break;
+                    }
+                }
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        const auto region = _frame * _frame_budget;
+        auto* ring = static_cast<uint8*>(_buffer.mapped()) + region;
+        auto offset = 0_u64;
+        _buffer.bind();
+        while (!_jobs.empty()) {
+            auto& job = _jobs.front();
+            if (job.band_size > _frame_budget) {
+                // a single band never fits a region, the level goes straight from client memory in one go
+                const auto source = job.row / job.band_height * job.band_size;
+                const auto rows = job.height - job.row;
+                const auto size = job.data.size() - source;
+                gl_state::bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                if (job.is_compressed) {
+                    glCompressedTextureSubImage2D(job.texture, job.level, 0, job.row, job.width, rows, job.format, size, job.data.data() + source);
+                } else {
+                    glTextureSubImage2D(job.texture, job.level, 0, job.row, job.width, rows, job.base_format, job.type, job.data.data() + source);
+                }
+                _buffer.bind();
+                _stats.uploaded_bytes += size;
+                _stats.pending_bytes -= size;
+                _completed = job.ticket;
+                _jobs.pop_front();
+                continue;
+            }
+            const auto bands_left = (job.height - job.row + job.band_height - 1) / job.band_height;
+            const auto bands = std::min<uint64>(bands_left, (_frame_budget - offset) / job.band_size);
+            if (bands == 0) {
+                break;
+            }
+            const auto rows = std::min<uint32>(bands * job.band_height, job.height - job.row);
+            const auto source = job.row / job.band_height * job.band_size;
+            const auto size = std::min(bands * job.band_size, job.data.size() - source);
+            std::memcpy(ring + offset, job.data.data() + source, size);
+            const auto* pointer = reinterpret_cast<const void*>(region + offset);
+            if (job.is_compressed) {
+                glCompressedTextureSubImage2D(job.texture, job.level, 0, job.row, job.width, rows, job.format, size, pointer);
+            } else {
+                glTextureSubImage2D(job.texture, job.level, 0, job.row, job.width, rows, job.base_format, job.type, pointer);
+            }
+            offset = (offset + size + band_alignment - 1) / band_alignment * band_alignment;
+            _stats.uploaded_bytes += size;
+            _stats.pending_bytes -= size;
+            job.row += rows;
+            if (job.row == job.height) {
+                _completed = job.ticket;
+                _jobs.pop_front();
+            }
+        }
+        // everything else uploads from client memory
+        gl_state::bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        if (_jobs.empty()) {
+            _completed = _next_ticket - 1;
+        }
+        _stats.pending = _jobs.size();
+    }
+
+    auto upload_queue_t::is_complete(uint64 ticket) const noexcept -> bool {
+        return ticket <= _completed;
+    }
+
+    auto upload_queue_t::stats() const noexcept -> upload_queue_stats_t {
+        return _stats;
+    }
+
+    auto upload_queue_t::swap(self& other) noexcept -> void {
+        using std::swap;
+        swap(_buffer, other._buffer);
+        swap(_fences, other._fences);
+        swap(_jobs, other._jobs);
+        swap(_frame_budget, other._frame_budget);
+        swap(_frame, other._frame);
+        swap(_next_ticket, other._next_ticket);
+        swap(_completed, other._completed);
+        swap(_stats, other._stats);
+    }
+
+    auto upload_queue_t::_enqueue(_job_t job) noexcept -> uint64 {
+        job.ticket = _next_ticket++;
+        if (job.band_size > _frame_budget) {
+            iris::log(
+                "upload queue: a band of ", job.band_size, " bytes does not fit the ", _frame_budget,
+                " byte frame budget, texture ", job.texture, " level ", job.level, " uploads from client memory");
+        }
+        _stats.pending = _jobs.size() + 1;
+        _stats.pending_bytes += job.data.size();
+        _jobs.emplace_back(job);
+        return job.ticket;
+    }
+} // namespace iris
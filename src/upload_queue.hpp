@@ -0,0 +1,98 @@
+#pragma once
+
+#include <utilities.hpp>
+#include <buffer.hpp>
+
+#include <deque>
+#include <vector>
+#include <span>
+
+namespace iris {
+    struct upload_queue_stats_t {
+        uint32 pending = 0;
+        uint64 pending_bytes = 0;
+        // issued by the last update()
+        uint64 uploaded_bytes = 0;
+        // updates that had to wait for the GPU to release a ring region
+        uint32 stalls = 0;
+    };
+
+    // texel uploads go through a persistently mapped pixel unpack ring with one region of "frame_budget" bytes per
+    // frame in flight, a region is only reused after the fence of the update that last filled it has signaled.
+    // a level larger than what is left of the region is split in bands of rows (of blocks for compressed formats)
+    // and finishes over several frames, a level whose single band exceeds the region is uploaded from client memory
+    // instead when its turn comes. source data is read when its turn comes, it has to stay alive and
+    // unchanged until is_complete() returns true for its ticket or the upload is cancelled
+    class upload_queue_t {
+    public:
+        using self = upload_queue_t;
+
+        upload_queue_t() noexcept;
+        ~upload_queue_t() noexcept;
+
+        upload_queue_t(const self&) noexcept = delete;
+        auto operator =(const self&) noexcept -> self& = delete;
+        upload_queue_t(self&& other) noexcept;
+        auto operator =(self&& other) noexcept -> self&;
+
+        static auto create(uint64 frame_budget = 16_MiB, uint32 frames = 3) noexcept -> self;
+
+        // both return a ticket, "data" has to be tightly packed
+        auto upload_compressed(
+            uint32 texture,
+            uint32 level,
+            uint32 width,
+            uint32 height,
+            uint32 format,
+            std::span<const uint8> data) noexcept -> uint64;
+        auto upload(
+            uint32 texture,
+            uint32 level,
+            uint32 width,
+            uint32 height,
+            uint32 base_format,
+            uint32 type,
+            std::span<const uint8> data) noexcept -> uint64;
+        // drops everything still waiting to go into "texture", for textures deleted before their uploads finished
+        auto cancel(uint32 texture) noexcept -> void;
+
+        // copies and issues uploads until the region of this frame is full
+        auto update() noexcept -> void;
+        // the upload and every one queued before it were issued, GL commands from now on see the texels
+        auto is_complete(uint64 ticket) const noexcept -> bool;
+
+        auto stats() const noexcept -> upload_queue_stats_t;
+
+        auto swap(self& other) noexcept -> void;
+
+    private:
+        struct _job_t {
+            uint64 ticket = 0;
+            uint32 texture = 0;
+            uint32 level = 0;
+            uint32 width = 0;
+            uint32 height = 0;
+            uint32 format = 0;
+            uint32 base_format = 0;
+            uint32 type = 0;
+            bool is_compressed = false;
+            std::span<const uint8> data;
+            // bytes and texel rows of one band, a band is a row of 4x4 blocks for compressed formats
+            uint64 band_size = 0;
+            uint32 band_height = 1;
+            // texel rows already issued
+            uint32 row = 0;
+        };
+
+        auto _enqueue(_job_t job) noexcept -> uint64;
+
+        buffer_t _buffer;
+        std::vector<GLsync> _fences;
+        std::deque<_job_t> _jobs;
+        uint64 _frame_budget = 0;
+        uint32 _frame = 0;
+        uint64 _next_ticket = 1;
+        uint64 _completed = 0;
+        upload_queue_stats_t _stats = {};
+    };
+} // namespace iris
@@ -8,6 +8,7 @@
 #include <cassert>
 #include <random>
 #include <string>
+#include <string_view>
 
 namespace iris {
     namespace fs = std::filesystem;
@@ -55,6 +56,17 @@ namespace iris {
         return seed;
     }
 
+    // fnv-1a, stable across runs and standard libraries unlike std::hash, pass the previous result to chain
+    inline constexpr auto fnv1a_offset_basis = static_cast<uint64>(0xcbf29ce484222325);
+
+    inline auto hash_fnv1a(std::string_view bytes, uint64 hash = fnv1a_offset_basis) noexcept -> uint64 {
+        for (const auto c : bytes) {
+            hash ^= static_cast<uint8>(c);
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+
     inline auto whole_file(const fs::path& path) noexcept -> std::string {
         auto file = std::ifstream(path, std::ios::ate);
         auto result = std::string(file.tellg(), '\0');
@@ -63,13 +75,22 @@ namespace iris {
         return result;
     }
 
+    // shared by every random() instantiation so a single seed_random() makes all draws reproducible
+    inline auto random_engine() noexcept -> std::mt19937_64& {
+        static auto engine = std::mt19937_64(std::random_device()());
+        return engine;
+    }
+
+    inline auto seed_random(uint64 seed) noexcept -> void {
+        random_engine().seed(seed);
+    }
+
     template <typename T>
     auto random(T min, T max) noexcept -> T {
-        static auto engine = std::mt19937(std::random_device()());
         if constexpr (std::is_floating_point_v<T>) {
-            return std::uniform_real_distribution<T>(min, max)(engine);
+            return std::uniform_real_distribution<T>(min, max)(random_engine());
         } else {
-            return std::uniform_int_distribution<T>(min, max)(engine);
+            return std::uniform_int_distribution<T>(min, max)(random_engine());
         }
     }
 